@@ -0,0 +1,79 @@
+#include "binary.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+std::uint8_t BinaryReader::u8() {
+  return static_cast<std::uint8_t>(read(1));
+}
+
+std::uint32_t BinaryReader::u32() {
+  return static_cast<std::uint32_t>(read(4));
+}
+
+std::uint64_t BinaryReader::u64() {
+  return read(8);
+}
+
+double BinaryReader::f64() {
+  auto bits = read(8);
+  double value;
+  std::memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+std::uint32_t BinaryReader::count(std::size_t size) {
+  auto n = u32();
+  if (size > 0 && n > (data_.size() - position_) / size) {
+    throw std::invalid_argument{"Not enough data"};
+  }
+  return n;
+}
+
+std::uint64_t BinaryReader::read(std::size_t size) {
+  if (data_.size() - position_ < size) {
+    throw std::invalid_argument{"Not enough data"};
+  }
+  std::uint64_t value = 0;
+  for (std::size_t i = 0; i < size; ++i) {
+    value |= std::uint64_t{static_cast<unsigned char>(data_[position_ + i])} << (8 * i);
+  }
+  position_ += size;
+  return value;
+}
+
+BinaryWriter::BinaryWriter(std::string& buffer): buffer_{buffer} {
+  buffer_.clear();
+}
+
+void BinaryWriter::f64(double value) {
+  std::uint64_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  u64(bits);
+}
+
+void BinaryWriter::string(std::string_view text) {
+  auto size = std::min<std::size_t>(text.size(), std::numeric_limits<std::uint32_t>::max());
+  u32(static_cast<std::uint32_t>(size));
+  buffer_.append(text.data(), size);
+}
+
+std::size_t BinaryWriter::skip(std::size_t size) {
+  auto offset = buffer_.size();
+  buffer_.append(size, '\0');
+  return offset;
+}
+
+void BinaryWriter::write(std::uint64_t value, std::size_t size) {
+  for (std::size_t i = 0; i < size; ++i) {
+    buffer_ += static_cast<char>((value >> (8 * i)) & 0xFF);
+  }
+}
+
+void BinaryWriter::write(std::size_t offset, std::uint64_t value, std::size_t size) {
+  for (std::size_t i = 0; i < size; ++i) {
+    buffer_[offset + i] = static_cast<char>((value >> (8 * i)) & 0xFF);
+  }
+}
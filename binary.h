@@ -0,0 +1,95 @@
+#ifndef BINARY_H_
+#define BINARY_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+/**
+ * Reader of little-endian fixed-width values from a binary message.
+ * Reading past the end throws std::invalid_argument "Not enough data",
+ * like a missing field of a JSON request.
+ */
+class BinaryReader {
+public:
+  BinaryReader() = default;
+  explicit BinaryReader(std::string_view data): data_{data} {}
+
+  std::uint8_t u8();
+  std::uint32_t u32();
+  std::uint64_t u64();
+  double f64();
+
+  /**
+   * Reads number of elements of an array.
+   * @param size - size of one element in bytes.
+   * @return the number, it is checked against the rest of the message.
+   */
+  std::uint32_t count(std::size_t size);
+
+  /**
+   * Checks whether the whole message is read.
+   * @return true if nothing is left.
+   */
+  bool isEnd() const { return position_ == data_.size(); }
+
+private:
+  std::uint64_t read(std::size_t size);
+
+  std::string_view data_;
+  std::size_t position_{0};
+};
+
+/**
+ * Writer of little-endian fixed-width values into a buffer which is reused
+ * between responses.
+ */
+class BinaryWriter {
+public:
+  /**
+   * Creates writer, the buffer is cleared.
+   * @param buffer - the buffer.
+   */
+  explicit BinaryWriter(std::string& buffer);
+
+  void u8(std::uint8_t value) { write(value, 1); }
+  void u32(std::uint32_t value) { write(value, 4); }
+  void u64(std::uint64_t value) { write(value, 8); }
+  void f64(double value);
+
+  /**
+   * Writes length-prefixed bytes.
+   * @param text - the bytes.
+   */
+  void string(std::string_view text);
+
+  /**
+   * Reserves space for a value which is known later.
+   * @param size - size of the value in bytes.
+   * @return offset of the value.
+   */
+  std::size_t skip(std::size_t size);
+
+  void u32At(std::size_t offset, std::uint32_t value) { write(offset, value, 4); }
+  void u64At(std::size_t offset, std::uint64_t value) { write(offset, value, 8); }
+
+  /**
+   * Clears the buffer to write another message.
+   */
+  void reset() { buffer_.clear(); }
+
+  /**
+   * Gets the written bytes.
+   * @return the bytes.
+   */
+  std::string const& text() const { return buffer_; }
+
+private:
+  void write(std::uint64_t value, std::size_t size);
+  void write(std::size_t offset, std::uint64_t value, std::size_t size);
+
+  std::string& buffer_;
+};
+
+#endif /* BINARY_H_ */
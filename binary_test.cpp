@@ -0,0 +1,105 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+#include "binary.h"
+
+using ::testing::Eq;
+
+TEST(Binary, LittleEndian) {
+  std::string buffer;
+  BinaryWriter w{buffer};
+
+  w.u8(1);
+  w.u32(0x01020304);
+  w.u64(0x0102030405060708);
+
+  EXPECT_THAT(buffer, Eq(std::string{"\x01\x04\x03\x02\x01\x08\x07\x06\x05\x04\x03\x02\x01", 13}));
+}
+
+TEST(Binary, ReadWritten) {
+  std::string buffer;
+  BinaryWriter w{buffer};
+  w.u8(200);
+  w.u32(4000000000);
+  w.u64(std::numeric_limits<std::uint64_t>::max());
+  w.f64(-3.25);
+  w.f64(std::numeric_limits<double>::infinity());
+
+  BinaryReader r{buffer};
+
+  EXPECT_THAT(r.u8(), Eq(200));
+  EXPECT_THAT(r.u32(), Eq(4000000000));
+  EXPECT_THAT(r.u64(), Eq(std::numeric_limits<std::uint64_t>::max()));
+  EXPECT_THAT(r.f64(), Eq(-3.25));
+  EXPECT_THAT(r.f64(), Eq(std::numeric_limits<double>::infinity()));
+  EXPECT_TRUE(r.isEnd());
+}
+
+TEST(Binary, String) {
+  std::string buffer;
+  BinaryWriter w{buffer};
+
+  w.string("abc");
+
+  EXPECT_THAT(buffer, Eq(std::string{"\x03\0\0\0abc", 7}));
+}
+
+TEST(Binary, Patch) {
+  std::string buffer;
+  BinaryWriter w{buffer};
+  w.u8(0);
+  auto at = w.skip(8);
+  w.u8(9);
+
+  w.u64At(at, 5);
+
+  BinaryReader r{buffer};
+  r.u8();
+  EXPECT_THAT(r.u64(), Eq(5));
+  EXPECT_THAT(r.u8(), Eq(9));
+}
+
+TEST(Binary, ReadPastEnd) {
+  BinaryReader r{std::string_view{"\x01\x02\x03", 3}};
+
+  EXPECT_THROW(r.u32(), std::invalid_argument);
+  EXPECT_THAT(r.u8(), Eq(1));
+}
+
+TEST(Binary, CountOverRest) {
+  std::string buffer;
+  BinaryWriter w{buffer};
+  w.u32(2);
+  w.u64(1);
+
+  BinaryReader r{buffer};
+
+  EXPECT_THROW(r.count(8), std::invalid_argument);
+}
+
+TEST(Binary, Count) {
+  std::string buffer;
+  BinaryWriter w{buffer};
+  w.u32(2);
+  w.u64(1);
+  w.u64(2);
+
+  BinaryReader r{buffer};
+
+  EXPECT_THAT(r.count(8), Eq(2));
+}
+
+TEST(Binary, ResetWriter) {
+  std::string buffer{"old"};
+  BinaryWriter w{buffer};
+  w.u32(7);
+
+  w.reset();
+  w.u8(1);
+
+  EXPECT_THAT(buffer, Eq("\x01"));
+}
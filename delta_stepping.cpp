@@ -0,0 +1,230 @@
+#include "delta_stepping.h"
+
+#include <algorithm>
+#include <limits>
+#include <map>
+#include <stdexcept>
+#include <vector>
+
+#include "graph.h"
+
+namespace {
+constexpr auto kInfinity = std::numeric_limits<Distance>::infinity();
+constexpr auto kNone = std::numeric_limits<std::size_t>::max();
+constexpr auto kLastBucket = kNone - 1;
+
+/**
+ * State of one delta-stepping run.
+ */
+class Search {
+public:
+  Search(Graph const& graph, std::size_t threads, Distance delta);
+
+  /**
+   * Calculates distances from the source.
+   * Buckets are settled in order, every phase is run by all workers.
+   * @param workers - the workers, one per part.
+   * @param source - the source vertex.
+   */
+  void run(Workers& workers, Vertex const& source);
+
+  /**
+   * Makes tree of the reached vertexes.
+   * @param source - the source vertex.
+   * @param version - version of the graph.
+   * @return the tree.
+   */
+  Tree tree(Id source, std::size_t version) const;
+
+  /**
+   * Sums work of all workers.
+   * @return the work.
+   */
+  SearchContext::Counters counters() const;
+
+private:
+  struct Request {
+    std::size_t vertex;  // slots of the vertexes
+    Distance distance;
+    std::size_t previous;
+  };
+
+  /**
+   * Vertexes owned by one worker, they are kept by slot.
+   */
+  struct Part {
+    std::map<std::size_t, std::vector<std::size_t>> buckets;
+    std::vector<std::size_t> frontier;
+    std::vector<std::size_t> settled;  // vertexes of the current bucket
+    std::vector<std::vector<Request>> outbox;  // requests by owner
+    SearchContext::Counters counters;  // work of the owner
+  };
+
+  std::size_t owner(std::size_t v) const { return v % parts_.size(); }
+  std::size_t bucket(Distance d) const;
+  void expand(Part& part, std::size_t i);
+  void expandHeavy(Part& part, std::size_t i);
+  void deliver(std::size_t t);
+  void relax(Part& part, Request const& r);
+  bool has(std::size_t i) const;
+  std::size_t first() const;
+
+  Distance delta_;
+  std::vector<Vertex const*> vertexes_;  // by slot
+  std::vector<Distance> distance_;
+  std::vector<std::size_t> previous_;
+  std::vector<Distance> expanded_;  // distance when light edges were relaxed
+  std::vector<Distance> heavy_;  // distance when heavy edges were relaxed
+  std::vector<Part> parts_;
+};
+
+Search::Search(Graph const& graph, std::size_t threads, Distance delta)
+  : delta_{delta}, parts_(threads) {
+  auto const n = graph.slots();
+  vertexes_.assign(n, nullptr);
+  std::size_t edges = 0;
+  Distance total = 0;
+  for (auto const& p: graph.vertexes()) {
+    vertexes_[p.second.slot] = &p.second;
+    if (delta_ == 0) {
+      edges += p.second.neighbors.size();
+      for (auto const& e: p.second.neighbors) total += e.second;
+    }
+  }
+  if (delta_ == 0 && edges > 0) delta_ = total / edges;
+  if (delta_ == 0) delta_ = 1;
+  distance_.assign(n, kInfinity);
+  previous_.assign(n, 0);
+  expanded_.assign(n, -1);
+  heavy_.assign(n, -1);
+  for (auto& part: parts_) part.outbox.resize(threads);
+}
+
+void Search::run(Workers& workers, Vertex const& source) {
+  relax(parts_[owner(source.slot)], {source.slot, 0, source.slot});
+  Workers::Task deliver = [this](std::size_t t) { this->deliver(t); };
+  for (auto i = first(); i != kNone; i = first()) {
+    Workers::Task light = [this, i](std::size_t t) { expand(parts_[t], i); };
+    Workers::Task heavy = [this, i](std::size_t t) { expandHeavy(parts_[t], i); };
+    do {
+      workers.run(light);
+      workers.run(deliver);
+    } while (has(i));
+    workers.run(heavy);
+    workers.run(deliver);
+  }
+}
+
+void Search::expand(Part& part, std::size_t i) {
+  auto it = part.buckets.find(i);
+  if (it == end(part.buckets)) return;
+  part.frontier.swap(it->second);
+  part.buckets.erase(it);
+  for (auto v: part.frontier) {
+    auto d = distance_[v];
+    if (bucket(d) != i || expanded_[v] == d) continue;
+    expanded_[v] = d;
+    part.settled.push_back(v);
+    ++part.counters.settled;
+    ++part.counters.heap;
+    part.counters.scanned += vertexes_[v]->neighbors.size();
+    vertexes_[v]->neighbors.forEach([&](Vertex const* w, Distance weight) {
+      if (weight <= delta_) {
+        part.outbox[owner(w->slot)].push_back({w->slot, d + weight, v});
+      }
+    });
+  }
+  part.frontier.clear();
+}
+
+void Search::expandHeavy(Part& part, std::size_t i) {
+  for (auto v: part.settled) {
+    // distances of the last bucket may still decrease, so they are relaxed again
+    auto d = distance_[v];
+    if (heavy_[v] == d) continue;
+    heavy_[v] = d;
+    part.counters.scanned += vertexes_[v]->neighbors.size();
+    vertexes_[v]->neighbors.forEach([&](Vertex const* w, Distance weight) {
+      if (weight > delta_) {
+        part.outbox[owner(w->slot)].push_back({w->slot, d + weight, v});
+      }
+    });
+  }
+  part.settled.clear();
+}
+
+void Search::deliver(std::size_t t) {
+  auto& part = parts_[t];
+  for (auto& sender: parts_) {
+    auto& requests = sender.outbox[t];
+    for (auto const& r: requests) relax(part, r);
+    requests.clear();
+  }
+}
+
+void Search::relax(Part& part, Request const& r) {
+  if (r.distance < distance_[r.vertex]) {
+    distance_[r.vertex] = r.distance;
+    previous_[r.vertex] = r.previous;
+    part.buckets[bucket(r.distance)].push_back(r.vertex);
+    ++part.counters.relaxed;
+    ++part.counters.heap;
+  }
+}
+
+std::size_t Search::bucket(Distance d) const {
+  // the ratio is not converted beyond the range, such distances share the last bucket
+  auto const i = d / delta_;
+  return i < static_cast<Distance>(kLastBucket) ? static_cast<std::size_t>(i) : kLastBucket;
+}
+
+bool Search::has(std::size_t i) const {
+  return std::any_of(begin(parts_), end(parts_),
+      [i](Part const& p) { return p.buckets.count(i) > 0; });
+}
+
+std::size_t Search::first() const {
+  auto result = kNone;
+  for (auto const& p: parts_) {
+    if (!p.buckets.empty()) result = std::min(result, begin(p.buckets)->first);
+  }
+  return result;
+}
+
+SearchContext::Counters Search::counters() const {
+  SearchContext::Counters sum;
+  for (auto const& part: parts_) sum += part.counters;
+  return sum;
+}
+
+Tree Search::tree(Id source, std::size_t version) const {
+  Tree t{source, version, kInfinity, {}};
+  t.steps.reserve(vertexes_.size());
+  for (std::size_t v = 0; v < vertexes_.size(); ++v) {
+    if (distance_[v] != kInfinity) {
+      t.steps.emplace(vertexes_[v]->id, Tree::Step{distance_[v], vertexes_[previous_[v]]->id});
+    }
+  }
+  return t;
+}
+}  // namespace
+
+DeltaStepping::DeltaStepping(Workers& workers, Distance delta)
+  : workers_{workers}, delta_{delta} {}
+
+Tree DeltaStepping::tree(Graph const& graph, Id source) {
+  SearchContext::Counters counters;
+  return tree(graph, source, counters);
+}
+
+Tree DeltaStepping::tree(Graph const& graph, Id source, SearchContext::Counters& counters) {
+  auto const& vertexes = graph.vertexes();
+  auto it = vertexes.find(source);
+  if (it == end(vertexes)) {
+    throw std::invalid_argument{"Wrong vertex ID"};
+  }
+  Search search{graph, workers_.size(), delta_};
+  search.run(workers_, it->second);
+  counters += search.counters();
+  return search.tree(source, graph.version());
+}
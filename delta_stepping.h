@@ -0,0 +1,59 @@
+#ifndef DELTA_STEPPING_H_
+#define DELTA_STEPPING_H_
+
+#include <cstddef>
+
+#include "search_context.h"
+#include "tree_cache.h"
+#include "types.h"
+#include "workers.h"
+
+class Graph;
+
+/**
+ * Parallel one-to-all shortest paths by delta-stepping.
+ * Tentative distances are sorted into buckets of width delta. Vertexes of
+ * the smallest bucket are settled together: edges not longer than delta are
+ * relaxed again and again until the bucket stays empty, then longer edges
+ * are relaxed once. Every vertex is owned by one worker which applies all
+ * relaxations of it, so distances and previous vertexes need no locks.
+ */
+class DeltaStepping {
+public:
+  /**
+   * Creates engine.
+   * @param workers - the workers which run every phase.
+   * @param delta - width of bucket, zero means average weight of edges.
+   */
+  explicit DeltaStepping(Workers& workers, Distance delta = 0);
+
+  /**
+   * Calculates shortest path tree of every reachable vertex.
+   * @param graph - the graph.
+   * @param source - the source vertex.
+   * @return complete tree of the current version of the graph.
+   */
+  Tree tree(Graph const& graph, Id source);
+
+  /**
+   * Calculates shortest path tree and counts work of all workers.
+   * A vertex is counted as settled every time its edges are expanded.
+   * @param graph - the graph.
+   * @param source - the source vertex.
+   * @param counters - the counters which the work is added to.
+   * @return complete tree of the current version of the graph.
+   */
+  Tree tree(Graph const& graph, Id source, SearchContext::Counters& counters);
+
+  /**
+   * Gets number of threads.
+   * @return the number of threads.
+   */
+  std::size_t threads() const { return workers_.size(); }
+
+private:
+  Workers& workers_;
+  Distance delta_;
+};
+
+#endif /* DELTA_STEPPING_H_ */
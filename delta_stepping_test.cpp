@@ -0,0 +1,140 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <random>
+
+#include "delta_stepping.h"
+#include "graph.h"
+
+using ::testing::Eq;
+using ::testing::DoubleEq;
+using ::testing::Lt;
+using ::testing::ContainerEq;
+using ::testing::SizeIs;
+
+namespace {
+Graph example() {
+  Graph g;
+  g.addVertex(); g.addVertex(); g.addVertex(); g.addVertex();
+  g.addVertex(); g.addVertex();
+  g.setEdge(0, 1, 7); g.setEdge(0, 2, 9); g.setEdge(0, 5, 14);
+  g.setEdge(1, 0, 7); g.setEdge(1, 2, 10); g.setEdge(1, 3, 15);
+  g.setEdge(2, 0, 9); g.setEdge(2, 1, 10); g.setEdge(2, 5, 2);
+  g.setEdge(3, 1, 15); g.setEdge(3, 2, 11); g.setEdge(3, 4, 6);
+  g.setEdge(4, 3, 6); g.setEdge(4, 5, 9);
+  g.setEdge(5, 0, 14); g.setEdge(5, 2, 2); g.setEdge(5, 4, 9);
+  return g;
+}
+
+Graph random(std::mt19937& random, Id size, int edges) {
+  std::uniform_int_distribution<Id> vertex{0, size - 1};
+  std::uniform_real_distribution<Distance> weight{0, 10};
+  Graph g;
+  for (Id i = 0; i < size; ++i) g.addVertex();
+  for (auto i = 0; i < edges; ++i) g.setEdge(vertex(random), vertex(random), weight(random));
+  return g;
+}
+}  // namespace
+
+TEST(DeltaStepping, Tree) {
+  auto g = example();
+  Workers w{2};
+  DeltaStepping d{w};
+
+  auto t = d.tree(g, 0);
+
+  EXPECT_TRUE(t.isComplete());
+  EXPECT_THAT(t.version, Eq(g.version()));
+  EXPECT_THAT(t.steps, SizeIs(6));
+  EXPECT_THAT(t.steps.at(4).distance, DoubleEq(20));
+  EXPECT_THAT(t.path(4), ContainerEq(std::list<Id>{0, 2, 5, 4}));
+}
+
+TEST(DeltaStepping, SkipUnreachable) {
+  Graph g;
+  g.addVertex(); g.addVertex(); g.addVertex();
+  g.setEdge(0, 1, 1); g.setEdge(2, 1, 1);
+  Workers w{3};
+  DeltaStepping d{w};
+
+  auto t = d.tree(g, 0);
+
+  EXPECT_THAT(t.steps, SizeIs(2));
+  EXPECT_THAT(t.path(2), ContainerEq(std::list<Id>{2}));
+}
+
+TEST(DeltaStepping, ZeroWeights) {
+  Graph g;
+  g.addVertex(); g.addVertex(); g.addVertex();
+  g.setEdge(0, 1, 0); g.setEdge(1, 2, 0); g.setEdge(2, 1, 0);
+  Workers w{2};
+  DeltaStepping d{w};
+
+  auto t = d.tree(g, 0);
+
+  EXPECT_THAT(t.path(2), ContainerEq(std::list<Id>{0, 1, 2}));
+}
+
+TEST(DeltaStepping, WrongId) {
+  auto g = example();
+  Workers w{2};
+  DeltaStepping d{w};
+
+  EXPECT_THROW(d.tree(g, 6), std::invalid_argument);
+}
+
+TEST(DeltaStepping, SameAsDijkstra) {
+  std::mt19937 r{13};
+  auto g = random(r, 200, 800);
+  g.removeVertex(7);
+
+  for (std::size_t threads = 1; threads <= 4; ++threads) {
+    for (Distance delta: {0.0, 0.5, 100.0}) {
+      Workers w{threads};
+      DeltaStepping d{w, delta};
+      for (Id from = 0; from < 200; from += 17) {
+        auto t = d.tree(g, from);
+        auto expected = g.distances(from);
+        ASSERT_THAT(t.steps.size(), Eq(expected.steps.size()));
+        for (auto const& [id, step]: expected.steps) {
+          ASSERT_THAT(t.steps.at(id).distance, DoubleEq(step.distance));
+          ASSERT_THAT(t.path(id), ContainerEq(expected.path(id)));
+        }
+      }
+    }
+  }
+}
+
+TEST(DeltaStepping, CompactedSlots) {
+  std::mt19937 r{17};
+  auto g = random(r, 100, 400);
+  for (Id id = 0; id < 100; ++id) {
+    if (id % 4 != 0) g.removeVertex(id);
+  }
+  ASSERT_THAT(g.slots(), Lt(g.nextId()));
+  Workers w{3};
+  DeltaStepping d{w};
+
+  for (Id from = 0; from < 100; from += 12) {
+    auto t = d.tree(g, from);
+    auto expected = g.distances(from);
+    ASSERT_THAT(t.steps.size(), Eq(expected.steps.size()));
+    for (auto const& [id, step]: expected.steps) {
+      ASSERT_THAT(t.path(id), ContainerEq(expected.path(id)));
+    }
+  }
+}
+
+TEST(DeltaStepping, DistancesBeyondBuckets) {
+  Graph g;
+  g.addVertex(); g.addVertex(); g.addVertex(); g.addVertex();
+  g.setEdge(0, 1, 3e300); g.setEdge(0, 2, 1e300); g.setEdge(2, 1, 1e300);
+  g.setEdge(1, 3, 1e300);
+  Workers w{2};
+  DeltaStepping d{w, 1e-300};
+
+  auto t = d.tree(g, 0);
+
+  EXPECT_THAT(t.steps.at(3).distance, DoubleEq(3e300));
+  EXPECT_THAT(t.path(3), ContainerEq(std::list<Id>{0, 2, 1, 3}));
+}
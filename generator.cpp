@@ -0,0 +1,168 @@
+#include "generator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+namespace {
+constexpr std::size_t kHighway = 16;  // every 16th row and column of a road graph is a highway
+constexpr double kStreet = 0.7;  // share of streets which are kept
+constexpr double kSpeed = 0.25;  // time of a highway relatively to a street
+constexpr double kPi = 3.14159265358979323846;
+
+/**
+ * Adds edge in both directions.
+ */
+void join(std::vector<Mutation::Edge>& edges, Id a, Id b, Distance weight) {
+  edges.push_back({a, b, weight});
+  edges.push_back({b, a, weight});
+}
+
+std::size_t width(std::size_t vertexes) {
+  return std::max<std::size_t>(1, std::llround(std::sqrt(static_cast<double>(vertexes))));
+}
+}  // namespace
+
+std::vector<Mutation::Edge> Generator::edges(Kind kind, std::size_t vertexes, std::uint64_t seed) {
+  switch (kind) {
+    case Kind::kGrid: return grid(vertexes);
+    case Kind::kGeometric: return geometric(vertexes, seed);
+    case Kind::kScaleFree: return scaleFree(vertexes, seed);
+    case Kind::kRoad: return road(vertexes, seed);
+  }
+  return {};
+}
+
+Graph Generator::graph(Kind kind, std::size_t vertexes, std::uint64_t seed) {
+  Graph g;
+  g.apply({
+    Mutation{Mutation::Type::kAddVertices, vertexes, {}, {}},
+    Mutation{Mutation::Type::kAddEdges, 0, edges(kind, vertexes, seed), {}}
+  });
+  return g;
+}
+
+std::string_view Generator::name(Kind kind) {
+  switch (kind) {
+    case Kind::kGrid: return "grid";
+    case Kind::kGeometric: return "geometric";
+    case Kind::kScaleFree: return "scale-free";
+    case Kind::kRoad: return "road";
+  }
+  return "";
+}
+
+std::vector<Mutation::Edge> Generator::grid(std::size_t vertexes) {
+  auto const side = width(vertexes);
+  std::vector<Mutation::Edge> edges;
+  edges.reserve(4 * vertexes);
+  for (Id v = 0; v < vertexes; ++v) {
+    auto weight = 1.0 + (v * 7919) % 10;
+    if (v % side + 1 < side && v + 1 < vertexes) join(edges, v, v + 1, weight);
+    if (v + side < vertexes) join(edges, v, v + side, weight);
+  }
+  return edges;
+}
+
+std::vector<Mutation::Edge> Generator::geometric(std::size_t vertexes, std::uint64_t seed) {
+  std::mt19937_64 random{seed};
+  std::uniform_real_distribution<double> coordinate{0, 1};
+  std::vector<std::pair<double, double>> points(vertexes);
+  for (auto& [x, y]: points) {
+    x = coordinate(random);
+    y = coordinate(random);
+  }
+  // points within the radius are in the same or adjacent cells
+  auto const radius = std::sqrt(kDegree / (kPi * std::max<std::size_t>(vertexes, 1)));
+  auto const cells = std::max<std::size_t>(1, static_cast<std::size_t>(1 / radius));
+  auto cell = [cells](double coordinate) {
+    return std::min(cells - 1, static_cast<std::size_t>(coordinate * cells));
+  };
+  std::vector<std::size_t> starts(cells * cells + 1);
+  for (auto const& [x, y]: points) ++starts[cell(y) * cells + cell(x) + 1];
+  for (std::size_t i = 1; i < starts.size(); ++i) starts[i] += starts[i - 1];
+  std::vector<Id> order(vertexes);
+  auto next = starts;
+  for (Id v = 0; v < vertexes; ++v) {
+    order[next[cell(points[v].second) * cells + cell(points[v].first)]++] = v;
+  }
+
+  auto const scale = std::sqrt(static_cast<double>(vertexes));  // a mean edge is about 1
+  std::vector<Mutation::Edge> edges;
+  edges.reserve(kDegree * vertexes + kDegree);
+  for (Id v = 0; v < vertexes; ++v) {
+    auto const [x, y] = points[v];
+    auto const cx = cell(x);
+    auto const cy = cell(y);
+    for (auto row = cy > 0 ? cy - 1 : 0; row <= std::min(cy + 1, cells - 1); ++row) {
+      for (auto col = cx > 0 ? cx - 1 : 0; col <= std::min(cx + 1, cells - 1); ++col) {
+        auto const c = row * cells + col;
+        for (auto i = starts[c]; i < starts[c + 1]; ++i) {
+          auto const u = order[i];
+          if (u <= v) continue;
+          auto const distance = std::hypot(points[u].first - x, points[u].second - y);
+          if (distance <= radius) join(edges, v, u, distance * scale);
+        }
+      }
+    }
+  }
+  return edges;
+}
+
+std::vector<Mutation::Edge> Generator::scaleFree(std::size_t vertexes, std::uint64_t seed) {
+  std::mt19937_64 random{seed};
+  std::uniform_int_distribution<int> weight{1, 100};
+  constexpr std::size_t kLinks = kDegree / 2;  // links of a new vertex
+  std::vector<Mutation::Edge> edges;
+  edges.reserve(kDegree * vertexes);
+  std::vector<Id> ends;  // a vertex is in it once per link, so it is picked by degree
+  ends.reserve(kDegree * vertexes);
+  auto const core = std::min(vertexes, kLinks + 1);
+  for (Id v = 0; v < core; ++v) {
+    for (Id u = 0; u < v; ++u) {
+      join(edges, u, v, weight(random));
+      ends.push_back(u);
+      ends.push_back(v);
+    }
+  }
+  std::vector<Id> targets;
+  for (Id v = core; v < vertexes; ++v) {
+    targets.clear();
+    while (targets.size() < kLinks) {
+      auto t = ends[std::uniform_int_distribution<std::size_t>{0, ends.size() - 1}(random)];
+      if (std::find(begin(targets), end(targets), t) == end(targets)) targets.push_back(t);
+    }
+    for (auto t: targets) {
+      join(edges, v, t, weight(random));
+      ends.push_back(v);
+      ends.push_back(t);
+    }
+  }
+  return edges;
+}
+
+std::vector<Mutation::Edge> Generator::road(std::size_t vertexes, std::uint64_t seed) {
+  std::mt19937_64 random{seed};
+  std::uniform_real_distribution<double> length{1, 3};
+  std::bernoulli_distribution street{kStreet};
+  auto const side = width(vertexes);
+  std::vector<Mutation::Edge> edges;
+  edges.reserve(4 * vertexes);
+  for (Id v = 0; v < vertexes; ++v) {
+    auto const row = v / side;
+    auto const col = v % side;
+    if (col + 1 < side && v + 1 < vertexes) {
+      auto const highway = row % kHighway == 0;
+      if (highway || street(random)) {
+        join(edges, v, v + 1, length(random) * (highway ? kSpeed : 1));
+      }
+    }
+    if (v + side < vertexes) {
+      auto const highway = col % kHighway == 0;
+      if (highway || street(random)) {
+        join(edges, v, v + side, length(random) * (highway ? kSpeed : 1));
+      }
+    }
+  }
+  return edges;
+}
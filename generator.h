@@ -0,0 +1,61 @@
+#ifndef GENERATOR_H_
+#define GENERATOR_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "graph.h"
+
+/**
+ * Generator of synthetic graphs of any size for benchmarks.
+ * A graph of the same kind, size and seed is always the same. IDs of
+ * vertexes are 0 to size - 1 and every edge is added in both directions.
+ */
+class Generator {
+public:
+  enum class Kind {
+    kGrid,  // square grid with four neighbours and weights from 1 to 10
+    kGeometric,  // random points in a square joined to the nearby ones by their distance
+    kScaleFree,  // preferential attachment, a few hubs and a heavy tail of degrees
+    kRoad  // sparse grid of streets with gaps, crossed by fast highways
+  };
+
+  static constexpr std::uint64_t kSeed = 20240601;
+  static constexpr std::size_t kDegree = 6;  // mean degree of geometric and scale-free graphs
+
+  /**
+   * Generates edges of a graph.
+   * @param kind - kind of the graph.
+   * @param vertexes - number of vertexes.
+   * @param seed - seed of random numbers.
+   * @return the edges, each one is followed by the reversed one.
+   */
+  static std::vector<Mutation::Edge> edges(Kind kind, std::size_t vertexes,
+                                           std::uint64_t seed = kSeed);
+
+  /**
+   * Generates graph.
+   * @param kind - kind of the graph.
+   * @param vertexes - number of vertexes.
+   * @param seed - seed of random numbers.
+   * @return the graph.
+   */
+  static Graph graph(Kind kind, std::size_t vertexes, std::uint64_t seed = kSeed);
+
+  /**
+   * Gets name of a kind.
+   * @param kind - the kind.
+   * @return grid, geometric, scale-free or road.
+   */
+  static std::string_view name(Kind kind);
+
+private:
+  static std::vector<Mutation::Edge> grid(std::size_t vertexes);
+  static std::vector<Mutation::Edge> geometric(std::size_t vertexes, std::uint64_t seed);
+  static std::vector<Mutation::Edge> scaleFree(std::size_t vertexes, std::uint64_t seed);
+  static std::vector<Mutation::Edge> road(std::size_t vertexes, std::uint64_t seed);
+};
+
+#endif /* GENERATOR_H_ */
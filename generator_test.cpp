@@ -0,0 +1,94 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <set>
+#include <tuple>
+#include <vector>
+
+#include "generator.h"
+#include "graph.h"
+
+using ::testing::AllOf;
+using ::testing::Each;
+using ::testing::Eq;
+using ::testing::Ge;
+using ::testing::Gt;
+using ::testing::Le;
+using ::testing::Lt;
+using ::testing::SizeIs;
+
+namespace {
+constexpr Generator::Kind kKinds[] = {
+  Generator::Kind::kGrid, Generator::Kind::kGeometric,
+  Generator::Kind::kScaleFree, Generator::Kind::kRoad
+};
+
+std::size_t edges(Graph const& g) {
+  std::size_t edges = 0;
+  for (auto const& p: g.vertexes()) edges += p.second.neighbors.size();
+  return edges;
+}
+}  // namespace
+
+TEST(Generator, Grid) {
+  auto g = Generator::graph(Generator::Kind::kGrid, 12);
+
+  EXPECT_THAT(g.vertexes(), SizeIs(12));
+  EXPECT_THAT(edges(g), Eq(2 * (3 * 3 + 2 * 4)));
+  EXPECT_THAT(g.distances(0).steps, SizeIs(12));
+}
+
+TEST(Generator, SameSeedSameGraph) {
+  for (auto kind: kKinds) {
+    auto a = Generator::edges(kind, 500, 1);
+    auto b = Generator::edges(kind, 500, 1);
+
+    ASSERT_THAT(a.size(), Eq(b.size())) << Generator::name(kind);
+    for (std::size_t i = 0; i < a.size(); ++i) {
+      EXPECT_THAT(std::tie(a[i].from, a[i].to, a[i].weight),
+          Eq(std::tie(b[i].from, b[i].to, b[i].weight)));
+    }
+  }
+}
+
+TEST(Generator, EdgesInBothDirections) {
+  for (auto kind: kKinds) {
+    auto e = Generator::edges(kind, 1000);
+    std::set<std::pair<Id, Id>> pairs;
+    for (auto const& edge: e) {
+      EXPECT_THAT(edge.from, Lt(1000));
+      EXPECT_THAT(edge.to, Lt(1000));
+      EXPECT_THAT(edge.weight, Gt(0));
+      pairs.emplace(edge.from, edge.to);
+    }
+
+    EXPECT_THAT(pairs, SizeIs(e.size())) << Generator::name(kind);
+    for (auto [from, to]: pairs) EXPECT_TRUE(pairs.count({to, from}));
+  }
+}
+
+TEST(Generator, MeanDegree) {
+  auto const vertexes = 10000;
+
+  EXPECT_THAT(Generator::edges(Generator::Kind::kGeometric, vertexes).size() / vertexes,
+      AllOf(Ge(Generator::kDegree - 1), Le(Generator::kDegree)));
+  EXPECT_THAT(Generator::edges(Generator::Kind::kScaleFree, vertexes).size() / vertexes,
+      Eq(Generator::kDegree - 1));
+  EXPECT_THAT(Generator::edges(Generator::Kind::kRoad, vertexes).size() / vertexes, Eq(2));
+}
+
+TEST(Generator, ScaleFreeHasHubs) {
+  auto g = Generator::graph(Generator::Kind::kScaleFree, 10000);
+  std::vector<std::size_t> degrees;
+  for (auto const& p: g.vertexes()) degrees.push_back(p.second.neighbors.size());
+
+  EXPECT_THAT(degrees, Each(Ge(Generator::kDegree / 2)));
+  EXPECT_THAT(*std::max_element(begin(degrees), end(degrees)), Gt(100));
+}
+
+TEST(Generator, Names) {
+  EXPECT_THAT(Generator::name(Generator::Kind::kScaleFree), Eq("scale-free"));
+  EXPECT_THAT(Generator::name(Generator::Kind::kRoad), Eq("road"));
+}
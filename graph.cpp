@@ -1,109 +1,771 @@
 #include "graph.h"
 
 #include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <functional>
 #include <iterator>
+#include <limits>
+#include <queue>
+#include <stdexcept>
+#include <unordered_set>
+#include <utility>
+#include <vector>
 
-bool Graph::LessDistance::operator()(Vertex const* lhs, Vertex const* rhs) const {
-  return (lhs->info.distance < rhs->info.distance)
-      || (lhs->info.distance == rhs->info.distance && lhs->id < rhs->id);
+#include "snapshot.h"
+
+namespace {
+using Item = std::pair<Distance, Vertex const*>;
+using Queue = std::priority_queue<Item, std::vector<Item>, std::greater<>>;
+
+/**
+ * Number of hierarchies and landmarks which were built or updated, it
+ * orders the builds of the same version on different snapshots.
+ */
+std::atomic<std::size_t> builds{0};
+
+/**
+ * Sets new distance to the vertex in the tree if it is shorter.
+ * The vertex out of the tree is added only if the distance does not exceed
+ * the bound of the tree, otherwise closer vertexes could be missed.
+ * @param t - the tree.
+ * @param v - the vertex.
+ * @param distance - new distance.
+ * @param previous - the vertex which the distance goes through.
+ * @return true if the distance was set.
+ */
+bool relax(Tree& t, Vertex const& v, Distance distance, Id previous) {
+  if (distance > t.bound) return false;
+  auto it = t.steps.find(v.id);
+  if (it != end(t.steps) && it->second.distance <= distance) return false;
+  t.steps[v.id] = {distance, previous};
+  return true;
 }
+}  // namespace
 
-void Vertex::setDistance(Vertex const& a) {
-  if (info.visited) return;
-  auto d = a.info.distance + a.neighbors.at(this);
-  if (d < info.distance) {
-    info.distance = d;
-    info.previous = &a;
+Distance Edges::at(Vertex const* v) const {
+  if (auto map = std::get_if<Map>(&edges_)) return map->at(const_cast<Vertex*>(v));
+  auto it = std::find_if(begin(), end(), [v](value_type const& e) { return e.first == v; });
+  if (it == end()) {
+    throw std::out_of_range{"No edge"};
   }
+  return (*it).second;
 }
 
-bool Vertex::isInfinity() const {
-  return info.distance == std::numeric_limits<Distance>::infinity();
+Edges::Map& Edges::own() {
+  if (auto span = std::get_if<Span>(&edges_)) {
+    Map map;
+    map.reserve(span->size);
+    for (std::size_t i = 0; i < span->size; ++i) {
+      map.emplace(span->table[span->ends[i]], span->weights[i]);
+    }
+    edges_ = std::move(map);
+  }
+  return std::get<Map>(edges_);
 }
 
-bool Vertex::isSource() const {
-  return info.visited && !info.previous;
+Edges Edges::rebase(Vertex* const* table) const {
+  auto span = std::get<Span>(edges_);
+  span.table = table;
+  return Edges{span};
+}
+
+Graph::Graph(Graph const& other)
+  : id_{other.id_},
+    slots_{other.slots_},
+    free_{other.free_},
+    layout_{other.layout_},
+    cache_{other.cache_},
+    borrowed_{true},
+    version_{other.version_},
+    topology_{other.topology_},
+    repairLimit_{other.repairLimit_},
+    decrease_{other.decrease_},
+    threads_{other.threads_},
+    parallelThreshold_{other.parallelThreshold_},
+    pool_{other.pool_},
+    mapping_{other.mapping_} {
+  share(other);  // queries of the origin may build them meanwhile
+  vertexes_.reserve(other.vertexes_.size());
+  for (auto const& p: other.vertexes_) {
+    vertexes_.emplace(p.first, Vertex{p.first, p.second.slot});
+  }
+  index();
+  for (auto const& [id, v]: other.vertexes_) {
+    auto& copy = vertexes_.at(id);
+    assign(copy.neighbors, v.neighbors);
+    assign(copy.incoming, v.incoming);
+  }
+}
+
+void Graph::assign(Edges& copy, Edges const& edges) {
+  if (edges.isMapped()) {
+    copy = edges.rebase(table_.data());
+    return;
+  }
+  copy.clear();
+  auto& map = copy.own();
+  map.reserve(edges.size());
+  for (auto const& [w, weight]: edges) {
+    map.emplace(&vertexes_.at(w->id), weight);
+  }
 }
 
-void Graph::updateNeighbors(Vertex const& a) {
-  std::for_each(begin(a.neighbors), end(a.neighbors),
-      [this, &a](auto const& p) {
-    auto v = p.first;
-    if (!v->info.visited) {
-      unvisited_.erase(v);
-      v->setDistance(a);
-      unvisited_.insert(v);
+void Graph::index() {
+  table_.assign(mapping_ ? mapping_->vertexes() : 0, nullptr);
+  for (std::size_t i = 0; i < table_.size(); ++i) {
+    // a removed vertex is not referred by mapped edges anymore
+    auto it = vertexes_.find(mapping_->ids()[i]);
+    if (it != end(vertexes_)) table_[i] = &it->second;
+  }
+}
+
+void Graph::updateNeighbors(SearchContext& c, Vertex const& a) const {
+  auto const distance = c.info_[a.slot].distance;
+  c.counters_.scanned += a.neighbors.size();
+  std::uint64_t relaxed = 0;  // it is kept in a register
+  a.neighbors.forEach([&](Vertex const* v, Distance weight) {
+    reach(c, *v);
+    auto& info = c.info_[v->slot];
+    if (info.visited) return;
+    auto d = distance + weight;
+    if (d < info.distance) {
+      info.distance = d;
+      info.previous = &a;
+      c.unvisited_.update(v->slot);
+      ++relaxed;
+    }
+  });
+  c.counters_.relaxed += relaxed;
+  c.counters_.heap += relaxed;
+}
+
+void Graph::updateIncoming(SearchContext& c, Vertex const& a) const {
+  auto const distance = c.back_[a.slot].distance;
+  c.counters_.scanned += a.incoming.size();
+  std::uint64_t relaxed = 0;
+  a.incoming.forEach([&](Vertex const* v, Distance weight) {
+    reachBack(c, *v);
+    auto& back = c.back_[v->slot];
+    if (back.visited) return;
+    auto d = distance + weight;
+    if (d < back.distance) {
+      back.distance = d;
+      back.previous = &a;
+      c.backward_.update(v->slot);
+      ++relaxed;
     }
   });
+  c.counters_.relaxed += relaxed;
+  c.counters_.heap += relaxed;
+}
+
+void Graph::markAsVisited(SearchContext& c, Vertex const& a) const {
+  c.info_[a.slot].visited = true;
+  c.unvisited_.erase(a.slot);
+  c.settled_.push_back(&a);
+  ++c.counters_.settled;
+  ++c.counters_.heap;
+}
+
+bool Graph::isFinished(SearchContext const& c) const {
+  return c.unvisited_.empty()
+      || c.info_[c.unvisited_.top()].distance == std::numeric_limits<Distance>::infinity();
+}
+
+Vertex const& Graph::next(SearchContext const& c) const {
+  return *c.info_[c.unvisited_.top()].vertex;
+}
+
+bool Graph::isSettled(SearchContext const& c, Vertex const& v) const {
+  return isReached(c, v) && c.info_[v.slot].visited;
+}
+
+void Graph::step(SearchContext& c) const {
+  auto& current = next(c);
+  updateNeighbors(c, current);
+  markAsVisited(c, current);
+}
+
+void Graph::start(SearchContext& c, Vertex const& from) const {
+  init(c);
+  setSource(c, from);
+}
+
+void Graph::resume(SearchContext& c, Vertex const& to) const {
+  while (!isSettled(c, to) && !isFinished(c)) {
+    step(c);
+  }
+}
+
+Tree Graph::tree(SearchContext const& c) const {
+  auto bound = isFinished(c) ? std::numeric_limits<Distance>::infinity()
+                             : c.info_[c.unvisited_.top()].distance;
+  Tree t{c.settled_.front()->id, version_, bound, {}};
+  t.steps.reserve(c.settled_.size());
+  for (auto v: c.settled_) {
+    auto const& info = c.info_[v->slot];
+    auto prev = info.previous;
+    t.steps.emplace(v->id, Tree::Step{info.distance, prev ? prev->id : v->id});
+  }
+  return t;
+}
+
+void Graph::save(SearchContext const& c) const {
+  if (isActual(c) && !c.settled_.empty() && cache_->trees.budget() > 0) {
+    auto t = tree(c);
+    std::lock_guard lock{cache_->mutex};
+    cache_->trees.put(std::move(t));
+  }
 }
 
-void Graph::markAsVisited(Vertex& a) {
-  a.info.visited = true;
-  unvisited_.erase(&a);
+void Graph::calculate(SearchContext& c, Vertex const& from) const {
+  start(c, from);
+  while (!isFinished(c)) {
+    step(c);
+  }
+}
+
+void Graph::init(SearchContext& c) const {
+  c.renew(*this);
+}
+
+bool Graph::isActual(SearchContext const& c) const {
+  return c.graph_ == this && c.version_ == version_;
+}
+
+void Graph::reach(SearchContext& c, Vertex const& v) const {
+  auto& info = c.info_[v.slot];
+  if (info.generation != c.generation_) {
+    info = {};
+    info.generation = c.generation_;
+    info.vertex = &v;
+  }
 }
 
-bool Graph::isFinished() const {
-  return unvisited_.empty() || (*begin(unvisited_))->isInfinity();
+bool Graph::isReached(SearchContext const& c, Vertex const& v) const {
+  return v.slot < c.info_.size() && c.info_[v.slot].generation == c.generation_;
 }
 
-Vertex& Graph::next() {
-  return **begin(unvisited_);
+void Graph::reachBack(SearchContext& c, Vertex const& v) const {
+  auto& back = c.back_[v.slot];
+  if (back.generation != c.backGeneration_) {
+    back = {};
+    back.generation = c.backGeneration_;
+    back.vertex = &v;
+  }
 }
 
-void Graph::calculate(Vertex& from) {
-  init();
-  setSource(from);
-  do {
-    auto& current = next();
-    updateNeighbors(current);
-    markAsVisited(current);
-  } while (!isFinished());
-  dirty_ = false;
+bool Graph::isReachedBack(SearchContext const& c, Vertex const& v) const {
+  return v.slot < c.back_.size() && c.back_[v.slot].generation == c.backGeneration_;
 }
 
-void Graph::init() {
-  std::for_each(begin(vertexes_), end(vertexes_),
-      [] (auto& p) { p.second.info = {}; });
-  unvisited_.clear();
-  std::transform(begin(vertexes_), end(vertexes_),
-      std::inserter(unvisited_, unvisited_.end()),
-      [] (auto& p) -> Vertex* { return &p.second; });
+void Graph::setSource(SearchContext& c, Vertex const& v) const {
+  reach(c, v);
+  c.info_[v.slot].distance = 0;
+  c.unvisited_.update(v.slot);
+  ++c.counters_.heap;
 }
 
-void Graph::setSource(Vertex& v) {
-  unvisited_.erase(&v);
-  v.info.distance = 0;
-  unvisited_.insert(&v);
+bool Graph::isSource(SearchContext const& c, Vertex const& v) const {
+  auto const& info = c.info_[v.slot];
+  return info.visited && !info.previous;
 }
 
 Id Graph::addVertex() {
-  vertexes_.emplace(id_, Vertex{id_});
+  detach();
+  save(*context_);
+  vertexes_.emplace(id_, Vertex{id_, take()});
+  touch(id_);
+  ++topology_;
+  auto const version = version_++;
+  restoreTrees(takeTrees(version));
   return id_++;
 }
 
 void Graph::setEdge(Id from, Id to, Distance distance) {
   checkDistance(distance);
-  at(from)->neighbors[at(to)] = distance;
-  dirty_ = true;
+  auto& a = *at(from);
+  auto& b = *at(to);
+  auto& neighbors = a.neighbors.own();
+  auto it = neighbors.find(&b);
+  auto before = std::numeric_limits<Distance>::infinity();
+  if (it == end(neighbors)) {
+    ++topology_;
+  } else {
+    before = it->second;
+  }
+  neighbors[&b] = distance;
+  b.incoming[&a] = distance;
+  touch(from);
+  touch(to);
+  changed(a, b, before, distance);
 }
 
-std::list<Id> Graph::path(Vertex const& to) const {
+std::list<Id> Graph::path(SearchContext const& c, Vertex const& to) const {
   std::list<Id> p{to.id};
-  auto prev = to.info.previous;
+  if (!isReached(c, to)) return p;
+  auto prev = c.info_[to.slot].previous;
   while (prev) {
     p.push_front(prev->id);
-    prev = prev->info.previous;
+    prev = c.info_[prev->slot].previous;
   }
   return p;
 }
 
 std::list<Id> Graph::path(Id from, Id to, bool force) {
-  auto& source = *at(from);
+  return path(*context_, from, to, force);
+}
+
+std::list<Id> Graph::path(SearchContext& context, Id from, Id to, bool force) const {
+  auto const& source = *at(from);
+  auto const& target = *at(to);
+  if (auto p = search(context, source, target, force, false)) return *p;
+  return path(context, target);
+}
+
+void Graph::path(SearchContext& context, Id from, Id to, std::vector<Id>& ids) const {
+  auto const& source = *at(from);
+  auto const& target = *at(to);
+  ids.clear();
+  if (auto p = search(context, source, target, false, false)) {
+    ids.assign(begin(*p), end(*p));
+    return;
+  }
+  ids.push_back(to);
+  if (!isReached(context, target)) return;
+  for (auto prev = context.info_[target.slot].previous; prev;
+       prev = context.info_[prev->slot].previous) {
+    ids.push_back(prev->id);
+  }
+  std::reverse(begin(ids), end(ids));
+}
+
+std::optional<std::list<Id>> Graph::search(SearchContext& c, Vertex const& source,
+                                           Vertex const& target, bool force,
+                                           bool parallel) const {
+  auto answer = SearchContext::Answer::kContinued;
+  if (force || !isActual(c) || !isReached(c, source) || !isSource(c, source)) {
+    if (!force) {
+      std::lock_guard lock{cache_->mutex};
+      if (auto t = cache_->trees.find(source.id, target.id, version_)) {
+        c.answered(SearchContext::Answer::kCached);
+        return t->path(target.id);
+      }
+    }
+    if (parallel) {
+      auto t = parallelTree(c, source.id);
+      auto p = t.path(target.id);
+      std::lock_guard lock{cache_->mutex};
+      cache_->trees.put(std::move(t));
+      c.answered(SearchContext::Answer::kParallel);
+      return p;
+    }
+    // the search of an older graph from the same source is outdated
+    answer = c.graph_ && !isActual(c) && isReached(c, source) && isSource(c, source)
+        ? SearchContext::Answer::kRecomputed : SearchContext::Answer::kSearched;
+    save(c);
+    start(c, source);
+  }
+  c.answered(answer);
+  resume(c, target);
+  return std::nullopt;
+}
+
+std::vector<std::list<Id>> Graph::paths(std::vector<std::pair<Id, Id>> const& pairs) {
+  return paths(*context_, pairs);
+}
+
+std::vector<std::list<Id>> Graph::paths(SearchContext& context,
+                                        std::vector<std::pair<Id, Id>> const& pairs) const {
+  std::unordered_map<Id, std::size_t> index;
+  std::vector<std::vector<std::size_t>> groups;  // pairs by source in order of appearance
+  for (std::size_t i = 0; i < pairs.size(); ++i) {
+    auto [from, to] = pairs[i];
+    at(from);
+    at(to);
+    auto [it, added] = index.emplace(from, groups.size());
+    if (added) groups.emplace_back();
+    groups[it->second].push_back(i);
+  }
+  std::vector<std::list<Id>> result(pairs.size());
+  auto answer = [this, &pairs, &groups, &result](SearchContext& c, std::size_t group,
+                                                 bool parallel) {
+    for (auto i: groups[group]) {
+      auto const& target = *at(pairs[i].second);
+      auto p = search(c, *at(pairs[i].first), target, false, parallel);
+      result[i] = p ? std::move(*p) : path(c, target);
+    }
+  };
+  if (threads_ > 1 && groups.size() > 1) {
+    std::lock_guard lock{pool_->mutex};
+    auto& w = workers();
+    auto& contexts = pool_->contexts;
+    if (!contexts) contexts = std::make_unique<SearchContext[]>(w.size());
+    std::vector<SearchContext::Counters> work(w.size());
+    w.run([&](std::size_t t) {
+      auto const before = contexts[t].counters();
+      for (auto group = t; group < groups.size(); group += w.size()) {
+        answer(contexts[t], group, false);
+      }
+      save(contexts[t]);
+      work[t] = contexts[t].counters() - before;
+    });
+    for (auto const& counters: work) context.counters_ += counters;
+  } else {
+    for (std::size_t group = 0; group < groups.size(); ++group) {
+      // the whole tree pays off only for several targets of the source
+      answer(context, group, isParallel() && groups[group].size() > 1);
+    }
+  }
+  return result;
+}
+
+Tree Graph::distances(Id from) {
+  return distances(*context_, from);
+}
+
+Tree Graph::distances(SearchContext& context, Id from) const {
+  auto const& source = *at(from);
+  {
+    std::lock_guard lock{cache_->mutex};
+    if (auto t = cache_->trees.find(from, from, version_); t && t->isComplete()) return *t;
+  }
+  if (threads_ > 1) {
+    auto t = parallelTree(context, from);
+    std::lock_guard lock{cache_->mutex};
+    cache_->trees.put(t);
+    return t;
+  }
+  save(context);
+  calculate(context, source);
+  return tree(context);
+}
+
+void Graph::setThreads(std::size_t threads) {
+  threads_ = std::max<std::size_t>(threads, 1);
+  pool_ = std::make_shared<Pool>();
+}
+
+bool Graph::isParallel() const {
+  return threads_ > 1 && vertexes_.size() >= parallelThreshold_;
+}
+
+Tree Graph::parallelTree(SearchContext& c, Id from) const {
+  std::lock_guard lock{pool_->mutex};
+  auto& deltaStepping = pool_->deltaStepping;
+  if (!deltaStepping) {
+    deltaStepping = std::make_unique<DeltaStepping>(workers());
+  }
+  return deltaStepping->tree(*this, from, c.counters_);
+}
+
+Workers& Graph::workers() const {
+  auto& workers = pool_->workers;
+  if (!workers) {
+    workers = std::make_unique<Workers>(threads_);
+  }
+  return *workers;
+}
+
+std::list<Id> Graph::bidirectionalPath(Id from, Id to) {
+  return bidirectionalPath(*context_, from, to);
+}
+
+std::list<Id> Graph::bidirectionalPath(SearchContext& context, Id from, Id to) const {
+  auto& c = context;
+  auto const& source = *at(from);
   auto const& target = *at(to);
-  if (force || dirty_ || !source.isSource()) {
-    calculate(source);
+  if (from == to) return {to};
+  if (isActual(c) && isReached(c, source) && isSource(c, source)
+      && isSettled(c, target)) {
+    return path(c, target);
+  }
+  save(c);
+  start(c, source);
+  c.renewBack(slots_);
+  reachBack(c, target);
+  c.back_[target.slot].distance = 0;
+  c.backward_.push(target.slot);
+  ++c.counters_.heap;
+
+  auto best = std::numeric_limits<Distance>::infinity();
+  Vertex const* tail = nullptr;
+  Vertex const* head = nullptr;
+  auto meet = [&](Vertex const& a, Vertex const& b, Distance d) {
+    if (d < best) {
+      best = d;
+      tail = &a;
+      head = &b;
+    }
+  };
+  while (!c.unvisited_.empty() && !c.backward_.empty()
+      && c.info_[c.unvisited_.top()].distance + c.back_[c.backward_.top()].distance < best) {
+    if (c.info_[c.unvisited_.top()].distance <= c.back_[c.backward_.top()].distance) {
+      auto const& a = next(c);
+      updateNeighbors(c, a);
+      markAsVisited(c, a);
+      auto const distance = c.info_[a.slot].distance;
+      for (auto const& [v, weight]: a.neighbors) {
+        if (isReachedBack(c, *v)) {
+          meet(a, *v, distance + weight + c.back_[v->slot].distance);
+        }
+      }
+    } else {
+      auto const& b = *c.back_[c.backward_.top()].vertex;
+      // a predecessor over an edge of zero weight may become the top meanwhile
+      c.back_[b.slot].visited = true;
+      c.backward_.erase(b.slot);
+      updateIncoming(c, b);
+      ++c.counters_.settled;
+      ++c.counters_.heap;
+      auto const distance = c.back_[b.slot].distance;
+      for (auto const& [v, weight]: b.incoming) {
+        if (isReached(c, *v)) {
+          meet(*v, b, c.info_[v->slot].distance + weight + distance);
+        }
+      }
+    }
   }
-  return path(target);
+
+  if (!tail) return {to};
+  auto p = path(c, *tail);
+  for (auto v = head; v; v = c.back_[v->slot].previous) {
+    p.push_back(v->id);
+  }
+  return p;
+}
+
+void Graph::buildHierarchy() {
+  auto hierarchy = std::make_shared<ContractionHierarchy>(*this);
+  std::lock_guard lock{locks_->hierarchy};
+  hierarchy_ = std::move(hierarchy);
+  hierarchyVersion_ = version_;
+  hierarchyTopology_ = topology_;
+  hierarchyBuild_ = ++builds;
+}
+
+std::shared_ptr<ContractionHierarchy const> Graph::currentHierarchy() const {
+  std::lock_guard lock{locks_->hierarchy};
+  return hierarchy_;
+}
+
+std::list<Id> Graph::hierarchyPath(Id from, Id to) {
+  at(from);
+  at(to);
+  return hierarchy()->path(from, to);
+}
+
+void Graph::distanceMatrix(std::vector<Id> const& sources,
+                           std::vector<Id> const& targets,
+                           std::size_t chunk, Rows const& rows) {
+  distanceMatrix(*context_, sources, targets, chunk, rows);
+}
+
+void Graph::distanceMatrix(SearchContext& context, std::vector<Id> const& sources,
+                           std::vector<Id> const& targets,
+                           std::size_t chunk, Rows const& rows) {
+  std::for_each(begin(sources), end(sources), [this](Id id) { at(id); });
+  std::for_each(begin(targets), end(targets), [this](Id id) { at(id); });
+  chunk = std::max<std::size_t>(chunk, 1);
+  std::shared_ptr<ContractionHierarchy const> h;
+  {
+    // the hierarchy is not built or customized by a query
+    std::lock_guard lock{locks_->hierarchy};
+    if (hierarchy_ && hierarchyTopology_ == topology_ && hierarchyVersion_ == version_) {
+      h = hierarchy_;
+    }
+  }
+  if (!h) {
+    searchMatrix(context, sources, targets, chunk, rows);
+    return;
+  }
+  ContractionHierarchy::Scratches scratches;
+  std::unique_lock lock{pool_->mutex};
+  auto buckets = h->buckets(targets, workers(), scratches);
+  lock.unlock();
+  for (std::size_t first = 0; first < sources.size(); first += chunk) {
+    auto last = std::min(first + chunk, sources.size());
+    std::vector<Id> part(begin(sources) + first, begin(sources) + last);
+    lock.lock();
+    auto distances = h->distances(part, buckets, workers(), scratches);
+    lock.unlock();
+    // the rows may wait for a slow client, so the workers are not held meanwhile
+    rows(first, distances);
+  }
+}
+
+void Graph::searchMatrix(SearchContext& context, std::vector<Id> const& sources,
+                         std::vector<Id> const& targets,
+                         std::size_t chunk, Rows const& rows) const {
+  std::vector<Vertex const*> columns;
+  columns.reserve(targets.size());
+  std::transform(begin(targets), end(targets), std::back_inserter(columns),
+      [this](Id id) { return at(id); });
+  auto const m = columns.size();
+  auto row = [this, &columns, m](SearchContext& c, Vertex const& source, Distance* row) {
+    start(c, source);
+    for (auto target: columns) resume(c, *target);
+    for (std::size_t j = 0; j < m; ++j) {
+      if (isSettled(c, *columns[j])) row[j] = c.info_[columns[j]->slot].distance;
+    }
+  };
+  std::unique_lock lock{pool_->mutex, std::defer_lock};
+  for (std::size_t first = 0; first < sources.size(); first += chunk) {
+    auto last = std::min(first + chunk, sources.size());
+    std::vector<Distance> distances((last - first) * m, std::numeric_limits<Distance>::infinity());
+    lock.lock();
+    auto& w = workers();
+    auto& contexts = pool_->contexts;
+    if (!contexts) contexts = std::make_unique<SearchContext[]>(w.size());
+    std::vector<SearchContext::Counters> work(w.size());
+    w.run([&](std::size_t t) {
+      auto const before = contexts[t].counters();
+      for (auto i = first + t; i < last; i += w.size()) {
+        row(contexts[t], *at(sources[i]), distances.data() + (i - first) * m);
+      }
+      work[t] = contexts[t].counters() - before;
+    });
+    lock.unlock();
+    for (auto const& counters: work) context.counters_ += counters;
+    rows(first, distances);
+  }
+}
+
+std::shared_ptr<ContractionHierarchy const> Graph::hierarchy() {
+  auto const current = [this] {
+    return hierarchy_ && hierarchyTopology_ == topology_ && hierarchyVersion_ == version_;
+  };
+  {
+    std::lock_guard lock{locks_->hierarchy};
+    if (current()) return hierarchy_;
+  }
+  // concurrent queries wait for one build, but sharing with other snapshots is not held by it
+  std::lock_guard build{locks_->hierarchyBuild};
+  std::shared_ptr<ContractionHierarchy const> base;
+  {
+    std::lock_guard lock{locks_->hierarchy};
+    if (current()) return hierarchy_;
+    if (hierarchy_ && hierarchyTopology_ == topology_) base = hierarchy_;
+  }
+  // other snapshots may hold the old one, so a copy is customized
+  auto built = base ? std::make_shared<ContractionHierarchy>(*base)
+                    : std::make_shared<ContractionHierarchy>(*this);
+  if (base) built->customize(*this);
+  std::lock_guard lock{locks_->hierarchy};
+  if (current()) return hierarchy_;
+  hierarchy_ = std::move(built);
+  hierarchyVersion_ = version_;
+  hierarchyTopology_ = topology_;
+  hierarchyBuild_ = ++builds;
+  return hierarchy_;
+}
+
+void Graph::buildLandmarks(std::size_t count) {
+  auto landmarks = std::make_shared<Landmarks>(*this, count);
+  std::lock_guard lock{locks_->landmarks};
+  landmarks_ = std::move(landmarks);
+  landmarksDecrease_ = decrease_;
+  landmarksBuild_ = ++builds;
+}
+
+std::shared_ptr<Landmarks const> Graph::currentLandmarks() const {
+  std::lock_guard lock{locks_->landmarks};
+  return landmarks_;
+}
+
+std::list<Id> Graph::landmarkPath(Id from, Id to) {
+  return landmarkPath(*context_, from, to);
+}
+
+std::list<Id> Graph::landmarkPath(SearchContext& context, Id from, Id to) {
+  at(from);
+  at(to);
+  std::shared_ptr<Landmarks const> landmarks;
+  auto const take = [this, &landmarks] {
+    std::lock_guard lock{locks_->landmarks};
+    landmarks = landmarks_;
+    // stale bounds could overestimate, they are measured again off the query path
+    if (landmarks && landmarksDecrease_ != decrease_) {
+      landmarks.reset();
+      return true;
+    }
+    return landmarks && landmarks->layout() == layout_;
+  };
+  if (!take()) {
+    // like the hierarchy, the landmarks are built without holding their lock
+    std::lock_guard build{locks_->landmarksBuild};
+    if (!take()) {
+      // slots were compacted since they were measured, so a copy is remapped
+      auto built = landmarks ? std::make_shared<Landmarks>(*landmarks)
+                             : std::make_shared<Landmarks>(*this, kLandmarks);
+      if (landmarks) built->remap(*this);
+      std::lock_guard lock{locks_->landmarks};
+      if (landmarks_ == landmarks) {
+        if (!landmarks_) landmarksDecrease_ = decrease_;
+        landmarks_ = std::move(built);
+        landmarksBuild_ = ++builds;
+      }
+      landmarks = landmarksDecrease_ == decrease_ ? landmarks_ : nullptr;
+    }
+  }
+  if (!landmarks) return path(context, from, to);
+  return landmarks->path(*this, context, from, to);
+}
+
+bool Graph::hasStaleLandmarks() const {
+  std::lock_guard lock{locks_->landmarks};
+  return landmarks_ && landmarksDecrease_ != decrease_;
+}
+
+void Graph::refreshLandmarks() {
+  std::shared_ptr<Landmarks const> stale;
+  {
+    std::lock_guard lock{locks_->landmarks};
+    if (!landmarks_ || landmarksDecrease_ == decrease_) return;
+    stale = landmarks_;
+  }
+  auto fresh = std::make_shared<Landmarks>(*stale);
+  fresh->refresh(*this);
+  std::lock_guard lock{locks_->landmarks};
+  if (landmarks_ != stale) return;  // they were built or taken meanwhile
+  landmarks_ = std::move(fresh);
+  landmarksDecrease_ = decrease_;
+  landmarksBuild_ = ++builds;
+}
+
+void Graph::share(Graph const& other) {
+  if (&other == this) return;
+  {
+    std::scoped_lock lock{locks_->hierarchy, other.locks_->hierarchy};
+    if (other.hierarchy_ && (!hierarchy_
+        || std::pair{other.hierarchyVersion_, other.hierarchyBuild_}
+           > std::pair{hierarchyVersion_, hierarchyBuild_})) {
+      hierarchy_ = other.hierarchy_;
+      hierarchyVersion_ = other.hierarchyVersion_;
+      hierarchyTopology_ = other.hierarchyTopology_;
+      hierarchyBuild_ = other.hierarchyBuild_;
+    }
+  }
+  std::scoped_lock lock{locks_->landmarks, other.locks_->landmarks};
+  if (other.landmarks_ && (!landmarks_
+      || std::pair{other.landmarksDecrease_, other.landmarksBuild_}
+         > std::pair{landmarksDecrease_, landmarksBuild_})) {
+    landmarks_ = other.landmarks_;
+    landmarksDecrease_ = other.landmarksDecrease_;
+    landmarksBuild_ = other.landmarksBuild_;
+  }
+}
+
+void Graph::setCacheBudget(std::size_t bytes) {
+  detach();
+  std::lock_guard lock{cache_->mutex};
+  cache_->trees.setBudget(bytes);
+}
+
+TreeCache::Statistics Graph::cacheStatistics() const {
+  std::lock_guard lock{cache_->mutex};
+  return cache_->trees.statistics();
 }
 
 Vertex* Graph::at(Id id) {
@@ -114,22 +776,391 @@ Vertex* Graph::at(Id id) {
   return &it->second;
 }
 
+Vertex const* Graph::at(Id id) const {
+  auto it = vertexes_.find(id);
+  if (it == end(vertexes_)) {
+    throw std::invalid_argument{"Wrong vertex ID"};
+  }
+  return &it->second;
+}
+
 void Graph::removeEdge(Id from, Id to) {
-  at(from)->neighbors.erase(at(to));
-  dirty_ = true;
+  auto& a = *at(from);
+  auto& b = *at(to);
+  auto& neighbors = a.neighbors.own();
+  auto it = neighbors.find(&b);
+  if (it == end(neighbors)) return;
+  auto before = it->second;
+  ++topology_;
+  neighbors.erase(it);
+  b.incoming.erase(&a);
+  touch(from);
+  touch(to);
+  changed(a, b, before, std::numeric_limits<Distance>::infinity());
+}
+
+void Graph::changed(Vertex const& a, Vertex const& b,
+                    Distance before, Distance after) {
+  detach();
+  save(*context_);
+  auto const version = version_++;
+  if (after < before) ++decrease_;
+  auto trees = takeTrees(version);
+  for (auto& t: trees) {
+    if ((after < before && !decrease(*t, a, b, after)) || (before < after && !increase(*t, a, b))) {
+      t.reset();
+    }
+  }
+  restoreTrees(std::move(trees));
+}
+
+std::vector<std::shared_ptr<Tree>> Graph::takeTrees(std::size_t version) {
+  std::vector<std::shared_ptr<Tree>> trees;
+  {
+    std::lock_guard lock{cache_->mutex};
+    trees = cache_->trees.take(version);
+  }
+  // the trees are repaired without holding the cache, so queries of snapshots go on
+  for (auto& t: trees) {
+    if (t.use_count() > 1) t = std::make_shared<Tree>(*t);  // somebody still reads it
+    t->version = version_;
+  }
+  return trees;
+}
+
+void Graph::restoreTrees(std::vector<std::shared_ptr<Tree>> trees) {
+  std::lock_guard lock{cache_->mutex};
+  cache_->trees.restore(std::move(trees));
+}
+
+bool Graph::decrease(Tree& t, Vertex const& a, Vertex const& b,
+                     Distance weight) const {
+  auto it = t.steps.find(a.id);
+  if (it == end(t.steps)) return true;
+  Queue queue;
+  auto distance = it->second.distance + weight;
+  if (relax(t, b, distance, a.id)) queue.emplace(distance, &b);
+  auto const max = limit(t);
+  std::size_t affected = 0;
+  while (!queue.empty()) {
+    auto [d, x] = queue.top();
+    queue.pop();
+    if (d > t.steps.at(x->id).distance) continue;
+    if (++affected > max) return false;
+    for (auto const& [w, weight]: x->neighbors) {
+      if (relax(t, *w, d + weight, x->id)) queue.emplace(d + weight, w);
+    }
+  }
+  return true;
+}
+
+bool Graph::increase(Tree& t, Vertex const& a, Vertex const& b) const {
+  auto it = t.steps.find(b.id);
+  if (it == end(t.steps) || it->second.previous != a.id || b.id == t.source) {
+    return true;
+  }
+  auto const max = limit(t);
+  std::vector<Vertex const*> subtree{&b};
+  std::unordered_set<Vertex const*> affected{&b};
+  for (std::size_t i = 0; i < subtree.size(); ++i) {
+    auto x = subtree[i];
+    for (auto const& p: x->neighbors) {
+      auto w = p.first;
+      auto step = t.steps.find(w->id);
+      if (step != end(t.steps) && step->second.previous == x->id
+          && affected.insert(w).second) {
+        subtree.push_back(w);
+      }
+    }
+    if (subtree.size() > max) return false;
+  }
+  for (auto x: subtree) t.steps.erase(x->id);
+
+  Queue queue;
+  for (auto x: subtree) {
+    for (auto const& [v, weight]: x->incoming) {
+      auto step = t.steps.find(v->id);
+      if (affected.count(v) || step == end(t.steps)) continue;
+      auto distance = step->second.distance + weight;
+      if (relax(t, *x, distance, v->id)) queue.emplace(distance, x);
+    }
+  }
+  while (!queue.empty()) {
+    auto [d, x] = queue.top();
+    queue.pop();
+    if (d > t.steps.at(x->id).distance) continue;
+    for (auto const& [w, weight]: x->neighbors) {
+      if (affected.count(w) && relax(t, *w, d + weight, x->id)) {
+        queue.emplace(d + weight, w);
+      }
+    }
+  }
+  return true;
+}
+
+std::size_t Graph::limit(Tree const& t) const {
+  return static_cast<std::size_t>(repairLimit_ * t.steps.size());
 }
 
 void Graph::removeVertex(Id id) {
-  auto const v = at(id);
-  std::for_each(begin(vertexes_), end(vertexes_), [v](auto& p) {
-    p.second.neighbors.erase(v);
-  });
+  remove({at(id)});
+}
+
+void Graph::removeVertices(std::vector<Id> const& ids) {
+  std::vector<Vertex*> victims;
+  victims.reserve(ids.size());
+  std::transform(begin(ids), end(ids), std::back_inserter(victims),
+      [this](Id id) { return at(id); });
+  std::sort(begin(victims), end(victims));
+  victims.erase(std::unique(begin(victims), end(victims)), end(victims));
+  remove(victims);
+}
+
+void Graph::remove(std::vector<Vertex*> const& victims) {
+  detach();
+  save(*context_);
+  auto const version = version_++;
+  ++topology_;
+  auto trees = takeTrees(version);
+  for (auto v: victims) {
+    // the vertex is cut off first, so the repair does not reach it again
+    for (auto const& p: v->incoming) {
+      p.first->neighbors.erase(v);
+      touch(p.first->id);
+    }
+    v->incoming.clear();
+    for (auto& t: trees) {
+      if (!t) continue;
+      auto it = t->steps.find(v->id);
+      if (it == end(t->steps)) continue;
+      if (v->id == t->source || !increase(*t, *at(it->second.previous), *v)) t.reset();
+    }
+    erase(v);
+  }
+  restoreTrees(std::move(trees));
+  compact();
+}
+
+std::vector<Id> Graph::apply(std::vector<Mutation> const& batch) {
+  check(batch);
+  detach();
+  save(*context_);
+  std::vector<Id> firsts;
+  bool decreased = false;
+  bool modified = false;
+  bool reshaped = false;  // vertexes or edges were added or removed
+  for (auto const& m: batch) {
+    switch (m.type) {
+      case Mutation::Type::kAddVertices:
+        firsts.push_back(id_);
+        modified = modified || m.count > 0;
+        reshaped = reshaped || m.count > 0;
+        vertexes_.reserve(vertexes_.size() + m.count);
+        for (std::size_t i = 0; i < m.count; ++i, ++id_) {
+          vertexes_.emplace(id_, Vertex{id_, take()});
+          touch(id_);
+        }
+        break;
+      case Mutation::Type::kAddEdges:
+        modified = modified || !m.edges.empty();
+        for (auto const& e: m.edges) {
+          auto& a = *at(e.from);
+          auto& b = *at(e.to);
+          auto [it, added] = a.neighbors.own().try_emplace(&b, e.weight);
+          if (!added) {
+            decreased = decreased || e.weight < it->second;
+            it->second = e.weight;
+          }
+          decreased = decreased || added;
+          reshaped = reshaped || added;
+          b.incoming[&a] = e.weight;
+          touch(e.from);
+          touch(e.to);
+        }
+        break;
+      case Mutation::Type::kRemoveEdges:
+        for (auto const& e: m.edges) {
+          auto& a = *at(e.from);
+          auto& b = *at(e.to);
+          if (a.neighbors.erase(&b) > 0) {
+            modified = true;
+            reshaped = true;
+            b.incoming.erase(&a);
+            touch(e.from);
+            touch(e.to);
+          }
+        }
+        break;
+      case Mutation::Type::kRemoveVertices:
+        for (auto id: m.ids) {
+          auto it = vertexes_.find(id);
+          if (it != end(vertexes_)) {
+            modified = true;
+            reshaped = true;
+            erase(&it->second);
+          }
+        }
+        break;
+    }
+  }
+  if (!modified) return firsts;
+  compact();
+  ++version_;
+  // a batch of weights only lets the hierarchy be customized instead of built again
+  if (reshaped) ++topology_;
+  if (decreased) ++decrease_;
+  return firsts;
+}
+
+void Graph::check(std::vector<Mutation> const& batch) const {
+  auto next = id_;
+  std::size_t added = 0;
+  std::unordered_set<Id> removed;
+  auto exists = [this, &next, &removed](Id id) {
+    return (id >= id_ ? id < next : vertexes_.count(id) > 0) && removed.count(id) == 0;
+  };
+  auto checkVertex = [&exists](Id id) {
+    if (!exists(id)) {
+      throw std::invalid_argument{"Wrong vertex ID"};
+    }
+  };
+  for (auto const& m: batch) {
+    switch (m.type) {
+      case Mutation::Type::kAddVertices:
+        if (m.count > kMaxAdded - added || m.count > std::numeric_limits<Id>::max() - next) {
+          throw std::invalid_argument{"Too many vertexes"};
+        }
+        added += m.count;
+        next += m.count;
+        break;
+      case Mutation::Type::kAddEdges:
+        for (auto const& e: m.edges) {
+          checkVertex(e.from);
+          checkVertex(e.to);
+          checkDistance(e.weight);
+        }
+        break;
+      case Mutation::Type::kRemoveEdges:
+        for (auto const& e: m.edges) {
+          checkVertex(e.from);
+          checkVertex(e.to);
+        }
+        break;
+      case Mutation::Type::kRemoveVertices:
+        std::for_each(begin(m.ids), end(m.ids), checkVertex);
+        removed.insert(begin(m.ids), end(m.ids));
+        break;
+    }
+  }
+}
+
+void Graph::erase(Vertex* v) {
+  for (auto const& p: v->neighbors) {
+    p.first->incoming.erase(v);
+    touch(p.first->id);
+  }
+  for (auto const& p: v->incoming) {
+    p.first->neighbors.erase(v);
+    touch(p.first->id);
+  }
+  touch(v->id);
+  free_.push_back(v->slot);
+  std::push_heap(begin(free_), end(free_), std::greater<>{});
   vertexes_.erase(v->id);
-  dirty_ = true;
+}
+
+std::size_t Graph::take() {
+  if (free_.empty()) return slots_++;
+  std::pop_heap(begin(free_), end(free_), std::greater<>{});
+  auto const slot = free_.back();
+  free_.pop_back();
+  return slot;
+}
+
+void Graph::compact() {
+  auto const n = vertexes_.size();
+  if (slots_ / 2 <= n) return;
+  // vertexes of the highest slots move to the free ones, so contexts shrink
+  std::vector<bool> taken(n);
+  for (auto const& p: vertexes_) {
+    if (p.second.slot < n) taken[p.second.slot] = true;
+  }
+  std::size_t slot = 0;
+  for (auto& [id, v]: vertexes_) {
+    if (v.slot < n) continue;
+    while (taken[slot]) ++slot;
+    v.slot = slot++;
+    touch(id);  // snapshots take the new slot
+  }
+  slots_ = n;
+  free_.clear();
+  ++layout_;
+}
+
+void Graph::touch(Id id) {
+  if (changes_) changes_->insert(id);
+}
+
+void Graph::recordChanges() {
+  changes_ = std::make_unique<std::unordered_set<Id>>();
+}
+
+std::unordered_set<Id> Graph::takeChanges() {
+  std::unordered_set<Id> changes;
+  if (changes_) changes_->swap(changes);
+  return changes;
+}
+
+void Graph::update(Graph const& origin, std::unordered_set<Id> const& changed) {
+  // edges of a removed vertex are changed too, so no kept vertex refers to it
+  for (auto id: changed) {
+    if (auto it = origin.vertexes_.find(id); it != end(origin.vertexes_)) {
+      vertexes_.try_emplace(id, Vertex{id}).first->second.slot = it->second.slot;
+    } else {
+      vertexes_.erase(id);
+    }
+  }
+  if (mapping_ != origin.mapping_) {
+    mapping_ = origin.mapping_;
+    index();
+  }
+  for (auto id: changed) {
+    auto it = origin.vertexes_.find(id);
+    if (it == end(origin.vertexes_)) continue;
+    auto& copy = vertexes_.at(id);
+    assign(copy.neighbors, it->second.neighbors);
+    assign(copy.incoming, it->second.incoming);
+  }
+  id_ = origin.id_;
+  slots_ = origin.slots_;
+  free_ = origin.free_;
+  layout_ = origin.layout_;
+  cache_ = origin.cache_;
+  borrowed_ = true;
+  version_ = origin.version_;
+  topology_ = origin.topology_;
+  repairLimit_ = origin.repairLimit_;
+  decrease_ = origin.decrease_;
+  threads_ = origin.threads_;
+  parallelThreshold_ = origin.parallelThreshold_;
+  pool_ = origin.pool_;
+  share(origin);
+}
+
+void Graph::detach() {
+  if (!borrowed_) return;
+  // the origin may reach the same version by other changes
+  auto cache = std::make_shared<Cache>();
+  {
+    std::lock_guard lock{cache_->mutex};
+    cache->trees.setBudget(cache_->trees.budget());
+  }
+  cache_ = std::move(cache);
+  borrowed_ = false;
 }
 
 void Graph::checkDistance(Distance distance) const {
-  if (distance < 0) {
-    throw std::invalid_argument{"Negative weight"};
+  if (!std::isfinite(distance) || distance < 0) {
+    throw std::invalid_argument{distance < 0 ? "Negative weight" : "Wrong weight"};
   }
 }
@@ -1,48 +1,231 @@
 #ifndef GRAPH_H_
 #define GRAPH_H_
 
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
 #include <limits>
 #include <list>
-#include <set>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <variant>
+#include <vector>
 
-using Id = long long unsigned int;
-using Distance = double;
+#include "delta_stepping.h"
+#include "hierarchy.h"
+#include "landmarks.h"
+#include "search_context.h"
+#include "tree_cache.h"
+#include "types.h"
 
+class SnapshotMapping;
 struct Vertex;
 
-struct SpfInfo {
-  Distance distance{std::numeric_limits<Distance>::infinity()};
-  bool visited{false};
-  Vertex const* previous{nullptr};
-};
+/**
+ * Weighted edges of a vertex to or from other vertexes.
+ * Edges which are loaded from a snapshot file stay in its mapped arrays
+ * until they are changed, then they are copied into the own hash map,
+ * so a loaded graph is queried without building its adjacency.
+ */
+class Edges {
+public:
+  using Map = std::unordered_map<Vertex*, Distance>;
+  using value_type = std::pair<Vertex*, Distance>;
 
-struct Vertex {
-  Id id;
-  std::unordered_map<Vertex*, Distance> neighbors;
-  SpfInfo info;
+  /**
+   * Edges in the mapped arrays, their ends are indexes of vertexes in the file.
+   */
+  struct Span {
+    Vertex* const* table{nullptr};  // vertexes of the graph by index
+    std::uint64_t const* ends{nullptr};
+    Distance const* weights{nullptr};
+    std::size_t size{0};
+  };
 
   /**
-   * Sets new distance to this vertex through a vertex.
-   * @param a - vertex which is used to calculate new distance.
+   * Iterator over the edges, it gives the other end and the weight.
    */
-  void setDistance(Vertex const& a);
+  class Iterator {
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = Edges::value_type;
+    using difference_type = std::ptrdiff_t;
+    using reference = value_type;
+
+    struct Arrow {
+      value_type value;
+      value_type const* operator->() const { return &value; }
+    };
+    using pointer = Arrow;
+
+    Iterator() = default;
+    explicit Iterator(Map::const_iterator node): node_{node} {}
+    Iterator(Span const& span, std::size_t i)
+      : table_{span.table}, end_{span.ends + i}, weight_{span.weights + i} {}
+
+    value_type operator*() const {
+      return table_ ? value_type{table_[*end_], *weight_} : value_type{node_->first, node_->second};
+    }
+    Arrow operator->() const { return {**this}; }
+
+    Iterator& operator++() {
+      if (table_) {
+        ++end_;
+        ++weight_;
+      } else {
+        ++node_;
+      }
+      return *this;
+    }
+
+    Iterator operator++(int) {
+      auto it = *this;
+      ++*this;
+      return it;
+    }
+
+    bool operator==(Iterator const& other) const {
+      return node_ == other.node_ && end_ == other.end_;
+    }
+    bool operator!=(Iterator const& other) const { return !(*this == other); }
+
+  private:
+    Map::const_iterator node_{};
+    Vertex* const* table_{nullptr};  // it is set for mapped edges
+    std::uint64_t const* end_{nullptr};
+    Distance const* weight_{nullptr};
+  };
+
+  Edges() = default;
+  explicit Edges(Span span): edges_{span} {}
+
+  Iterator begin() const {
+    if (auto span = std::get_if<Span>(&edges_)) return {*span, 0};
+    return Iterator{std::get<Map>(edges_).begin()};
+  }
+
+  Iterator end() const {
+    if (auto span = std::get_if<Span>(&edges_)) return {*span, span->size};
+    return Iterator{std::get<Map>(edges_).end()};
+  }
+
+  std::size_t size() const {
+    if (auto span = std::get_if<Span>(&edges_)) return span->size;
+    return std::get<Map>(edges_).size();
+  }
+
+  bool empty() const { return size() == 0; }
 
   /**
-   * Checks whether distance to this vertex is infinite.
-   * @return true if the distance is infinite.
+   * Calls the function for every edge, the kind of the edges is checked
+   * once instead of at every step like by the iterators.
+   * @param function - function which takes Vertex* and Distance.
    */
-  bool isInfinity() const;
+  template <typename Function>
+  void forEach(Function function) const {
+    if (auto span = std::get_if<Span>(&edges_)) {
+      for (std::size_t i = 0; i < span->size; ++i) {
+        function(span->table[span->ends[i]], span->weights[i]);
+      }
+    } else {
+      for (auto const& [v, weight]: std::get<Map>(edges_)) function(v, weight);
+    }
+  }
 
   /**
-   * Checks whether the vertex is source of the path.
-   * @return true if the vertex is source;
+   * Gets weight of the edge.
+   * @param v - the other end.
+   * @return the weight.
+   * @throw std::out_of_range if there is no such edge.
    */
-  bool isSource() const;
+  Distance at(Vertex const* v) const;
+
+  /**
+   * Checks whether the edges are still in the mapped file.
+   * @return true if they are mapped.
+   */
+  bool isMapped() const { return std::holds_alternative<Span>(edges_); }
+
+  /**
+   * Gets the own hash map to change the edges, mapped edges are copied
+   * into it first.
+   * @return the map.
+   */
+  Map& own();
+
+  Distance& operator[](Vertex* v) { return own()[v]; }
+  std::size_t erase(Vertex* v) { return own().erase(v); }
+  void clear() { edges_ = Map{}; }
+
+  /**
+   * Gets the same mapped edges whose ends are vertexes of another graph.
+   * @param table - vertexes of the graph by index in the file.
+   * @return the edges.
+   */
+  Edges rebase(Vertex* const* table) const;
+
+private:
+  std::variant<Map, Span> edges_;
 };
 
+struct Vertex {
+  Id id{0};
+  std::size_t slot{0};  // place of its states in search contexts
+  Edges neighbors{};
+  Edges incoming{};
+};
+
+/**
+ * One change of a batch.
+ */
+struct Mutation {
+  enum class Type { kAddVertices, kAddEdges, kRemoveEdges, kRemoveVertices };
+
+  struct Edge {
+    Id from{0};
+    Id to{0};
+    Distance weight{0};  // it is ignored by removal
+  };
+
+  Type type{Type::kAddVertices};
+  std::size_t count{0};  // number of added vertexes
+  std::vector<Edge> edges{};  // added, updated or removed edges
+  std::vector<Id> ids{};  // removed vertexes
+};
+
+/**
+ * Directed weighted graph.
+ * Queries which take a search context may run at the same time, each one
+ * with its own context, but a modification must not run at the same time
+ * with anything else.
+ */
 class Graph {
+  friend class Snapshot;
+
 public:
+  Graph() = default;
+
+  /**
+   * Makes snapshot of the graph.
+   * Vertexes and edges are copied, edges which are still in a mapped
+   * snapshot file refer to it as well. The cache of trees, the workers and
+   * the built hierarchy and landmarks are shared with the origin, they
+   * are copied before one of the graphs changes them. The copy gets its
+   * own empty cache when it is changed, so trees of the origin are not
+   * taken for the ones of the copy of the same version.
+   * The origin may be queried by others while it is copied.
+   * @param other - the origin.
+   */
+  Graph(Graph const& other);
+  Graph(Graph&&) = default;
+  Graph& operator=(Graph const&) = delete;
+  Graph& operator=(Graph&&) = default;
+
   /**
    * Adds new vertex in graph.
    * @return id of the vertex.
@@ -51,10 +234,19 @@ public:
 
   /**
    * Removes vertex and its edges.
+   * It takes time proportional to degree of the vertex, cached trees are
+   * repaired like after removal of its edges.
    * @param id - the vertex.
    */
   void removeVertex(Id id);
 
+  /**
+   * Removes several vertexes and their edges at once.
+   * Nothing is removed if any of the vertexes does not exist.
+   * @param ids - the vertexes.
+   */
+  void removeVertices(std::vector<Id> const& ids);
+
   /**
    * Adds a new edge or update distance of the already existed one.
    * @param from - begin the edge.
@@ -70,8 +262,23 @@ public:
    */
   void removeEdge(Id from, Id to);
 
+  /**
+   * Applies several changes at once.
+   * The whole batch is checked before anything is changed, so either
+   * every change is applied or none. A change may refer to vertexes which
+   * are added by the previous ones. The version changes once and cached
+   * trees are not repaired, so a big batch costs no more than its changes.
+   * A batch which changes nothing keeps the version. At most kMaxAdded
+   * vertexes are added by one batch.
+   * @param batch - the changes in order.
+   * @return first id of every range of added vertexes in order.
+   */
+  std::vector<Id> apply(std::vector<Mutation> const& batch);
+
   /**
    * Gets path from a source to a target vertex.
+   * The search stops as soon as the target is settled and keeps its frontier,
+   * so next request from the same source continues it.
    * @param from - the source vertex.
    * @param to - the target vertex.
    * @param force - calculate distances also if true.
@@ -79,54 +286,467 @@ public:
    */
   std::list<Id> path(Id from, Id to, bool force = false);
 
+  /**
+   * Gets path from a source to a target vertex like path() but keeps
+   * the search in the given context instead of the own one of the graph.
+   * The graph is not changed, so queries with different contexts may run
+   * at the same time.
+   * @param context - the search context of the caller.
+   * @param from - the source vertex.
+   * @param to - the target vertex.
+   * @param force - calculate distances also if true.
+   * @return list of the vertex by order.
+   */
+  std::list<Id> path(SearchContext& context, Id from, Id to, bool force = false) const;
+
+  /**
+   * Gets path into the given buffer. A search which is continued in
+   * a warmed up context allocates no memory, nor does a new search if
+   * the cache budget is 0: otherwise the previous search is saved into
+   * the cache as a new tree, and a path found in the cache is copied.
+   * @param context - the search context of the caller.
+   * @param from - the source vertex.
+   * @param to - the target vertex.
+   * @param ids - the buffer which takes the vertexes by order.
+   */
+  void path(SearchContext& context, Id from, Id to, std::vector<Id>& ids) const;
+
+  /**
+   * Gets paths of several pairs of vertexes.
+   * Pairs are grouped by source, so one search from every distinct source
+   * is continued until all its targets are settled.
+   * @param pairs - sources and targets.
+   * @return paths in order of the pairs.
+   */
+  std::vector<std::list<Id>> paths(std::vector<std::pair<Id, Id>> const& pairs);
+
+  /**
+   * Gets paths of several pairs of vertexes in the given context.
+   * If several threads are set, sources are shared among the workers
+   * and every worker searches in its own context, its work is added to
+   * counters of the given context.
+   * @param context - the search context of the caller.
+   * @param pairs - sources and targets.
+   * @return paths in order of the pairs.
+   */
+  std::vector<std::list<Id>> paths(SearchContext& context,
+                                   std::vector<std::pair<Id, Id>> const& pairs) const;
+
+  /**
+   * Gets path from a source to a target vertex by bidirectional search.
+   * Forward search goes from the source by outgoing edges and backward one
+   * goes from the target by incoming edges until they meet.
+   * The forward part is kept, so it is continued by next path() request.
+   * @param from - the source vertex.
+   * @param to - the target vertex.
+   * @return list of the vertex by order.
+   */
+  std::list<Id> bidirectionalPath(Id from, Id to);
+
+  /**
+   * Gets path by bidirectional search in the given context.
+   * @param context - the search context of the caller.
+   * @param from - the source vertex.
+   * @param to - the target vertex.
+   * @return list of the vertex by order.
+   */
+  std::list<Id> bidirectionalPath(SearchContext& context, Id from, Id to) const;
+
+  /**
+   * Gets shortest path tree of every vertex reachable from the source.
+   * It is calculated by parallel delta-stepping if several threads are set.
+   * @param from - the source vertex.
+   * @return the complete tree.
+   */
+  Tree distances(Id from);
+
+  /**
+   * Gets shortest path tree of every reachable vertex in the given context.
+   * Work of the parallel calculation is added to counters of the context.
+   * @param context - the search context of the caller.
+   * @param from - the source vertex.
+   * @return the complete tree.
+   */
+  Tree distances(SearchContext& context, Id from) const;
+
+  /**
+   * Builds contraction hierarchy of the graph to answer hierarchyPath().
+   * It is built without holding queries which run meanwhile on the graph
+   * and replaces the previous one, so it may be built on a snapshot.
+   */
+  void buildHierarchy();
+
+  /**
+   * Gets the hierarchy which was built or taken from another snapshot.
+   * @return the hierarchy, null if there is none.
+   */
+  std::shared_ptr<ContractionHierarchy const> currentHierarchy() const;
+
+  /**
+   * Gets path from a source to a target vertex by contraction hierarchy.
+   * The hierarchy is built again if vertexes or edges were added or removed
+   * since it was built, and it is customized if only weights were changed.
+   * @param from - the source vertex.
+   * @param to - the target vertex.
+   * @return list of the vertex by order.
+   */
+  std::list<Id> hierarchyPath(Id from, Id to);
+
+  /**
+   * Function which takes index of the first row and distances of the rows
+   * one after another.
+   */
+  using Rows = std::function<void(std::size_t, std::vector<Distance> const&)>;
+
+  /**
+   * Calculates distances from every source to every target, only distances
+   * are found without paths. They are found in contraction hierarchy if it
+   * was built or customized for the current version, otherwise by Dijkstra
+   * search from every source which stops when all the targets are settled.
+   * The hierarchy is never built here.
+   * @param sources - the source vertexes, one row per source.
+   * @param targets - the target vertexes, one column per target.
+   * @param chunk - number of rows which are given at once.
+   * @param rows - function which takes the rows, infinity means no path.
+   */
+  void distanceMatrix(std::vector<Id> const& sources, std::vector<Id> const& targets,
+                      std::size_t chunk, Rows const& rows);
+
+  /**
+   * Calculates distances of a matrix like distanceMatrix(), the work of
+   * Dijkstra search of the workers is added to counters of the given context.
+   * @param context - the search context of the caller.
+   * @param sources - the source vertexes, one row per source.
+   * @param targets - the target vertexes, one column per target.
+   * @param chunk - number of rows which are given at once.
+   * @param rows - function which takes the rows, infinity means no path.
+   */
+  void distanceMatrix(SearchContext& context, std::vector<Id> const& sources,
+                      std::vector<Id> const& targets, std::size_t chunk, Rows const& rows);
+
+  /**
+   * Selects landmarks and measures distances to answer landmarkPath().
+   * Like the hierarchy, they are built without holding queries.
+   * @param count - number of landmarks.
+   */
+  void buildLandmarks(std::size_t count = kLandmarks);
+
+  /**
+   * Gets the landmarks which were built or taken from another snapshot.
+   * @return the landmarks, null if there are none.
+   */
+  std::shared_ptr<Landmarks const> currentLandmarks() const;
+
+  /**
+   * Gets path from a source to a target vertex by A* search with landmarks.
+   * If some weight was decreased or an edge was added since the landmarks
+   * were measured, their bounds may be wrong, so the path is searched by
+   * Dijkstra until refreshLandmarks() measures them again.
+   * @param from - the source vertex.
+   * @param to - the target vertex.
+   * @return list of the vertex by order.
+   */
+  std::list<Id> landmarkPath(Id from, Id to);
+
+  /**
+   * Gets path by A* search with landmarks in the given context.
+   * @param context - the search context of the caller.
+   * @param from - the source vertex.
+   * @param to - the target vertex.
+   * @return list of the vertex by order.
+   */
+  std::list<Id> landmarkPath(SearchContext& context, Id from, Id to);
+
+  /**
+   * Checks whether the landmarks need to be measured again.
+   * @return true if some weight was decreased or an edge was added since
+   * the landmarks were measured.
+   */
+  bool hasStaleLandmarks() const;
+
+  /**
+   * Measures distances of the same landmarks again if they are stale.
+   * A copy is measured without holding queries, so it is meant to run in
+   * background while the graph is queried.
+   */
+  void refreshLandmarks();
+
+  /**
+   * Starts recording of vertexes whose edges are changed, so a copy of the
+   * graph is brought up to date by update() instead of being copied again.
+   */
+  void recordChanges();
+
+  /**
+   * Takes vertexes which were added, removed or whose edges were changed
+   * since the previous call.
+   * @return IDs of the vertexes.
+   */
+  std::unordered_set<Id> takeChanges();
+
+  /**
+   * Brings a copy of the graph up to date with the origin.
+   * Only the changed vertexes are copied, so it takes time proportional to
+   * their edges. The version, the settings and the shared structures are
+   * taken from the origin.
+   * @param origin - the graph which the copy was made of.
+   * @param changed - vertexes which were changed since the copy was equal to the origin.
+   */
+  void update(Graph const& origin, std::unordered_set<Id> const& changed);
+
+  /**
+   * Takes the hierarchy and the landmarks of another snapshot of the same
+   * graph if they were built or updated for a later version than the own
+   * ones, or for the same version but later.
+   * They are brought up to date with this graph when they are used.
+   * @param other - the other snapshot, both may be queried meanwhile.
+   */
+  void share(Graph const& other);
+
+  /**
+   * Gets all vertexes of the graph.
+   * @return vertexes by their IDs.
+   */
+  std::unordered_map<Id, Vertex> const& vertexes() const { return vertexes_; }
+
+  /**
+   * Sets memory budget of cache of shortest path trees.
+   * @param bytes - the budget.
+   */
+  void setCacheBudget(std::size_t bytes);
+
+  /**
+   * Gets counters of cache of shortest path trees.
+   * The cache is shared by snapshots, so they have the same counters.
+   * @return the counters.
+   */
+  TreeCache::Statistics cacheStatistics() const;
+
+  /**
+   * Sets how much of a cached tree may be repaired after modification of
+   * an edge, the tree is dropped and calculated again if more is affected.
+   * @param share - part of the tree from 0 to 1.
+   */
+  void setRepairLimit(double share) { repairLimit_ = share; }
+
+  /**
+   * Sets number of threads for one-to-all calculations.
+   * @param threads - the number of threads, one means sequential Dijkstra.
+   */
+  void setThreads(std::size_t threads);
+
+  /**
+   * Sets size of graph from which paths of a source with several targets
+   * are found by calculation of the whole tree in parallel instead of
+   * sequential search which stops at the farthest target. A single path is
+   * always searched sequentially.
+   * @param vertexes - number of vertexes.
+   */
+  void setParallelThreshold(std::size_t vertexes) { parallelThreshold_ = vertexes; }
+
+  /**
+   * Gets cache of shortest path trees.
+   * @return the cache.
+   */
+  TreeCache const& cache() const { return cache_->trees; }
+
+  /**
+   * Gets version of the graph, every modification changes it.
+   * @return the version.
+   */
+  std::size_t version() const { return version_; }
+
+  /**
+   * Gets ID of the next added vertex, IDs of all vertexes are less than it.
+   * @return the ID.
+   */
+  Id nextId() const { return id_; }
+
+  /**
+   * Gets number of slots of vertexes, every search context keeps states of
+   * this many vertexes. A new vertex takes the lowest free slot and slots
+   * are compacted when less than a half of them are taken, so unlike IDs
+   * they are not used up by removed vertexes.
+   * @return the number of slots.
+   */
+  std::size_t slots() const { return slots_; }
+
+  /**
+   * Gets layout of slots, it changes when compaction moves vertexes to
+   * other slots, so tables which are indexed by slot are remapped.
+   * @return the number of compactions.
+   */
+  std::size_t layout() const { return layout_; }
+
+  /**
+   * Default number of landmarks.
+   */
+  static constexpr std::size_t kLandmarks = 8;
+
+  /**
+   * Default size of graph to search paths of a source in parallel.
+   */
+  static constexpr std::size_t kParallelThreshold = 100000;
+
+  /**
+   * Maximal number of vertexes which one batch adds.
+   */
+  static constexpr std::size_t kMaxAdded = 10000000;
+
 protected:
   /**
-   * Initializes graph to calculate.
+   * Initializes the context to calculate in the graph.
+   * Starts new generation of search, so it takes constant time.
+   * @param c - the search context.
+   */
+  void init(SearchContext& c) const;
+
+  /**
+   * Checks whether the search of the context runs in the current version
+   * of the graph.
+   * @param c - the search context.
+   * @return true if the search is actual.
+   */
+  bool isActual(SearchContext const& c) const;
+
+  /**
+   * Brings the vertex into the current search.
+   * Resets the state of the vertex if it was left by an older search.
+   * @param c - the search context.
+   * @param v - the vertex.
+   */
+  void reach(SearchContext& c, Vertex const& v) const;
+
+  /**
+   * Checks whether the vertex was reached by the current search.
+   * @param c - the search context.
+   * @param v - the vertex.
+   * @return true if the vertex was reached.
    */
-  void init();
+  bool isReached(SearchContext const& c, Vertex const& v) const;
+
+  /**
+   * Brings the vertex into the current backward search.
+   * @param c - the search context.
+   * @param v - the vertex.
+   */
+  void reachBack(SearchContext& c, Vertex const& v) const;
+
+  /**
+   * Checks whether the vertex was reached by the current backward search.
+   * @param c - the search context.
+   * @param v - the vertex.
+   * @return true if the vertex was reached.
+   */
+  bool isReachedBack(SearchContext const& c, Vertex const& v) const;
+
+  /**
+   * Updates distance to the vertexes which have edge to the current vertex
+   * in the backward search.
+   * @param c - the search context.
+   * @param a - current vertex.
+   */
+  void updateIncoming(SearchContext& c, Vertex const& a) const;
 
   /**
    * Sets the vertex like source.
+   * @param c - the search context.
    * @param v - the source vertex.
    */
-  void setSource(Vertex& v);
+  void setSource(SearchContext& c, Vertex const& v) const;
+
+  /**
+   * Checks whether the vertex is source of the current search.
+   * @param c - the search context.
+   * @param v - the vertex.
+   * @return true if the vertex is source.
+   */
+  bool isSource(SearchContext const& c, Vertex const& v) const;
 
   /**
    * Updates distance to neighbors of the current vertex through it.
+   * @param c - the search context.
    * @param a - current vertex.
    */
-  void updateNeighbors(Vertex const& a);
+  void updateNeighbors(SearchContext& c, Vertex const& a) const;
 
   /**
    * Marks vertex as visited.
+   * @param c - the search context.
    * @param a - the vertex.
    */
-  void markAsVisited(Vertex& a);
+  void markAsVisited(SearchContext& c, Vertex const& a) const;
 
   /**
    * Checks whether calculation finished.
+   * @param c - the search context.
    * @return true if calculation finished.
    */
-  bool isFinished() const;
+  bool isFinished(SearchContext const& c) const;
 
   /**
    * Gets the next unvisited vertex with the minimum distance.
+   * @param c - the search context.
    * @return the vertex.
    */
-  Vertex& next();
+  Vertex const& next(SearchContext const& c) const;
+
+  /**
+   * Checks whether the shortest distance to the vertex is already known.
+   * @param c - the search context.
+   * @param v - the vertex.
+   * @return true if the vertex was visited by the current search.
+   */
+  bool isSettled(SearchContext const& c, Vertex const& v) const;
+
+  /**
+   * Settles the next unvisited vertex with the minimum distance.
+   * @param c - the search context.
+   */
+  void step(SearchContext& c) const;
+
+  /**
+   * Starts new search from the source vertex.
+   * @param c - the search context.
+   * @param from - the source vertex.
+   */
+  void start(SearchContext& c, Vertex const& from) const;
+
+  /**
+   * Continues the current search until the target vertex is settled
+   * or there is no reachable vertex anymore.
+   * @param c - the search context.
+   * @param to - the target vertex.
+   */
+  void resume(SearchContext& c, Vertex const& to) const;
+
+  /**
+   * Makes shortest path tree of the current search.
+   * @param c - the search context.
+   * @return the tree of settled vertices.
+   */
+  Tree tree(SearchContext const& c) const;
+
+  /**
+   * Puts the tree of the current search into the cache if it is actual.
+   * @param c - the search context.
+   */
+  void save(SearchContext const& c) const;
 
   /**
    * Calculate distance from source vertex to every one.
+   * @param c - the search context.
    * @param from - the source vertex.
    */
-  void calculate(Vertex& from);
+  void calculate(SearchContext& c, Vertex const& from) const;
 
   /**
    * Gets path to the target vertex.
+   * @param c - the search context.
    * @param to - the target vertex.
    * @return list of the vertex by order.
    */
-  std::list<Id> path(Vertex const& to) const;
+  std::list<Id> path(SearchContext const& c, Vertex const& to) const;
 
   /**
    * Gets vertex by id
@@ -135,17 +755,136 @@ protected:
    */
   Vertex& operator[](Id id) { return *at(id); }
 
-  bool hasUnvisited(Id id)
-  { return unvisited_.find(at(id)) != unvisited_.end(); }
+  bool hasUnvisited(SearchContext const& c, Id id) const {
+    return c.unvisited_.contains(id);
+  }
+
+  /**
+   * Gets number of additions and removals of vertexes or edges, the
+   * hierarchy is built again when it changes.
+   * @return the number.
+   */
+  std::size_t topology() const { return topology_; }
 
 private:
-  struct LessDistance { bool operator()(Vertex const* lhs, Vertex const* rhs) const; };
+  void erase(Vertex* v);
+  std::size_t take();
+  void compact();
+  void touch(Id id);
+
+  /**
+   * Copies edges of a vertex of another graph, so they refer to the own
+   * vertexes. Mapped edges are not copied, they refer to the own table.
+   * @param copy - the own edges.
+   * @param edges - the edges of the other graph.
+   */
+  void assign(Edges& copy, Edges const& edges);
+
+  /**
+   * Makes table of the own vertexes by index in the mapped file.
+   */
+  void index();
+
+  /**
+   * Removes vertexes and repairs cached trees like a change of an edge.
+   * @param victims - the distinct vertexes.
+   */
+  void remove(std::vector<Vertex*> const& victims);
+
+  /**
+   * Checks that a batch can be applied.
+   * @param batch - the changes in order.
+   */
+  void check(std::vector<Mutation> const& batch) const;
+  bool isParallel() const;
+  Tree parallelTree(SearchContext& c, Id from) const;
+  Workers& workers() const;
+  std::optional<std::list<Id>> search(SearchContext& c, Vertex const& source,
+                                      Vertex const& target, bool force,
+                                      bool parallel) const;
+  std::shared_ptr<ContractionHierarchy const> hierarchy();
+
+  /**
+   * Calculates distances of a matrix by Dijkstra search in the contexts of
+   * the workers.
+   * @param context - the context which the work of the workers is added to.
+   * @param sources - the source vertexes.
+   * @param targets - the target vertexes.
+   * @param chunk - number of rows which are given at once.
+   * @param rows - function which takes the rows.
+   */
+  void searchMatrix(SearchContext& context, std::vector<Id> const& sources,
+                    std::vector<Id> const& targets, std::size_t chunk, Rows const& rows) const;
+  void changed(Vertex const& a, Vertex const& b, Distance before, Distance after);
+  bool decrease(Tree& t, Vertex const& a, Vertex const& b, Distance weight) const;
+  bool increase(Tree& t, Vertex const& a, Vertex const& b) const;
+  std::vector<std::shared_ptr<Tree>> takeTrees(std::size_t version);
+  void restoreTrees(std::vector<std::shared_ptr<Tree>> trees);
+  std::size_t limit(Tree const& t) const;
   Vertex* at(Id id);
+  Vertex const* at(Id id) const;
   void checkDistance(Distance distance) const;
+
+  /**
+   * Gives the graph its own cache if it shares the cache of the graph
+   * which it was copied from, it is called before the graph is changed.
+   */
+  void detach();
+
+  /**
+   * Cache of trees, it is shared by snapshots of the graph.
+   */
+  struct Cache {
+    std::mutex mutex;
+    TreeCache trees;
+  };
+
+  /**
+   * Workers of parallel calculations, they are shared by snapshots.
+   */
+  struct Pool {
+    std::mutex mutex;
+    std::unique_ptr<Workers> workers;
+    std::unique_ptr<DeltaStepping> deltaStepping;
+    std::unique_ptr<SearchContext[]> contexts;  // one per worker
+  };
+
+  /**
+   * Locks of the structures which are built by concurrent queries.
+   */
+  struct Locks {
+    std::mutex hierarchy;
+    std::mutex landmarks;
+    std::mutex hierarchyBuild;  // held by a lazy build, so concurrent queries do not repeat it
+    std::mutex landmarksBuild;
+  };
+
   Id id_{0};
   std::unordered_map<Id, Vertex> vertexes_;
-  std::set<Vertex*, LessDistance> unvisited_{LessDistance{}};
-  bool dirty_{true};
+  std::size_t slots_{0};
+  std::vector<std::size_t> free_;  // free slots in a min-heap
+  std::size_t layout_{0};
+  std::unique_ptr<SearchContext> context_{std::make_unique<SearchContext>()};
+  std::unique_ptr<Locks> locks_{std::make_unique<Locks>()};
+  std::shared_ptr<Cache> cache_{std::make_shared<Cache>()};
+  bool borrowed_{false};  // the cache is the one of the origin of the copy
+  std::size_t version_{0};
+  std::size_t topology_{0};
+  double repairLimit_{0.5};
+  std::shared_ptr<ContractionHierarchy> hierarchy_;
+  std::size_t hierarchyVersion_{0};
+  std::size_t hierarchyTopology_{0};
+  std::size_t hierarchyBuild_{0};  // order of the builds among snapshots
+  std::shared_ptr<Landmarks> landmarks_;
+  std::size_t decrease_{0};  // number of decreased distances
+  std::size_t landmarksDecrease_{0};
+  std::size_t landmarksBuild_{0};
+  std::size_t threads_{1};
+  std::size_t parallelThreshold_{kParallelThreshold};
+  std::shared_ptr<Pool> pool_{std::make_shared<Pool>()};
+  std::unique_ptr<std::unordered_set<Id>> changes_;  // it is set if changes are recorded
+  std::shared_ptr<SnapshotMapping const> mapping_;  // loaded file which edges may refer to
+  std::vector<Vertex*> table_;  // vertexes by index in the mapped file
 };
 
 #endif /* GRAPH_H_ */
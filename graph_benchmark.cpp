@@ -1,6 +1,15 @@
 #include <benchmark/benchmark.h>
 
+#include <cstdio>
+#include <filesystem>
+
+#include "binary.h"
+#include "delta_stepping.h"
 #include "graph.h"
+#include "journal.h"
+#include "logger.h"
+#include "processor.h"
+#include "snapshot.h"
 
 static void BM_SPF_CalculatePath(benchmark::State& state) {
   Graph g;
@@ -51,3 +60,373 @@ BENCHMARK(BM_SPF_GetPath)
   ->Args({4, 1})
   ->Args({5, 0})
   ->Complexity();
+
+static Graph grid(Id side) {
+  Graph g;
+  for (Id i = 0; i < side * side; ++i) g.addVertex();
+  for (Id row = 0; row < side; ++row) {
+    for (Id col = 0; col < side; ++col) {
+      auto v = row * side + col;
+      auto weight = 1.0 + (v * 7919) % 10;
+      if (col + 1 < side) { g.setEdge(v, v + 1, weight); g.setEdge(v + 1, v, weight); }
+      if (row + 1 < side) { g.setEdge(v, v + side, weight); g.setEdge(v + side, v, weight); }
+    }
+  }
+  return g;
+}
+
+static void BM_SPF_GridDijkstra(benchmark::State& state) {
+  Id side = state.range(0);
+  auto g = grid(side);
+  auto center = side / 2 * side + side / 2;
+
+  for (auto _ : state) {
+    g.path(0, center, true);
+  }
+  state.SetComplexityN(side * side);
+}
+BENCHMARK(BM_SPF_GridDijkstra)->RangeMultiplier(2)->Range(16, 256)->Complexity();
+
+static void BM_SPF_GridBidirectional(benchmark::State& state) {
+  Id side = state.range(0);
+  auto g = grid(side);
+  auto center = side / 2 * side + side / 2;
+
+  for (auto _ : state) {
+    g.bidirectionalPath(0, center);
+  }
+  state.SetComplexityN(side * side);
+}
+BENCHMARK(BM_SPF_GridBidirectional)->RangeMultiplier(2)->Range(16, 256)->Complexity();
+
+static void BM_SPF_GridPaths(benchmark::State& state) {
+  Id side = state.range(0);
+  auto g = grid(side);
+  std::vector<std::pair<Id, Id>> pairs;
+  for (Id i = 0; i < 64; ++i) {
+    pairs.emplace_back(i % 4 * side, (i * 7919) % (side * side));
+  }
+
+  for (auto _ : state) {
+    g.setEdge(0, 1, 1.0 + state.iterations() % 2);
+    g.paths(pairs);
+  }
+  state.SetComplexityN(side * side);
+}
+BENCHMARK(BM_SPF_GridPaths)->RangeMultiplier(2)->Range(16, 256)->Complexity();
+
+static void BM_SPF_GridPathsByWorkers(benchmark::State& state) {
+  Id side = state.range(0);
+  auto g = grid(side);
+  g.setThreads(state.range(1));
+  std::vector<std::pair<Id, Id>> pairs;
+  for (Id i = 0; i < 64; ++i) {
+    pairs.emplace_back(i % 8 * side, (i * 7919) % (side * side));
+  }
+
+  for (auto _ : state) {
+    g.setEdge(0, 1, 1.0 + state.iterations() % 2);
+    g.paths(pairs);
+  }
+}
+BENCHMARK(BM_SPF_GridPathsByWorkers)->ArgsProduct({{64, 128}, {1, 2, 4}})->UseRealTime();
+
+static void BM_SPF_GridContextPath(benchmark::State& state) {
+  static Graph const g = [] {
+    auto g = grid(128);
+    g.setCacheBudget(0);
+    return g;
+  }();
+  SearchContext context;
+  std::vector<Id> ids;
+  Id const n = g.nextId();
+  Id i = state.thread_index();
+
+  for (auto _ : state) {
+    g.path(context, i * 7919 % n, i * 104729 % n, ids);
+    ++i;
+  }
+}
+BENCHMARK(BM_SPF_GridContextPath)->ThreadRange(1, 4)->UseRealTime();
+
+static std::shared_ptr<SharedGraph> sharedGrid(Id side) {
+  auto graph = std::make_shared<SharedGraph>();
+  graph->modify([side](Graph& g) { g = grid(side); });
+  return graph;
+}
+
+static void BM_SPF_ServeGetPath(benchmark::State& state) {
+  Processor p{sharedGrid(2)};
+  Processor::Send send = [](std::string const&) {};
+  std::string const request{R"({"action":"GetPath","from":0,"to":3})"};
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(p.serve(request, send).data());
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SPF_ServeGetPath);
+
+static void BM_SPF_ServeBinaryGetPath(benchmark::State& state) {
+  Processor p{sharedGrid(2)};
+  Processor::Send send = [](std::string const&) {};
+  std::string request;
+  BinaryWriter w{request};
+  w.u8(static_cast<std::uint8_t>(Opcode::kGetPath));
+  w.u64(0);
+  w.u64(3);
+  w.u8(static_cast<std::uint8_t>(Algorithm::kDijkstra));
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(p.serveBinary(request, send).data());
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SPF_ServeBinaryGetPath);
+
+/**
+ * Edges of a grid like grid() makes.
+ */
+static std::vector<std::pair<Id, Id>> gridEdges(Id side) {
+  std::vector<std::pair<Id, Id>> edges;
+  for (Id row = 0; row < side; ++row) {
+    for (Id col = 0; col < side; ++col) {
+      auto v = row * side + col;
+      if (col + 1 < side) { edges.emplace_back(v, v + 1); edges.emplace_back(v + 1, v); }
+      if (row + 1 < side) { edges.emplace_back(v, v + side); edges.emplace_back(v + side, v); }
+    }
+  }
+  return edges;
+}
+
+static void BM_SPF_ServeAddEdges(benchmark::State& state) {
+  Id side = state.range(0);
+  auto edges = gridEdges(side);
+  std::vector<std::string> requests;
+  for (auto [from, to]: edges) {
+    requests.push_back(R"({"action":"AddEdge","from":)" + std::to_string(from) +
+                       R"(,"to":)" + std::to_string(to) + R"(,"weight":1})");
+  }
+  Processor::Send send = [](std::string const&) {};
+
+  for (auto _ : state) {
+    Processor p;
+    for (Id i = 0; i < side * side; ++i) p.serve(R"({"action":"AddVertex"})", send);
+    for (auto const& request: requests) p.serve(request, send);
+  }
+  state.SetItemsProcessed(state.iterations() * edges.size());
+}
+BENCHMARK(BM_SPF_ServeAddEdges)->Arg(64)->Arg(256)->Unit(benchmark::kMillisecond);
+
+static void BM_SPF_ServeBatch(benchmark::State& state) {
+  Id side = state.range(0);
+  auto edges = gridEdges(side);
+  std::string request{R"({"action":"Batch","mutations":[{"type":"AddVertices","count":)"};
+  request += std::to_string(side * side) + R"(},{"type":"AddEdges","edges":[)";
+  for (auto [from, to]: edges) {
+    request += R"({"from":)" + std::to_string(from) + R"(,"to":)" + std::to_string(to) +
+               R"(,"weight":1},)";
+  }
+  request.back() = ']';
+  request += "}]}";
+  Processor::Send send = [](std::string const&) {};
+
+  for (auto _ : state) {
+    Processor p;
+    p.serve(request, send);
+  }
+  state.SetItemsProcessed(state.iterations() * edges.size());
+}
+BENCHMARK(BM_SPF_ServeBatch)->Arg(64)->Arg(256)->Arg(1024)->Unit(benchmark::kMillisecond);
+
+static void BM_SPF_ServeBinaryBatch(benchmark::State& state) {
+  Id side = state.range(0);
+  auto edges = gridEdges(side);
+  std::string request;
+  BinaryWriter w{request};
+  w.u8(static_cast<std::uint8_t>(Opcode::kBatch));
+  w.u32(2);
+  w.u8(static_cast<std::uint8_t>(Mutation::Type::kAddVertices));
+  w.u32(static_cast<std::uint32_t>(side * side));
+  w.u8(static_cast<std::uint8_t>(Mutation::Type::kAddEdges));
+  w.u32(static_cast<std::uint32_t>(edges.size()));
+  for (auto [from, to]: edges) {
+    w.u64(from);
+    w.u64(to);
+    w.f64(1);
+  }
+  Processor::Send send = [](std::string const&) {};
+
+  for (auto _ : state) {
+    Processor p;
+    p.serveBinary(request, send);
+  }
+  state.SetItemsProcessed(state.iterations() * edges.size());
+}
+BENCHMARK(BM_SPF_ServeBinaryBatch)->Arg(64)->Arg(256)->Arg(1024)->Unit(benchmark::kMillisecond);
+
+static void BM_SPF_LoadSnapshot(benchmark::State& state) {
+  std::string file{"spf_benchmark.snapshot"};
+  Snapshot::write(grid(state.range(0)), file);
+  std::size_t edges = 0;
+
+  for (auto _ : state) {
+    Graph g;
+    Snapshot::read(file, g);
+    edges = 0;
+    for (auto const& p: g.vertexes()) edges += p.second.neighbors.size();
+  }
+  state.SetItemsProcessed(state.iterations() * edges);
+  std::remove(file.c_str());
+}
+BENCHMARK(BM_SPF_LoadSnapshot)->Arg(64)->Arg(256)->Arg(1024)->Unit(benchmark::kMillisecond);
+
+static void BM_SPF_LoadedGridDijkstra(benchmark::State& state) {
+  std::string file{"spf_benchmark.snapshot"};
+  Id side = state.range(0);
+  Snapshot::write(grid(side), file);
+  Graph g;
+  Snapshot::read(file, g);
+  auto center = side / 2 * side + side / 2;
+
+  for (auto _ : state) {
+    g.path(0, center, true);
+  }
+  state.SetComplexityN(side * side);
+  std::remove(file.c_str());
+}
+BENCHMARK(BM_SPF_LoadedGridDijkstra)->RangeMultiplier(2)->Range(16, 256)->Complexity();
+
+/**
+ * Serves AddEdge without journal (argument 0) or with journal which is
+ * flushed never (1), periodically (2) or always (3).
+ */
+static void BM_SPF_ServeAddEdgeJournal(benchmark::State& state) {
+  std::string directory{"spf_benchmark.wal"};
+  std::filesystem::remove_all(directory);
+  {
+    Processor p;
+    if (state.range(0) > 0) {
+      p.recover(directory, static_cast<Journal::Sync>(3 - state.range(0)));
+    }
+    Processor::Send send = [](std::string const&) {};
+    p.serve(R"({"action":"AddVertex"})", send);
+    p.serve(R"({"action":"AddVertex"})", send);
+    std::string const requests[] = {
+      R"({"action":"AddEdge","from":0,"to":1,"weight":1})",
+      R"({"action":"AddEdge","from":0,"to":1,"weight":2})"
+    };
+    std::size_t i = 0;
+
+    for (auto _ : state) {
+      p.serve(requests[i++ % 2], send);
+    }
+  }
+  std::filesystem::remove_all(directory);
+}
+BENCHMARK(BM_SPF_ServeAddEdgeJournal)->DenseRange(0, 3)->UseRealTime();
+
+static void BM_SPF_Log(benchmark::State& state) {
+  static std::FILE* output = std::fopen("/dev/null", "w");
+  static Logger logger{output, Logger::Level::kDebug};
+  std::string const response(state.range(0), 'x');
+
+  for (auto _ : state) {
+    logger.log(Logger::Level::kDebug, "response=", response);
+  }
+}
+BENCHMARK(BM_SPF_Log)->Arg(16)->Arg(4096)->ThreadRange(1, 4)->UseRealTime();
+
+static void BM_SPF_ServeGetDistances(benchmark::State& state) {
+  Processor p{sharedGrid(state.range(0))};
+  Processor::Send send = [](std::string const&) {};
+  std::string const request{R"({"action":"GetDistances","from":0})"};
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(p.serve(request, send).data());
+  }
+  state.SetItemsProcessed(state.iterations());
+  state.SetBytesProcessed(state.iterations() * p.serve(request, send).size());
+}
+BENCHMARK(BM_SPF_ServeGetDistances)->Arg(16)->Arg(64);
+
+static void BM_SPF_ServeBinaryGetDistances(benchmark::State& state) {
+  Processor p{sharedGrid(state.range(0))};
+  Processor::Send send = [](std::string const&) {};
+  std::string request;
+  BinaryWriter w{request};
+  w.u8(static_cast<std::uint8_t>(Opcode::kGetDistances));
+  w.u64(0);
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(p.serveBinary(request, send).data());
+  }
+  state.SetItemsProcessed(state.iterations());
+  state.SetBytesProcessed(state.iterations() * p.serveBinary(request, send).size());
+}
+BENCHMARK(BM_SPF_ServeBinaryGetDistances)->Arg(16)->Arg(64);
+
+static void BM_SPF_GridCalculate(benchmark::State& state) {
+  Id side = state.range(0);
+  auto g = grid(side);
+
+  for (auto _ : state) {
+    g.path(0, side * side - 1, true);
+  }
+  state.SetComplexityN(side * side);
+}
+BENCHMARK(BM_SPF_GridCalculate)->RangeMultiplier(2)->Range(16, 256)->Complexity();
+
+static void BM_SPF_GridDeltaStepping(benchmark::State& state) {
+  Id side = state.range(0);
+  auto g = grid(side);
+  Workers w{static_cast<std::size_t>(state.range(1))};
+  DeltaStepping d{w};
+
+  for (auto _ : state) {
+    d.tree(g, 0);
+  }
+  state.SetComplexityN(side * side);
+}
+BENCHMARK(BM_SPF_GridDeltaStepping)
+    ->ArgsProduct({{64, 256, 512}, {1, 2, 4, 8, 16}})->UseRealTime();
+
+static void BM_SPF_GridHierarchy(benchmark::State& state) {
+  Id side = state.range(0);
+  auto g = grid(side);
+  auto center = side / 2 * side + side / 2;
+  g.buildHierarchy();
+
+  for (auto _ : state) {
+    g.hierarchyPath(0, center);
+  }
+  state.SetComplexityN(side * side);
+}
+BENCHMARK(BM_SPF_GridHierarchy)->RangeMultiplier(2)->Range(16, 128)->Complexity();
+
+static void BM_SPF_GridDistanceMatrix(benchmark::State& state) {
+  Id side = state.range(0);
+  auto g = grid(side);
+  g.setThreads(state.range(1));
+  std::vector<Id> ids;
+  for (Id i = 0; i < 100; ++i) ids.push_back((i * 7919) % (side * side));
+  g.buildHierarchy();
+
+  for (auto _ : state) {
+    g.distanceMatrix(ids, ids, ids.size(), [](std::size_t, std::vector<Distance> const&) {});
+  }
+}
+BENCHMARK(BM_SPF_GridDistanceMatrix)->ArgsProduct({{64, 128}, {1, 2, 4}})->UseRealTime();
+
+static void BM_SPF_GridLandmarks(benchmark::State& state) {
+  Id side = state.range(0);
+  auto g = grid(side);
+  auto center = side / 2 * side + side / 2;
+  g.buildLandmarks();
+
+  for (auto _ : state) {
+    g.landmarkPath(0, center);
+  }
+  state.SetComplexityN(side * side);
+}
+BENCHMARK(BM_SPF_GridLandmarks)->RangeMultiplier(2)->Range(16, 256)->Complexity();
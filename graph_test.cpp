@@ -1,53 +1,108 @@
 #include <gtest/gtest.h>
 #include <gmock/gmock.h>
 
+#include <iterator>
+#include <limits>
+#include <list>
+#include <numeric>
+#include <random>
+#include <thread>
+
 #include "graph.h"
 
 using ::testing::Eq;
 using ::testing::ContainerEq;
+using ::testing::DoubleEq;
+using ::testing::Ne;
+using ::testing::Gt;
 
 class TestGraph : public Graph {
 public:
   using Graph::operator[];
   using Graph::hasUnvisited;
   using Graph::init;
+  using Graph::reach;
+  using Graph::isReached;
   using Graph::setSource;
   using Graph::updateNeighbors;
   using Graph::markAsVisited;
   using Graph::isFinished;
   using Graph::next;
+  using Graph::isSettled;
+  using Graph::start;
+  using Graph::resume;
   using Graph::calculate;
   using Graph::path;
+  using Graph::topology;
 };
 
+namespace {
+/**
+ * Gets length of a path, a path of the target alone is infinite unless the
+ * source is the target.
+ * @param g - the graph.
+ * @param from - the source vertex.
+ * @param p - the path.
+ * @return the length.
+ */
+Distance length(Graph const& g, Id from, std::list<Id> const& p) {
+  if (p.front() != from) return std::numeric_limits<Distance>::infinity();
+  Distance sum = 0;
+  for (auto it = begin(p); std::next(it) != end(p); ++it) {
+    auto const& neighbors = g.vertexes().at(*it).neighbors;
+    sum += neighbors.at(const_cast<Vertex*>(&g.vertexes().at(*std::next(it))));
+  }
+  return sum;
+}
+}  // namespace
+
 TEST(SPF, ShorterPathFound) {
-  Vertex a{0, {}, {6}};
-  Vertex b{1, {}, {10}};
-  a.neighbors = {{&b, 2}};
+  TestGraph g;
+  SearchContext c;
+  g.addVertex(); g.addVertex();
+  g.setEdge(0, 1, 2);
+  g.init(c);
+  g.reach(c, g[0]);
+  g.reach(c, g[1]);
+  c.info(0).distance = 6;
+  c.info(1).distance = 10;
 
-  b.setDistance(a);
+  g.updateNeighbors(c, g[0]);
 
-  EXPECT_THAT(b.info.distance, Eq(8));
+  EXPECT_THAT(c.info(1).distance, Eq(8));
 }
 
 TEST(SPF, NoShorterPath) {
-  Vertex a{0, {}, {6}};
-  Vertex b{1, {}, {7}};
-  a.neighbors = {{&b, 2}};
+  TestGraph g;
+  SearchContext c;
+  g.addVertex(); g.addVertex();
+  g.setEdge(0, 1, 2);
+  g.init(c);
+  g.reach(c, g[0]);
+  g.reach(c, g[1]);
+  c.info(0).distance = 6;
+  c.info(1).distance = 7;
 
-  b.setDistance(a);
+  g.updateNeighbors(c, g[0]);
 
-  EXPECT_THAT(b.info.distance, Eq(7));
+  EXPECT_THAT(c.info(1).distance, Eq(7));
 }
 
 TEST(SPF, VertexIsVisited) {
-  Vertex a{0, {}, {6}};
-  Vertex b{1, {}, {10, true}};
-  a.neighbors = {{&b, 2}};
+  TestGraph g;
+  SearchContext c;
+  g.addVertex(); g.addVertex();
+  g.setEdge(0, 1, 2);
+  g.init(c);
+  g.reach(c, g[0]);
+  g.reach(c, g[1]);
+  c.info(0).distance = 6;
+  c.info(1).distance = 10;
+  c.info(1).visited = true;
 
-  b.setDistance(a);
+  g.updateNeighbors(c, g[0]);
 
-  EXPECT_THAT(b.info.distance, Eq(10));
+  EXPECT_THAT(c.info(1).distance, Eq(10));
 }
 
 TEST(SPF, AddVertex) {
@@ -74,10 +129,50 @@ TEST(SPF, RemoveVertex) {
 TEST(SPF, RemoveVertexWithEdges) {
   TestGraph g;
   g.addVertex(); g.addVertex();
-  g[1].neighbors = {{&g[0], 20}};
+  g.setEdge(1, 0, 20);
+
+  g.removeVertex(0);
+  EXPECT_THAT(g[1].neighbors.size(), Eq(0));
+}
+
+TEST(SPF, RemoveVertexWithIncomingEdges) {
+  TestGraph g;
+  g.addVertex(); g.addVertex();
+  g.setEdge(0, 1, 20);
 
   g.removeVertex(0);
+  EXPECT_THAT(g[1].incoming.size(), Eq(0));
+}
+
+TEST(SPF, RemoveVertexWithLoop) {
+  TestGraph g;
+  g.addVertex(); g.addVertex();
+  g.setEdge(0, 0, 1); g.setEdge(0, 1, 1); g.setEdge(1, 0, 1);
+
+  g.removeVertex(0);
+  EXPECT_THROW(g[0], std::invalid_argument);
   EXPECT_THAT(g[1].neighbors.size(), Eq(0));
+  EXPECT_THAT(g[1].incoming.size(), Eq(0));
+}
+
+TEST(SPF, RemoveVertices) {
+  TestGraph g;
+  g.addVertex(); g.addVertex(); g.addVertex();
+  g.setEdge(0, 1, 1); g.setEdge(1, 2, 1); g.setEdge(2, 0, 1);
+
+  g.removeVertices({0, 1, 1});
+  EXPECT_THROW(g[0], std::invalid_argument);
+  EXPECT_THROW(g[1], std::invalid_argument);
+  EXPECT_THAT(g[2].neighbors.size(), Eq(0));
+  EXPECT_THAT(g[2].incoming.size(), Eq(0));
+}
+
+TEST(SPF, RemoveVerticesWithWrongId) {
+  TestGraph g;
+  g.addVertex();
+
+  EXPECT_THROW(g.removeVertices({0, 1}), std::invalid_argument);
+  EXPECT_NO_THROW(g[0]);
 }
 
 TEST(SPF, RemoveVertexWithWrongId) {
@@ -117,6 +212,15 @@ TEST(SPF, SetEdgeWithWrongTo) {
   EXPECT_THROW(g.setEdge(0, 1, 1.1), std::invalid_argument);
 }
 
+TEST(SPF, SetEdgeWithNotFiniteWeight) {
+  TestGraph g;
+  g.addVertex(); g.addVertex();
+
+  EXPECT_THROW(g.setEdge(0, 1, std::numeric_limits<Distance>::quiet_NaN()), std::invalid_argument);
+  EXPECT_THROW(g.setEdge(0, 1, std::numeric_limits<Distance>::infinity()), std::invalid_argument);
+  EXPECT_THAT(g[0].neighbors.empty(), Eq(true));
+}
+
 TEST(SPF, RemoveEdge) {
   TestGraph g;
   g.addVertex(); g.addVertex();
@@ -142,99 +246,197 @@ TEST(SPF, RemoveEdgeWithWrongTo) {
 
 TEST(SPF, UpdateNeighbors) {
   TestGraph g;
+  SearchContext c;
   g.addVertex(); g.addVertex(); g.addVertex();
   g.setEdge(0, 1, 3); g.setEdge(0, 2, 5);
-  g.init();
-  g.setSource(g[0]);
+  g.init(c);
+  g.setSource(c, g[0]);
 
-  g.updateNeighbors(g[0]);
+  g.updateNeighbors(c, g[0]);
 
-  EXPECT_THAT(g[1].info.distance, Eq(3));
-  EXPECT_THAT(g.hasUnvisited(1), Eq(true));
-  EXPECT_THAT(g[2].info.distance, Eq(5));
-  EXPECT_THAT(g.hasUnvisited(2), Eq(true));
+  EXPECT_THAT(c.info(1).distance, Eq(3));
+  EXPECT_THAT(g.hasUnvisited(c, 1), Eq(true));
+  EXPECT_THAT(c.info(2).distance, Eq(5));
+  EXPECT_THAT(g.hasUnvisited(c, 2), Eq(true));
+}
+
+TEST(SPF, UnreachedVertexIsNotQueued) {
+  TestGraph g;
+  SearchContext c;
+  g.addVertex(); g.addVertex();
+  g.init(c);
+  g.setSource(c, g[0]);
+
+  EXPECT_THAT(g.hasUnvisited(c, 1), Eq(false));
+}
+
+TEST(SPF, DecreaseQueuedNeighbor) {
+  TestGraph g;
+  SearchContext c;
+  g.addVertex(); g.addVertex(); g.addVertex(); g.addVertex();
+  g.setEdge(0, 1, 1); g.setEdge(0, 2, 5); g.setEdge(0, 3, 3);
+  g.setEdge(1, 2, 1);
+  g.init(c);
+  g.setSource(c, g[0]);
+  g.updateNeighbors(c, g[0]);
+  g.markAsVisited(c, g[0]);
+  g.updateNeighbors(c, g[1]);
+  g.markAsVisited(c, g[1]);
+
+  EXPECT_THAT(c.info(2).distance, Eq(2));
+  EXPECT_THAT(g.next(c).id, Eq(2));
 }
 
 TEST(SPF, SkipVisitedNeighbor) {
   TestGraph g;
+  SearchContext c;
+  g.addVertex(); g.addVertex();
+  g.setEdge(0, 1, 1);
+  g.init(c);
+  g.reach(c, g[0]);
+  g.reach(c, g[1]);
+  c.info(1).distance = 5;
+  c.info(1).visited = true;
+
+  g.updateNeighbors(c, g[0]);
+
+  EXPECT_THAT(c.info(1).distance, Eq(5));
+}
+
+TEST(SPF, InitLeavesVertexesUnreached) {
+  TestGraph g;
+  SearchContext c;
+  g.addVertex(); g.addVertex();
+  g.setEdge(0, 1, 1);
+  g.calculate(c, g[0]);
+
+  g.init(c);
+
+  EXPECT_THAT(g.isReached(c, g[0]), Eq(false));
+  EXPECT_THAT(g.isReached(c, g[1]), Eq(false));
+}
+
+TEST(SPF, ReachResetsStaleInfo) {
+  TestGraph g;
+  SearchContext c;
+  g.addVertex(); g.addVertex();
+  g.setEdge(0, 1, 1);
+  g.calculate(c, g[0]);
+  g.init(c);
+
+  g.reach(c, g[1]);
+
+  EXPECT_THAT(g.isReached(c, g[1]), Eq(true));
+  EXPECT_THAT(c.info(1).distance, Eq(std::numeric_limits<Distance>::infinity()));
+  EXPECT_THAT(c.info(1).visited, Eq(false));
+}
+
+TEST(SPF, StaleVertexHasNoPath) {
+  TestGraph g;
+  SearchContext c;
   g.addVertex(); g.addVertex();
   g.setEdge(0, 1, 1);
-  g.init();
-  g[1].info.distance = 5;
-  g[1].info.visited = true;
+  g.calculate(c, g[0]);
+  g.init(c);
+
+  EXPECT_THAT(g.path(c, g[1]), ContainerEq(std::list<Id>{1}));
+}
 
-  g.updateNeighbors(g[0]);
+TEST(SPF, ContextsAreIndependent) {
+  TestGraph g;
+  SearchContext a;
+  SearchContext b;
+  g.addVertex(); g.addVertex(); g.addVertex();
+  g.setEdge(0, 1, 1); g.setEdge(1, 2, 1); g.setEdge(2, 0, 1);
+  g.calculate(a, g[0]);
 
-  EXPECT_THAT(g[1].info.distance, Eq(5));
+  g.calculate(b, g[1]);
+
+  EXPECT_THAT(g.path(a, g[2]), ContainerEq(std::list<Id>{0, 1, 2}));
+  EXPECT_THAT(g.path(b, g[0]), ContainerEq(std::list<Id>{1, 2, 0}));
 }
 
 TEST(SPF, MarkAsVisited) {
   TestGraph g;
+  SearchContext c;
   g.addVertex(); g.addVertex();
+  g.init(c);
 
-  g.markAsVisited(g[0]);
+  g.markAsVisited(c, g[0]);
 
-  EXPECT_THAT(g[0].info.visited, Eq(true));
-  EXPECT_THAT(g.hasUnvisited(0), Eq(false));
+  EXPECT_THAT(c.info(0).visited, Eq(true));
+  EXPECT_THAT(g.hasUnvisited(c, 0), Eq(false));
 }
 
 TEST(SPF, TheEndNoUnvisited) {
   TestGraph g;
+  SearchContext c;
   g.addVertex(); g.addVertex();
 
-  EXPECT_THAT(g.isFinished(), Eq(true));
+  EXPECT_THAT(g.isFinished(c), Eq(true));
 }
 
 TEST(SPF, TheEndWithNoEdge) {
   TestGraph g;
+  SearchContext c;
   g.addVertex(); g.addVertex();
-  g.init();
-  g.markAsVisited(g[0]);
+  g.init(c);
+  g.markAsVisited(c, g[0]);
 
-  EXPECT_THAT(g.isFinished(), Eq(true));
+  EXPECT_THAT(g.isFinished(c), Eq(true));
 }
 
 TEST(SPF, NoFinished) {
   TestGraph g;
+  SearchContext c;
   g.addVertex(); g.addVertex();
-  g.init();
-  g.markAsVisited(g[0]);
-  g[1].info.distance = 4;
+  g.setEdge(0, 1, 4);
+  g.init(c);
+  g.setSource(c, g[0]);
+  g.updateNeighbors(c, g[0]);
+  g.markAsVisited(c, g[0]);
 
-  EXPECT_THAT(g.isFinished(), Eq(false));
+  EXPECT_THAT(g.isFinished(c), Eq(false));
 }
 
 TEST(SPF, FirstUnvisited) {
   TestGraph g;
+  SearchContext c;
   g.addVertex(); g.addVertex(); g.addVertex();
-  g.init();
-  g.setSource(g[0]);
+  g.init(c);
+  g.setSource(c, g[0]);
 
-  EXPECT_THAT(g.next().id, Eq(0));
+  EXPECT_THAT(g.next(c).id, Eq(0));
 }
 
 TEST(SPF, NextUnvisited) {
   TestGraph g;
+  SearchContext c;
   g.addVertex(); g.addVertex(); g.addVertex();
-  g.init();
-  g.markAsVisited(g[0]);
+  g.setEdge(0, 1, 3); g.setEdge(0, 2, 5);
+  g.init(c);
+  g.setSource(c, g[0]);
+  g.updateNeighbors(c, g[0]);
+  g.markAsVisited(c, g[0]);
 
-  EXPECT_THAT(g.next().id, Eq(1));
+  EXPECT_THAT(g.next(c).id, Eq(1));
 }
 
 TEST(SPF, SetSource) {
   TestGraph g;
+  SearchContext c;
   g.addVertex(); g.addVertex();
-  g.init();
+  g.init(c);
 
-  g.setSource(g[0]);
+  g.setSource(c, g[0]);
 
-  EXPECT_THAT(g[0].info.distance, Eq(0));
-  EXPECT_THAT(g.hasUnvisited(0), Eq(true));
+  EXPECT_THAT(c.info(0).distance, Eq(0));
+  EXPECT_THAT(g.hasUnvisited(c, 0), Eq(true));
 }
 
 TEST(SPF, Calculate) {
   TestGraph g;
+  SearchContext c;
   g.addVertex(); g.addVertex(); g.addVertex(); g.addVertex();
   g.addVertex(); g.addVertex();
   g.setEdge(0, 1, 7); g.setEdge(0, 2, 9); g.setEdge(0, 5, 14);
@@ -244,23 +446,52 @@ TEST(SPF, Calculate) {
   g.setEdge(4, 3, 6); g.setEdge(4, 5, 9);
   g.setEdge(5, 0, 14); g.setEdge(5, 2, 2); g.setEdge(5, 4, 9);
 
-  g.calculate(g[0]);
+  g.calculate(c, g[0]);
+
+  EXPECT_THAT(c.info(4).distance, Eq(20));
+}
+
+TEST(SPF, ResumeStopsAtTarget) {
+  TestGraph g;
+  SearchContext c;
+  g.addVertex(); g.addVertex(); g.addVertex();
+  g.setEdge(0, 1, 1); g.setEdge(1, 2, 1);
+  g.start(c, g[0]);
+
+  g.resume(c, g[1]);
+
+  EXPECT_THAT(g.isSettled(c, g[1]), Eq(true));
+  EXPECT_THAT(g.isSettled(c, g[2]), Eq(false));
+  EXPECT_THAT(g.hasUnvisited(c, 2), Eq(true));
+}
+
+TEST(SPF, ResumeToUnreachable) {
+  TestGraph g;
+  SearchContext c;
+  g.addVertex(); g.addVertex(); g.addVertex();
+  g.setEdge(0, 1, 1);
+  g.start(c, g[0]);
+
+  g.resume(c, g[2]);
 
-  EXPECT_THAT(g[4].info.distance, Eq(20));
+  EXPECT_THAT(g.isSettled(c, g[1]), Eq(true));
+  EXPECT_THAT(g.isFinished(c), Eq(true));
 }
 
 TEST(SPF, GetPath) {
   TestGraph g;
+  SearchContext c;
   g.addVertex(); g.addVertex(); g.addVertex(); g.addVertex();
   g.addVertex(); g.addVertex();
-  g[0].info = {0, true};
-  g[1].info = {0, true, &g[0]};
-  g[2].info = {0, true, &g[0]};
-  g[3].info = {0, true, &g[2]};
-  g[4].info = {0, true, &g[5]};
-  g[5].info = {0, true, &g[2]};
-
-  EXPECT_THAT(g.path(g[4]), ContainerEq(std::list<Id>{0, 2, 5, 4}));
+  g.init(c);
+  for (Id id = 0; id < 6; ++id) g.reach(c, g[id]);
+  c.info(1).previous = &g[0];
+  c.info(2).previous = &g[0];
+  c.info(3).previous = &g[2];
+  c.info(4).previous = &g[5];
+  c.info(5).previous = &g[2];
+
+  EXPECT_THAT(g.path(c, g[4]), ContainerEq(std::list<Id>{0, 2, 5, 4}));
 }
 
 TEST(SPF, GetPathWithWrongFrom) {
@@ -305,6 +536,24 @@ TEST(SPF, GetAlreadyCalculatedPath) {
   EXPECT_THAT(g.path(0, 4), ContainerEq(std::list<Id>{0, 2, 5, 4}));
 }
 
+TEST(SPF, ContinueSearchForFartherTarget) {
+  TestGraph g;
+  g.addVertex(); g.addVertex(); g.addVertex(); g.addVertex();
+  g.addVertex(); g.addVertex();
+  g.setEdge(0, 1, 7); g.setEdge(0, 2, 9); g.setEdge(0, 5, 14);
+  g.setEdge(1, 0, 7); g.setEdge(1, 2, 10); g.setEdge(1, 3, 15);
+  g.setEdge(2, 0, 9); g.setEdge(2, 1, 10); g.setEdge(2, 5, 2);
+  g.setEdge(3, 1, 15); g.setEdge(3, 2, 11); g.setEdge(3, 4, 6);
+  g.setEdge(4, 3, 6); g.setEdge(4, 5, 9);
+  g.setEdge(5, 0, 14); g.setEdge(5, 2, 2); g.setEdge(5, 4, 9);
+  SearchContext c;
+  g.path(c, 0, 1);
+  EXPECT_THAT(g.isSettled(c, g[4]), Eq(false));
+
+  EXPECT_THAT(g.path(c, 0, 4), ContainerEq(std::list<Id>{0, 2, 5, 4}));
+  EXPECT_THAT(g.path(c, 0, 3), ContainerEq(std::list<Id>{0, 1, 3}));
+}
+
 TEST(SPF, CalculatedTwoDifferentPathes) {
   Graph g;
   g.addVertex(); g.addVertex(); g.addVertex(); g.addVertex();
@@ -367,3 +616,1030 @@ TEST(SPF, RecalculateIfVertexRemoved) {
 
   EXPECT_THAT(g.path(0, 4), ContainerEq(std::list<Id>{0, 5, 4}));
 }
+
+TEST(SPF, AlternatingSourcesUseCache) {
+  Graph g;
+  g.addVertex(); g.addVertex(); g.addVertex(); g.addVertex();
+  g.addVertex(); g.addVertex();
+  g.setEdge(0, 1, 7); g.setEdge(0, 2, 9); g.setEdge(0, 5, 14);
+  g.setEdge(1, 0, 7); g.setEdge(1, 2, 10); g.setEdge(1, 3, 15);
+  g.setEdge(2, 0, 9); g.setEdge(2, 1, 10); g.setEdge(2, 5, 2);
+  g.setEdge(3, 1, 15); g.setEdge(3, 2, 11); g.setEdge(3, 4, 6);
+  g.setEdge(4, 3, 6); g.setEdge(4, 5, 9);
+  g.setEdge(5, 0, 14); g.setEdge(5, 2, 2); g.setEdge(5, 4, 9);
+  g.path(0, 4);
+  g.path(1, 5);
+
+  EXPECT_THAT(g.path(0, 4), ContainerEq(std::list<Id>{0, 2, 5, 4}));
+  EXPECT_THAT(g.cache().hits(), Eq(1));
+}
+
+TEST(SPF, CacheIsInvalidatedByModification) {
+  Graph g;
+  g.addVertex(); g.addVertex(); g.addVertex(); g.addVertex();
+  g.addVertex(); g.addVertex();
+  g.setEdge(0, 1, 7); g.setEdge(0, 2, 9); g.setEdge(0, 5, 14);
+  g.setEdge(1, 0, 7); g.setEdge(1, 2, 10); g.setEdge(1, 3, 15);
+  g.setEdge(2, 0, 9); g.setEdge(2, 1, 10); g.setEdge(2, 5, 2);
+  g.setEdge(3, 1, 15); g.setEdge(3, 2, 11); g.setEdge(3, 4, 6);
+  g.setEdge(4, 3, 6); g.setEdge(4, 5, 9);
+  g.setEdge(5, 0, 14); g.setEdge(5, 2, 2); g.setEdge(5, 4, 9);
+  g.path(0, 4);
+  g.path(1, 5);
+  g.setEdge(2, 5, 100);
+
+  EXPECT_THAT(g.path(0, 4), ContainerEq(std::list<Id>{0, 5, 4}));
+  EXPECT_THAT(g.cache().hits(), Eq(0));
+}
+
+TEST(SPF, RepairTreeIfWeightIncreased) {
+  Graph g;
+  g.addVertex(); g.addVertex(); g.addVertex(); g.addVertex();
+  g.addVertex(); g.addVertex();
+  g.setEdge(0, 1, 7); g.setEdge(0, 2, 9); g.setEdge(0, 5, 14);
+  g.setEdge(1, 0, 7); g.setEdge(1, 2, 10); g.setEdge(1, 3, 15);
+  g.setEdge(2, 0, 9); g.setEdge(2, 1, 10); g.setEdge(2, 5, 2);
+  g.setEdge(3, 1, 15); g.setEdge(3, 2, 11); g.setEdge(3, 4, 6);
+  g.setEdge(4, 3, 6); g.setEdge(4, 5, 9);
+  g.setEdge(5, 0, 14); g.setEdge(5, 2, 2); g.setEdge(5, 4, 9);
+  g.path(0, 3);
+  g.setEdge(2, 5, 100);
+
+  EXPECT_THAT(g.path(0, 4), ContainerEq(std::list<Id>{0, 5, 4}));
+  EXPECT_THAT(g.cache().hits(), Eq(1));
+}
+
+TEST(SPF, RepairTreeIfWeightDecreased) {
+  Graph g;
+  g.addVertex(); g.addVertex(); g.addVertex(); g.addVertex();
+  g.addVertex(); g.addVertex();
+  g.setEdge(0, 1, 7); g.setEdge(0, 2, 9); g.setEdge(0, 5, 14);
+  g.setEdge(1, 0, 7); g.setEdge(1, 2, 10); g.setEdge(1, 3, 15);
+  g.setEdge(2, 0, 9); g.setEdge(2, 1, 10); g.setEdge(2, 5, 2);
+  g.setEdge(3, 1, 15); g.setEdge(3, 2, 11); g.setEdge(3, 4, 6);
+  g.setEdge(4, 3, 6); g.setEdge(4, 5, 9);
+  g.setEdge(5, 0, 14); g.setEdge(5, 2, 2); g.setEdge(5, 4, 9);
+  g.path(0, 3);
+  g.setEdge(0, 4, 1);
+
+  EXPECT_THAT(g.path(0, 3), ContainerEq(std::list<Id>{0, 4, 3}));
+  EXPECT_THAT(g.cache().hits(), Eq(1));
+}
+
+TEST(SPF, RepairTreeIfEdgeRemoved) {
+  Graph g;
+  g.addVertex(); g.addVertex(); g.addVertex(); g.addVertex();
+  g.addVertex(); g.addVertex();
+  g.setEdge(0, 1, 7); g.setEdge(0, 2, 9); g.setEdge(0, 5, 14);
+  g.setEdge(1, 0, 7); g.setEdge(1, 2, 10); g.setEdge(1, 3, 15);
+  g.setEdge(2, 0, 9); g.setEdge(2, 1, 10); g.setEdge(2, 5, 2);
+  g.setEdge(3, 1, 15); g.setEdge(3, 2, 11); g.setEdge(3, 4, 6);
+  g.setEdge(4, 3, 6); g.setEdge(4, 5, 9);
+  g.setEdge(5, 0, 14); g.setEdge(5, 2, 2); g.setEdge(5, 4, 9);
+  g.path(0, 3);
+  g.removeEdge(2, 5);
+
+  EXPECT_THAT(g.path(0, 4), ContainerEq(std::list<Id>{0, 5, 4}));
+  EXPECT_THAT(g.cache().hits(), Eq(1));
+}
+
+TEST(SPF, RepairPartialTree) {
+  Graph g;
+  g.addVertex(); g.addVertex(); g.addVertex(); g.addVertex();
+  g.addVertex(); g.addVertex();
+  g.setEdge(0, 1, 7); g.setEdge(0, 2, 9); g.setEdge(0, 5, 14);
+  g.setEdge(1, 0, 7); g.setEdge(1, 2, 10); g.setEdge(1, 3, 15);
+  g.setEdge(2, 0, 9); g.setEdge(2, 1, 10); g.setEdge(2, 5, 2);
+  g.setEdge(3, 1, 15); g.setEdge(3, 2, 11); g.setEdge(3, 4, 6);
+  g.setEdge(4, 3, 6); g.setEdge(4, 5, 9);
+  g.setEdge(5, 0, 14); g.setEdge(5, 2, 2); g.setEdge(5, 4, 9);
+  g.path(0, 2);
+  g.setEdge(0, 1, 20);
+
+  EXPECT_THAT(g.path(0, 2), ContainerEq(std::list<Id>{0, 2}));
+  EXPECT_THAT(g.cache().hits(), Eq(1));
+  EXPECT_THAT(g.path(0, 1), ContainerEq(std::list<Id>{0, 2, 1}));
+  EXPECT_THAT(g.cache().misses(), Eq(2));
+}
+
+TEST(SPF, RecalculateIfRepairIsTooLarge) {
+  Graph g;
+  g.addVertex(); g.addVertex(); g.addVertex(); g.addVertex();
+  g.addVertex(); g.addVertex();
+  g.setEdge(0, 1, 7); g.setEdge(0, 2, 9); g.setEdge(0, 5, 14);
+  g.setEdge(1, 0, 7); g.setEdge(1, 2, 10); g.setEdge(1, 3, 15);
+  g.setEdge(2, 0, 9); g.setEdge(2, 1, 10); g.setEdge(2, 5, 2);
+  g.setEdge(3, 1, 15); g.setEdge(3, 2, 11); g.setEdge(3, 4, 6);
+  g.setEdge(4, 3, 6); g.setEdge(4, 5, 9);
+  g.setEdge(5, 0, 14); g.setEdge(5, 2, 2); g.setEdge(5, 4, 9);
+  g.setRepairLimit(0);
+  g.path(0, 3);
+  g.setEdge(2, 5, 100);
+
+  EXPECT_THAT(g.path(0, 4), ContainerEq(std::list<Id>{0, 5, 4}));
+  EXPECT_THAT(g.cache().hits(), Eq(0));
+}
+
+TEST(SPF, RepairedTreeMatchesRecalculation) {
+  std::mt19937 random{42};
+  std::uniform_int_distribution<Id> vertex{0, 29};
+  std::uniform_real_distribution<Distance> weight{1, 10};
+  TestGraph g;
+  Graph expected;
+  for (auto i = 0; i < 30; ++i) {
+    g.addVertex(); expected.addVertex();
+  }
+  for (auto i = 0; i < 120; ++i) {
+    auto from = vertex(random), to = vertex(random);
+    auto w = weight(random);
+    g.setEdge(from, to, w); expected.setEdge(from, to, w);
+  }
+  g.setRepairLimit(1);
+  g.distances(0);
+  auto const misses = g.cache().misses();
+
+  for (auto i = 0; i < 200; ++i) {
+    auto from = vertex(random), to = vertex(random);
+    if (i % 3 == 0) {
+      g.removeEdge(from, to); expected.removeEdge(from, to);
+    } else {
+      auto w = weight(random);
+      g.setEdge(from, to, w); expected.setEdge(from, to, w);
+    }
+    auto target = vertex(random);
+    ASSERT_THAT(g.path(0, target), ContainerEq(expected.path(0, target, true)));
+  }
+  EXPECT_THAT(g.cache().misses(), Eq(misses));
+}
+
+TEST(SPF, RepairTreeIfVertexRemoved) {
+  Graph g;
+  g.addVertex(); g.addVertex(); g.addVertex(); g.addVertex();
+  g.addVertex(); g.addVertex();
+  g.setEdge(0, 1, 7); g.setEdge(0, 2, 9); g.setEdge(0, 5, 14);
+  g.setEdge(1, 0, 7); g.setEdge(1, 2, 10); g.setEdge(1, 3, 15);
+  g.setEdge(2, 0, 9); g.setEdge(2, 1, 10); g.setEdge(2, 5, 2);
+  g.setEdge(3, 1, 15); g.setEdge(3, 2, 11); g.setEdge(3, 4, 6);
+  g.setEdge(4, 3, 6); g.setEdge(4, 5, 9);
+  g.setEdge(5, 0, 14); g.setEdge(5, 2, 2); g.setEdge(5, 4, 9);
+  g.path(0, 3);
+  g.removeVertex(2);
+
+  EXPECT_THAT(g.path(0, 4), ContainerEq(std::list<Id>{0, 5, 4}));
+  EXPECT_THAT(g.cache().hits(), Eq(1));
+}
+
+TEST(SPF, ContinueSearchAfterVertexRemoved) {
+  Graph g;
+  g.addVertex(); g.addVertex(); g.addVertex(); g.addVertex();
+  g.addVertex(); g.addVertex();
+  g.setEdge(0, 1, 7); g.setEdge(0, 2, 9); g.setEdge(0, 5, 14);
+  g.setEdge(1, 0, 7); g.setEdge(1, 2, 10); g.setEdge(1, 3, 15);
+  g.setEdge(2, 0, 9); g.setEdge(2, 1, 10); g.setEdge(2, 5, 2);
+  g.setEdge(3, 1, 15); g.setEdge(3, 2, 11); g.setEdge(3, 4, 6);
+  g.setEdge(4, 3, 6); g.setEdge(4, 5, 9);
+  g.setEdge(5, 0, 14); g.setEdge(5, 2, 2); g.setEdge(5, 4, 9);
+  g.path(0, 2);
+  g.removeVertex(2);
+
+  EXPECT_THAT(g.path(0, 4), ContainerEq(std::list<Id>{0, 5, 4}));
+  EXPECT_THAT(g.path(0, 3), ContainerEq(std::list<Id>{0, 1, 3}));
+}
+
+TEST(SPF, RepairedTreeMatchesRecalculationAfterRemoval) {
+  std::mt19937 random{7};
+  std::uniform_int_distribution<Id> vertex{0, 39};
+  std::uniform_real_distribution<Distance> weight{1, 10};
+  Graph g;
+  Graph expected;
+  for (auto i = 0; i < 40; ++i) {
+    g.addVertex(); expected.addVertex();
+  }
+  for (auto i = 0; i < 200; ++i) {
+    auto from = vertex(random), to = vertex(random);
+    auto w = weight(random);
+    g.setEdge(from, to, w); expected.setEdge(from, to, w);
+  }
+  g.setRepairLimit(1);
+  g.distances(0);
+
+  for (Id victim = 1; victim < 40; victim += 3) {
+    g.removeVertex(victim); expected.removeVertex(victim);
+    for (Id target = 0; target < 40; target += 3) {
+      ASSERT_THAT(g.path(0, target), ContainerEq(expected.path(0, target, true)));
+    }
+  }
+  EXPECT_THAT(g.cache().hits(), Eq(13 * 14));
+}
+
+TEST(SPF, SetEdgeKeepsIncoming) {
+  TestGraph g;
+  g.addVertex(); g.addVertex();
+
+  g.setEdge(0, 1, 2.3);
+
+  EXPECT_THAT(g[1].incoming[&g[0]], Eq(2.3));
+}
+
+TEST(SPF, RemoveEdgeKeepsIncoming) {
+  TestGraph g;
+  g.addVertex(); g.addVertex();
+  g.setEdge(0, 1, 2.3);
+
+  g.removeEdge(0, 1);
+
+  EXPECT_THAT(g[1].incoming.empty(), Eq(true));
+}
+
+TEST(SPF, BidirectionalPath) {
+  Graph g;
+  g.addVertex(); g.addVertex(); g.addVertex(); g.addVertex();
+  g.addVertex(); g.addVertex();
+  g.setEdge(0, 1, 7); g.setEdge(0, 2, 9); g.setEdge(0, 5, 14);
+  g.setEdge(1, 0, 7); g.setEdge(1, 2, 10); g.setEdge(1, 3, 15);
+  g.setEdge(2, 0, 9); g.setEdge(2, 1, 10); g.setEdge(2, 5, 2);
+  g.setEdge(3, 1, 15); g.setEdge(3, 2, 11); g.setEdge(3, 4, 6);
+  g.setEdge(4, 3, 6); g.setEdge(4, 5, 9);
+  g.setEdge(5, 0, 14); g.setEdge(5, 2, 2); g.setEdge(5, 4, 9);
+
+  EXPECT_THAT(g.bidirectionalPath(0, 4), ContainerEq(std::list<Id>{0, 2, 5, 4}));
+  EXPECT_THAT(g.bidirectionalPath(3, 0), ContainerEq(std::list<Id>{3, 2, 0}));
+}
+
+TEST(SPF, BidirectionalPathToItself) {
+  Graph g;
+  g.addVertex(); g.addVertex(); g.addVertex(); g.addVertex();
+  g.addVertex(); g.addVertex();
+  g.setEdge(0, 1, 7); g.setEdge(0, 2, 9); g.setEdge(0, 5, 14);
+  g.setEdge(1, 0, 7); g.setEdge(1, 2, 10); g.setEdge(1, 3, 15);
+  g.setEdge(2, 0, 9); g.setEdge(2, 1, 10); g.setEdge(2, 5, 2);
+  g.setEdge(3, 1, 15); g.setEdge(3, 2, 11); g.setEdge(3, 4, 6);
+  g.setEdge(4, 3, 6); g.setEdge(4, 5, 9);
+  g.setEdge(5, 0, 14); g.setEdge(5, 2, 2); g.setEdge(5, 4, 9);
+
+  EXPECT_THAT(g.bidirectionalPath(2, 2), ContainerEq(std::list<Id>{2}));
+}
+
+TEST(SPF, BidirectionalPathToUnreachable) {
+  Graph g;
+  g.addVertex(); g.addVertex(); g.addVertex();
+  g.setEdge(0, 1, 1); g.setEdge(2, 1, 1);
+
+  EXPECT_THAT(g.bidirectionalPath(0, 2), ContainerEq(std::list<Id>{2}));
+}
+
+TEST(SPF, BidirectionalPathWithWrongId) {
+  Graph g;
+  g.addVertex();
+
+  EXPECT_THROW(g.bidirectionalPath(0, 1), std::invalid_argument);
+}
+
+TEST(SPF, ContinueSearchAfterBidirectional) {
+  Graph g;
+  g.addVertex(); g.addVertex(); g.addVertex(); g.addVertex();
+  g.addVertex(); g.addVertex();
+  g.setEdge(0, 1, 7); g.setEdge(0, 2, 9); g.setEdge(0, 5, 14);
+  g.setEdge(1, 0, 7); g.setEdge(1, 2, 10); g.setEdge(1, 3, 15);
+  g.setEdge(2, 0, 9); g.setEdge(2, 1, 10); g.setEdge(2, 5, 2);
+  g.setEdge(3, 1, 15); g.setEdge(3, 2, 11); g.setEdge(3, 4, 6);
+  g.setEdge(4, 3, 6); g.setEdge(4, 5, 9);
+  g.setEdge(5, 0, 14); g.setEdge(5, 2, 2); g.setEdge(5, 4, 9);
+  g.bidirectionalPath(0, 1);
+
+  EXPECT_THAT(g.path(0, 3), ContainerEq(std::list<Id>{0, 1, 3}));
+  EXPECT_THAT(g.path(0, 4), ContainerEq(std::list<Id>{0, 2, 5, 4}));
+}
+
+TEST(SPF, BidirectionalPathAfterVertexAdded) {
+  Graph g;
+  g.addVertex(); g.addVertex();
+  g.setEdge(0, 1, 1);
+  g.bidirectionalPath(0, 1);
+  g.addVertex(); g.addVertex();
+  g.setEdge(1, 2, 1); g.setEdge(2, 3, 1); g.setEdge(0, 3, 5);
+
+  EXPECT_THAT(g.bidirectionalPath(0, 3), ContainerEq(std::list<Id>{0, 1, 2, 3}));
+}
+
+TEST(SPF, BidirectionalMatchesDijkstra) {
+  std::mt19937 random{7};
+  std::uniform_int_distribution<Id> vertex{0, 49};
+  std::uniform_real_distribution<Distance> weight{1, 10};
+  Graph g;
+  for (auto i = 0; i < 50; ++i) g.addVertex();
+  for (auto i = 0; i < 150; ++i) g.setEdge(vertex(random), vertex(random), weight(random));
+
+  for (auto i = 0; i < 100; ++i) {
+    auto from = vertex(random), to = vertex(random);
+    ASSERT_THAT(g.bidirectionalPath(from, to), ContainerEq(g.path(from, to, true)));
+  }
+}
+
+TEST(SPF, BidirectionalPathWithZeroWeight) {
+  Graph g;
+  for (auto i = 0; i < 6; ++i) g.addVertex();
+  g.setEdge(4, 5, 0);
+  g.setEdge(1, 3, 9);
+  g.setEdge(1, 5, 7);
+  g.setEdge(1, 0, 1);
+  g.setEdge(0, 4, 1);
+
+  EXPECT_THAT(g.bidirectionalPath(1, 5), ContainerEq(std::list<Id>{1, 0, 4, 5}));
+}
+
+TEST(SPF, BidirectionalMatchesDijkstraWithZeroWeights) {
+  std::mt19937 random{11};
+  std::uniform_int_distribution<Id> vertex{0, 59};
+  std::uniform_int_distribution<int> weight{0, 3};
+  Graph g;
+  for (auto i = 0; i < 60; ++i) g.addVertex();
+  for (auto i = 0; i < 180; ++i) g.setEdge(vertex(random), vertex(random), weight(random));
+
+  for (auto i = 0; i < 500; ++i) {
+    auto from = vertex(random), to = vertex(random);
+    SearchContext c;
+    auto expected = length(g, from, g.path(from, to, true));
+    ASSERT_THAT(length(g, from, g.bidirectionalPath(c, from, to)), Eq(expected))
+        << from << " -> " << to;
+  }
+}
+
+TEST(SPF, HierarchyPath) {
+  Graph g;
+  g.addVertex(); g.addVertex(); g.addVertex(); g.addVertex();
+  g.addVertex(); g.addVertex();
+  g.setEdge(0, 1, 7); g.setEdge(0, 2, 9); g.setEdge(0, 5, 14);
+  g.setEdge(1, 0, 7); g.setEdge(1, 2, 10); g.setEdge(1, 3, 15);
+  g.setEdge(2, 0, 9); g.setEdge(2, 1, 10); g.setEdge(2, 5, 2);
+  g.setEdge(3, 1, 15); g.setEdge(3, 2, 11); g.setEdge(3, 4, 6);
+  g.setEdge(4, 3, 6); g.setEdge(4, 5, 9);
+  g.setEdge(5, 0, 14); g.setEdge(5, 2, 2); g.setEdge(5, 4, 9);
+
+  EXPECT_THAT(g.hierarchyPath(0, 4), ContainerEq(std::list<Id>{0, 2, 5, 4}));
+}
+
+TEST(SPF, HierarchyPathWithWrongId) {
+  Graph g;
+  g.addVertex(); g.addVertex(); g.addVertex(); g.addVertex();
+  g.addVertex(); g.addVertex();
+  g.setEdge(0, 1, 7); g.setEdge(0, 2, 9); g.setEdge(0, 5, 14);
+  g.setEdge(1, 0, 7); g.setEdge(1, 2, 10); g.setEdge(1, 3, 15);
+  g.setEdge(2, 0, 9); g.setEdge(2, 1, 10); g.setEdge(2, 5, 2);
+  g.setEdge(3, 1, 15); g.setEdge(3, 2, 11); g.setEdge(3, 4, 6);
+  g.setEdge(4, 3, 6); g.setEdge(4, 5, 9);
+  g.setEdge(5, 0, 14); g.setEdge(5, 2, 2); g.setEdge(5, 4, 9);
+
+  EXPECT_THROW(g.hierarchyPath(0, 6), std::invalid_argument);
+}
+
+TEST(SPF, HierarchyPathIfWeightUpdated) {
+  Graph g;
+  g.addVertex(); g.addVertex(); g.addVertex(); g.addVertex();
+  g.addVertex(); g.addVertex();
+  g.setEdge(0, 1, 7); g.setEdge(0, 2, 9); g.setEdge(0, 5, 14);
+  g.setEdge(1, 0, 7); g.setEdge(1, 2, 10); g.setEdge(1, 3, 15);
+  g.setEdge(2, 0, 9); g.setEdge(2, 1, 10); g.setEdge(2, 5, 2);
+  g.setEdge(3, 1, 15); g.setEdge(3, 2, 11); g.setEdge(3, 4, 6);
+  g.setEdge(4, 3, 6); g.setEdge(4, 5, 9);
+  g.setEdge(5, 0, 14); g.setEdge(5, 2, 2); g.setEdge(5, 4, 9);
+  g.buildHierarchy();
+  g.setEdge(2, 5, 100);
+
+  EXPECT_THAT(g.hierarchyPath(0, 4), ContainerEq(std::list<Id>{0, 5, 4}));
+}
+
+TEST(SPF, HierarchyPathIfVertexAdded) {
+  Graph g;
+  g.addVertex(); g.addVertex(); g.addVertex(); g.addVertex();
+  g.addVertex(); g.addVertex();
+  g.setEdge(0, 1, 7); g.setEdge(0, 2, 9); g.setEdge(0, 5, 14);
+  g.setEdge(1, 0, 7); g.setEdge(1, 2, 10); g.setEdge(1, 3, 15);
+  g.setEdge(2, 0, 9); g.setEdge(2, 1, 10); g.setEdge(2, 5, 2);
+  g.setEdge(3, 1, 15); g.setEdge(3, 2, 11); g.setEdge(3, 4, 6);
+  g.setEdge(4, 3, 6); g.setEdge(4, 5, 9);
+  g.setEdge(5, 0, 14); g.setEdge(5, 2, 2); g.setEdge(5, 4, 9);
+  g.buildHierarchy();
+  g.addVertex();
+  g.setEdge(0, 6, 1); g.setEdge(6, 4, 1);
+
+  EXPECT_THAT(g.hierarchyPath(0, 4), ContainerEq(std::list<Id>{0, 6, 4}));
+}
+
+TEST(SPF, LandmarkPath) {
+  Graph g;
+  g.addVertex(); g.addVertex(); g.addVertex(); g.addVertex();
+  g.addVertex(); g.addVertex();
+  g.setEdge(0, 1, 7); g.setEdge(0, 2, 9); g.setEdge(0, 5, 14);
+  g.setEdge(1, 0, 7); g.setEdge(1, 2, 10); g.setEdge(1, 3, 15);
+  g.setEdge(2, 0, 9); g.setEdge(2, 1, 10); g.setEdge(2, 5, 2);
+  g.setEdge(3, 1, 15); g.setEdge(3, 2, 11); g.setEdge(3, 4, 6);
+  g.setEdge(4, 3, 6); g.setEdge(4, 5, 9);
+  g.setEdge(5, 0, 14); g.setEdge(5, 2, 2); g.setEdge(5, 4, 9);
+
+  EXPECT_THAT(g.landmarkPath(0, 4), ContainerEq(std::list<Id>{0, 2, 5, 4}));
+}
+
+TEST(SPF, LandmarkPathWithWrongId) {
+  Graph g;
+  g.addVertex(); g.addVertex();
+  g.setEdge(0, 1, 7);
+
+  EXPECT_THROW(g.landmarkPath(0, 2), std::invalid_argument);
+}
+
+TEST(SPF, LandmarkPathIfWeightDecreased) {
+  Graph g;
+  g.addVertex(); g.addVertex(); g.addVertex(); g.addVertex();
+  g.addVertex(); g.addVertex();
+  g.setEdge(0, 1, 7); g.setEdge(0, 2, 9); g.setEdge(0, 5, 14);
+  g.setEdge(1, 0, 7); g.setEdge(1, 2, 10); g.setEdge(1, 3, 15);
+  g.setEdge(2, 0, 9); g.setEdge(2, 1, 10); g.setEdge(2, 5, 2);
+  g.setEdge(3, 1, 15); g.setEdge(3, 2, 11); g.setEdge(3, 4, 6);
+  g.setEdge(4, 3, 6); g.setEdge(4, 5, 9);
+  g.setEdge(5, 0, 14); g.setEdge(5, 2, 2); g.setEdge(5, 4, 9);
+  g.buildLandmarks(2);
+  g.setEdge(1, 3, 1);
+
+  EXPECT_THAT(g.landmarkPath(0, 4), ContainerEq(std::list<Id>{0, 1, 3, 4}));
+}
+
+TEST(SPF, LandmarkPathIsNotRefreshedByQuery) {
+  Graph g;
+  g.addVertex(); g.addVertex(); g.addVertex(); g.addVertex();
+  g.setEdge(0, 1, 1); g.setEdge(1, 2, 1); g.setEdge(2, 3, 1); g.setEdge(0, 3, 5);
+  g.buildLandmarks(2);
+  auto measured = g.currentLandmarks();
+  g.setEdge(0, 3, 1);
+
+  EXPECT_TRUE(g.hasStaleLandmarks());
+  EXPECT_THAT(g.landmarkPath(0, 3), ContainerEq(std::list<Id>{0, 3}));
+  EXPECT_THAT(g.currentLandmarks(), Eq(measured));
+
+  g.refreshLandmarks();
+
+  EXPECT_FALSE(g.hasStaleLandmarks());
+  EXPECT_THAT(g.currentLandmarks(), Ne(measured));
+  EXPECT_THAT(g.currentLandmarks()->landmarks(), ContainerEq(measured->landmarks()));
+  EXPECT_THAT(g.landmarkPath(0, 3), ContainerEq(std::list<Id>{0, 3}));
+}
+
+TEST(SPF, LandmarkPathIfVertexAdded) {
+  Graph g;
+  g.addVertex(); g.addVertex(); g.addVertex(); g.addVertex();
+  g.addVertex(); g.addVertex();
+  g.setEdge(0, 1, 7); g.setEdge(0, 2, 9); g.setEdge(0, 5, 14);
+  g.setEdge(1, 0, 7); g.setEdge(1, 2, 10); g.setEdge(1, 3, 15);
+  g.setEdge(2, 0, 9); g.setEdge(2, 1, 10); g.setEdge(2, 5, 2);
+  g.setEdge(3, 1, 15); g.setEdge(3, 2, 11); g.setEdge(3, 4, 6);
+  g.setEdge(4, 3, 6); g.setEdge(4, 5, 9);
+  g.setEdge(5, 0, 14); g.setEdge(5, 2, 2); g.setEdge(5, 4, 9);
+  g.buildLandmarks();
+  g.addVertex();
+  g.setEdge(0, 6, 1); g.setEdge(6, 4, 1);
+
+  EXPECT_THAT(g.landmarkPath(0, 4), ContainerEq(std::list<Id>{0, 6, 4}));
+}
+
+TEST(SPF, LandmarkPathAfterCompaction) {
+  Graph g;
+  for (auto i = 0; i < 8; ++i) g.addVertex();
+  g.setEdge(0, 6, 1); g.setEdge(6, 7, 1); g.setEdge(0, 7, 5);
+  g.buildLandmarks(2);
+  auto measured = g.currentLandmarks();
+  for (Id id = 1; id < 6; ++id) g.removeVertex(id);
+  ASSERT_THAT(g.layout(), Ne(measured->layout()));
+
+  EXPECT_THAT(g.landmarkPath(0, 7), ContainerEq(std::list<Id>{0, 6, 7}));
+  EXPECT_THAT(g.currentLandmarks(), Ne(measured));
+  EXPECT_THAT(g.currentLandmarks()->layout(), Eq(g.layout()));
+  EXPECT_THAT(g.currentLandmarks()->landmarks(), ContainerEq(measured->landmarks()));
+}
+
+TEST(SPF, Distances) {
+  Graph g;
+  g.addVertex(); g.addVertex(); g.addVertex(); g.addVertex();
+  g.setEdge(0, 1, 2); g.setEdge(1, 2, 3); g.setEdge(3, 0, 1);
+
+  auto t = g.distances(0);
+
+  EXPECT_TRUE(t.isComplete());
+  EXPECT_THAT(t.steps.size(), Eq(3));
+  EXPECT_THAT(t.steps.at(2).distance, Eq(5));
+}
+
+TEST(SPF, DistancesInParallel) {
+  Graph g;
+  g.setThreads(3);
+  g.addVertex(); g.addVertex(); g.addVertex(); g.addVertex();
+  g.setEdge(0, 1, 2); g.setEdge(1, 2, 3); g.setEdge(3, 0, 1);
+
+  auto t = g.distances(0);
+
+  EXPECT_THAT(t.steps.size(), Eq(3));
+  EXPECT_THAT(t.steps.at(2).distance, Eq(5));
+  EXPECT_THAT(g.cache().size(), Eq(1));
+}
+
+TEST(SPF, PathsInParallel) {
+  std::mt19937 random{17};
+  std::uniform_int_distribution<Id> vertex{0, 49};
+  std::uniform_real_distribution<Distance> weight{1, 10};
+  Graph g;
+  g.setThreads(2);
+  g.setParallelThreshold(10);
+  for (auto i = 0; i < 50; ++i) g.addVertex();
+  for (auto i = 0; i < 150; ++i) g.setEdge(vertex(random), vertex(random), weight(random));
+
+  for (auto i = 0; i < 50; ++i) {
+    auto from = vertex(random), to = vertex(random), other = vertex(random);
+    auto expected = g.bidirectionalPath(from, to);
+    g.setCacheBudget(0);  // the tree is calculated again
+    g.setCacheBudget(TreeCache::kBudget);
+    SearchContext c;
+    ASSERT_THAT(g.paths(c, {{from, to}, {from, other}})[0], ContainerEq(expected));
+    ASSERT_THAT(g.cache().size(), Eq(1));  // the whole tree was calculated
+  }
+}
+
+TEST(SPF, WorkOfWorkersIsCounted) {
+  Graph g;
+  g.setThreads(2);
+  g.setParallelThreshold(1);
+  g.addVertex(); g.addVertex(); g.addVertex();
+  g.setEdge(0, 1, 1); g.setEdge(1, 2, 1);
+  SearchContext c;
+
+  g.paths(c, {{0, 2}, {1, 2}});
+  EXPECT_THAT(c.counters().answers[static_cast<std::size_t>(SearchContext::Answer::kSearched)],
+      Eq(2));
+  EXPECT_THAT(c.counters().settled, Eq(5));
+
+  g.distanceMatrix(c, {0, 1}, {2}, 1, [](std::size_t, std::vector<Distance> const&) {});
+  EXPECT_THAT(c.counters().settled, Eq(10));
+
+  auto const settled = c.counters().settled;
+  g.setCacheBudget(0);
+  g.distances(c, 0);
+  EXPECT_THAT(c.counters().settled, Gt(settled));
+}
+
+TEST(SPF, SinglePathIsNotParallel) {
+  Graph g;
+  g.setThreads(2);
+  g.setParallelThreshold(1);
+  g.addVertex(); g.addVertex(); g.addVertex();
+  g.setEdge(0, 1, 1); g.setEdge(1, 2, 1);
+  SearchContext c;
+
+  EXPECT_THAT(g.path(c, 0, 1), ContainerEq(std::list<Id>{0, 1}));
+  EXPECT_THAT(c.answer(), Eq(SearchContext::Answer::kSearched));
+  EXPECT_THAT(g.cache().size(), Eq(0));
+}
+
+TEST(SPF, Paths) {
+  Graph g;
+  g.addVertex(); g.addVertex(); g.addVertex(); g.addVertex();
+  g.setEdge(0, 1, 2); g.setEdge(1, 2, 3); g.setEdge(3, 0, 1);
+
+  auto p = g.paths({{0, 2}, {3, 2}, {0, 1}, {2, 0}});
+
+  EXPECT_THAT(p, ContainerEq(std::vector<std::list<Id>>{
+      {0, 1, 2}, {3, 0, 1, 2}, {0, 1}, {0}}));
+}
+
+TEST(SPF, PathsShareSearch) {
+  std::mt19937 random{19};
+  std::uniform_int_distribution<Id> vertex{0, 49};
+  std::uniform_real_distribution<Distance> weight{1, 10};
+  Graph g;
+  for (auto i = 0; i < 50; ++i) g.addVertex();
+  for (auto i = 0; i < 150; ++i) g.setEdge(vertex(random), vertex(random), weight(random));
+  std::vector<std::pair<Id, Id>> pairs;
+  for (auto i = 0; i < 100; ++i) pairs.emplace_back(vertex(random) % 5, vertex(random));
+
+  auto p = g.paths(pairs);
+
+  EXPECT_THAT(g.cache().size(), Eq(4));
+  for (std::size_t i = 0; i < pairs.size(); ++i) {
+    ASSERT_THAT(p[i], ContainerEq(g.path(pairs[i].first, pairs[i].second, true)));
+  }
+}
+
+TEST(SPF, PathsByWorkers) {
+  std::mt19937 random{23};
+  std::uniform_int_distribution<Id> vertex{0, 49};
+  std::uniform_real_distribution<Distance> weight{1, 10};
+  Graph g;
+  for (auto i = 0; i < 50; ++i) g.addVertex();
+  for (auto i = 0; i < 150; ++i) g.setEdge(vertex(random), vertex(random), weight(random));
+  std::vector<std::pair<Id, Id>> pairs;
+  for (auto i = 0; i < 100; ++i) pairs.emplace_back(vertex(random) % 7, vertex(random));
+  g.setThreads(3);
+
+  auto p = g.paths(pairs);
+
+  for (std::size_t i = 0; i < pairs.size(); ++i) {
+    ASSERT_THAT(p[i], ContainerEq(g.path(pairs[i].first, pairs[i].second, true)));
+  }
+}
+
+TEST(SPF, PathsWithWrongId) {
+  Graph g;
+  g.addVertex(); g.addVertex();
+
+  EXPECT_THROW(g.paths({{0, 1}, {0, 2}}), std::invalid_argument);
+}
+
+TEST(SPF, DistanceMatrix) {
+  Graph g;
+  g.addVertex(); g.addVertex(); g.addVertex(); g.addVertex();
+  g.setEdge(0, 1, 2); g.setEdge(1, 2, 3); g.setEdge(3, 0, 1);
+  std::vector<std::size_t> firsts;
+  std::vector<Distance> distances;
+
+  g.distanceMatrix({0, 3, 1}, {2, 0}, 2,
+      [&](std::size_t first, std::vector<Distance> const& rows) {
+    firsts.push_back(first);
+    distances.insert(end(distances), begin(rows), end(rows));
+  });
+
+  auto const inf = std::numeric_limits<Distance>::infinity();
+  EXPECT_THAT(firsts, ContainerEq(std::vector<std::size_t>{0, 2}));
+  EXPECT_THAT(distances, ContainerEq(std::vector<Distance>{5, 0, 6, 1, 3, inf}));
+}
+
+TEST(SPF, DistanceMatrixDoesNotBuildHierarchy) {
+  Graph g;
+  g.addVertex(); g.addVertex(); g.addVertex();
+  g.setEdge(0, 1, 2); g.setEdge(1, 2, 3); g.setEdge(0, 2, 9);
+  g.buildHierarchy();
+  auto const built = g.currentHierarchy();
+  g.setEdge(0, 2, 1);
+  g.addVertex();
+  std::vector<Distance> distances;
+
+  g.distanceMatrix({0}, {2, 3}, 1, [&](std::size_t, std::vector<Distance> const& rows) {
+    distances.insert(end(distances), begin(rows), end(rows));
+  });
+
+  EXPECT_THAT(distances, ContainerEq(std::vector<Distance>{
+      1, std::numeric_limits<Distance>::infinity()}));
+  EXPECT_THAT(g.currentHierarchy(), Eq(built));
+  EXPECT_THAT(Graph{}.currentHierarchy(), Eq(nullptr));
+}
+
+TEST(SPF, DistanceMatrixMatchesDijkstra) {
+  std::mt19937 random{29};
+  std::uniform_int_distribution<Id> vertex{0, 39};
+  std::uniform_real_distribution<Distance> weight{1, 10};
+  Graph g;
+  g.setThreads(2);
+  for (auto i = 0; i < 40; ++i) g.addVertex();
+  for (auto i = 0; i < 160; ++i) g.setEdge(vertex(random), vertex(random), weight(random));
+  std::vector<Id> sources{3, 0, 17, 3, 39};
+  std::vector<Id> targets{5, 3, 22, 38, 0, 11};
+
+  for (auto hierarchy: {false, true}) {
+    if (hierarchy) g.buildHierarchy();
+    std::vector<Distance> distances;
+    g.distanceMatrix(sources, targets, 2, [&](std::size_t, std::vector<Distance> const& rows) {
+      distances.insert(end(distances), begin(rows), end(rows));
+    });
+    ASSERT_THAT(distances.size(), Eq(sources.size() * targets.size()));
+    for (std::size_t i = 0; i < sources.size(); ++i) {
+      auto const t = g.distances(sources[i]);
+      for (std::size_t j = 0; j < targets.size(); ++j) {
+        auto it = t.steps.find(targets[j]);
+        auto expected = it == end(t.steps) ? std::numeric_limits<Distance>::infinity()
+                                           : it->second.distance;
+        ASSERT_THAT(distances[i * targets.size() + j], DoubleEq(expected))
+            << hierarchy << ": " << sources[i] << " -> " << targets[j];
+      }
+    }
+  }
+}
+
+TEST(SPF, DistanceMatrixWithWrongId) {
+  Graph g;
+  g.addVertex(); g.addVertex();
+  auto called = false;
+
+  EXPECT_THROW(g.distanceMatrix({0}, {1, 2}, 1,
+      [&called](std::size_t, std::vector<Distance> const&) { called = true; }),
+      std::invalid_argument);
+  EXPECT_FALSE(called);
+}
+
+TEST(SPF, DistanceMatrixReleasesWorkers) {
+  Graph g;
+  g.setThreads(2);
+  g.setCacheBudget(0);
+  g.addVertex(); g.addVertex(); g.addVertex();
+  g.setEdge(0, 1, 2); g.setEdge(1, 2, 3);
+  std::vector<std::size_t> sizes;
+
+  g.distanceMatrix({0, 1}, {2}, 1, [&g, &sizes](std::size_t, std::vector<Distance> const&) {
+    // another query takes the workers while the rows are sent
+    std::thread query{[&g, &sizes] { sizes.push_back(g.distances(0).steps.size()); }};
+    query.join();
+  });
+
+  EXPECT_THAT(sizes, ContainerEq(std::vector<std::size_t>{3, 3}));
+}
+
+TEST(SPF, PathInConstGraph) {
+  Graph g;
+  g.addVertex(); g.addVertex(); g.addVertex();
+  g.setEdge(0, 1, 1); g.setEdge(1, 2, 1);
+  Graph const& cg = g;
+  SearchContext c;
+
+  EXPECT_THAT(cg.path(c, 0, 2), ContainerEq(std::list<Id>{0, 1, 2}));
+  EXPECT_THAT(cg.bidirectionalPath(c, 2, 0), ContainerEq(std::list<Id>{0}));
+}
+
+TEST(SPF, PathIntoBuffer) {
+  Graph g;
+  g.addVertex(); g.addVertex(); g.addVertex(); g.addVertex();
+  g.setEdge(0, 1, 1); g.setEdge(1, 2, 1); g.setEdge(0, 2, 5);
+  SearchContext c;
+  std::vector<Id> ids{7, 7, 7, 7, 7};
+
+  g.path(c, 0, 2, ids);
+  EXPECT_THAT(ids, ContainerEq(std::vector<Id>{0, 1, 2}));
+  g.path(c, 0, 3, ids);
+  EXPECT_THAT(ids, ContainerEq(std::vector<Id>{3}));
+  g.path(c, 0, 0, ids);
+  EXPECT_THAT(ids, ContainerEq(std::vector<Id>{0}));
+}
+
+TEST(SPF, AddVertexChangesVersion) {
+  Graph g;
+  g.addVertex();
+  auto version = g.version();
+
+  g.addVertex();
+
+  EXPECT_THAT(g.version(), Eq(version + 1));
+}
+
+TEST(SPF, SlotsOfRemovedVertexesAreReused) {
+  Graph g;
+  for (auto i = 0; i < 4; ++i) g.addVertex();
+  g.removeVertex(1);
+
+  g.addVertex();
+
+  EXPECT_THAT(g.nextId(), Eq(5));
+  EXPECT_THAT(g.slots(), Eq(4));
+  EXPECT_THAT(g.vertexes().at(4).slot, Eq(1));
+}
+
+TEST(SPF, SlotsAreCompacted) {
+  Graph g;
+  for (auto i = 0; i < 100; ++i) g.addVertex();
+  g.setEdge(97, 98, 1); g.setEdge(98, 99, 1); g.setEdge(0, 99, 5);
+  SearchContext c;
+  EXPECT_THAT(g.path(c, 97, 99), ContainerEq(std::list<Id>{97, 98, 99}));
+  g.recordChanges();
+  Graph snapshot{g};
+  std::vector<Id> ids(96);
+  std::iota(begin(ids), end(ids), 1);
+
+  g.removeVertices(ids);
+  snapshot.update(g, g.takeChanges());
+
+  EXPECT_THAT(g.slots(), Eq(4));
+  for (auto const* graph: {&g, &snapshot}) {
+    EXPECT_THAT(graph->slots(), Eq(4));
+    EXPECT_THAT(graph->path(c, 97, 99), ContainerEq(std::list<Id>{97, 98, 99}));
+    EXPECT_THAT(graph->path(c, 0, 99), ContainerEq(std::list<Id>{0, 99}));
+  }
+}
+
+TEST(SPF, CopyIsIndependent) {
+  Graph g;
+  g.addVertex(); g.addVertex(); g.addVertex();
+  g.setEdge(0, 1, 1); g.setEdge(1, 2, 1);
+
+  Graph copy{g};
+  copy.removeEdge(1, 2);
+  copy.addVertex();
+
+  EXPECT_THAT(copy.version(), Eq(g.version() + 2));
+  EXPECT_THAT(copy.path(0, 2), ContainerEq(std::list<Id>{2}));
+  EXPECT_THAT(g.path(0, 2), ContainerEq(std::list<Id>{0, 1, 2}));
+  EXPECT_THAT(g.vertexes().at(1).incoming.begin()->first, Eq(&g.vertexes().at(0)));
+}
+
+TEST(SPF, CopyDoesNotTakeTreesOfOrigin) {
+  Graph g;
+  g.addVertex(); g.addVertex(); g.addVertex();
+  g.setEdge(0, 1, 1); g.setEdge(1, 2, 1); g.setEdge(0, 2, 5);
+  Graph copy{g};
+  g.path(0, 2);
+
+  copy.setEdge(1, 2, 10);
+  g.setEdge(0, 2, 3);  // the tree of 0 is cached for the same version as the copy
+
+  EXPECT_THAT(copy.version(), Eq(g.version()));
+  EXPECT_THAT(copy.path(0, 2), ContainerEq(std::list<Id>{0, 2}));
+  EXPECT_THAT(g.path(0, 2), ContainerEq(std::list<Id>{0, 1, 2}));
+  EXPECT_THAT(copy.cache().budget(), Eq(g.cache().budget()));
+}
+
+TEST(SPF, CopySharesHierarchy) {
+  Graph g;
+  g.addVertex(); g.addVertex(); g.addVertex();
+  g.setEdge(0, 1, 1); g.setEdge(1, 2, 1); g.setEdge(0, 2, 5);
+  g.buildHierarchy();
+
+  Graph copy{g};
+  copy.setEdge(0, 2, 1);
+
+  EXPECT_THAT(copy.hierarchyPath(0, 2), ContainerEq(std::list<Id>{0, 2}));
+  EXPECT_THAT(g.hierarchyPath(0, 2), ContainerEq(std::list<Id>{0, 1, 2}));
+}
+
+TEST(SPF, ShareNewerStructures) {
+  Graph g;
+  g.addVertex(); g.addVertex(); g.addVertex();
+  g.setEdge(0, 1, 1); g.setEdge(1, 2, 1);
+  Graph older{g};
+  older.buildLandmarks(2);
+  older.hierarchyPath(0, 2);
+  g.setEdge(1, 2, 2);
+
+  Graph snapshot{g};
+  snapshot.share(older);
+
+  EXPECT_THAT(snapshot.hierarchyPath(0, 2), ContainerEq(std::list<Id>{0, 1, 2}));
+  EXPECT_THAT(snapshot.landmarkPath(0, 2), ContainerEq(std::list<Id>{0, 1, 2}));
+}
+
+TEST(SPF, ConcurrentQueries) {
+  std::mt19937 random{11};
+  std::uniform_int_distribution<Id> vertex{0, 99};
+  std::uniform_real_distribution<Distance> weight{1, 10};
+  Graph g;
+  for (auto i = 0; i < 100; ++i) g.addVertex();
+  for (auto i = 0; i < 400; ++i) g.setEdge(vertex(random), vertex(random), weight(random));
+  std::vector<std::pair<Id, Id>> pairs;
+  std::vector<std::list<Id>> expected;
+  for (auto i = 0; i < 50; ++i) {
+    auto from = vertex(random), to = vertex(random);
+    pairs.emplace_back(from, to);
+    expected.push_back(g.path(from, to, true));
+  }
+
+  std::vector<std::vector<std::list<Id>>> results(4);
+  std::vector<std::thread> threads;
+  for (std::size_t t = 0; t < results.size(); ++t) {
+    threads.emplace_back([&g, &pairs, &result = results[t], t] {
+      SearchContext c;
+      for (std::size_t i = 0; i < pairs.size(); ++i) {
+        auto [from, to] = pairs[(i + t * 7) % pairs.size()];
+        switch ((i + t) % 4) {
+          case 0: result.push_back(g.path(c, from, to)); break;
+          case 1: result.push_back(g.bidirectionalPath(c, from, to)); break;
+          case 2: result.push_back(g.hierarchyPath(from, to)); break;
+          default: result.push_back(g.landmarkPath(c, from, to)); break;
+        }
+      }
+    });
+  }
+  for (auto& thread: threads) thread.join();
+
+  for (std::size_t t = 0; t < results.size(); ++t) {
+    for (std::size_t i = 0; i < pairs.size(); ++i) {
+      ASSERT_THAT(results[t][i], ContainerEq(expected[(i + t * 7) % pairs.size()]));
+    }
+  }
+}
+
+TEST(SPF, ApplyBatch) {
+  TestGraph g;
+  g.addVertex();
+  auto const version = g.version();
+
+  auto firsts = g.apply({
+    {Mutation::Type::kAddVertices, 3},
+    {Mutation::Type::kAddEdges, 0, {{0, 1, 1}, {1, 3, 1}, {0, 2, 5}, {2, 3, 1}}},
+    {Mutation::Type::kAddVertices, 1},
+    {Mutation::Type::kRemoveEdges, 0, {{0, 2, 0}}},
+    {Mutation::Type::kRemoveVertices, 0, {}, {2}}
+  });
+
+  EXPECT_THAT(firsts, ContainerEq(std::vector<Id>{1, 4}));
+  EXPECT_THAT(g.version(), Eq(version + 1));
+  EXPECT_THAT(g.nextId(), Eq(5));
+  EXPECT_THROW(g[2], std::invalid_argument);
+  EXPECT_THAT(g[1].incoming.size(), Eq(1));
+  EXPECT_THAT(g[3].incoming.size(), Eq(1));
+  EXPECT_THAT(g.path(0, 3), ContainerEq(std::list<Id>{0, 1, 3}));
+}
+
+TEST(SPF, ApplyBatchRollsBack) {
+  TestGraph g;
+  g.addVertex(); g.addVertex();
+  g.setEdge(0, 1, 1);
+  auto const version = g.version();
+
+  EXPECT_THROW(g.apply({
+    {Mutation::Type::kAddVertices, 2},
+    {Mutation::Type::kAddEdges, 0, {{0, 2, 1}}},
+    {Mutation::Type::kRemoveVertices, 0, {}, {1}},
+    {Mutation::Type::kAddEdges, 0, {{0, 1, 1}}}
+  }), std::invalid_argument);
+
+  EXPECT_THAT(g.version(), Eq(version));
+  EXPECT_THAT(g.nextId(), Eq(2));
+  EXPECT_THAT(g.vertexes().size(), Eq(2));
+  EXPECT_THAT(g[0].neighbors.size(), Eq(1));
+}
+
+TEST(SPF, ApplyBatchWithNegativeWeight) {
+  TestGraph g;
+  g.addVertex(); g.addVertex();
+
+  EXPECT_THROW(g.apply({{Mutation::Type::kAddEdges, 0, {{0, 1, 1}, {1, 0, -1}}}}),
+               std::invalid_argument);
+  EXPECT_THAT(g[0].neighbors.empty(), Eq(true));
+}
+
+TEST(SPF, ApplyBatchWithNaNWeight) {
+  TestGraph g;
+  g.addVertex(); g.addVertex();
+
+  EXPECT_THROW(g.apply({{Mutation::Type::kAddEdges, 0,
+                         {{0, 1, 1}, {1, 0, std::numeric_limits<Distance>::quiet_NaN()}}}}),
+               std::invalid_argument);
+  EXPECT_THAT(g[0].neighbors.empty(), Eq(true));
+}
+
+TEST(SPF, ApplyBatchWithTooManyVertexes) {
+  TestGraph g;
+  g.addVertex();
+  auto const version = g.version();
+
+  EXPECT_THROW(g.apply({{Mutation::Type::kAddVertices, Graph::kMaxAdded + 1, {}}}),
+               std::invalid_argument);
+  EXPECT_THROW(g.apply({{Mutation::Type::kAddVertices, Graph::kMaxAdded, {}},
+                        {Mutation::Type::kAddVertices, 1, {}}}),
+               std::invalid_argument);
+  EXPECT_THROW(g.apply({{Mutation::Type::kAddVertices, std::numeric_limits<std::size_t>::max(), {}}}),
+               std::invalid_argument);
+  EXPECT_THAT(g.version(), Eq(version));
+  EXPECT_THAT(g.nextId(), Eq(1));
+}
+
+TEST(SPF, ApplyBatchOfWeightsKeepsTopology) {
+  TestGraph g;
+  g.addVertex(); g.addVertex(); g.addVertex();
+  g.setEdge(0, 1, 1); g.setEdge(1, 2, 1); g.setEdge(0, 2, 5);
+  g.buildHierarchy();
+  auto const topology = g.topology();
+
+  g.apply({{Mutation::Type::kAddEdges, 0, {{0, 2, 1}, {1, 2, 3}}, {}}});
+
+  EXPECT_THAT(g.topology(), Eq(topology));
+  EXPECT_THAT(g.hierarchyPath(0, 2), ContainerEq(std::list<Id>{0, 2}));
+
+  g.apply({{Mutation::Type::kAddEdges, 0, {{2, 0, 1}}, {}}});
+
+  EXPECT_THAT(g.topology(), Eq(topology + 1));
+  EXPECT_THAT(g.hierarchyPath(2, 1), ContainerEq(std::list<Id>{2, 0, 1}));
+}
+
+TEST(SPF, ApplyEmptyBatch) {
+  TestGraph g;
+  g.addVertex(); g.addVertex();
+  auto const version = g.version();
+
+  EXPECT_THAT(g.apply({}), ContainerEq(std::vector<Id>{}));
+  EXPECT_THAT(g.apply({{Mutation::Type::kAddVertices, 0, {}},
+                       {Mutation::Type::kAddEdges, 0, {}},
+                       {Mutation::Type::kRemoveEdges, 0, {{0, 1, 0}}}}),
+              ContainerEq(std::vector<Id>{2}));
+  EXPECT_THAT(g.version(), Eq(version));
+  EXPECT_THAT(g.nextId(), Eq(2));
+}
+
+TEST(SPF, ApplyBatchRefreshesSearches) {
+  Graph g;
+  g.addVertex(); g.addVertex(); g.addVertex();
+  g.setEdge(0, 1, 1); g.setEdge(1, 2, 1); g.setEdge(0, 2, 5);
+  g.buildHierarchy();
+  g.buildLandmarks(2);
+  EXPECT_THAT(g.path(0, 2), ContainerEq(std::list<Id>{0, 1, 2}));
+
+  g.apply({
+    {Mutation::Type::kAddEdges, 0, {{0, 2, 1}, {1, 2, 3}}}
+  });
+
+  EXPECT_THAT(g.path(0, 2), ContainerEq(std::list<Id>{0, 2}));
+  EXPECT_THAT(g.distances(0).steps.at(2).distance, Eq(1));
+  EXPECT_THAT(g.hierarchyPath(0, 2), ContainerEq(std::list<Id>{0, 2}));
+  EXPECT_THAT(g.landmarkPath(0, 2), ContainerEq(std::list<Id>{0, 2}));
+}
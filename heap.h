@@ -0,0 +1,165 @@
+#ifndef HEAP_H_
+#define HEAP_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <utility>
+#include <vector>
+
+/**
+ * Indexed d-ary min-heap.
+ * Every element knows its own slot in the heap through the Position functor,
+ * so decrease-key and erase are done in place without searching.
+ * The storage is a contiguous vector which keeps its capacity after clear().
+ * @tparam T - type of element, cheap to copy (e.g. pointer or index).
+ * @tparam Less - strict weak ordering of elements.
+ * @tparam Position - functor returning std::size_t& slot of an element.
+ * @tparam Arity - number of children of every node.
+ */
+template <typename T, typename Less, typename Position, std::size_t Arity = 4>
+class Heap {
+  static_assert(Arity >= 2, "Arity of heap must be at least 2");
+
+public:
+  /**
+   * Position of an element which is not in the heap.
+   */
+  static constexpr std::size_t npos = std::numeric_limits<std::size_t>::max();
+
+  explicit Heap(Less less = Less{}, Position position = Position{})
+    : less_{std::move(less)}, position_{std::move(position)} {}
+
+  /**
+   * Checks whether the heap is empty.
+   * @return true if there is no element.
+   */
+  bool empty() const { return items_.empty(); }
+
+  /**
+   * Gets number of elements in the heap.
+   * @return the number of elements.
+   */
+  std::size_t size() const { return items_.size(); }
+
+  /**
+   * Gets the minimum element.
+   * @return the element.
+   */
+  T const& top() const { return items_.front(); }
+
+  /**
+   * Checks whether the element is in the heap.
+   * @param x - the element.
+   * @return true if the element is in the heap.
+   */
+  bool contains(T const& x) const {
+    auto i = position_(x);
+    return i < items_.size() && items_[i] == x;
+  }
+
+  /**
+   * Inserts new element.
+   * @param x - the element which is not in the heap yet.
+   */
+  void push(T x) {
+    items_.push_back(x);
+    position_(x) = items_.size() - 1;
+    up(items_.size() - 1);
+  }
+
+  /**
+   * Restores order after key of the element was decreased.
+   * @param x - the element which is in the heap.
+   */
+  void decrease(T const& x) { up(position_(x)); }
+
+  /**
+   * Inserts new element or restores order after its key was decreased.
+   * @param x - the element.
+   */
+  void update(T const& x) {
+    if (contains(x)) {
+      decrease(x);
+    } else {
+      push(x);
+    }
+  }
+
+  /**
+   * Removes the minimum element.
+   */
+  void pop() { remove(0); }
+
+  /**
+   * Removes the element if it is in the heap.
+   * @param x - the element.
+   */
+  void erase(T const& x) {
+    if (contains(x)) remove(position_(x));
+  }
+
+  /**
+   * Removes all elements, allocated memory is kept to reuse it.
+   */
+  void clear() {
+    for (auto& x: items_) position_(x) = npos;
+    items_.clear();
+  }
+
+private:
+  void remove(std::size_t i) {
+    position_(items_[i]) = npos;
+    auto last = items_.back();
+    items_.pop_back();
+    if (i == items_.size()) return;
+    place(i, last);
+    if (i > 0 && less_(items_[i], items_[parent(i)])) {
+      up(i);
+    } else {
+      down(i);
+    }
+  }
+
+  void up(std::size_t i) {
+    auto x = items_[i];
+    while (i > 0) {
+      auto p = parent(i);
+      if (!less_(x, items_[p])) break;
+      place(i, items_[p]);
+      i = p;
+    }
+    place(i, x);
+  }
+
+  void down(std::size_t i) {
+    auto x = items_[i];
+    auto const n = items_.size();
+    for (;;) {
+      auto first = i * Arity + 1;
+      if (first >= n) break;
+      auto last = std::min(first + Arity, n);
+      auto best = first;
+      for (auto c = first + 1; c < last; ++c) {
+        if (less_(items_[c], items_[best])) best = c;
+      }
+      if (!less_(items_[best], x)) break;
+      place(i, items_[best]);
+      i = best;
+    }
+    place(i, x);
+  }
+
+  void place(std::size_t i, T x) {
+    items_[i] = x;
+    position_(x) = i;
+  }
+
+  static std::size_t parent(std::size_t i) { return (i - 1) / Arity; }
+
+  Less less_;
+  Position position_;
+  std::vector<T> items_;
+};
+
+#endif /* HEAP_H_ */
@@ -0,0 +1,105 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <limits>
+#include <vector>
+
+#include "heap.h"
+
+using ::testing::Eq;
+using ::testing::ContainerEq;
+
+namespace {
+struct Item {
+  int key;
+  std::size_t position{std::numeric_limits<std::size_t>::max()};
+};
+
+struct LessKey {
+  bool operator()(Item const* lhs, Item const* rhs) const
+  { return lhs->key < rhs->key; }
+};
+
+struct ItemPosition {
+  std::size_t& operator()(Item* x) const { return x->position; }
+};
+
+using ItemHeap = Heap<Item*, LessKey, ItemPosition>;
+
+std::vector<int> drain(ItemHeap& h) {
+  std::vector<int> keys;
+  while (!h.empty()) {
+    keys.push_back(h.top()->key);
+    h.pop();
+  }
+  return keys;
+}
+}  // namespace
+
+TEST(Heap, Empty) {
+  ItemHeap h;
+
+  EXPECT_THAT(h.empty(), Eq(true));
+}
+
+TEST(Heap, PopInOrder) {
+  std::vector<Item> items{{7}, {3}, {9}, {1}, {5}, {8}, {2}, {6}, {4}};
+  ItemHeap h;
+  for (auto& x: items) h.push(&x);
+
+  EXPECT_THAT(drain(h), ContainerEq(std::vector<int>{1, 2, 3, 4, 5, 6, 7, 8, 9}));
+}
+
+TEST(Heap, Contains) {
+  std::vector<Item> items{{1}, {2}};
+  ItemHeap h;
+  h.push(&items[0]);
+
+  EXPECT_THAT(h.contains(&items[0]), Eq(true));
+  EXPECT_THAT(h.contains(&items[1]), Eq(false));
+}
+
+TEST(Heap, Decrease) {
+  std::vector<Item> items{{5}, {3}, {9}, {7}};
+  ItemHeap h;
+  for (auto& x: items) h.push(&x);
+
+  items[2].key = 1;
+  h.decrease(&items[2]);
+
+  EXPECT_THAT(h.top(), Eq(&items[2]));
+}
+
+TEST(Heap, Update) {
+  std::vector<Item> items{{5}, {3}};
+  ItemHeap h;
+  h.update(&items[0]);
+  h.update(&items[1]);
+  items[0].key = 1;
+  h.update(&items[0]);
+
+  EXPECT_THAT(h.size(), Eq(2));
+  EXPECT_THAT(h.top(), Eq(&items[0]));
+}
+
+TEST(Heap, Erase) {
+  std::vector<Item> items{{4}, {2}, {6}, {1}, {3}, {5}};
+  ItemHeap h;
+  for (auto& x: items) h.push(&x);
+
+  h.erase(&items[1]);
+
+  EXPECT_THAT(h.contains(&items[1]), Eq(false));
+  EXPECT_THAT(drain(h), ContainerEq(std::vector<int>{1, 3, 4, 5, 6}));
+}
+
+TEST(Heap, Clear) {
+  std::vector<Item> items{{1}, {2}};
+  ItemHeap h;
+  for (auto& x: items) h.push(&x);
+
+  h.clear();
+
+  EXPECT_THAT(h.empty(), Eq(true));
+  EXPECT_THAT(items[0].position, Eq(ItemHeap::npos));
+}
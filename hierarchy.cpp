@@ -0,0 +1,387 @@
+#include "hierarchy.h"
+
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <queue>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+
+#include "graph.h"
+#include "workers.h"
+
+namespace {
+/**
+ * Maximum number of vertexes settled by a witness search.
+ * The search is local, if it gives up a shortcut is added just in case.
+ * Estimation of priority uses shorter search than the contraction itself.
+ */
+constexpr std::size_t kWitnessLimit = 500;
+constexpr std::size_t kEstimateLimit = 50;
+
+template <typename T>
+using MinQueue = std::priority_queue<std::pair<T, std::size_t>,
+    std::vector<std::pair<T, std::size_t>>, std::greater<>>;
+}  // namespace
+
+ContractionHierarchy::ContractionHierarchy(Graph const& graph) {
+  load(graph);
+  rank();
+}
+
+void ContractionHierarchy::customize(Graph const& graph) {
+  load(graph);
+  contract();
+}
+
+void ContractionHierarchy::load(Graph const& graph) {
+  auto const& vertexes = graph.vertexes();
+  if (ids_.empty()) {
+    ids_.reserve(vertexes.size());
+    for (auto const& p: vertexes) {
+      index_.emplace(p.first, ids_.size());
+      ids_.push_back(p.first);
+    }
+  }
+  auto const n = ids_.size();
+  out_.assign(n, {});
+  in_.assign(n, {});
+  witness_.assign(n, std::numeric_limits<Distance>::infinity());
+  touched_.clear();
+  for (auto const& p: vertexes) {
+    auto from = index(p.first);
+    for (auto const& [v, weight]: p.second.neighbors) {
+      auto to = index(v->id);
+      if (from == to) continue;
+      out_[from][to] = {weight, npos};
+      in_[to][from] = {weight, npos};
+    }
+  }
+}
+
+void ContractionHierarchy::rank() {
+  auto const n = ids_.size();
+  up_.assign(n, {});
+  down_.assign(n, {});
+  contracted_.assign(n, 0);
+  rank_.assign(n, npos);
+  order_.clear();
+  order_.reserve(n);
+  shortcuts_ = 0;
+
+  MinQueue<int> queue;
+  for (std::size_t v = 0; v < n; ++v) {
+    queue.emplace(priority(v), v);
+  }
+  while (!queue.empty()) {
+    auto v = queue.top().second;
+    queue.pop();
+    auto actual = priority(v);
+    if (!queue.empty() && actual > queue.top().first) {
+      queue.emplace(actual, v);
+      continue;
+    }
+    rank_[v] = order_.size();
+    order_.push_back(v);
+    contract(v);
+  }
+}
+
+void ContractionHierarchy::contract() {
+  auto const n = ids_.size();
+  up_.assign(n, {});
+  down_.assign(n, {});
+  contracted_.assign(n, 0);
+  shortcuts_ = 0;
+  for (auto v: order_) {
+    contract(v);
+  }
+}
+
+void ContractionHierarchy::contract(std::size_t v) {
+  for (auto const& [edge, weight]: shortcuts(v, kWitnessLimit)) {
+    auto [from, to] = edge;
+    auto it = out_[from].find(to);
+    if (it == end(out_[from]) || it->second.weight > weight) {
+      out_[from][to] = {weight, v};
+      in_[to][from] = {weight, v};
+      ++shortcuts_;
+    }
+  }
+  for (auto const& [to, e]: out_[v]) {
+    up_[v].push_back({to, e.weight, e.middle});
+    in_[to].erase(v);
+    ++contracted_[to];
+  }
+  for (auto const& [from, e]: in_[v]) {
+    down_[v].push_back({from, e.weight, e.middle});
+    out_[from].erase(v);
+    ++contracted_[from];
+  }
+  out_[v].clear();
+  in_[v].clear();
+}
+
+std::vector<ContractionHierarchy::Shortcut>
+ContractionHierarchy::shortcuts(std::size_t v, std::size_t settle) {
+  std::vector<Shortcut> result;
+  Distance longest = 0;
+  for (auto const& p: out_[v]) {
+    longest = std::max(longest, p.second.weight);
+  }
+  for (auto const& [from, in]: in_[v]) {
+    witness(from, v, in.weight + longest, settle);
+    for (auto const& [to, out]: out_[v]) {
+      if (to == from) continue;
+      auto weight = in.weight + out.weight;
+      if (witness_[to] > weight) {
+        result.push_back({{from, to}, weight});
+      }
+    }
+  }
+  return result;
+}
+
+int ContractionHierarchy::priority(std::size_t v) {
+  auto added = static_cast<int>(shortcuts(v, kEstimateLimit).size());
+  auto removed = static_cast<int>(in_[v].size() + out_[v].size());
+  return added - removed + static_cast<int>(contracted_[v]);
+}
+
+void ContractionHierarchy::witness(std::size_t from, std::size_t skip,
+                                   Distance limit, std::size_t settle) {
+  for (auto v: touched_) {
+    witness_[v] = std::numeric_limits<Distance>::infinity();
+  }
+  touched_.clear();
+  witness_[from] = 0;
+  touched_.push_back(from);
+  MinQueue<Distance> queue;
+  queue.emplace(0, from);
+  std::size_t settled = 0;
+  while (!queue.empty() && settled < settle) {
+    auto [d, u] = queue.top();
+    queue.pop();
+    if (d > witness_[u]) continue;
+    if (d > limit) break;
+    ++settled;
+    for (auto const& [v, e]: out_[u]) {
+      if (v == skip) continue;
+      auto candidate = d + e.weight;
+      if (candidate < witness_[v]) {
+        if (witness_[v] == std::numeric_limits<Distance>::infinity()) {
+          touched_.push_back(v);
+        }
+        witness_[v] = candidate;
+        queue.emplace(candidate, v);
+      }
+    }
+  }
+}
+
+std::list<Id> ContractionHierarchy::path(Id from, Id to) const {
+  struct Label {
+    Distance distance;
+    std::size_t parent;
+  };
+  using Labels = std::unordered_map<std::size_t, Label>;
+
+  auto source = index(from);
+  auto target = index(to);
+  Labels forward{{source, {0, npos}}};
+  Labels backward{{target, {0, npos}}};
+  MinQueue<Distance> fqueue;
+  MinQueue<Distance> bqueue;
+  fqueue.emplace(0, source);
+  bqueue.emplace(0, target);
+  auto best = std::numeric_limits<Distance>::infinity();
+  auto meet = npos;
+
+  auto step = [&best, &meet](MinQueue<Distance>& queue, Labels& mine,
+      Labels const& other, std::vector<std::vector<Arc>> const& arcs) {
+    auto [d, u] = queue.top();
+    queue.pop();
+    if (d > mine.at(u).distance) return;
+    auto it = other.find(u);
+    if (it != end(other) && d + it->second.distance < best) {
+      best = d + it->second.distance;
+      meet = u;
+    }
+    for (auto const& a: arcs[u]) {
+      auto candidate = d + a.weight;
+      auto label = mine.find(a.to);
+      if (label == end(mine) || candidate < label->second.distance) {
+        mine[a.to] = {candidate, u};
+        queue.emplace(candidate, a.to);
+      }
+    }
+  };
+  for (;;) {
+    auto f = !fqueue.empty() && fqueue.top().first < best;
+    auto b = !bqueue.empty() && bqueue.top().first < best;
+    if (!f && !b) break;
+    if (f && (!b || fqueue.top().first <= bqueue.top().first)) {
+      step(fqueue, forward, backward, up_);
+    } else {
+      step(bqueue, backward, forward, down_);
+    }
+  }
+  if (meet == npos) return {to};
+
+  std::vector<std::size_t> nodes;
+  for (auto v = meet; v != npos; v = forward.at(v).parent) {
+    nodes.push_back(v);
+  }
+  std::reverse(begin(nodes), end(nodes));
+  for (auto v = backward.at(meet).parent; v != npos; v = backward.at(v).parent) {
+    nodes.push_back(v);
+  }
+  std::list<Id> p{ids_[nodes.front()]};
+  for (std::size_t i = 1; i < nodes.size(); ++i) {
+    unpack(nodes[i - 1], nodes[i], p);
+  }
+  return p;
+}
+
+ContractionHierarchy::Buckets ContractionHierarchy::buckets(
+    std::vector<Id> const& targets, Workers& workers) const {
+  Scratches scratches;
+  return buckets(targets, workers, scratches);
+}
+
+ContractionHierarchy::Buckets ContractionHierarchy::buckets(
+    std::vector<Id> const& targets, Workers& workers, Scratches& scratches) const {
+  using Found = std::vector<std::tuple<std::size_t, std::size_t, Distance>>;
+  std::vector<std::size_t> columns;
+  columns.reserve(targets.size());
+  std::transform(begin(targets), end(targets), std::back_inserter(columns),
+      [this](Id id) { return index(id); });
+
+  auto const n = ids_.size();
+  auto const step = workers.size();
+  std::vector<Found> found(step);
+  scratches.resize(std::max(scratches.size(), step));
+  workers.run([&](std::size_t t) {
+    auto& s = scratch(scratches, t);
+    for (auto j = t; j < columns.size(); j += step) {
+      upward(columns[j], down_, s, [&found, t, j](std::size_t u, Distance d) {
+        found[t].emplace_back(u, j, d);
+      });
+    }
+  });
+
+  Buckets b;
+  b.targets_ = targets.size();
+  b.offsets_.assign(n + 1, 0);
+  for (auto const& f: found) {
+    for (auto const& e: f) ++b.offsets_[std::get<0>(e) + 1];
+  }
+  for (std::size_t v = 0; v < n; ++v) b.offsets_[v + 1] += b.offsets_[v];
+  b.entries_.resize(b.offsets_[n]);
+  auto next = b.offsets_;
+  for (auto const& f: found) {
+    for (auto const& [u, j, d]: f) b.entries_[next[u]++] = {j, d};
+  }
+  return b;
+}
+
+std::vector<Distance> ContractionHierarchy::distances(
+    std::vector<Id> const& sources, Buckets const& buckets, Workers& workers) const {
+  Scratches scratches;
+  return distances(sources, buckets, workers, scratches);
+}
+
+std::vector<Distance> ContractionHierarchy::distances(
+    std::vector<Id> const& sources, Buckets const& buckets, Workers& workers,
+    Scratches& scratches) const {
+  std::vector<std::size_t> rows;
+  rows.reserve(sources.size());
+  std::transform(begin(sources), end(sources), std::back_inserter(rows),
+      [this](Id id) { return index(id); });
+
+  auto const m = buckets.targets();
+  auto const step = workers.size();
+  std::vector<Distance> result(rows.size() * m, std::numeric_limits<Distance>::infinity());
+  scratches.resize(std::max(scratches.size(), step));
+  workers.run([&](std::size_t t) {
+    auto& s = scratch(scratches, t);
+    for (auto i = t; i < rows.size(); i += step) {
+      auto row = result.data() + i * m;
+      upward(rows[i], up_, s, [&buckets, row](std::size_t u, Distance d) {
+        for (auto k = buckets.offsets_[u]; k < buckets.offsets_[u + 1]; ++k) {
+          auto const& e = buckets.entries_[k];
+          row[e.target] = std::min(row[e.target], d + e.distance);
+        }
+      });
+    }
+  });
+  return result;
+}
+
+ContractionHierarchy::Scratch& ContractionHierarchy::scratch(
+    Scratches& scratches, std::size_t worker) const {
+  auto& s = scratches[worker];
+  if (s.distance.size() != ids_.size()) {
+    s.distance.assign(ids_.size(), std::numeric_limits<Distance>::infinity());
+    s.touched.clear();
+  }
+  return s;
+}
+
+template <typename Visit>
+void ContractionHierarchy::upward(std::size_t from,
+    std::vector<std::vector<Arc>> const& arcs, Scratch& scratch, Visit visit) const {
+  auto& distance = scratch.distance;
+  for (auto v: scratch.touched) {
+    distance[v] = std::numeric_limits<Distance>::infinity();
+  }
+  scratch.touched.clear();
+  distance[from] = 0;
+  scratch.touched.push_back(from);
+  MinQueue<Distance> queue;
+  queue.emplace(0, from);
+  while (!queue.empty()) {
+    auto [d, u] = queue.top();
+    queue.pop();
+    if (d > distance[u]) continue;
+    visit(u, d);
+    for (auto const& a: arcs[u]) {
+      auto candidate = d + a.weight;
+      if (candidate < distance[a.to]) {
+        if (distance[a.to] == std::numeric_limits<Distance>::infinity()) {
+          scratch.touched.push_back(a.to);
+        }
+        distance[a.to] = candidate;
+        queue.emplace(candidate, a.to);
+      }
+    }
+  }
+}
+
+ContractionHierarchy::Arc const& ContractionHierarchy::arc(
+    std::size_t from, std::size_t to) const {
+  auto const& arcs = rank_[from] < rank_[to] ? up_[from] : down_[to];
+  auto const other = rank_[from] < rank_[to] ? to : from;
+  return *std::find_if(begin(arcs), end(arcs),
+      [other](Arc const& a) { return a.to == other; });
+}
+
+void ContractionHierarchy::unpack(std::size_t from, std::size_t to,
+                                  std::list<Id>& path) const {
+  auto const& a = arc(from, to);
+  if (a.middle == npos) {
+    path.push_back(ids_[to]);
+  } else {
+    unpack(from, a.middle, path);
+    unpack(a.middle, to, path);
+  }
+}
+
+std::size_t ContractionHierarchy::index(Id id) const {
+  auto it = index_.find(id);
+  if (it == end(index_)) {
+    throw std::invalid_argument{"Wrong vertex ID"};
+  }
+  return it->second;
+}
@@ -0,0 +1,179 @@
+#ifndef HIERARCHY_H_
+#define HIERARCHY_H_
+
+#include <cstddef>
+#include <limits>
+#include <list>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "types.h"
+
+class Graph;
+class Workers;
+
+/**
+ * Contraction hierarchy of a graph.
+ * Vertexes are contracted one by one from the least important, shortcuts
+ * keep distances between the remaining ones. A query is bidirectional search
+ * which goes only upward to more important vertexes, then shortcuts are
+ * unpacked to the original edges.
+ */
+class ContractionHierarchy {
+public:
+  /**
+   * Builds the hierarchy of the graph.
+   * @param graph - the graph.
+   */
+  explicit ContractionHierarchy(Graph const& graph);
+
+  /**
+   * Recalculates shortcuts after weights of the graph were changed.
+   * Order of vertexes is kept, so the graph must have the same vertexes.
+   * @param graph - the graph.
+   */
+  void customize(Graph const& graph);
+
+  /**
+   * Gets path from a source to a target vertex.
+   * @param from - the source vertex.
+   * @param to - the target vertex.
+   * @return list of the vertex by order.
+   */
+  std::list<Id> path(Id from, Id to) const;
+
+  /**
+   * Distances from vertexes of the hierarchy to some targets.
+   * Every vertex keeps distances of the targets whose upward backward search
+   * reached it.
+   */
+  class Buckets {
+  public:
+    /**
+     * Gets number of the targets.
+     * @return the number of the targets.
+     */
+    std::size_t targets() const { return targets_; }
+
+  private:
+    friend class ContractionHierarchy;
+    struct Entry {
+      std::size_t target;
+      Distance distance;
+    };
+    std::size_t targets_{0};
+    std::vector<std::size_t> offsets_;  // entries of vertex v are from offsets_[v] to offsets_[v + 1]
+    std::vector<Entry> entries_;
+  };
+
+  /**
+   * Labels of an upward search by vertex index.
+   * Only the touched labels are reset by the next search, so one scratch
+   * serves every search of a worker.
+   */
+  struct Scratch {
+    std::vector<Distance> distance;
+    std::vector<std::size_t> touched;
+  };
+
+  /**
+   * Scratches of the workers, one per worker.
+   */
+  using Scratches = std::vector<Scratch>;
+
+  /**
+   * Fills buckets by backward searches from the targets.
+   * @param targets - the target vertexes.
+   * @param workers - the workers which share the searches.
+   * @return the buckets.
+   */
+  Buckets buckets(std::vector<Id> const& targets, Workers& workers) const;
+
+  /**
+   * Fills buckets like buckets() in the given scratches.
+   * @param targets - the target vertexes.
+   * @param workers - the workers which share the searches.
+   * @param scratches - the scratches which are kept for the next searches.
+   * @return the buckets.
+   */
+  Buckets buckets(std::vector<Id> const& targets, Workers& workers,
+                  Scratches& scratches) const;
+
+  /**
+   * Gets distances from the sources to the targets of the buckets.
+   * Forward search from every source meets the targets in the buckets
+   * of vertexes it settles.
+   * @param sources - the source vertexes.
+   * @param buckets - the buckets of the targets.
+   * @param workers - the workers which share the searches.
+   * @return distances row by row, infinity if there is no path.
+   */
+  std::vector<Distance> distances(std::vector<Id> const& sources,
+                                  Buckets const& buckets, Workers& workers) const;
+
+  /**
+   * Gets distances like distances() in the given scratches, so the rows
+   * of a matrix which are found by chunks allocate no labels.
+   * @param sources - the source vertexes.
+   * @param buckets - the buckets of the targets.
+   * @param workers - the workers which share the searches.
+   * @param scratches - the scratches which are kept for the next searches.
+   * @return distances row by row, infinity if there is no path.
+   */
+  std::vector<Distance> distances(std::vector<Id> const& sources, Buckets const& buckets,
+                                  Workers& workers, Scratches& scratches) const;
+
+  /**
+   * Gets number of shortcuts which were added.
+   * @return the number of shortcuts.
+   */
+  std::size_t shortcuts() const { return shortcuts_; }
+
+private:
+  static constexpr std::size_t npos = std::numeric_limits<std::size_t>::max();
+
+  struct Edge {
+    Distance weight;
+    std::size_t middle;  // npos for an original edge
+  };
+
+  struct Arc {
+    std::size_t to;
+    Distance weight;
+    std::size_t middle;
+  };
+
+  using Adjacency = std::vector<std::unordered_map<std::size_t, Edge>>;
+  using Shortcut = std::pair<std::pair<std::size_t, std::size_t>, Distance>;
+
+  void load(Graph const& graph);
+  void rank();
+  void contract();
+  void contract(std::size_t v);
+  std::vector<Shortcut> shortcuts(std::size_t v, std::size_t settle);
+  int priority(std::size_t v);
+  void witness(std::size_t from, std::size_t skip, Distance limit, std::size_t settle);
+  Arc const& arc(std::size_t from, std::size_t to) const;
+  void unpack(std::size_t from, std::size_t to, std::list<Id>& path) const;
+  Scratch& scratch(Scratches& scratches, std::size_t worker) const;
+  template <typename Visit>
+  void upward(std::size_t from, std::vector<std::vector<Arc>> const& arcs,
+              Scratch& scratch, Visit visit) const;
+  std::size_t index(Id id) const;
+
+  std::vector<Id> ids_;
+  std::unordered_map<Id, std::size_t> index_;
+  std::vector<std::size_t> order_;
+  std::vector<std::size_t> rank_;
+  std::vector<std::size_t> contracted_;  // number of contracted neighbors
+  Adjacency out_;
+  Adjacency in_;
+  std::vector<std::vector<Arc>> up_;
+  std::vector<std::vector<Arc>> down_;  // reversed arcs from more important vertexes
+  std::vector<Distance> witness_;  // distances of the last witness search
+  std::vector<std::size_t> touched_;
+  std::size_t shortcuts_{0};
+};
+
+#endif /* HIERARCHY_H_ */
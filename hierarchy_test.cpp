@@ -0,0 +1,185 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "graph.h"
+#include "hierarchy.h"
+#include "workers.h"
+
+using ::testing::Eq;
+using ::testing::DoubleEq;
+using ::testing::Gt;
+using ::testing::ContainerEq;
+
+namespace {
+Graph example() {
+  Graph g;
+  g.addVertex(); g.addVertex(); g.addVertex(); g.addVertex();
+  g.addVertex(); g.addVertex();
+  g.setEdge(0, 1, 7); g.setEdge(0, 2, 9); g.setEdge(0, 5, 14);
+  g.setEdge(1, 0, 7); g.setEdge(1, 2, 10); g.setEdge(1, 3, 15);
+  g.setEdge(2, 0, 9); g.setEdge(2, 1, 10); g.setEdge(2, 5, 2);
+  g.setEdge(3, 1, 15); g.setEdge(3, 2, 11); g.setEdge(3, 4, 6);
+  g.setEdge(4, 3, 6); g.setEdge(4, 5, 9);
+  g.setEdge(5, 0, 14); g.setEdge(5, 2, 2); g.setEdge(5, 4, 9);
+  return g;
+}
+
+Graph random(std::mt19937& random, Id size, int edges) {
+  std::uniform_int_distribution<Id> vertex{0, size - 1};
+  std::uniform_real_distribution<Distance> weight{1, 10};
+  Graph g;
+  for (Id i = 0; i < size; ++i) g.addVertex();
+  for (auto i = 0; i < edges; ++i) g.setEdge(vertex(random), vertex(random), weight(random));
+  return g;
+}
+}  // namespace
+
+TEST(Hierarchy, Path) {
+  auto g = example();
+  ContractionHierarchy h{g};
+
+  EXPECT_THAT(h.path(0, 4), ContainerEq(std::list<Id>{0, 2, 5, 4}));
+}
+
+TEST(Hierarchy, PathToItself) {
+  auto g = example();
+  ContractionHierarchy h{g};
+
+  EXPECT_THAT(h.path(3, 3), ContainerEq(std::list<Id>{3}));
+}
+
+TEST(Hierarchy, PathToUnreachable) {
+  Graph g;
+  g.addVertex(); g.addVertex(); g.addVertex();
+  g.setEdge(0, 1, 1); g.setEdge(2, 1, 1);
+  ContractionHierarchy h{g};
+
+  EXPECT_THAT(h.path(0, 2), ContainerEq(std::list<Id>{2}));
+}
+
+TEST(Hierarchy, PathWithWrongId) {
+  auto g = example();
+  ContractionHierarchy h{g};
+
+  EXPECT_THROW(h.path(0, 6), std::invalid_argument);
+}
+
+TEST(Hierarchy, UnpackShortcuts) {
+  Graph g;
+  for (auto i = 0; i < 5; ++i) g.addVertex();
+  for (Id i = 0; i < 4; ++i) {
+    g.setEdge(i, i + 1, 1); g.setEdge(i + 1, i, 1);
+  }
+  ContractionHierarchy h{g};
+
+  EXPECT_THAT(h.shortcuts(), Gt(0));
+  EXPECT_THAT(h.path(0, 4), ContainerEq(std::list<Id>{0, 1, 2, 3, 4}));
+  EXPECT_THAT(h.path(4, 0), ContainerEq(std::list<Id>{4, 3, 2, 1, 0}));
+}
+
+TEST(Hierarchy, SameAsDijkstra) {
+  std::mt19937 r{11};
+  auto g = random(r, 60, 240);
+  ContractionHierarchy h{g};
+
+  for (Id from = 0; from < 60; ++from) {
+    for (Id to = 0; to < 60; ++to) {
+      ASSERT_THAT(h.path(from, to), ContainerEq(g.path(from, to)));
+    }
+  }
+}
+
+TEST(Hierarchy, Customize) {
+  std::mt19937 r{5};
+  auto g = random(r, 40, 160);
+  ContractionHierarchy h{g};
+  std::uniform_int_distribution<Id> vertex{0, 39};
+  std::uniform_real_distribution<Distance> weight{1, 10};
+  for (auto const& p: g.vertexes()) {
+    for (auto const& e: p.second.neighbors) {
+      if (vertex(r) % 2) g.setEdge(p.first, e.first->id, weight(r));
+    }
+  }
+
+  h.customize(g);
+
+  for (Id from = 0; from < 40; ++from) {
+    for (Id to = 0; to < 40; ++to) {
+      ASSERT_THAT(h.path(from, to), ContainerEq(g.path(from, to)));
+    }
+  }
+}
+
+TEST(Hierarchy, Distances) {
+  auto g = example();
+  ContractionHierarchy h{g};
+  Workers w{2};
+
+  auto b = h.buckets({4, 0}, w);
+  auto d = h.distances({0, 3, 4}, b, w);
+
+  EXPECT_THAT(b.targets(), Eq(2));
+  EXPECT_THAT(d, ContainerEq(std::vector<Distance>{20, 0, 6, 20, 0, 20}));
+}
+
+TEST(Hierarchy, DistancesToUnreachable) {
+  Graph g;
+  g.addVertex(); g.addVertex(); g.addVertex();
+  g.setEdge(0, 1, 1); g.setEdge(2, 1, 1);
+  ContractionHierarchy h{g};
+  Workers w{1};
+
+  auto d = h.distances({0, 1}, h.buckets({1, 2}, w), w);
+
+  EXPECT_THAT(d, ContainerEq(std::vector<Distance>{
+      1, std::numeric_limits<Distance>::infinity(),
+      0, std::numeric_limits<Distance>::infinity()}));
+}
+
+TEST(Hierarchy, DistancesSameAsDijkstra) {
+  std::mt19937 r{23};
+  auto g = random(r, 60, 240);
+  ContractionHierarchy h{g};
+  std::vector<Id> ids;
+  for (Id i = 0; i < 60; ++i) ids.push_back(i);
+
+  for (std::size_t threads = 1; threads <= 3; ++threads) {
+    Workers w{threads};
+    auto d = h.distances(ids, h.buckets(ids, w), w);
+    for (Id from = 0; from < 60; ++from) {
+      auto t = g.distances(from);
+      for (Id to = 0; to < 60; ++to) {
+        auto it = t.steps.find(to);
+        auto expected = it == end(t.steps) ? std::numeric_limits<Distance>::infinity()
+                                           : it->second.distance;
+        ASSERT_THAT(d[from * 60 + to], DoubleEq(expected));
+      }
+    }
+  }
+}
+
+TEST(Hierarchy, DistancesInKeptScratches) {
+  std::mt19937 r{31};
+  auto g = random(r, 50, 200);
+  ContractionHierarchy h{g};
+  std::vector<Id> ids;
+  for (Id i = 0; i < 50; ++i) ids.push_back(i);
+  Workers w{2};
+  auto const expected = h.distances(ids, h.buckets(ids, w), w);
+  ContractionHierarchy::Scratches scratches;
+
+  auto b = h.buckets(ids, w, scratches);
+  std::vector<Distance> d;
+  for (std::size_t first = 0; first < ids.size(); first += 7) {
+    std::vector<Id> part(begin(ids) + first, begin(ids) + std::min(first + 7, ids.size()));
+    auto rows = h.distances(part, b, w, scratches);
+    d.insert(end(d), begin(rows), end(rows));
+  }
+
+  EXPECT_THAT(scratches.size(), Eq(w.size()));
+  EXPECT_THAT(d, ContainerEq(expected));
+}
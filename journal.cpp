@@ -0,0 +1,272 @@
+#include "journal.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+#include "binary.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+constexpr std::size_t kHeader = 17;  // size, checksum, version and type
+constexpr std::size_t kChecked = 8;  // checksum covers the header from the version
+constexpr char kExtension[] = ".wal";
+constexpr std::size_t kDigits = 20;
+
+constexpr std::array<std::uint32_t, 256> crcTable() {
+  std::array<std::uint32_t, 256> table{};
+  for (std::uint32_t i = 0; i < table.size(); ++i) {
+    auto c = i;
+    for (int k = 0; k < 8; ++k) c = c & 1 ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+    table[i] = c;
+  }
+  return table;
+}
+
+constexpr auto kCrcTable = crcTable();
+
+/**
+ * Continues CRC-32 of data.
+ * @param crc - checksum of the previous data, 0 for the first one.
+ * @param data - the data.
+ * @return checksum of all the data.
+ */
+std::uint32_t crc32(std::uint32_t crc, std::string_view data) {
+  crc = ~crc;
+  for (unsigned char c: data) crc = kCrcTable[(crc ^ c) & 0xFF] ^ (crc >> 8);
+  return ~crc;
+}
+
+void put(char* out, std::uint64_t value, std::size_t size) {
+  for (std::size_t i = 0; i < size; ++i) out[i] = static_cast<char>((value >> (8 * i)) & 0xFF);
+}
+
+/**
+ * Stops the process when the journal can not be written.
+ * @param what - the failed operation.
+ */
+[[noreturn]] void crash(char const* what) {
+  std::cerr << "Journal: " << what << ": " << std::strerror(errno) << '\n';
+  std::abort();
+}
+
+void syncDirectory(std::string const& directory) {
+  auto fd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+  if (fd < 0) return;
+  ::fsync(fd);
+  ::close(fd);
+}
+}  // namespace
+
+Journal::Journal(std::string directory, Sync sync, std::size_t limit, Compact compact):
+    directory_{std::move(directory)},
+    snapshot_{directory_ + "/snapshot"},
+    sync_{sync},
+    limit_{limit},
+    compact_{std::move(compact)},
+    synced_{std::chrono::steady_clock::now()} {
+  std::vector<std::uint64_t> numbers;
+  try {
+    fs::create_directories(directory_);
+    for (auto const& entry: fs::directory_iterator{directory_}) {
+      auto name = entry.path().filename().string();
+      if (name.size() != kDigits + sizeof(kExtension) - 1
+          || name.compare(kDigits, std::string::npos, kExtension) != 0
+          || !std::all_of(begin(name), begin(name) + kDigits,
+                          [](unsigned char c) { return std::isdigit(c); })) {
+        continue;
+      }
+      numbers.push_back(std::stoull(name.substr(0, kDigits)));
+    }
+  } catch (fs::filesystem_error const&) {
+    throw std::runtime_error{"Can not open journal"};
+  }
+  std::sort(begin(numbers), end(numbers));
+  for (auto n: numbers) {
+    closed_.push_back({segment(n), std::numeric_limits<std::size_t>::max()});
+  }
+  number_ = numbers.empty() ? 1 : numbers.back() + 1;
+  open(number_);
+  writer_ = std::thread{&Journal::loop, this};
+}
+
+Journal::~Journal() {
+  {
+    std::lock_guard lock{mutex_};
+    stop_ = true;
+  }
+  appended_.notify_one();
+  writer_.join();
+  if (compactor_.joinable()) compactor_.join();
+  ::close(fd_);
+}
+
+void Journal::replay(Record const& record) {
+  std::vector<Segment> segments;
+  {
+    std::lock_guard lock{mutex_};
+    segments = closed_;
+  }
+  for (auto& s: segments) {
+    std::ifstream in{s.file, std::ios::binary};
+    std::string data{std::istreambuf_iterator<char>{in}, {}};
+    std::string_view rest{data};
+    s.version = 0;
+    while (rest.size() >= kHeader) {
+      BinaryReader header{rest.substr(0, kHeader)};
+      std::size_t size = header.u32();
+      auto checksum = header.u32();
+      auto version = header.u64();
+      auto type = header.u8();
+      if (rest.size() - kHeader < size || type > static_cast<std::uint8_t>(Type::kBinary)
+          || crc32(0, rest.substr(kChecked, kHeader - kChecked + size)) != checksum) {
+        break;  // the rest was not written completely
+      }
+      record(static_cast<Type>(type), version, rest.substr(kHeader, size));
+      s.version = version;
+      rest.remove_prefix(kHeader + size);
+    }
+  }
+  std::lock_guard lock{mutex_};
+  for (auto const& s: segments) {
+    auto it = std::find_if(begin(closed_), end(closed_),
+        [&s](Segment const& c) { return c.file == s.file; });
+    if (it != end(closed_)) it->version = s.version;
+  }
+}
+
+std::uint64_t Journal::append(Type type, std::size_t version, std::string_view request) {
+  char header[kHeader];
+  put(header, request.size(), 4);
+  put(header + 8, version, 8);
+  header[16] = static_cast<char>(type);
+  auto checksum = crc32(crc32(0, {header + kChecked, kHeader - kChecked}), request);
+  put(header + 4, checksum, 4);
+  std::lock_guard lock{mutex_};
+  if (buffer_.empty()) appended_.notify_one();  // the writer is woken by the first record
+  buffer_.append(header, kHeader);
+  buffer_.append(request);
+  bufferVersion_ = version;
+  return ++tickets_;
+}
+
+void Journal::wait(std::uint64_t ticket) {
+  if (sync_ != Sync::kAlways) return;
+  std::unique_lock lock{mutex_};
+  durable_.wait(lock, [this, ticket] { return written_ >= ticket; });
+}
+
+std::string Journal::segment(std::uint64_t number) const {
+  char name[kDigits + sizeof(kExtension)];
+  std::snprintf(name, sizeof(name), "%020llu%s", static_cast<unsigned long long>(number), kExtension);
+  return directory_ + "/" + name;
+}
+
+void Journal::open(std::uint64_t number) {
+  fd_ = ::open(segment(number).c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+  if (fd_ < 0) crash("open");
+  if (sync_ != Sync::kNever) syncDirectory(directory_);
+  size_ = 0;
+}
+
+void Journal::write(std::string const& data) {
+  for (std::size_t done = 0; done < data.size();) {
+    auto n = ::write(fd_, data.data() + done, data.size() - done);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      crash("write");
+    }
+    done += static_cast<std::size_t>(n);
+  }
+  size_ += data.size();
+}
+
+void Journal::loop() {
+  std::string batch;
+  bool dirty = false;
+  std::unique_lock lock{mutex_};
+  while (true) {
+    auto ready = [this] { return stop_ || !buffer_.empty(); };
+    if (sync_ == Sync::kPeriodic && dirty) {
+      appended_.wait_until(lock, synced_ + kPeriod, ready);
+    } else {
+      appended_.wait(lock, ready);
+    }
+    auto const stop = stop_;
+    auto const tickets = tickets_;
+    auto const version = bufferVersion_;
+    batch.swap(buffer_);
+    lock.unlock();
+
+    if (!batch.empty()) {
+      write(batch);
+      batch.clear();
+      version_ = version;
+      dirty = true;
+    }
+    auto const now = std::chrono::steady_clock::now();
+    if (dirty && (stop || sync_ == Sync::kAlways
+                  || (sync_ == Sync::kPeriodic && now - synced_ >= kPeriod))) {
+      if (::fdatasync(fd_) != 0) crash("sync");
+      synced_ = now;
+      dirty = false;
+    }
+    if (size_ >= limit_ && !stop) {
+      rotate();
+      dirty = false;
+    }
+
+    lock.lock();
+    written_ = tickets;
+    durable_.notify_all();
+    if (stop && buffer_.empty()) break;
+  }
+}
+
+void Journal::rotate() {
+  if (sync_ != Sync::kNever && ::fdatasync(fd_) != 0) crash("sync");
+  ::close(fd_);
+  {
+    std::lock_guard lock{mutex_};
+    closed_.push_back({segment(number_), version_});
+    if (!compacting_) {
+      compacting_ = true;
+      if (compactor_.joinable()) compactor_.join();
+      compactor_ = std::thread{&Journal::compact, this};
+    }
+  }
+  open(++number_);
+}
+
+void Journal::compact() {
+  std::size_t version = 0;
+  try {
+    version = compact_(snapshot_);
+  } catch (std::exception const& e) {
+    std::cerr << "Journal: compaction: " << e.what() << '\n';
+  }
+  if (version > 0) syncDirectory(directory_);
+  std::lock_guard lock{mutex_};
+  if (version > 0) {
+    auto covered = std::stable_partition(begin(closed_), end(closed_),
+        [version](Segment const& s) { return s.version > version; });
+    for (auto it = covered; it != end(closed_); ++it) std::remove(it->file.c_str());
+    closed_.erase(covered, end(closed_));
+  }
+  compacting_ = false;
+}
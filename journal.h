@@ -0,0 +1,147 @@
+#ifndef JOURNAL_H_
+#define JOURNAL_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+/**
+ * Write-ahead log of requests which changed the graph.
+ * The journal is a directory of a snapshot and numbered segments of
+ * records. A record keeps the request as it was received and the version
+ * which it made, so the graph is restored by loading the snapshot and
+ * serving the newer requests again.
+ * Requests are appended into a buffer and a writer thread writes all the
+ * buffered ones at once. When the segment grows over the limit, the writer
+ * starts the next one and a snapshot of the graph is saved in background,
+ * after that the segments which it covers are removed.
+ * A failed write stops the process, since the graph is not durable anymore.
+ */
+class Journal {
+public:
+  /**
+   * When the written records are flushed to the disk.
+   */
+  enum class Sync {
+    kAlways,  // before the request is answered
+    kPeriodic,  // once in a period, a crash loses the last period
+    kNever  // when the system decides
+  };
+
+  /**
+   * Encoding of a request.
+   */
+  enum class Type: std::uint8_t { kText, kBinary };
+
+  /**
+   * Function which saves the snapshot.
+   * It returns version of the saved graph or 0 if nothing is saved.
+   */
+  using Compact = std::function<std::size_t(std::string const& file)>;
+
+  /**
+   * Function which takes a request from the journal.
+   */
+  using Record = std::function<void(Type type, std::size_t version, std::string_view request)>;
+
+  static constexpr std::size_t kLimit = 64 * 1024 * 1024;
+  static constexpr std::chrono::milliseconds kPeriod{1000};
+
+  /**
+   * Opens the journal, the directory is created if it does not exist.
+   * New records go to a new segment, so the old ones are not changed.
+   * @param directory - the directory.
+   * @param sync - when records are flushed.
+   * @param limit - size of a segment which causes compaction in bytes.
+   * @param compact - function which saves the snapshot.
+   * @throw std::runtime_error if the directory can not be used.
+   */
+  Journal(std::string directory, Sync sync, std::size_t limit, Compact compact);
+
+  /**
+   * Writes and flushes the buffered records and stops the threads.
+   */
+  ~Journal();
+
+  Journal(Journal const&) = delete;
+  Journal& operator=(Journal const&) = delete;
+
+  /**
+   * Gets file of the snapshot.
+   * @return the file, it may not exist.
+   */
+  std::string const& snapshot() const { return snapshot_; }
+
+  /**
+   * Reads records of the old segments in order.
+   * Reading of a segment stops at a record which was not written completely.
+   * @param record - function which takes every record.
+   */
+  void replay(Record const& record);
+
+  /**
+   * Appends request which changed the graph.
+   * Requests must be appended in order of their versions.
+   * @param type - encoding of the request.
+   * @param version - version which the request made.
+   * @param request - the request.
+   * @return ticket to wait for the record.
+   */
+  std::uint64_t append(Type type, std::size_t version, std::string_view request);
+
+  /**
+   * Waits until the record is flushed if every record is flushed.
+   * @param ticket - ticket of the record.
+   */
+  void wait(std::uint64_t ticket);
+
+private:
+  /**
+   * Segment which is not written anymore.
+   */
+  struct Segment {
+    std::string file;
+    std::size_t version;  // version of the last record
+  };
+
+  std::string segment(std::uint64_t number) const;
+  void open(std::uint64_t number);
+  void write(std::string const& data);
+  void loop();
+  void rotate();
+  void compact();
+
+  std::string directory_;
+  std::string snapshot_;
+  Sync sync_;
+  std::size_t limit_;
+  Compact compact_;
+  std::uint64_t number_{0};  // number of the current segment
+  int fd_{-1};
+  std::size_t size_{0};  // size of the current segment
+  std::size_t version_{0};  // version of the last written record
+  std::chrono::steady_clock::time_point synced_;
+
+  std::mutex mutex_;  // it guards the fields below
+  std::condition_variable appended_;
+  std::condition_variable durable_;
+  std::string buffer_;
+  std::size_t bufferVersion_{0};  // version of the last buffered record
+  std::uint64_t tickets_{0};  // number of appended records
+  std::uint64_t written_{0};  // number of written records
+  std::vector<Segment> closed_;  // segments in order, old ones go first
+  bool compacting_{false};
+  bool stop_{false};
+
+  std::thread compactor_;
+  std::thread writer_;
+};
+
+#endif /* JOURNAL_H_ */
@@ -0,0 +1,166 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "binary.h"
+#include "journal.h"
+#include "processor.h"
+
+using ::testing::Eq;
+using ::testing::ElementsAre;
+using ::testing::IsEmpty;
+
+namespace fs = std::filesystem;
+
+namespace {
+/**
+ * Directory which is removed at the end of a test.
+ */
+struct TempDirectory {
+  explicit TempDirectory(std::string name): name{::testing::TempDir() + name} {
+    fs::remove_all(this->name);
+  }
+  ~TempDirectory() { fs::remove_all(name); }
+
+  std::string name;
+};
+
+using Records = std::vector<std::tuple<Journal::Type, std::size_t, std::string>>;
+
+Records replay(std::string const& directory) {
+  Records records;
+  Journal journal{directory, Journal::Sync::kNever, Journal::kLimit,
+                  [](std::string const&) { return std::size_t{0}; }};
+  journal.replay([&records](Journal::Type type, std::size_t version, std::string_view request) {
+    records.emplace_back(type, version, request);
+  });
+  return records;
+}
+
+Journal::Compact const never = [](std::string const&) { return std::size_t{0}; };
+}  // namespace
+
+TEST(Journal, ReplayAppended) {
+  TempDirectory directory{"journal_replay"};
+  {
+    Journal journal{directory.name, Journal::Sync::kPeriodic, Journal::kLimit, never};
+    journal.append(Journal::Type::kText, 1, R"({"action":"AddVertex"})");
+    journal.append(Journal::Type::kBinary, 2, std::string{"\x01", 1});
+  }
+
+  EXPECT_THAT(replay(directory.name), ElementsAre(
+      std::make_tuple(Journal::Type::kText, 1, R"({"action":"AddVertex"})"),
+      std::make_tuple(Journal::Type::kBinary, 2, std::string{"\x01", 1})));
+}
+
+TEST(Journal, WaitForFlush) {
+  TempDirectory directory{"journal_wait"};
+  Journal journal{directory.name, Journal::Sync::kAlways, Journal::kLimit, never};
+
+  journal.wait(journal.append(Journal::Type::kText, 1, "a"));
+
+  EXPECT_THAT(replay(directory.name), ElementsAre(std::make_tuple(Journal::Type::kText, 1, "a")));
+}
+
+TEST(Journal, SkipTornRecord) {
+  TempDirectory directory{"journal_torn"};
+  {
+    Journal journal{directory.name, Journal::Sync::kNever, Journal::kLimit, never};
+    journal.append(Journal::Type::kText, 1, "a");
+    journal.append(Journal::Type::kText, 2, "b");
+  }
+  for (auto const& entry: fs::directory_iterator{directory.name}) {
+    if (fs::file_size(entry.path()) == 0) continue;
+    fs::resize_file(entry.path(), fs::file_size(entry.path()) - 1);
+  }
+
+  EXPECT_THAT(replay(directory.name), ElementsAre(std::make_tuple(Journal::Type::kText, 1, "a")));
+}
+
+TEST(Journal, SkipCorruptedRecord) {
+  TempDirectory directory{"journal_corrupted"};
+  {
+    Journal journal{directory.name, Journal::Sync::kNever, Journal::kLimit, never};
+    journal.append(Journal::Type::kText, 1, "abc");
+  }
+  for (auto const& entry: fs::directory_iterator{directory.name}) {
+    if (fs::file_size(entry.path()) == 0) continue;
+    std::fstream file{entry.path(), std::ios::in | std::ios::out | std::ios::binary};
+    file.seekp(-1, std::ios::end);
+    file.put('x');
+  }
+
+  EXPECT_THAT(replay(directory.name), IsEmpty());
+}
+
+TEST(Journal, CompactFullSegment) {
+  TempDirectory directory{"journal_compact"};
+  std::string saved;
+  {
+    Journal journal{directory.name, Journal::Sync::kAlways, 1,
+                    [&saved](std::string const& file) { saved = file; return std::size_t{1}; }};
+    journal.wait(journal.append(Journal::Type::kText, 1, "a"));
+  }
+
+  EXPECT_THAT(saved, Eq(directory.name + "/snapshot"));
+  EXPECT_THAT(replay(directory.name), IsEmpty());
+}
+
+TEST(Journal, KeepSegmentNewerThanSnapshot) {
+  TempDirectory directory{"journal_newer"};
+  {
+    Journal journal{directory.name, Journal::Sync::kAlways, 1,
+                    [](std::string const&) { return std::size_t{0}; }};
+    journal.wait(journal.append(Journal::Type::kText, 1, "a"));
+  }
+
+  EXPECT_THAT(replay(directory.name), ElementsAre(std::make_tuple(Journal::Type::kText, 1, "a")));
+}
+
+TEST(Journal, RecoverGraph) {
+  TempDirectory directory{"journal_recover"};
+  {
+    Processor p;
+    p.recover(directory.name, Journal::Sync::kNever);
+    p.serve(R"({"action":"AddVertex"})");
+    p.serve(R"({"action":"AddVertex"})");
+    p.serve(R"({"action":"AddEdge","from":0,"to":1,"weight":2})");
+    p.serve(R"({"action":"RemoveEdge","from":1,"to":0})");
+    p.serve(R"({"action":"AddEdge","from":0,"to":5,"weight":2})");
+    std::string buffer;
+    BinaryWriter request{buffer};
+    request.u8(static_cast<std::uint8_t>(Opcode::kAddVertex));
+    p.serveBinary(buffer, [](std::string const&) {});
+  }
+
+  Processor p;
+  p.recover(directory.name, Journal::Sync::kNever);
+
+  EXPECT_THAT(p.serve(R"({"action":"GetPath","from":0,"to":1})"),
+      Eq(R"({"ids":["0","1"],"version":"4"})"));
+  EXPECT_THAT(p.serve(R"({"action":"AddVertex"})"), Eq(R"({"id":"3","version":"5"})"));
+}
+
+TEST(Journal, RecoverCompactedGraph) {
+  TempDirectory directory{"journal_recover_compacted"};
+  {
+    Processor p;
+    p.recover(directory.name, Journal::Sync::kAlways, 1);
+    p.serve(R"({"action":"AddVertex"})");
+    p.serve(R"({"action":"AddVertex"})");
+    p.serve(R"({"action":"AddEdge","from":0,"to":1,"weight":2})");
+  }
+
+  Processor p;
+  p.recover(directory.name, Journal::Sync::kNever);
+
+  EXPECT_TRUE(fs::exists(directory.name + "/snapshot"));
+  EXPECT_THAT(p.serve(R"({"action":"GetPath","from":0,"to":1})"),
+      Eq(R"({"ids":["0","1"],"version":"3"})"));
+}
@@ -0,0 +1,305 @@
+#include "json.h"
+
+JsonValue::Iterator& JsonValue::Iterator::operator++() {
+  index_ = document_->nodes_[index_].next + step_;
+  return *this;
+}
+
+JsonValue JsonValue::operator[](std::string_view key) const {
+  if (!document_) return {};
+  auto const& nodes = document_->nodes_;
+  auto const& object = nodes[index_];
+  if (object.type != JsonDocument::Type::kObject) return {};
+  for (auto i = index_ + 1; i < object.next; i = nodes[i + 1].next) {
+    if (document_->text(nodes[i]) == key) return {document_, i + 1};
+  }
+  return {};
+}
+
+JsonValue::Iterator JsonValue::begin() const {
+  if (!document_) return {nullptr, 0, 0};
+  auto const& node = document_->nodes_[index_];
+  if (node.type == JsonDocument::Type::kArray) return {document_, index_ + 1, 0};
+  if (node.type == JsonDocument::Type::kObject) return {document_, index_ + 2, 1};
+  return end();
+}
+
+JsonValue::Iterator JsonValue::end() const {
+  if (!document_) return {nullptr, 0, 0};
+  auto const& node = document_->nodes_[index_];
+  if (node.type == JsonDocument::Type::kObject) return {document_, node.next + 1, 1};
+  return {document_, node.next, 0};
+}
+
+std::optional<std::string_view> JsonValue::text() const {
+  if (!document_) return std::nullopt;
+  auto const& node = document_->nodes_[index_];
+  if (node.type == JsonDocument::Type::kArray || node.type == JsonDocument::Type::kObject) {
+    return std::nullopt;
+  }
+  return document_->text(node);
+}
+
+JsonValue JsonDocument::parse(std::string_view text) {
+  source_ = text;
+  position_ = 0;
+  nodes_.clear();
+  strings_.clear();
+  space();
+  value(0);
+  space();
+  if (position_ != source_.size()) fail();
+  return {this, 0};
+}
+
+void JsonDocument::value(std::size_t depth) {
+  if (position_ == source_.size()) fail();
+  switch (source_[position_]) {
+    case '{': return container(Type::kObject, '}', depth);
+    case '[': return container(Type::kArray, ']', depth);
+    case '"': return string();
+    case 't': return literal("true");
+    case 'f': return literal("false");
+    case 'n': return literal("null");
+    default: return number();
+  }
+}
+
+void JsonDocument::container(Type type, char close, std::size_t depth) {
+  if (depth == kMaxDepth) fail();
+  auto index = nodes_.size();
+  nodes_.push_back({type, false, position_, 0, 0});
+  ++position_;
+  space();
+  if (!consume(close)) {
+    do {
+      space();
+      if (type == Type::kObject) {
+        if (position_ == source_.size() || source_[position_] != '"') fail();
+        string();
+        space();
+        if (!consume(':')) fail();
+        space();
+      }
+      value(depth + 1);
+      space();
+    } while (consume(','));
+    if (!consume(close)) fail();
+  }
+  nodes_[index].size = position_ - nodes_[index].offset;
+  nodes_[index].next = nodes_.size();
+}
+
+void JsonDocument::string() {
+  auto begin = ++position_;
+  bool escaped = false;
+  for (;; ++position_) {
+    if (position_ == source_.size()) fail();
+    auto c = static_cast<unsigned char>(source_[position_]);
+    if (c == '"') break;
+    if (c < 0x20) fail();
+    if (c == '\\') {
+      escaped = true;
+      ++position_;
+    }
+  }
+  auto raw = source_.substr(begin, position_ - begin);
+  ++position_;
+  if (!escaped) {
+    nodes_.push_back({Type::kString, false, begin, raw.size(), nodes_.size() + 1});
+    return;
+  }
+  auto offset = strings_.size();
+  for (std::size_t i = 0; i < raw.size(); ++i) {
+    if (raw[i] != '\\') {
+      strings_ += raw[i];
+      continue;
+    }
+    if (++i == raw.size()) fail();
+    switch (raw[i]) {
+      case '"': strings_ += '"'; break;
+      case '\\': strings_ += '\\'; break;
+      case '/': strings_ += '/'; break;
+      case 'b': strings_ += '\b'; break;
+      case 'f': strings_ += '\f'; break;
+      case 'n': strings_ += '\n'; break;
+      case 'r': strings_ += '\r'; break;
+      case 't': strings_ += '\t'; break;
+      case 'u': {
+        auto hex = [this, &raw](std::size_t at) {
+          unsigned code = 0;
+          if (at + 4 > raw.size()) fail();
+          auto [end, error] = std::from_chars(raw.data() + at, raw.data() + at + 4, code, 16);
+          if (error != std::errc{} || end != raw.data() + at + 4) fail();
+          return code;
+        };
+        auto code = hex(i + 1);
+        i += 4;
+        if (code >= 0xD800 && code < 0xDC00) {
+          if (i + 2 >= raw.size() || raw[i + 1] != '\\' || raw[i + 2] != 'u') fail();
+          auto low = hex(i + 3);
+          if (low < 0xDC00 || low >= 0xE000) fail();
+          code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+          i += 6;
+        } else if (code >= 0xDC00 && code < 0xE000) {
+          fail();
+        }
+        if (code < 0x80) {
+          strings_ += static_cast<char>(code);
+        } else if (code < 0x800) {
+          strings_ += static_cast<char>(0xC0 | (code >> 6));
+          strings_ += static_cast<char>(0x80 | (code & 0x3F));
+        } else if (code < 0x10000) {
+          strings_ += static_cast<char>(0xE0 | (code >> 12));
+          strings_ += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+          strings_ += static_cast<char>(0x80 | (code & 0x3F));
+        } else {
+          strings_ += static_cast<char>(0xF0 | (code >> 18));
+          strings_ += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+          strings_ += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+          strings_ += static_cast<char>(0x80 | (code & 0x3F));
+        }
+        break;
+      }
+      default: fail();
+    }
+  }
+  nodes_.push_back({Type::kString, true, offset, strings_.size() - offset, nodes_.size() + 1});
+}
+
+void JsonDocument::number() {
+  auto begin = position_;
+  auto digits = [this] {
+    auto start = position_;
+    while (position_ < source_.size() && source_[position_] >= '0' && source_[position_] <= '9') {
+      ++position_;
+    }
+    if (position_ == start) fail();
+  };
+  consume('-');
+  if (!consume('0')) digits();
+  if (consume('.')) digits();
+  if (consume('e') || consume('E')) {
+    if (!consume('+')) consume('-');
+    digits();
+  }
+  nodes_.push_back({Type::kNumber, false, begin, position_ - begin, nodes_.size() + 1});
+}
+
+void JsonDocument::literal(std::string_view word) {
+  if (source_.substr(position_, word.size()) != word) fail();
+  nodes_.push_back({Type::kLiteral, false, position_, word.size(), nodes_.size() + 1});
+  position_ += word.size();
+}
+
+void JsonDocument::space() {
+  while (position_ < source_.size()) {
+    auto c = source_[position_];
+    if (c != ' ' && c != '\t' && c != '\n' && c != '\r') return;
+    ++position_;
+  }
+}
+
+bool JsonDocument::consume(char c) {
+  if (position_ == source_.size() || source_[position_] != c) return false;
+  ++position_;
+  return true;
+}
+
+void JsonDocument::fail() const {
+  throw JsonError{"Invalid JSON at " + std::to_string(position_)};
+}
+
+std::string_view JsonDocument::text(Node const& node) const {
+  if (node.decoded) return std::string_view{strings_}.substr(node.offset, node.size);
+  return source_.substr(node.offset, node.size);
+}
+
+JsonWriter::JsonWriter(std::string& buffer): buffer_{buffer} {
+  buffer_.clear();
+}
+
+void JsonWriter::beginObject() {
+  separate();
+  buffer_ += '{';
+  comma_ = false;
+  ++depth_;
+}
+
+void JsonWriter::endObject() {
+  --depth_;
+  if (style_ == Style::kPropertyTree && depth_ > 0 && buffer_.back() == '{') {
+    buffer_.back() = '"';
+    buffer_ += '"';
+  } else {
+    buffer_ += '}';
+  }
+  comma_ = true;
+}
+
+void JsonWriter::beginArray() {
+  separate();
+  buffer_ += '[';
+  comma_ = false;
+  ++depth_;
+}
+
+void JsonWriter::endArray() {
+  --depth_;
+  if (style_ == Style::kPropertyTree && buffer_.back() == '[') {
+    buffer_.back() = '"';
+    buffer_ += '"';
+  } else {
+    buffer_ += ']';
+  }
+  comma_ = true;
+}
+
+void JsonWriter::key(std::string_view name) {
+  separate();
+  escape(name);
+  buffer_ += ':';
+  comma_ = false;
+}
+
+void JsonWriter::value(std::string_view text) {
+  separate();
+  escape(text);
+  comma_ = true;
+}
+
+void JsonWriter::reset() {
+  buffer_.clear();
+  comma_ = false;
+  depth_ = 0;
+}
+
+void JsonWriter::separate() {
+  if (comma_) buffer_ += ',';
+}
+
+void JsonWriter::escape(std::string_view text) {
+  static constexpr char kHex[] = "0123456789ABCDEF";
+  buffer_ += '"';
+  for (auto c: text) {
+    auto u = static_cast<unsigned char>(c);
+    if (u >= 0x20 && u != '"' && u != '/' && u != '\\') {
+      buffer_ += c;
+      continue;
+    }
+    buffer_ += '\\';
+    switch (c) {
+      case '\b': buffer_ += 'b'; break;
+      case '\f': buffer_ += 'f'; break;
+      case '\n': buffer_ += 'n'; break;
+      case '\r': buffer_ += 'r'; break;
+      case '\t': buffer_ += 't'; break;
+      case '"': case '/': case '\\': buffer_ += c; break;
+      default:
+        buffer_ += "u00";
+        buffer_ += kHex[u >> 4];
+        buffer_ += kHex[u & 0xF];
+    }
+  }
+  buffer_ += '"';
+}
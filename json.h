@@ -0,0 +1,266 @@
+#ifndef JSON_H_
+#define JSON_H_
+
+#include <charconv>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+class JsonDocument;
+
+/**
+ * Error of parsing of JSON text.
+ */
+class JsonError: public std::runtime_error {
+public:
+  using std::runtime_error::runtime_error;
+};
+
+/**
+ * Value in a parsed JSON document.
+ * It refers to the document, so it is valid until the document is parsed
+ * again. A missing value is empty, so lookups can be chained.
+ */
+class JsonValue {
+public:
+  /**
+   * Iterator over elements of an array or values of an object.
+   */
+  class Iterator {
+  public:
+    JsonValue operator*() const { return {document_, index_}; }
+    Iterator& operator++();
+    bool operator!=(Iterator const& other) const { return index_ != other.index_; }
+
+  private:
+    friend class JsonValue;
+    Iterator(JsonDocument const* document, std::size_t index, std::size_t step)
+      : document_{document}, index_{index}, step_{step} {}
+
+    JsonDocument const* document_;
+    std::size_t index_;
+    std::size_t step_;  // nodes between the end of a value and the next one
+  };
+
+  JsonValue() = default;
+  JsonValue(JsonDocument const* document, std::size_t index)
+    : document_{document}, index_{index} {}
+
+  /**
+   * Checks whether the value exists.
+   * @return true if the value exists.
+   */
+  explicit operator bool() const { return document_ != nullptr; }
+
+  /**
+   * Gets member of an object.
+   * @param key - name of the member.
+   * @return the first member with the name or empty value.
+   */
+  JsonValue operator[](std::string_view key) const;
+
+  /**
+   * Gets the value as a string or a number.
+   * Numbers are accepted both as JSON numbers and as strings.
+   * @return the value or nothing if it is missing, an array, an object
+   *         or can not be converted.
+   */
+  template <typename T>
+  std::optional<T> as() const;
+
+  Iterator begin() const;
+  Iterator end() const;
+
+private:
+  /**
+   * Gets text of a string, a number or a literal.
+   * @return unescaped text or nothing if it is missing, an array or an object.
+   */
+  std::optional<std::string_view> text() const;
+
+  JsonDocument const* document_{nullptr};
+  std::size_t index_{0};
+};
+
+/**
+ * JSON document parsed from a text without copying it.
+ * Values are stored in one array in order of the text, every value knows
+ * where its subtree ends. Only strings with escapes are copied. Memory of
+ * the document is reused by the next parsing, so a warmed up document
+ * parses requests of the same shape without allocation.
+ */
+class JsonDocument {
+public:
+  /**
+   * Parses the text, it should live while the document is used.
+   * @param text - the text.
+   * @return the root value.
+   * @throw JsonError if the text is not valid JSON.
+   */
+  JsonValue parse(std::string_view text);
+
+private:
+  friend class JsonValue;
+
+  enum class Type: std::uint8_t { kLiteral, kNumber, kString, kArray, kObject };
+
+  struct Node {
+    Type type;
+    bool decoded;  // text is in the buffer of unescaped strings
+    std::size_t offset;
+    std::size_t size;
+    std::size_t next;  // index of the node after the subtree
+  };
+
+  static constexpr std::size_t kMaxDepth = 256;
+
+  void value(std::size_t depth);
+  void container(Type type, char close, std::size_t depth);
+  void string();
+  void number();
+  void literal(std::string_view word);
+  void space();
+  bool consume(char c);
+  [[noreturn]] void fail() const;
+  std::string_view text(Node const& node) const;
+
+  std::string_view source_;
+  std::size_t position_{0};
+  std::vector<Node> nodes_;
+  std::string strings_;  // unescaped strings
+};
+
+/**
+ * Writer of compact JSON into a buffer which is reused between responses.
+ * Scalars are written as strings. By default empty nested arrays and objects
+ * are written as empty strings, so the output is the same as property tree
+ * made before, the actions which property tree never wrote use plain JSON.
+ */
+class JsonWriter {
+public:
+  /**
+   * Style of the output.
+   */
+  enum class Style {
+    kPropertyTree,  // empty nested containers as "", numbers with max_digits10
+    kJson  // empty containers as they are, the shortest numbers which are read back
+  };
+
+  /**
+   * Creates writer, the buffer is cleared.
+   * @param buffer - the buffer.
+   */
+  explicit JsonWriter(std::string& buffer);
+
+  void beginObject();
+  void endObject();
+  void beginArray();
+  void endArray();
+
+  /**
+   * Sets style of the rest of the output, it is kept by reset().
+   * @param style - the style.
+   */
+  void setStyle(Style style) { style_ = style; }
+
+  /**
+   * Writes name of the next member of the current object.
+   * @param name - the name.
+   */
+  void key(std::string_view name);
+
+  /**
+   * Writes number as name of the next member of the current object.
+   * @param name - the name.
+   */
+  template <typename Number, typename = std::enable_if_t<std::is_arithmetic_v<Number>>>
+  void key(Number name) {
+    char chars[kNumberSize];
+    key(format(chars, name));
+  }
+
+  /**
+   * Writes string value.
+   * @param text - the value.
+   */
+  void value(std::string_view text);
+
+  /**
+   * Writes number as a string value.
+   * @param number - the value.
+   */
+  template <typename Number, typename = std::enable_if_t<std::is_arithmetic_v<Number>>>
+  void value(Number number) {
+    char chars[kNumberSize];
+    value(format(chars, number));
+  }
+
+  /**
+   * Clears the buffer to write another document.
+   */
+  void reset();
+
+  /**
+   * Gets the written text.
+   * @return the text.
+   */
+  std::string const& text() const { return buffer_; }
+
+private:
+  static constexpr std::size_t kNumberSize = 32;
+
+  /**
+   * Formats number so the same value is read back, like an output stream
+   * with max_digits10 precision in property tree style, otherwise by
+   * the shortest text.
+   */
+  template <typename Number>
+  std::string_view format(char (&chars)[kNumberSize], Number number) const {
+    std::to_chars_result result;
+    if constexpr (std::is_floating_point_v<Number>) {
+      result = style_ == Style::kPropertyTree
+          ? std::to_chars(chars, chars + kNumberSize, number, std::chars_format::general,
+                          std::numeric_limits<Number>::max_digits10)
+          : std::to_chars(chars, chars + kNumberSize, number);
+    } else {
+      result = std::to_chars(chars, chars + kNumberSize, number);
+    }
+    return {chars, static_cast<std::size_t>(result.ptr - chars)};
+  }
+
+  void separate();
+  void escape(std::string_view text);
+
+  std::string& buffer_;
+  bool comma_{false};  // the next member or element follows another one
+  std::size_t depth_{0};
+  Style style_{Style::kPropertyTree};
+};
+
+template <>
+inline std::optional<std::string_view> JsonValue::as<std::string_view>() const {
+  return text();
+}
+
+template <typename T>
+std::optional<T> JsonValue::as() const {
+  static_assert(std::is_arithmetic_v<T>, "only strings and numbers are supported");
+  auto t = text();
+  if (!t || t->empty()) return std::nullopt;
+  T result{};
+  auto [end, error] = std::from_chars(t->data(), t->data() + t->size(), result);
+  if (error != std::errc{} || end != t->data() + t->size()) return std::nullopt;
+  if constexpr (std::is_floating_point_v<T>) {
+    if (!std::isfinite(result)) return std::nullopt;
+  }
+  return result;
+}
+
+#endif /* JSON_H_ */
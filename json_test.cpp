@@ -0,0 +1,255 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <limits>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "json.h"
+#include "types.h"
+
+using ::testing::ElementsAre;
+using ::testing::Eq;
+using ::testing::Optional;
+
+TEST(Json, Member) {
+  JsonDocument d;
+  auto v = d.parse(R"({"action":"GetPath","from":0,"to":12})");
+
+  EXPECT_THAT(v["action"].as<std::string_view>(), Optional(Eq("GetPath")));
+  EXPECT_THAT(v["from"].as<Id>(), Optional(Eq(0)));
+  EXPECT_THAT(v["to"].as<Id>(), Optional(Eq(12)));
+}
+
+TEST(Json, MissingMember) {
+  JsonDocument d;
+  auto v = d.parse(R"({"from":0})");
+
+  EXPECT_FALSE(v["to"]);
+  EXPECT_THAT(v["to"].as<Id>(), Eq(std::nullopt));
+  EXPECT_THAT(v["to"]["from"].as<Id>(), Eq(std::nullopt));
+}
+
+TEST(Json, FirstOfSameMembers) {
+  JsonDocument d;
+  auto v = d.parse(R"({"id":1,"id":2})");
+
+  EXPECT_THAT(v["id"].as<Id>(), Optional(Eq(1)));
+}
+
+TEST(Json, MemberAfterNested) {
+  JsonDocument d;
+  auto v = d.parse(R"({"a":{"id":1,"b":[1,[2]]},"id":3})");
+
+  EXPECT_THAT(v["id"].as<Id>(), Optional(Eq(3)));
+  EXPECT_THAT(v["a"]["id"].as<Id>(), Optional(Eq(1)));
+}
+
+TEST(Json, NumberAsString) {
+  JsonDocument d;
+  auto v = d.parse(R"({"from":"7","weight":"1.5"})");
+
+  EXPECT_THAT(v["from"].as<Id>(), Optional(Eq(7)));
+  EXPECT_THAT(v["weight"].as<Distance>(), Optional(Eq(1.5)));
+}
+
+TEST(Json, WrongNumber) {
+  JsonDocument d;
+  auto v = d.parse(R"({"a":3.5,"b":-1,"c":"x","d":[1],"e":true})");
+
+  EXPECT_THAT(v["a"].as<Id>(), Eq(std::nullopt));
+  EXPECT_THAT(v["b"].as<Id>(), Eq(std::nullopt));
+  EXPECT_THAT(v["c"].as<Id>(), Eq(std::nullopt));
+  EXPECT_THAT(v["d"].as<Id>(), Eq(std::nullopt));
+  EXPECT_THAT(v["e"].as<Id>(), Eq(std::nullopt));
+}
+
+TEST(Json, NotFiniteNumber) {
+  JsonDocument d;
+  auto v = d.parse(R"({"a":"nan","b":"inf","c":"-inf","d":"infinity","e":1e400})");
+
+  EXPECT_THAT(v["a"].as<Distance>(), Eq(std::nullopt));
+  EXPECT_THAT(v["b"].as<Distance>(), Eq(std::nullopt));
+  EXPECT_THAT(v["c"].as<Distance>(), Eq(std::nullopt));
+  EXPECT_THAT(v["d"].as<Distance>(), Eq(std::nullopt));
+  EXPECT_THAT(v["e"].as<Distance>(), Eq(std::nullopt));
+}
+
+TEST(Json, Elements) {
+  JsonDocument d;
+  auto v = d.parse(R"({"ids":[3, [4], {"a":5}, 6]})");
+  std::vector<std::string> texts;
+
+  for (auto item: v["ids"]) {
+    texts.push_back(std::string{item.as<std::string_view>().value_or("-")});
+  }
+
+  EXPECT_THAT(texts, ElementsAre("3", "-", "-", "6"));
+}
+
+TEST(Json, ObjectValues) {
+  JsonDocument d;
+  auto v = d.parse(R"({"pairs":{"x":{"from":1},"y":{"from":2}}})");
+  std::vector<Id> ids;
+
+  for (auto item: v["pairs"]) ids.push_back(item["from"].as<Id>().value_or(0));
+
+  EXPECT_THAT(ids, ElementsAre(1, 2));
+}
+
+TEST(Json, EmptyContainers) {
+  JsonDocument d;
+  auto v = d.parse(R"({"a":[],"b":{}})");
+
+  EXPECT_FALSE(v["a"].begin() != v["a"].end());
+  EXPECT_FALSE(v["b"].begin() != v["b"].end());
+}
+
+TEST(Json, Escapes) {
+  JsonDocument d;
+  auto v = d.parse(R"({"a\"b":"x\\y\/\nAé😀"})");
+
+  EXPECT_THAT(v["a\"b"].as<std::string_view>(),
+              Optional(Eq("x\\y/\nA\xC3\xA9\xF0\x9F\x98\x80")));
+}
+
+TEST(Json, InvalidText) {
+  JsonDocument d;
+
+  for (auto text: {"", "{", R"({"a":})", R"({"a" 1})", "[1,]", "01", R"({"a":tru})",
+                   R"("\x")", R"("\ud83d")", "1 2", "\"a\nb\""}) {
+    EXPECT_THROW(d.parse(text), JsonError) << text;
+  }
+}
+
+TEST(Json, TooDeep) {
+  JsonDocument d;
+
+  EXPECT_THROW(d.parse(std::string(1000, '[') + std::string(1000, ']')), JsonError);
+}
+
+TEST(Json, ReparseReusesDocument) {
+  JsonDocument d;
+  d.parse(R"({"a":"\n","b":[1,2,3]})");
+  auto v = d.parse(R"({"a":1})");
+
+  EXPECT_THAT(v["a"].as<Id>(), Optional(Eq(1)));
+  EXPECT_FALSE(v["b"]);
+}
+
+TEST(Json, WriteObject) {
+  std::string buffer;
+  JsonWriter w{buffer};
+
+  w.beginObject();
+  w.key("ids");
+  w.beginArray();
+  w.value(Id{0});
+  w.value(Id{1});
+  w.endArray();
+  w.key(Id{5});
+  w.value(3.4);
+  w.key("version");
+  w.value(std::size_t{2});
+  w.endObject();
+
+  EXPECT_THAT(buffer, Eq(R"({"ids":["0","1"],"5":"3.3999999999999999","version":"2"})"));
+}
+
+TEST(Json, WriteNumbers) {
+  std::string buffer;
+  JsonWriter w{buffer};
+
+  w.beginArray();
+  w.value(3.0);
+  w.value(std::numeric_limits<Distance>::infinity());
+  w.value(0.1);
+  w.value(1e20);
+  w.endArray();
+
+  EXPECT_THAT(buffer, Eq(R"(["3","inf","0.10000000000000001","1e+20"])"));
+}
+
+TEST(Json, WriteEmptyNested) {
+  std::string buffer;
+  JsonWriter w{buffer};
+
+  w.beginObject();
+  w.key("a");
+  w.beginArray();
+  w.endArray();
+  w.key("b");
+  w.beginObject();
+  w.endObject();
+  w.key("c");
+  w.beginArray();
+  w.beginArray();
+  w.endArray();
+  w.endArray();
+  w.endObject();
+
+  EXPECT_THAT(buffer, Eq(R"({"a":"","b":"","c":[""]})"));
+}
+
+TEST(Json, WriteJsonStyle) {
+  std::string buffer;
+  JsonWriter w{buffer};
+  w.setStyle(JsonWriter::Style::kJson);
+
+  w.beginObject();
+  w.key("a");
+  w.beginArray();
+  w.endArray();
+  w.key("b");
+  w.beginObject();
+  w.endObject();
+  w.key("c");
+  w.beginArray();
+  w.value(3.4);
+  w.value(0.1);
+  w.value(3.0);
+  w.value(1e20);
+  w.value(std::numeric_limits<Distance>::infinity());
+  w.beginArray();
+  w.endArray();
+  w.endArray();
+  w.endObject();
+
+  EXPECT_THAT(buffer, Eq(R"({"a":[],"b":{},"c":["3.4","0.1","3","1e+20","inf",[]]})"));
+}
+
+TEST(Json, WriteEmptyRoot) {
+  std::string buffer;
+  JsonWriter w{buffer};
+
+  w.beginObject();
+  w.endObject();
+
+  EXPECT_THAT(buffer, Eq("{}"));
+}
+
+TEST(Json, WriteEscapes) {
+  std::string buffer;
+  JsonWriter w{buffer};
+
+  w.value("a\"b\\c/d\n\x01\xC3\xA9");
+
+  EXPECT_THAT(buffer, Eq(R"("a\"b\\c\/d\n\u0001)" "\xC3\xA9\""));
+}
+
+TEST(Json, ResetWriter) {
+  std::string buffer{"old"};
+  JsonWriter w{buffer};
+  w.beginObject();
+  w.key("a");
+  w.value("b");
+
+  w.reset();
+  w.beginObject();
+  w.key("c");
+  w.value("d");
+  w.endObject();
+
+  EXPECT_THAT(buffer, Eq(R"({"c":"d"})"));
+}
@@ -0,0 +1,208 @@
+#include "landmarks.h"
+
+#include <algorithm>
+#include <functional>
+#include <queue>
+#include <stdexcept>
+#include <utility>
+
+#include "graph.h"
+
+namespace {
+using Item = std::pair<Distance, Vertex const*>;
+using Queue = std::priority_queue<Item, std::vector<Item>, std::greater<>>;
+
+constexpr auto kInfinity = std::numeric_limits<Distance>::infinity();
+
+/**
+ * Calculates distances from the source by outgoing edges
+ * or to the source by incoming edges.
+ * @param source - the source vertex.
+ * @param forward - direction of the search.
+ * @param distances - distances by slot of vertex, they must be infinite.
+ */
+void measure(Vertex const& source, bool forward, Distance* distances) {
+  Queue queue;
+  distances[source.slot] = 0;
+  queue.emplace(0, &source);
+  while (!queue.empty()) {
+    auto [d, v] = queue.top();
+    queue.pop();
+    if (d > distances[v->slot]) continue;
+    (forward ? v->neighbors : v->incoming).forEach([&](Vertex const* w, Distance weight) {
+      auto candidate = d + weight;
+      if (candidate < distances[w->slot]) {
+        distances[w->slot] = candidate;
+        queue.emplace(candidate, w);
+      }
+    });
+  }
+}
+}  // namespace
+
+Landmarks::Landmarks(Graph const& graph, std::size_t count) {
+  auto const& vertexes = graph.vertexes();
+  index(graph);
+  count = std::min(count, vertexes.size());
+  if (count == 0) return;
+
+  auto first = std::min_element(begin(vertexes), end(vertexes),
+      [](auto const& lhs, auto const& rhs) { return lhs.first < rhs.first; });
+  landmarks_.push_back(first->first);
+  from_.assign(count * size_, kInfinity);
+  to_.assign(count * size_, kInfinity);
+  measure(graph, 0);
+
+  std::vector<Distance> score(size_, kInfinity);
+  while (landmarks_.size() < count) {
+    auto const i = landmarks_.size() - 1;
+    auto best = vertexes.end();
+    for (auto it = begin(vertexes); it != end(vertexes); ++it) {
+      auto const id = it->first;
+      auto const slot = it->second.slot;
+      auto round = from_[i * size_ + slot] + to_[i * size_ + slot];
+      score[slot] = std::min(score[slot], round);
+      if (best == vertexes.end() || score[slot] > score[best->second.slot]
+          || (score[slot] == score[best->second.slot] && id < best->first)) {
+        best = it;
+      }
+    }
+    if (score[best->second.slot] == 0) break;
+    landmarks_.push_back(best->first);
+    measure(graph, landmarks_.size() - 1);
+  }
+  from_.resize(landmarks_.size() * size_);
+  to_.resize(landmarks_.size() * size_);
+}
+
+void Landmarks::refresh(Graph const& graph) {
+  auto const& vertexes = graph.vertexes();
+  landmarks_.erase(std::remove_if(begin(landmarks_), end(landmarks_),
+      [&vertexes](Id id) { return vertexes.find(id) == end(vertexes); }),
+      end(landmarks_));
+  index(graph);
+  from_.assign(landmarks_.size() * size_, kInfinity);
+  to_.assign(landmarks_.size() * size_, kInfinity);
+  for (std::size_t i = 0; i < landmarks_.size(); ++i) {
+    measure(graph, i);
+  }
+}
+
+void Landmarks::remap(Graph const& graph) {
+  auto const& vertexes = graph.vertexes();
+  auto const size = graph.slots();
+  std::vector<Distance> from(landmarks_.size() * size, kInfinity);
+  std::vector<Distance> to(landmarks_.size() * size, kInfinity);
+  std::vector<Id> ids(size, kNone);
+  for (std::size_t old = 0; old < size_; ++old) {
+    auto it = vertexes.find(ids_[old]);
+    if (it == end(vertexes)) continue;
+    auto const slot = it->second.slot;
+    ids[slot] = ids_[old];
+    for (std::size_t i = 0; i < landmarks_.size(); ++i) {
+      from[i * size + slot] = from_[i * size_ + old];
+      to[i * size + slot] = to_[i * size_ + old];
+    }
+  }
+  size_ = size;
+  layout_ = graph.layout();
+  ids_ = std::move(ids);
+  from_ = std::move(from);
+  to_ = std::move(to);
+}
+
+void Landmarks::index(Graph const& graph) {
+  size_ = graph.slots();
+  layout_ = graph.layout();
+  ids_.assign(size_, kNone);
+  for (auto const& p: graph.vertexes()) ids_[p.second.slot] = p.first;
+}
+
+bool Landmarks::has(Vertex const& v) const {
+  return v.slot < size_ && ids_[v.slot] == v.id;
+}
+
+void Landmarks::measure(Graph const& graph, std::size_t i) {
+  auto const& landmark = graph.vertexes().at(landmarks_[i]);
+  ::measure(landmark, true, &from_[i * size_]);
+  ::measure(landmark, false, &to_[i * size_]);
+}
+
+Distance Landmarks::bound(Vertex const& from, Vertex const& to) const {
+  if (!has(from) || !has(to)) return 0;
+  auto const a = from.slot;
+  auto const b = to.slot;
+  Distance best = 0;
+  for (std::size_t i = 0; i < landmarks_.size(); ++i) {
+    auto const row = i * size_;
+    if (to_[row + b] != kInfinity) {
+      best = std::max(best, to_[row + a] - to_[row + b]);
+    }
+    if (from_[row + a] != kInfinity) {
+      best = std::max(best, from_[row + b] - from_[row + a]);
+    }
+  }
+  return best;
+}
+
+std::list<Id> Landmarks::path(Graph const& graph, SearchContext& context,
+                              Id from, Id to) const {
+  auto const& vertexes = graph.vertexes();
+  auto source = vertexes.find(from);
+  auto target = vertexes.find(to);
+  if (source == end(vertexes) || target == end(vertexes)) {
+    throw std::invalid_argument{"Wrong vertex ID"};
+  }
+  if (from == to) return {to};
+
+  // labels are kept apart from the forward search, so it may be continued later
+  context.renewBack(graph.slots());
+  auto& estimates = context.estimates_;
+  if (estimates.size() < context.back_.size()) estimates.resize(context.back_.size());
+  auto label = [&context](Vertex const& v) -> SpfInfo& {
+    auto& l = context.back_[v.slot];
+    if (l.generation != context.backGeneration_) {
+      l = {};
+      l.generation = context.backGeneration_;
+      l.vertex = &v;
+    }
+    return l;
+  };
+  auto& queue = context.goal_;
+  label(source->second).distance = 0;
+  estimates[source->second.slot] = bound(source->second, target->second);
+  queue.push(source->second.slot);
+  auto& counters = context.counters_;
+  ++counters.heap;
+  while (!queue.empty()) {
+    auto& a = context.back_[queue.top()];
+    auto v = a.vertex;
+    queue.pop();
+    ++counters.heap;
+    a.visited = true;
+    ++counters.settled;
+    if (v->id == to) break;
+    counters.scanned += v->neighbors.size();
+    v->neighbors.forEach([&](Vertex const* w, Distance weight) {
+      auto& b = label(*w);
+      auto d = a.distance + weight;
+      if (b.visited || d >= b.distance) return;
+      auto h = bound(*w, target->second);
+      if (h == kInfinity) return;
+      b.distance = d;
+      b.previous = v;
+      estimates[w->slot] = d + h;
+      queue.update(w->slot);
+      ++counters.relaxed;
+      ++counters.heap;
+    });
+  }
+
+  std::list<Id> p{to};
+  auto const& last = context.back_[target->second.slot];
+  if (last.generation != context.backGeneration_ || !last.visited) return p;
+  for (auto v = last.previous; v; v = context.back_[v->slot].previous) {
+    p.push_front(v->id);
+  }
+  return p;
+}
@@ -0,0 +1,92 @@
+#ifndef LANDMARKS_H_
+#define LANDMARKS_H_
+
+#include <cstddef>
+#include <limits>
+#include <list>
+#include <vector>
+
+#include "search_context.h"
+#include "types.h"
+
+class Graph;
+struct Vertex;
+
+/**
+ * Landmarks for goal-directed A* search (ALT).
+ * Distances from and to every landmark give a lower bound of distance
+ * between any two vertexes by the triangle inequality.
+ * Tables are indexed by slot of vertex, a vertex added after they were
+ * measured has no bound but zero even if it took the slot of a removed one.
+ */
+class Landmarks {
+public:
+  /**
+   * Selects landmarks far from each other and measures distances.
+   * @param graph - the graph.
+   * @param count - number of landmarks.
+   */
+  Landmarks(Graph const& graph, std::size_t count);
+
+  /**
+   * Measures distances of the same landmarks again.
+   * It is needed only if some distance could decrease, bounds stay valid
+   * while weights only grow and edges or vertexes are removed.
+   * @param graph - the graph.
+   */
+  void refresh(Graph const& graph);
+
+  /**
+   * Moves the distances to the slots which vertexes took when slots of
+   * the graph were compacted, the distances are not measured again.
+   * @param graph - the graph.
+   */
+  void remap(Graph const& graph);
+
+  /**
+   * Gets path from a source to a target vertex by A* search.
+   * @param graph - the graph which the landmarks were measured on.
+   * @param context - the search context which keeps labels of vertexes,
+   * its forward search is left to be continued.
+   * @param from - the source vertex.
+   * @param to - the target vertex.
+   * @return list of the vertex by order.
+   */
+  std::list<Id> path(Graph const& graph, SearchContext& context, Id from, Id to) const;
+
+  /**
+   * Gets lower bound of distance between vertexes.
+   * @param from - the first vertex.
+   * @param to - the second vertex.
+   * @return the bound, infinity if there is no path for sure.
+   */
+  Distance bound(Vertex const& from, Vertex const& to) const;
+
+  /**
+   * Gets the landmarks.
+   * @return IDs of the landmarks.
+   */
+  std::vector<Id> const& landmarks() const { return landmarks_; }
+
+  /**
+   * Gets layout of slots of the graph which the tables are indexed by.
+   * @return the number of compactions of the graph.
+   */
+  std::size_t layout() const { return layout_; }
+
+private:
+  void measure(Graph const& graph, std::size_t i);
+  void index(Graph const& graph);
+  bool has(Vertex const& v) const;
+
+  static constexpr Id kNone = std::numeric_limits<Id>::max();
+
+  std::size_t size_{0};  // number of columns in the tables
+  std::size_t layout_{0};
+  std::vector<Id> ids_;  // vertex of the column, kNone if the slot was free
+  std::vector<Id> landmarks_;
+  std::vector<Distance> from_;  // distance from landmark to vertex
+  std::vector<Distance> to_;  // distance from vertex to landmark
+};
+
+#endif /* LANDMARKS_H_ */
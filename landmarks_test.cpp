@@ -0,0 +1,212 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <random>
+
+#include "graph.h"
+#include "landmarks.h"
+
+using ::testing::Eq;
+using ::testing::Le;
+using ::testing::ContainerEq;
+using ::testing::SizeIs;
+
+namespace {
+Graph example() {
+  Graph g;
+  g.addVertex(); g.addVertex(); g.addVertex(); g.addVertex();
+  g.addVertex(); g.addVertex();
+  g.setEdge(0, 1, 7); g.setEdge(0, 2, 9); g.setEdge(0, 5, 14);
+  g.setEdge(1, 0, 7); g.setEdge(1, 2, 10); g.setEdge(1, 3, 15);
+  g.setEdge(2, 0, 9); g.setEdge(2, 1, 10); g.setEdge(2, 5, 2);
+  g.setEdge(3, 1, 15); g.setEdge(3, 2, 11); g.setEdge(3, 4, 6);
+  g.setEdge(4, 3, 6); g.setEdge(4, 5, 9);
+  g.setEdge(5, 0, 14); g.setEdge(5, 2, 2); g.setEdge(5, 4, 9);
+  return g;
+}
+
+Graph random(std::mt19937& random, Id size, int edges) {
+  std::uniform_int_distribution<Id> vertex{0, size - 1};
+  std::uniform_real_distribution<Distance> weight{1, 10};
+  Graph g;
+  for (Id i = 0; i < size; ++i) g.addVertex();
+  for (auto i = 0; i < edges; ++i) g.setEdge(vertex(random), vertex(random), weight(random));
+  return g;
+}
+
+Distance length(Graph const& g, std::list<Id> const& path) {
+  Distance d = 0;
+  for (auto it = begin(path); std::next(it) != end(path); ++it) {
+    auto const& a = g.vertexes().at(*it);
+    d += a.neighbors.at(const_cast<Vertex*>(&g.vertexes().at(*std::next(it))));
+  }
+  return d;
+}
+}  // namespace
+
+TEST(Landmarks, Select) {
+  auto g = example();
+  Landmarks l{g, 3};
+
+  EXPECT_THAT(l.landmarks(), SizeIs(3));
+  EXPECT_THAT(l.landmarks().front(), Eq(0));
+}
+
+TEST(Landmarks, SelectNotMoreThanVertexes) {
+  auto g = example();
+  Landmarks l{g, 10};
+
+  EXPECT_THAT(l.landmarks(), SizeIs(Le(6)));
+}
+
+TEST(Landmarks, Path) {
+  auto g = example();
+  Landmarks l{g, 2};
+  SearchContext c;
+
+  EXPECT_THAT(l.path(g, c, 0, 4), ContainerEq(std::list<Id>{0, 2, 5, 4}));
+}
+
+TEST(Landmarks, PathToItself) {
+  auto g = example();
+  Landmarks l{g, 2};
+  SearchContext c;
+
+  EXPECT_THAT(l.path(g, c, 3, 3), ContainerEq(std::list<Id>{3}));
+}
+
+TEST(Landmarks, PathToUnreachable) {
+  Graph g;
+  g.addVertex(); g.addVertex(); g.addVertex();
+  g.setEdge(0, 1, 1); g.setEdge(2, 1, 1);
+  Landmarks l{g, 2};
+  SearchContext c;
+
+  EXPECT_THAT(l.bound(g.vertexes().at(0), g.vertexes().at(2)),
+      Eq(std::numeric_limits<Distance>::infinity()));
+  EXPECT_THAT(l.path(g, c, 0, 2), ContainerEq(std::list<Id>{2}));
+}
+
+TEST(Landmarks, PathWithWrongId) {
+  auto g = example();
+  Landmarks l{g, 2};
+  SearchContext c;
+
+  EXPECT_THROW(l.path(g, c, 0, 6), std::invalid_argument);
+}
+
+TEST(Landmarks, KeepDijkstraSearch) {
+  auto g = example();
+  SearchContext c;
+  g.path(c, 0, 1);
+  g.landmarkPath(c, 3, 5);
+
+  EXPECT_THAT(g.path(c, 0, 4), ContainerEq(std::list<Id>{0, 2, 5, 4}));
+  EXPECT_THAT(c.answer(), Eq(SearchContext::Answer::kContinued));
+  EXPECT_THAT(g.landmarkPath(c, 3, 5), ContainerEq(std::list<Id>{3, 2, 5}));
+}
+
+TEST(Landmarks, LowerBound) {
+  std::mt19937 r{3};
+  auto g = random(r, 50, 200);
+  Landmarks l{g, 4};
+
+  for (Id from = 0; from < 50; ++from) {
+    for (Id to = 0; to < 50; ++to) {
+      auto p = g.path(from, to);
+      if (p.front() != from) continue;
+      ASSERT_THAT(l.bound(g.vertexes().at(from), g.vertexes().at(to)), Le(length(g, p) + 1e-9));
+    }
+  }
+}
+
+TEST(Landmarks, SameAsDijkstra) {
+  std::mt19937 r{11};
+  auto g = random(r, 60, 240);
+  Landmarks l{g, 4};
+  SearchContext c;
+
+  for (Id from = 0; from < 60; ++from) {
+    for (Id to = 0; to < 60; ++to) {
+      ASSERT_THAT(l.path(g, c, from, to), ContainerEq(g.path(from, to)));
+    }
+  }
+}
+
+TEST(Landmarks, IncreaseWithoutRefresh) {
+  std::mt19937 r{5};
+  auto g = random(r, 40, 160);
+  Landmarks l{g, 4};
+  SearchContext c;
+  std::uniform_real_distribution<Distance> factor{1, 3};
+  for (auto const& p: g.vertexes()) {
+    for (auto const& e: p.second.neighbors) {
+      g.setEdge(p.first, e.first->id, e.second * factor(r));
+    }
+  }
+  g.removeVertex(0);
+
+  for (Id from = 1; from < 40; ++from) {
+    for (Id to = 1; to < 40; ++to) {
+      ASSERT_THAT(l.path(g, c, from, to), ContainerEq(g.path(from, to)));
+    }
+  }
+}
+
+TEST(Landmarks, Refresh) {
+  std::mt19937 r{7};
+  auto g = random(r, 40, 160);
+  Landmarks l{g, 4};
+  SearchContext c;
+  std::uniform_int_distribution<Id> vertex{0, 39};
+  for (auto i = 0; i < 40; ++i) g.setEdge(vertex(r), vertex(r), 0.5);
+
+  l.refresh(g);
+
+  for (Id from = 0; from < 40; ++from) {
+    for (Id to = 0; to < 40; ++to) {
+      ASSERT_THAT(l.path(g, c, from, to), ContainerEq(g.path(from, to)));
+    }
+  }
+}
+
+TEST(Landmarks, NoBoundInReusedSlot) {
+  auto g = example();
+  Landmarks l{g, 2};
+  SearchContext c;
+  g.removeVertex(2);
+  auto const added = g.addVertex();
+  g.setEdge(0, added, 1); g.setEdge(added, 4, 1);
+
+  EXPECT_THAT(g.vertexes().at(added).slot, Eq(2));
+  EXPECT_THAT(l.bound(g.vertexes().at(added), g.vertexes().at(4)), Eq(0));
+  EXPECT_THAT(l.path(g, c, 0, 4), ContainerEq(std::list<Id>{0, added, 4}));
+}
+
+TEST(Landmarks, Remap) {
+  std::mt19937 r{13};
+  auto g = random(r, 40, 200);
+  Landmarks l{g, 4};
+  std::vector<Id> kept;
+  for (Id id = 0; id < 40; ++id) {
+    if (id % 3 == 0) kept.push_back(id);
+  }
+  std::vector<Distance> bounds;
+  for (auto from: kept) {
+    for (auto to: kept) bounds.push_back(l.bound(g.vertexes().at(from), g.vertexes().at(to)));
+  }
+  for (Id id = 0; id < 40; ++id) {
+    if (id % 3 != 0) g.removeVertex(id);
+  }
+  ASSERT_THAT(g.layout(), Eq(1));
+
+  l.remap(g);
+
+  EXPECT_THAT(l.layout(), Eq(1));
+  auto it = begin(bounds);
+  for (auto from: kept) {
+    for (auto to: kept) {
+      ASSERT_THAT(l.bound(g.vertexes().at(from), g.vertexes().at(to)), Eq(*it++));
+    }
+  }
+}
@@ -0,0 +1,143 @@
+#include "logger.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <ctime>
+#include <string>
+
+namespace {
+constexpr std::string_view kTruncated{"..."};
+constexpr std::chrono::milliseconds kIdle{10};  // sleep of the thread when nothing is logged
+
+char const* name(Logger::Level level) {
+  switch (level) {
+    case Logger::Level::kDebug: return "DEBUG";
+    case Logger::Level::kInfo: return "INFO";
+    case Logger::Level::kWarning: return "WARNING";
+    case Logger::Level::kError: return "ERROR";
+  }
+  return "";
+}
+
+/**
+ * Appends UTC time with microseconds.
+ * @param batch - the output.
+ * @param time - nanoseconds since the epoch.
+ */
+void format(std::string& batch, std::int64_t time) {
+  std::time_t seconds = time / 1000000000;
+  std::tm tm;
+  ::gmtime_r(&seconds, &tm);
+  char text[32];
+  auto size = std::strftime(text, sizeof(text), "%Y-%m-%dT%H:%M:%S", &tm);
+  size += std::snprintf(text + size, sizeof(text) - size, ".%06dZ",
+                        static_cast<int>(time % 1000000000 / 1000));
+  batch.append(text, size);
+}
+}  // namespace
+
+Logger::Logger(std::FILE* output, Level level, std::size_t sample, std::size_t capacity):
+    output_{output}, level_{level}, sample_{sample} {
+  std::size_t size = 2;  // a ready slot of a ring of one is taken for a free one
+  while (size < capacity) size *= 2;
+  mask_ = size - 1;
+  slots_ = std::make_unique<Slot[]>(size);
+  for (std::size_t i = 0; i < size; ++i) slots_[i].sequence.store(i, std::memory_order_relaxed);
+  thread_ = std::thread{&Logger::loop, this};
+}
+
+Logger::~Logger() {
+  stop_.store(true, std::memory_order_release);
+  thread_.join();
+}
+
+bool Logger::sample() {
+  if (sample_ == 0) return false;
+  return sampled_.fetch_add(1, std::memory_order_relaxed) % sample_ == 0;
+}
+
+void Logger::log(Level level, std::string_view what, std::string_view text) {
+  if (!isEnabled(level)) return;
+  auto position = head_.load(std::memory_order_relaxed);
+  Slot* slot;
+  for (;;) {
+    slot = &slots_[position & mask_];
+    auto sequence = slot->sequence.load(std::memory_order_acquire);
+    auto difference = static_cast<std::ptrdiff_t>(sequence - position);
+    if (difference == 0) {
+      if (head_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) break;
+    } else if (difference < 0) {
+      dropped_.fetch_add(1, std::memory_order_relaxed);
+      return;
+    } else {
+      position = head_.load(std::memory_order_relaxed);
+    }
+  }
+  slot->time = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::system_clock::now().time_since_epoch()).count();
+  slot->level = level;
+  auto size = std::min(what.size(), kMessage);
+  std::memcpy(slot->text, what.data(), size);
+  auto rest = std::min(text.size(), kMessage - size);
+  std::memcpy(slot->text + size, text.data(), rest);
+  size += rest;
+  if (what.size() + text.size() > kMessage) {
+    std::memcpy(slot->text + kMessage - kTruncated.size(), kTruncated.data(), kTruncated.size());
+  }
+  slot->size = static_cast<std::uint16_t>(size);
+  slot->sequence.store(position + 1, std::memory_order_release);
+}
+
+bool Logger::parse(std::string_view name, Level& level) {
+  if (name == "debug") {
+    level = Level::kDebug;
+  } else if (name == "info") {
+    level = Level::kInfo;
+  } else if (name == "warning") {
+    level = Level::kWarning;
+  } else if (name == "error") {
+    level = Level::kError;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+bool Logger::pop(std::string& batch) {
+  auto& slot = slots_[tail_ & mask_];
+  if (slot.sequence.load(std::memory_order_acquire) != tail_ + 1) return false;
+  format(batch, slot.time);
+  batch += ' ';
+  batch += name(slot.level);
+  batch += ' ';
+  batch.append(slot.text, slot.size);
+  batch += '\n';
+  slot.sequence.store(tail_ + mask_ + 1, std::memory_order_release);
+  ++tail_;
+  return true;
+}
+
+void Logger::loop() {
+  std::string batch;
+  for (;;) {
+    auto const stop = stop_.load(std::memory_order_acquire);
+    for (std::size_t i = 0; i <= mask_ && pop(batch); ++i) {}
+    if (auto dropped = dropped_.exchange(0, std::memory_order_relaxed)) {
+      format(batch, std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::system_clock::now().time_since_epoch()).count());
+      batch += ' ';
+      batch += name(Level::kWarning);
+      batch += " dropped " + std::to_string(dropped) + " messages\n";
+    }
+    if (!batch.empty()) {
+      std::fwrite(batch.data(), 1, batch.size(), output_);
+      std::fflush(output_);
+      batch.clear();
+    } else if (stop) {
+      break;
+    } else {
+      std::this_thread::sleep_for(kIdle);
+    }
+  }
+}
@@ -0,0 +1,102 @@
+#ifndef LOGGER_H_
+#define LOGGER_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string_view>
+#include <thread>
+
+/**
+ * Asynchronous logger.
+ * Messages are put into a bounded lock-free ring and a background thread
+ * formats and writes them in batches, so a logging thread neither waits
+ * for the output nor takes a lock. A message is truncated to the size of
+ * a slot and is dropped when the ring is full, the number of dropped
+ * messages is written instead of them.
+ */
+class Logger {
+public:
+  enum class Level: std::uint8_t { kDebug, kInfo, kWarning, kError };
+
+  static constexpr std::size_t kCapacity = 4096;  // number of messages in the ring
+  static constexpr std::size_t kMessage = 256;  // size of a message in bytes
+
+  /**
+   * Starts the background thread.
+   * @param output - the output, it is not closed by the logger.
+   * @param level - the lowest level of written messages.
+   * @param sample - one of how many sampled messages is written, 0 for none.
+   * @param capacity - number of messages in the ring, it is rounded up
+   * to a power of two not less than 2.
+   */
+  Logger(std::FILE* output, Level level, std::size_t sample = 1,
+         std::size_t capacity = kCapacity);
+
+  /**
+   * Writes the rest of messages and stops the background thread.
+   */
+  ~Logger();
+
+  Logger(Logger const&) = delete;
+  Logger& operator=(Logger const&) = delete;
+
+  /**
+   * Checks whether messages of the level are written.
+   * @param level - the level.
+   * @return true if they are written.
+   */
+  bool isEnabled(Level level) const { return level >= level_; }
+
+  /**
+   * Picks every n-th call by the sampling rate.
+   * It is used for messages which are too many to write all of them,
+   * like bodies of requests.
+   * @return true if a message should be written.
+   */
+  bool sample();
+
+  /**
+   * Puts message into the ring if its level is enabled.
+   * @param level - the level.
+   * @param what - beginning of the message.
+   * @param text - the rest of the message.
+   */
+  void log(Level level, std::string_view what, std::string_view text = {});
+
+  /**
+   * Parses name of a level.
+   * @param name - debug, info, warning or error.
+   * @param level - the parsed level.
+   * @return true if the name is known.
+   */
+  static bool parse(std::string_view name, Level& level);
+
+private:
+  struct Slot {
+    std::atomic<std::size_t> sequence;  // position which the slot is ready for
+    std::int64_t time;  // nanoseconds since the epoch
+    Level level;
+    std::uint16_t size;
+    char text[kMessage];
+  };
+
+  bool pop(std::string& batch);
+  void loop();
+
+  std::FILE* output_;
+  Level level_;
+  std::size_t sample_;
+  std::size_t mask_;
+  std::unique_ptr<Slot[]> slots_;
+  alignas(64) std::atomic<std::size_t> head_{0};  // next position to put
+  alignas(64) std::atomic<std::size_t> sampled_{0};
+  std::atomic<std::size_t> dropped_{0};
+  alignas(64) std::size_t tail_{0};  // next position to write, it is used by the thread only
+  std::atomic<bool> stop_{false};
+  std::thread thread_;
+};
+
+#endif /* LOGGER_H_ */
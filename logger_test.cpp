@@ -0,0 +1,160 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "logger.h"
+
+using ::testing::Eq;
+using ::testing::EndsWith;
+using ::testing::HasSubstr;
+using ::testing::MatchesRegex;
+using ::testing::Not;
+using ::testing::SizeIs;
+
+namespace {
+/**
+ * Temporary file which the logger writes into.
+ */
+class Output {
+public:
+  Output(): file_{std::tmpfile(), &std::fclose} {}
+
+  std::FILE* file() const { return file_.get(); }
+
+  /**
+   * Reads the written lines.
+   * @return the lines.
+   */
+  std::vector<std::string> lines() const {
+    std::vector<std::string> lines;
+    std::rewind(file_.get());
+    char buffer[4096];
+    while (std::fgets(buffer, sizeof(buffer), file_.get())) {
+      std::string line{buffer};
+      if (!line.empty() && line.back() == '\n') line.pop_back();
+      lines.push_back(line);
+    }
+    return lines;
+  }
+
+private:
+  std::unique_ptr<std::FILE, int(*)(std::FILE*)> file_;
+};
+}  // namespace
+
+TEST(Logger, WriteMessage) {
+  Output output;
+  {
+    Logger logger{output.file(), Logger::Level::kInfo};
+    logger.log(Logger::Level::kInfo, "request=", "{}");
+  }
+
+  auto lines = output.lines();
+
+  ASSERT_THAT(lines, SizeIs(1));
+  EXPECT_THAT(lines[0], MatchesRegex(R"(....-..-..T..:..:..\.......Z INFO request=\{\})"));
+}
+
+TEST(Logger, SkipLowerLevel) {
+  Output output;
+  {
+    Logger logger{output.file(), Logger::Level::kWarning};
+    logger.log(Logger::Level::kInfo, "info");
+    logger.log(Logger::Level::kError, "error");
+  }
+
+  auto lines = output.lines();
+
+  ASSERT_THAT(lines, SizeIs(1));
+  EXPECT_THAT(lines[0], EndsWith("ERROR error"));
+}
+
+TEST(Logger, IsEnabled) {
+  Logger logger{nullptr, Logger::Level::kInfo};
+
+  EXPECT_FALSE(logger.isEnabled(Logger::Level::kDebug));
+  EXPECT_TRUE(logger.isEnabled(Logger::Level::kInfo));
+  EXPECT_TRUE(logger.isEnabled(Logger::Level::kError));
+}
+
+TEST(Logger, TruncateLongMessage) {
+  Output output;
+  {
+    Logger logger{output.file(), Logger::Level::kDebug};
+    logger.log(Logger::Level::kDebug, "response=", std::string(Logger::kMessage * 2, 'x'));
+  }
+
+  auto lines = output.lines();
+
+  ASSERT_THAT(lines, SizeIs(1));
+  EXPECT_THAT(lines[0], EndsWith("x..."));
+  EXPECT_THAT(lines[0].substr(lines[0].find("response=")), SizeIs(Logger::kMessage));
+}
+
+TEST(Logger, Sample) {
+  Logger logger{nullptr, Logger::Level::kDebug, 3};
+  std::vector<bool> sampled;
+
+  for (int i = 0; i < 6; ++i) sampled.push_back(logger.sample());
+
+  EXPECT_THAT(sampled, Eq(std::vector<bool>{true, false, false, true, false, false}));
+}
+
+TEST(Logger, SampleNothing) {
+  Logger logger{nullptr, Logger::Level::kDebug, 0};
+
+  EXPECT_FALSE(logger.sample());
+}
+
+TEST(Logger, ParseLevel) {
+  Logger::Level level;
+
+  EXPECT_TRUE(Logger::parse("warning", level));
+  EXPECT_THAT(level, Eq(Logger::Level::kWarning));
+  EXPECT_FALSE(Logger::parse("verbose", level));
+}
+
+TEST(Logger, ManyThreads) {
+  Output output;
+  {
+    Logger logger{output.file(), Logger::Level::kInfo, 1, 1 << 16};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+      threads.emplace_back([&logger, t] {
+        for (int i = 0; i < 1000; ++i) logger.log(Logger::Level::kInfo, std::to_string(t));
+      });
+    }
+    for (auto& t: threads) t.join();
+  }
+
+  auto lines = output.lines();
+
+  EXPECT_THAT(lines, SizeIs(4000));
+  EXPECT_THAT(lines, Not(::testing::Contains(HasSubstr("dropped"))));
+}
+
+TEST(Logger, CountDropped) {
+  Output output;
+  {
+    Logger logger{output.file(), Logger::Level::kInfo, 1, 1};
+    for (int i = 0; i < 1000; ++i) logger.log(Logger::Level::kInfo, "message");
+  }
+
+  auto lines = output.lines();
+  std::size_t written = 0;
+  std::size_t dropped = 0;
+  for (auto const& line: lines) {
+    if (line.find("dropped") != std::string::npos) {
+      dropped += std::stoul(line.substr(line.find("dropped") + 8));
+    } else {
+      ++written;
+    }
+  }
+
+  EXPECT_THAT(written + dropped, Eq(1000));
+}
@@ -1,14 +1,28 @@
 #include <boost/asio/ip/tcp.hpp>
 #include <boost/asio/spawn.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/strand.hpp>
+#include <boost/asio/thread_pool.hpp>
 #include <boost/beast.hpp>
-#include <boost/beast/core/buffers_to_string.hpp>
 #include <boost/program_options.hpp>
 
+#include <algorithm>
+#include <deque>
 #include <functional>
 #include <iostream>
+#include <iterator>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
 
+#include "journal.h"
+#include "logger.h"
 #include "processor.h"
+#include "snapshot.h"
 
 namespace net = boost::asio;
 using tcp = net::ip::tcp;
@@ -16,54 +30,270 @@ namespace beast = boost::beast;
 namespace ws = beast::websocket;
 namespace po = boost::program_options;
 
-void fail(beast::error_code ec, char const* what) {
-  std::cerr << what << ": " << ec.message() << '\n';
+void fail(Logger& logger, beast::error_code ec, char const* what) {
+  logger.log(Logger::Level::kError, std::string{what} + ": ", ec.message());
 }
 
-void process(ws::stream<beast::tcp_stream>& wsock, net::yield_context yield) {
-  std::cout << "process\n";
+/**
+ * Stack of a computation, it is as large as the one of a thread since
+ * unpacking of shortcuts recurses.
+ */
+constexpr std::size_t kComputeStack = 8 * 1024 * 1024;
+
+/**
+ * Runs function in a coroutine of the pool and resumes the caller with its
+ * result on the executor of the caller. The function takes the coroutine,
+ * so it may wait without holding a thread of the pool.
+ * @param executor - executor of the pool.
+ * @param function - the function.
+ * @param token - completion token of the caller.
+ */
+template <typename Executor, typename Function, typename Token>
+auto offload(Executor const& executor, Function function, Token&& token) {
+  using Result = decltype(function(std::declval<net::yield_context>()));
+  return net::async_initiate<Token, void(Result)>(
+      [executor](auto handler, Function function) {
+        auto work = net::make_work_guard(net::get_associated_executor(handler));
+        net::spawn(executor, [handler = std::move(handler), function = std::move(function),
+                              work = std::move(work)](net::yield_context yield) mutable {
+          auto result = function(yield);
+          auto executor = work.get_executor();
+          net::post(executor, [handler = std::move(handler),
+                               result = std::move(result)]() mutable {
+            handler(std::move(result));
+          });
+        }, boost::coroutines::attributes{kComputeStack});
+      }, token, std::move(function));
+}
+
+/**
+ * Parts of long responses which the computation queues and the strand of
+ * the connection writes in order, one at a time.
+ * The computation goes on while the queued parts fit the high-water mark,
+ * otherwise its coroutine is suspended until a write makes room, so it does
+ * not hold a thread of the pool meanwhile.
+ */
+class Outbox {
+public:
+  /**
+   * Creates outbox of the connection.
+   * @param wsock - the connection.
+   * @param producer - strand of the pool where the computations run.
+   * @param limit - the high-water mark in bytes, a larger part is queued alone.
+   */
+  template <typename Executor>
+  Outbox(ws::stream<beast::tcp_stream>& wsock, Executor const& producer, std::size_t limit)
+    : wsock_{wsock}, limit_{std::max<std::size_t>(limit, 1)},
+      idle_{wsock.get_executor()}, room_{producer} {}
+
+  /**
+   * Queues copy of the part, it is called by the computation on the strand
+   * of the producer. Buffers of the written parts are reused.
+   * @param part - the part.
+   * @param yield - the coroutine of the computation.
+   * @return error of a previous write, the part is dropped then.
+   */
+  beast::error_code push(std::string const& part, net::yield_context yield) {
+    std::unique_lock lock{mutex_};
+    while (bytes_ >= limit_ && !error_) {
+      waiting_ = true;
+      lock.unlock();
+      // the wakeup is posted to the same strand, so it is not lost before the wait
+      beast::error_code ec;
+      room_.expires_at(net::steady_timer::time_point::max());
+      room_.async_wait(yield[ec]);
+      lock.lock();
+    }
+    if (error_) return error_;
+    if (spare_.empty()) {
+      parts_.push_back(part);
+    } else {
+      parts_.push_back(std::move(spare_.back()));
+      spare_.pop_back();
+      parts_.back().assign(part);
+    }
+    bytes_ += part.size();
+    if (!writing_) {
+      writing_ = true;
+      net::post(wsock_.get_executor(), [this] { write(); });
+    }
+    return {};
+  }
+
+  /**
+   * Waits on the strand until every queued part is written.
+   * @param yield - the coroutine of the connection.
+   * @return error of the writes.
+   */
+  beast::error_code flush(net::yield_context yield) {
+    for (;;) {
+      {
+        std::lock_guard lock{mutex_};
+        if (!writing_) return error_;
+      }
+      beast::error_code ec;
+      idle_.expires_at(net::steady_timer::time_point::max());
+      idle_.async_wait(yield[ec]);  // it is cancelled by the last write
+    }
+  }
+
+private:
+  void write() {
+    std::string const* part;
+    {
+      std::lock_guard lock{mutex_};
+      part = &parts_.front();  // it is not moved by pushes to the back
+    }
+    wsock_.async_write(net::buffer(*part), [this](beast::error_code ec, std::size_t) {
+      std::unique_lock lock{mutex_};
+      bytes_ -= parts_.front().size();
+      spare_.push_back(std::move(parts_.front()));
+      parts_.pop_front();
+      if (ec) {
+        error_ = ec;
+        bytes_ = 0;
+        std::move(begin(parts_), end(parts_), std::back_inserter(spare_));
+        parts_.clear();
+      }
+      if (waiting_) {
+        waiting_ = false;
+        net::post(room_.get_executor(), [this] { room_.cancel(); });
+      }
+      if (!parts_.empty()) {
+        lock.unlock();
+        return write();
+      }
+      writing_ = false;
+      idle_.cancel();
+    });
+  }
+
+  ws::stream<beast::tcp_stream>& wsock_;
+  std::size_t const limit_;
+  net::steady_timer idle_;  // the strand waits on it for the writes
+  net::steady_timer room_;  // the computation waits on it for the room
+  std::mutex mutex_;
+  std::deque<std::string> parts_;
+  std::vector<std::string> spare_;
+  std::size_t bytes_{0};
+  bool writing_{false};
+  bool waiting_{false};  // the computation waits for the room
+  beast::error_code error_;
+};
+
+void process(ws::stream<beast::tcp_stream>& wsock,
+             std::shared_ptr<SharedGraph> const& graph,
+             net::thread_pool& compute,
+             std::size_t limit,
+             Logger& logger,
+             net::yield_context yield) {
+  logger.log(Logger::Level::kInfo, "process");
   beast::error_code ec;
-  Processor p;
+  wsock.async_accept(yield[ec]);
+  if (ec) return fail(logger, ec, "accept ws");
+  Processor p{graph};
+  auto producer = net::make_strand(compute);
+  Outbox outbox{wsock, producer, limit};
   for(;;)
   {
     beast::flat_buffer ibuf;
     wsock.async_read(ibuf, yield[ec]);
     if (ec == ws::error::closed) break;
-    if (ec) return fail(ec, "read");
-    auto request = beast::buffers_to_string(ibuf.data());
-    std::cout << "request=" << request << '\n';
-    auto response = p.serve(request);
-    std::cout << "response=" << response << '\n';
-    wsock.text(wsock.got_text());
+    if (ec) return fail(logger, ec, "read");
+    std::string_view request{static_cast<char const*>(ibuf.data().data()), ibuf.size()};
+    auto binary = wsock.got_binary();
+    // Bodies of the sampled requests are logged with their responses.
+    auto sampled = logger.isEnabled(Logger::Level::kDebug) && logger.sample();
+    auto log = [binary, sampled, &logger](char const* what, std::string_view message) {
+      if (!sampled) return;
+      if (binary) {
+        logger.log(Logger::Level::kDebug, what, std::to_string(message.size()) + " bytes");
+      } else {
+        logger.log(Logger::Level::kDebug, what, message);
+      }
+    };
+    log("request=", request);
+    wsock.binary(binary);
+    // Parts are written on the strand of the connection while the computation
+    // goes on, the last one is written after them.
+    auto response = offload(producer, [&p, request, binary, &outbox, &log](net::yield_context produce) {
+      auto send = [&outbox, &log, produce](std::string const& part) {
+        log("response=", part);
+        // the computation stops if the connection failed, the response is the error then
+        if (auto ec = outbox.push(part, produce)) throw beast::system_error{ec};
+      };
+      return std::string_view{binary ? p.serveBinary(request, send) : p.serve(request, send)};
+    }, yield);
+    ec = outbox.flush(yield);
+    if (ec) return fail(logger, ec, "write");
+    log("response=", response);
     wsock.async_write(net::buffer(response), yield[ec]);
-    if (ec) return fail(ec, "write");
+    if (ec) return fail(logger, ec, "write");
   }
 }
 
 void wait(net::io_context& ioc,
           tcp::endpoint const& endpoint,
+          std::shared_ptr<SharedGraph> const& graph,
+          net::thread_pool& compute,
+          std::size_t limit,
+          Logger& logger,
           net::yield_context yield) {
-  std::cout << "wait\n";
+  logger.log(Logger::Level::kInfo, "wait");
   tcp::acceptor acceptor{ioc, endpoint};
   for(;;) {
     beast::error_code ec;
-    ws::stream<beast::tcp_stream> wsock{ioc};
+    ws::stream<beast::tcp_stream> wsock{net::make_strand(ioc)};
     acceptor.async_accept(beast::get_lowest_layer(wsock).socket(), yield[ec]);
-    if (ec) return fail(ec, "accept tcp");
-    wsock.async_accept(yield[ec]);
-    if (ec) return fail(ec, "accept ws");
-    net::spawn(acceptor.get_executor(),
-        std::bind(&process, std::move(wsock), std::placeholders::_1));
+    if (ec) return fail(logger, ec, "accept tcp");
+    auto executor = wsock.get_executor();
+    net::spawn(executor,
+        std::bind(&process, std::move(wsock), graph, std::ref(compute), limit,
+                  std::ref(logger), std::placeholders::_1));
   }
 }
 
 int main(int argc, char* argv[]) {
   unsigned short port{8080};
+  std::size_t cache{64};
+  std::size_t threads{1};
+  std::size_t io{1};
+  std::size_t computations{std::max(1u, std::thread::hardware_concurrency())};
+  std::string load;
+  std::string snapshot;
+  std::string wal;
+  std::string fsync{"periodic"};
+  std::size_t walLimit{Journal::kLimit / 1024 / 1024};
+  std::size_t streamLimit{4};
+  std::string logLevel{"info"};
+  std::size_t logSample{1};
 
   po::options_description args("Using");
   args.add_options()
     ("help", "produce help message")
-    ("port", po::value<unsigned short>(&port)->default_value(8080), "port to listen");
+    ("port", po::value<unsigned short>(&port)->default_value(8080), "port to listen")
+    ("cache", po::value<std::size_t>(&cache)->default_value(64),
+        "memory budget of shortest path tree cache, MiB")
+    ("threads", po::value<std::size_t>(&io)->default_value(1),
+        "threads of network input and output")
+    ("compute-threads", po::value<std::size_t>(&computations)->default_value(computations),
+        "threads which execute requests")
+    ("spf-threads", po::value<std::size_t>(&threads)->default_value(1),
+        "threads of one-to-all shortest path calculation")
+    ("stream-limit", po::value<std::size_t>(&streamLimit)->default_value(streamLimit),
+        "parts of long responses which are queued per connection, MiB")
+    ("load", po::value<std::string>(&load), "snapshot file to load the graph from")
+    ("snapshot", po::value<std::string>(&snapshot),
+        "snapshot file which SaveSnapshot action writes")
+    ("wal", po::value<std::string>(&wal), "directory of write-ahead log to restore the graph from")
+    ("fsync", po::value<std::string>(&fsync)->default_value(fsync),
+        "when the log is flushed: always, periodic or never")
+    ("wal-limit", po::value<std::size_t>(&walLimit)->default_value(walLimit),
+        "size of log segment which causes compaction, MiB")
+    ("log-level", po::value<std::string>(&logLevel)->default_value(logLevel),
+        "lowest level of logged messages: debug, info, warning or error")
+    ("log-sample", po::value<std::size_t>(&logSample)->default_value(logSample),
+        "one of how many requests is logged with its responses at debug level, 0 for none");
 
   po::variables_map vm;
   po::store(po::parse_command_line(argc, argv, args), vm);
@@ -73,13 +303,70 @@ int main(int argc, char* argv[]) {
       std::cout << args << "\n";
       return 1;
   }
+  if (io == 0 || computations == 0) {
+    std::cerr << "threads must be positive\n";
+    return 1;
+  }
+  Journal::Sync sync;
+  if (fsync == "always") {
+    sync = Journal::Sync::kAlways;
+  } else if (fsync == "periodic") {
+    sync = Journal::Sync::kPeriodic;
+  } else if (fsync == "never") {
+    sync = Journal::Sync::kNever;
+  } else {
+    std::cerr << "fsync must be always, periodic or never\n";
+    return 1;
+  }
+  Logger::Level level;
+  if (!Logger::parse(logLevel, level)) {
+    std::cerr << "log level must be debug, info, warning or error\n";
+    return 1;
+  }
+  if (!load.empty() && !wal.empty()) {
+    std::cerr << "load can not be used with wal\n";
+    return 1;
+  }
 
-  net::io_context ioc;
+  auto graph = std::make_shared<SharedGraph>();
+  graph->modify([cache, threads](Graph& g) {
+    g.setCacheBudget(cache * 1024 * 1024);
+    g.setThreads(threads);
+  });
+  if (!load.empty()) {
+    try {
+      graph->modify([&load](Graph& g) { Snapshot::read(load, g); });
+    } catch (std::exception const& e) {
+      std::cerr << load << ": " << e.what() << '\n';
+      return 1;
+    }
+  }
+  if (!wal.empty()) {
+    try {
+      Processor{graph}.recover(wal, sync, std::max<std::size_t>(walLimit, 1) * 1024 * 1024);
+    } catch (std::exception const& e) {
+      std::cerr << wal << ": " << e.what() << '\n';
+      return 1;
+    }
+  }
+  graph->setSnapshotFile(snapshot);
+
+  Logger logger{stdout, level, logSample};
+  net::thread_pool compute{computations};
+  net::io_context ioc{static_cast<int>(io)};
   tcp::endpoint point{tcp::v6(), port};
-  net::spawn(ioc, [&ioc, point](auto yield) {
-    wait(ioc, point, yield);
+  auto const limit = streamLimit * 1024 * 1024;
+  net::spawn(ioc, [&ioc, point, graph, &compute, limit, &logger](auto yield) {
+    wait(ioc, point, graph, compute, limit, logger, yield);
   });
+  std::vector<std::thread> pool;
+  pool.reserve(io - 1);
+  for (std::size_t i = 1; i < io; ++i) {
+    pool.emplace_back([&ioc] { ioc.run(); });
+  }
   ioc.run();
+  for (auto& t: pool) t.join();
+  compute.join();
 
   return 0;
 }
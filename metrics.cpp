@@ -0,0 +1,149 @@
+#include "metrics.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+
+namespace {
+using Cell = std::atomic<std::uint64_t>;
+
+/**
+ * Metrics of one thread, only the thread changes them.
+ */
+struct Shard {
+  std::array<Cell, Metrics::kCounters> counters{};
+  struct Histogram {
+    std::array<Cell, Metrics::kBuckets> buckets{};
+    Cell count{0};
+    Cell sum{0};
+    Cell max{0};
+  };
+  std::array<Histogram, Metrics::kHistograms> histograms{};
+};
+
+/**
+ * Adds to a cell which has the only writer, so no atomic addition is needed.
+ */
+void bump(Cell& cell, std::uint64_t value) {
+  cell.store(cell.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+void add(Metrics::Totals& totals, Shard const& shard) {
+  for (std::size_t i = 0; i < Metrics::kCounters; ++i) {
+    totals.counters[i] += shard.counters[i].load(std::memory_order_relaxed);
+  }
+  for (std::size_t h = 0; h < Metrics::kHistograms; ++h) {
+    auto const& from = shard.histograms[h];
+    auto& to = totals.histograms[h];
+    if (from.count.load(std::memory_order_relaxed) == 0) continue;
+    for (std::size_t b = 0; b < Metrics::kBuckets; ++b) {
+      to.buckets[b] += from.buckets[b].load(std::memory_order_relaxed);
+    }
+    to.count += from.count.load(std::memory_order_relaxed);
+    to.sum += from.sum.load(std::memory_order_relaxed);
+    to.max = std::max(to.max, from.max.load(std::memory_order_relaxed));
+  }
+}
+
+/**
+ * Shards of the running threads and totals of the finished ones.
+ */
+struct Registry {
+  std::mutex mutex;
+  std::vector<Shard const*> shards;
+  Metrics::Totals finished;
+};
+
+Registry& registry() {
+  static auto registry = new Registry;  // it outlives threads which finish after main
+  return *registry;
+}
+
+/**
+ * Shard of the thread, it is created on the first use.
+ */
+class Local {
+public:
+  ~Local() {
+    if (!shard_) return;
+    auto& r = registry();
+    std::lock_guard lock{r.mutex};
+    add(r.finished, *shard_);
+    r.shards.erase(std::find(begin(r.shards), end(r.shards), shard_.get()));
+  }
+
+  Shard& shard() {
+    if (!shard_) {
+      shard_ = std::make_unique<Shard>();
+      auto& r = registry();
+      std::lock_guard lock{r.mutex};
+      r.shards.push_back(shard_.get());
+    }
+    return *shard_;
+  }
+
+private:
+  std::unique_ptr<Shard> shard_;
+};
+
+Shard& local() {
+  thread_local Local local;
+  return local.shard();
+}
+}  // namespace
+
+std::uint64_t Metrics::Histogram::quantile(double q) const {
+  if (count == 0) return 0;
+  auto const rank = std::max<std::uint64_t>(1, static_cast<std::uint64_t>(q * count + 0.5));
+  std::uint64_t seen = 0;
+  for (std::size_t b = 0; b < kBuckets; ++b) {
+    seen += buckets[b];
+    if (seen >= rank) {
+      auto low = lowest(b);
+      auto high = b + 1 < kBuckets ? lowest(b + 1) : max + 1;
+      return std::min(low + (high - low) / 2, max);
+    }
+  }
+  return max;
+}
+
+void Metrics::add(Counter counter, std::uint64_t value) {
+  bump(local().counters[static_cast<std::size_t>(counter)], value);
+}
+
+void Metrics::add(std::array<std::uint64_t, kCounters> const& values) {
+  auto& counters = local().counters;
+  for (std::size_t i = 0; i < kCounters; ++i) bump(counters[i], values[i]);
+}
+
+void Metrics::record(std::size_t histogram, std::uint64_t nanoseconds) {
+  auto& h = local().histograms[histogram];
+  bump(h.buckets[bucket(nanoseconds)], 1);
+  bump(h.count, 1);
+  bump(h.sum, nanoseconds);
+  if (nanoseconds > h.max.load(std::memory_order_relaxed)) {
+    h.max.store(nanoseconds, std::memory_order_relaxed);
+  }
+}
+
+Metrics::Totals Metrics::collect() {
+  auto& r = registry();
+  std::lock_guard lock{r.mutex};
+  auto totals = r.finished;
+  for (auto shard: r.shards) ::add(totals, *shard);
+  return totals;
+}
+
+std::size_t Metrics::bucket(std::uint64_t nanoseconds) {
+  if (nanoseconds < kSubBuckets) return nanoseconds;
+  std::size_t exponent = 63 - __builtin_clzll(nanoseconds);
+  auto sub = (nanoseconds >> (exponent - 3)) & (kSubBuckets - 1);
+  return (exponent - 2) * kSubBuckets + sub;
+}
+
+std::uint64_t Metrics::lowest(std::size_t bucket) {
+  if (bucket < kSubBuckets) return bucket;
+  auto exponent = bucket / kSubBuckets + 2;
+  return (kSubBuckets + bucket % kSubBuckets) << (exponent - 3);
+}
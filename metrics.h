@@ -0,0 +1,113 @@
+#ifndef METRICS_H_
+#define METRICS_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Counters and latency histograms of the process.
+ * Every thread writes its own shard without locks and atomic
+ * read-modify-write operations, a reader sums the shards. A shard of
+ * a finished thread is added to the totals, so nothing is lost.
+ * Histograms keep 8 buckets for every power of two of nanoseconds,
+ * so a quantile is known within 12.5%.
+ */
+class Metrics {
+public:
+  /**
+   * Counters of work of the engine.
+   */
+  enum class Counter: std::size_t {
+    kSettled,  // vertices whose distance became final
+    kScanned,  // edges which were looked at
+    kRelaxed,  // edges which improved a distance
+    kHeapOperations,  // pushes, updates and pops of the queues
+    kSearched,  // paths of new searches, the answers follow in order of SearchContext::Answer
+    kRecomputed,  // paths of searches which were started again since the graph changed
+    kContinued,  // paths of continued searches
+    kCached,  // paths taken from cached trees
+    kParallel,  // paths of trees which were calculated in parallel
+    kCount
+  };
+
+  static constexpr std::size_t kCounters = static_cast<std::size_t>(Counter::kCount);
+  static constexpr std::size_t kHistograms = 16;  // histograms are indexed by opcodes
+  static constexpr std::size_t kSubBuckets = 8;
+  static constexpr std::size_t kBuckets = 62 * kSubBuckets;
+
+  /**
+   * Latencies of one kind of request.
+   */
+  struct Histogram {
+    std::array<std::uint64_t, kBuckets> buckets{};
+    std::uint64_t count{0};
+    std::uint64_t sum{0};  // nanoseconds
+    std::uint64_t max{0};  // nanoseconds
+
+    /**
+     * Gets quantile of the latencies.
+     * @param q - the quantile from 0 to 1.
+     * @return middle of the bucket of the quantile in nanoseconds,
+     * 0 if nothing is recorded.
+     */
+    std::uint64_t quantile(double q) const;
+  };
+
+  /**
+   * Sum of all shards.
+   */
+  struct Totals {
+    std::array<std::uint64_t, kCounters> counters{};
+    std::vector<Histogram> histograms = std::vector<Histogram>(kHistograms);
+
+    std::uint64_t operator[](Counter counter) const {
+      return counters[static_cast<std::size_t>(counter)];
+    }
+  };
+
+  /**
+   * Adds to a counter of the calling thread.
+   * @param counter - the counter.
+   * @param value - the addition.
+   */
+  static void add(Counter counter, std::uint64_t value);
+
+  /**
+   * Adds to all counters of the calling thread at once.
+   * @param values - the additions by counters.
+   */
+  static void add(std::array<std::uint64_t, kCounters> const& values);
+
+  /**
+   * Records latency into a histogram of the calling thread.
+   * @param histogram - index of the histogram.
+   * @param nanoseconds - the latency.
+   */
+  static void record(std::size_t histogram, std::uint64_t nanoseconds);
+
+  /**
+   * Sums the shards of all threads.
+   * A shard may be changed while it is read, so the totals are not
+   * a consistent cut, but every counter is exact at some moment.
+   * @return the totals.
+   */
+  static Totals collect();
+
+  /**
+   * Gets bucket of a latency.
+   * @param nanoseconds - the latency.
+   * @return index of the bucket.
+   */
+  static std::size_t bucket(std::uint64_t nanoseconds);
+
+  /**
+   * Gets the least latency of a bucket.
+   * @param bucket - index of the bucket.
+   * @return the latency in nanoseconds.
+   */
+  static std::uint64_t lowest(std::size_t bucket);
+};
+
+#endif /* METRICS_H_ */
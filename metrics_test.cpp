@@ -0,0 +1,60 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <cstdint>
+#include <thread>
+
+#include "metrics.h"
+
+using ::testing::AllOf;
+using ::testing::Eq;
+using ::testing::Ge;
+using ::testing::Le;
+
+TEST(Metrics, Bucket) {
+  EXPECT_THAT(Metrics::bucket(0), Eq(0));
+  EXPECT_THAT(Metrics::bucket(7), Eq(7));
+  EXPECT_THAT(Metrics::bucket(8), Eq(8));
+  EXPECT_THAT(Metrics::bucket(15), Eq(15));
+  EXPECT_THAT(Metrics::bucket(16), Eq(16));
+  EXPECT_THAT(Metrics::bucket(UINT64_MAX), Eq(Metrics::kBuckets - 1));
+}
+
+TEST(Metrics, LowestOfBucket) {
+  for (std::uint64_t v: {1ull, 9ull, 100ull, 12345ull, 1000000007ull, 1ull << 62}) {
+    auto b = Metrics::bucket(v);
+    EXPECT_THAT(Metrics::lowest(b), Le(v));
+    EXPECT_THAT(Metrics::bucket(Metrics::lowest(b)), Eq(b));
+    EXPECT_THAT(Metrics::lowest(b + 1), AllOf(Ge(v + 1), Le(v + v / 8 + 1)));
+  }
+}
+
+TEST(Metrics, Quantile) {
+  Metrics::Histogram h;
+  for (std::uint64_t v = 1; v <= 1000; ++v) {
+    ++h.buckets[Metrics::bucket(v * 1000)];
+    ++h.count;
+    h.sum += v * 1000;
+    h.max = v * 1000;
+  }
+
+  EXPECT_THAT(h.quantile(0.5), AllOf(Ge(500000 * 7 / 8), Le(500000 * 9 / 8)));
+  EXPECT_THAT(h.quantile(0.99), AllOf(Ge(990000 * 7 / 8), Le(990000 * 9 / 8)));
+  EXPECT_THAT(h.quantile(1), Le(1000000));
+  EXPECT_THAT(Metrics::Histogram{}.quantile(0.5), Eq(0));
+}
+
+TEST(Metrics, CollectFinishedThreads) {
+  auto const before = Metrics::collect();
+
+  Metrics::add(Metrics::Counter::kRelaxed, 3);
+  std::thread{[] {
+    Metrics::add(Metrics::Counter::kRelaxed, 4);
+    Metrics::record(15, 1000);
+  }}.join();
+  auto const after = Metrics::collect();
+
+  EXPECT_THAT(after[Metrics::Counter::kRelaxed] - before[Metrics::Counter::kRelaxed], Eq(7));
+  EXPECT_THAT(after.histograms[15].count - before.histograms[15].count, Eq(1));
+  EXPECT_THAT(after.histograms[15].max, Ge(1000));
+}
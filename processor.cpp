@@ -1,166 +1,1234 @@
 #include "processor.h"
 
-#include <boost/property_tree/ptree.hpp>
-#include <boost/property_tree/json_parser.hpp>
-
-#include <sstream>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <stdexcept>
+#include <string>
 #include <utility>
+#include <vector>
 
-namespace ptree = boost::property_tree;
-namespace json = boost::property_tree::json_parser;
+#include "binary.h"
+#include "journal.h"
+#include "json.h"
+#include "metrics.h"
+#include "snapshot.h"
 
 namespace {
+/**
+ * Request which is being served.
+ */
+template <typename Input, typename Output>
+struct Request {
+  Input input;
+  SearchContext& context;
+  Output& output;  // the current part of response is started
+  Processor::Send const& send;
+  std::size_t version;  // version of the graph which the request is served on
+  std::vector<Id>& ids;  // buffer of a path
+  std::string const& file;  // snapshot file, it is empty if saving is disabled
+  std::string_view message;  // the request as it was received
+  std::chrono::steady_clock::time_point received;  // when the request was received
+};
+
+using TextRequest = Request<JsonValue, JsonWriter>;
+using BinaryRequest = Request<BinaryReader, BinaryWriter>;
+
+constexpr std::uint8_t kSuccess = 0;
+constexpr std::uint8_t kFailure = 1;
+constexpr std::size_t kVersionOffset = 1;  // the version follows the status
+constexpr std::size_t kCommands = static_cast<std::size_t>(Opcode::kStats) + 1;
+
+/**
+ * Names of the answers of Dijkstra search in order of SearchContext::Answer.
+ */
+constexpr std::string_view kAnswers[] = {"search", "recompute", "continue", "cache", "parallel"};
+static_assert(std::size(kAnswers) == SearchContext::kAnswers, "every answer has name");
+static_assert(static_cast<std::size_t>(Metrics::Counter::kCount)
+              - static_cast<std::size_t>(Metrics::Counter::kSearched) == SearchContext::kAnswers,
+              "every answer has counter");
+
+constexpr Journal::Type type(TextRequest const&) { return Journal::Type::kText; }
+constexpr Journal::Type type(BinaryRequest const&) { return Journal::Type::kBinary; }
+
+/**
+ * Starts part of response.
+ * @param output - the output.
+ */
+void startPart(JsonWriter& output) {
+  output.beginObject();
+}
+
+void startPart(BinaryWriter& output) {
+  output.u8(kSuccess);
+  output.skip(8);
+}
+
+/**
+ * Finishes successful part of response.
+ * @param request - the request.
+ */
+void endPart(TextRequest& request) {
+  request.output.key("version");
+  request.output.value(request.version);
+  request.output.endObject();
+}
+
+void endPart(BinaryRequest& request) {
+  request.output.u64At(kVersionOffset, request.version);
+}
+
+/**
+ * Replaces response by error.
+ * @param output - the output.
+ * @param message - the error.
+ */
+void fail(JsonWriter& output, char const* message) {
+  output.reset();
+  output.beginObject();
+  output.key("error");
+  output.value(message);
+  output.endObject();
+}
+
+void fail(BinaryWriter& output, char const* message) {
+  output.reset();
+  output.u8(kFailure);
+  output.string(message);
+}
+
 /**
  * Abstract action.
+ * Every action serves both JSON and binary requests.
  */
 class Action {
 public:
   /**
-   * Creates specific command.
-   * @param input - input data about command.
-   * @return pointer to specific command.
+   * Finds command, commands keep no state, so they are shared.
+   * @param name - name of command.
+   * @return opcode of the command, 0 if it is unknown.
+   */
+  static std::uint8_t find(std::string_view name);
+
+  /**
+   * Checks opcode of binary request.
+   * @param opcode - code of command.
+   * @return the opcode, 0 if it is unknown.
+   */
+  static std::uint8_t find(std::uint8_t opcode);
+
+  /**
+   * Gets command by opcode.
+   * @param opcode - the opcode which is found.
+   * @return the command.
+   */
+  static Action const& get(std::uint8_t opcode);
+
+  /**
+   * Gets name of command.
+   * @param opcode - the opcode which is found.
+   * @return the name.
    */
-  static std::unique_ptr<Action> create(ptree::ptree input);
-  Action(ptree::ptree input): input_{move(input)} {}
+  static std::string_view name(std::uint8_t opcode);
+
   virtual ~Action() = default;
 
   /**
    * Executes command.
+   * Error replaces everything that was written into the current part.
    * @param graph - the graph to run the command on it.
-   * @return result of the command.
+   * @param request - the request.
+   * @return true if the command succeeded.
+   */
+  template <typename Input, typename Output>
+  bool execute(Graph& graph, Request<Input, Output>& request) const;
+
+  /**
+   * Checks whether the command only reads vertexes and edges of the graph.
+   * @return true if the command does not modify them, it may build
+   * the hierarchy or the landmarks.
    */
-  ptree::ptree execute(Graph& graph);
+  virtual bool isQuery() const { return false; }
 
 protected:
   /**
    * Runs command.
    * @param graph - the graph to run the command on it.
-   * @return result of the command.
+   * @param request - the request, result is written into its output.
    */
-  virtual ptree::ptree run(Graph& graph) = 0;
+  virtual void run(Graph& graph, TextRequest& request) const = 0;
+  virtual void run(Graph& graph, BinaryRequest& request) const = 0;
 
-  ptree::ptree input_;
+  /**
+   * Sends the current part of response and starts the next one.
+   * @param request - the request.
+   */
+  template <typename Input, typename Output>
+  static void reply(Request<Input, Output>& request) {
+    endPart(request);
+    request.send(request.output.text());
+    request.output.reset();
+    startPart(request.output);
+  }
+
+  /**
+   * Gets array of vertex IDs from input.
+   * @param input - the input.
+   * @param key - name of the array.
+   * @return the IDs.
+   */
+  static std::vector<Id> ids(JsonValue input, std::string_view key);
+  static std::vector<Id> ids(BinaryReader& input);
+
+  /**
+   * Checks that binary request has no more data than the command takes.
+   * @param input - the input.
+   */
+  static void finish(BinaryReader const& input);
+
+  /**
+   * Writes array of vertex IDs.
+   * @param output - the output.
+   * @param ids - the IDs.
+   */
+  template <typename Ids>
+  static void write(JsonWriter& output, Ids const& ids) {
+    output.beginArray();
+    for (auto id: ids) output.value(id);
+    output.endArray();
+  }
+
+  template <typename Ids>
+  static void write(BinaryWriter& output, Ids const& ids) {
+    output.u32(static_cast<std::uint32_t>(ids.size()));
+    for (auto id: ids) output.u64(id);
+  }
 };
 
 class AddVertex: public Action {
 public:
-  using Action::Action;
-  ptree::ptree run(Graph& graph) {
-    ptree::ptree output;
-    output.put("id", graph.addVertex());
-    return output;
+  void run(Graph& graph, TextRequest& request) const {
+    request.output.key("id");
+    request.output.value(graph.addVertex());
+  }
+
+  void run(Graph& graph, BinaryRequest& request) const {
+    finish(request.input);
+    request.output.u64(graph.addVertex());
   }
 };
 
 class RemoveVertex: public Action {
 public:
-  using Action::Action;
-  ptree::ptree run(Graph& graph) {
-    auto id = input_.get_optional<Id>("id");
+  void run(Graph& graph, TextRequest& request) const {
+    auto id = request.input["id"].as<Id>();
     if (!id) {
       throw std::invalid_argument{"Not enough data"};
     }
     graph.removeVertex(*id);
-    return {};
+  }
+
+  void run(Graph& graph, BinaryRequest& request) const {
+    auto id = request.input.u64();
+    finish(request.input);
+    graph.removeVertex(id);
+  }
+};
+
+class RemoveVertices: public Action {
+public:
+  void run(Graph& graph, TextRequest& request) const {
+    graph.removeVertices(ids(request.input, "ids"));
+  }
+
+  void run(Graph& graph, BinaryRequest& request) const {
+    auto vertexes = ids(request.input);
+    finish(request.input);
+    graph.removeVertices(vertexes);
   }
 };
 
 class AddEdge: public Action {
 public:
-  using Action::Action;
-  ptree::ptree run(Graph& graph) {
-    auto from = input_.get_optional<Id>("from");
-    auto to = input_.get_optional<Id>("to");
-    auto weight = input_.get_optional<Distance>("weight");
+  void run(Graph& graph, TextRequest& request) const {
+    auto from = request.input["from"].as<Id>();
+    auto to = request.input["to"].as<Id>();
+    auto weight = request.input["weight"].as<Distance>();
     if (!from || !to || !weight) {
       throw std::invalid_argument{"Not enough data"};
     }
     graph.setEdge(*from, *to, *weight);
-    return {};
+  }
+
+  void run(Graph& graph, BinaryRequest& request) const {
+    auto from = request.input.u64();
+    auto to = request.input.u64();
+    auto weight = request.input.f64();
+    finish(request.input);
+    graph.setEdge(from, to, weight);
   }
 };
 
 class RemoveEdge: public Action {
 public:
-  using Action::Action;
-  ptree::ptree run(Graph& graph) {
-    auto from = input_.get_optional<Id>("from");
-    auto to = input_.get_optional<Id>("to");
+  void run(Graph& graph, TextRequest& request) const {
+    auto from = request.input["from"].as<Id>();
+    auto to = request.input["to"].as<Id>();
     if (!from || !to) {
       throw std::invalid_argument{"Not enough data"};
     }
     graph.removeEdge(*from, *to);
-    return {};
+  }
+
+  void run(Graph& graph, BinaryRequest& request) const {
+    auto from = request.input.u64();
+    auto to = request.input.u64();
+    finish(request.input);
+    graph.removeEdge(from, to);
   }
 };
 
 class GetPath: public Action {
 public:
-  using Action::Action;
-  ptree::ptree run(Graph& graph) {
-    auto from = input_.get_optional<Id>("from");
-    auto to = input_.get_optional<Id>("to");
+  bool isQuery() const { return true; }
+
+  void run(Graph& graph, TextRequest& request) const {
+    auto from = request.input["from"].as<Id>();
+    auto to = request.input["to"].as<Id>();
     if (!from || !to) {
       throw std::invalid_argument{"Not enough data"};
     }
-    ptree::ptree output;
-    ptree::ptree array;
-    auto ids = graph.path(*from, *to);
-    for (auto id: ids) {
-      ptree::ptree item;
-      item.put("", id);
-      array.push_back(std::make_pair("", item));
+    auto algorithm = request.input["algorithm"].as<std::string_view>().value_or("dijkstra");
+    auto profile = request.input["profile"].as<std::string_view>() == "true";
+    request.output.key("ids");
+    path(graph, request, *from, *to, algorithm, profile);
+  }
+
+  void run(Graph& graph, BinaryRequest& request) const {
+    static constexpr std::string_view kAlgorithms[] = {
+      "dijkstra", "bidirectional", "hierarchy", "alt"
+    };
+    auto from = request.input.u64();
+    auto to = request.input.u64();
+    auto code = request.input.u8();
+    finish(request.input);
+    auto const flag = static_cast<std::uint8_t>(Algorithm::kProfile);
+    auto profile = (code & flag) != 0;
+    code &= ~flag;
+    path(graph, request, from, to, code < std::size(kAlgorithms) ? kAlgorithms[code] : "",
+         profile);
+  }
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  /**
+   * Phases and work of one query, it is gathered only if it is asked for.
+   */
+  struct Profile {
+    Clock::time_point started;
+    Clock::time_point computed;
+    Clock::time_point serialized;
+    SearchContext::Counters before;
+    SearchContext::Answer answer{SearchContext::Answer::kSearched};
+  };
+
+  template <typename Input, typename Output>
+  static void path(Graph& graph, Request<Input, Output>& request, Id from, Id to,
+                   std::string_view algorithm, bool profile) {
+    if (profile) {
+      path<true>(graph, request, from, to, algorithm);
+    } else {
+      path<false>(graph, request, from, to, algorithm);
+    }
+  }
+
+  /**
+   * Finds the path and writes it.
+   * The probes of the profile are compiled only into the profiled instance,
+   * so a query which is not profiled does not read the clock.
+   * @param graph - the graph.
+   * @param request - the request.
+   * @param from - the source.
+   * @param to - the target.
+   * @param algorithm - the algorithm.
+   */
+  template <bool Profiled, typename Input, typename Output>
+  static void path(Graph& graph, Request<Input, Output>& request, Id from, Id to,
+                   std::string_view algorithm) {
+    [[maybe_unused]] Profile p;
+    if constexpr (Profiled) {
+      p.started = Clock::now();
+      p.before = request.context.counters();
+    }
+    if (algorithm == "dijkstra") {
+      graph.path(request.context, from, to, request.ids);
+      write(request.output, computed<Profiled>(p, request.ids));
+    } else if (algorithm == "bidirectional") {
+      write(request.output, computed<Profiled>(p, graph.bidirectionalPath(request.context, from, to)));
+    } else if (algorithm == "hierarchy") {
+      write(request.output, computed<Profiled>(p, graph.hierarchyPath(from, to)));
+    } else if (algorithm == "alt") {
+      write(request.output, computed<Profiled>(p, graph.landmarkPath(request.context, from, to)));
+    } else {
+      throw std::invalid_argument{"Unknown algorithm"};
+    }
+    if constexpr (Profiled) {
+      p.serialized = Clock::now();
+      if (algorithm == "dijkstra") p.answer = request.context.answer();
+      report(request, p);
+    }
+  }
+
+  /**
+   * Marks the end of computation of a profiled query.
+   * @param profile - the profile, it is not touched if the query is not profiled.
+   * @param ids - the path.
+   * @return the path.
+   */
+  template <bool Profiled, typename Ids>
+  static Ids const& computed([[maybe_unused]] Profile& profile, Ids const& ids) {
+    if constexpr (Profiled) profile.computed = Clock::now();
+    return ids;
+  }
+
+  static std::uint64_t nanoseconds(Clock::time_point from, Clock::time_point to) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(to - from).count();
+  }
+
+  /**
+   * Writes the profile after the path.
+   * @param request - the request.
+   * @param p - the profile.
+   */
+  static void report(TextRequest& request, Profile const& p) {
+    auto const& counters = request.context.counters();
+    auto& output = request.output;
+    output.key("profile");
+    output.beginObject();
+    output.key("answer");
+    output.value(kAnswers[static_cast<std::size_t>(p.answer)]);
+    output.key("parse");
+    output.value(nanoseconds(request.received, p.started));
+    output.key("compute");
+    output.value(nanoseconds(p.started, p.computed));
+    output.key("serialize");
+    output.value(nanoseconds(p.computed, p.serialized));
+    output.key("settled");
+    output.value(counters.settled - p.before.settled);
+    output.key("scanned");
+    output.value(counters.scanned - p.before.scanned);
+    output.key("relaxed");
+    output.value(counters.relaxed - p.before.relaxed);
+    output.key("heapOperations");
+    output.value(counters.heap - p.before.heap);
+    output.endObject();
+  }
+
+  static void report(BinaryRequest& request, Profile const& p) {
+    auto const& counters = request.context.counters();
+    auto& output = request.output;
+    output.u8(static_cast<std::uint8_t>(p.answer));
+    output.u64(nanoseconds(request.received, p.started));
+    output.u64(nanoseconds(p.started, p.computed));
+    output.u64(nanoseconds(p.computed, p.serialized));
+    output.u64(counters.settled - p.before.settled);
+    output.u64(counters.scanned - p.before.scanned);
+    output.u64(counters.relaxed - p.before.relaxed);
+    output.u64(counters.heap - p.before.heap);
+  }
+};
+class GetPaths: public Action {
+public:
+  bool isQuery() const { return true; }
+
+  void run(Graph& graph, TextRequest& request) const {
+    auto array = request.input["pairs"];
+    if (!array) {
+      throw std::invalid_argument{"Not enough data"};
+    }
+    std::vector<std::pair<Id, Id>> pairs;
+    for (auto item: array) {
+      auto from = item["from"].as<Id>();
+      auto to = item["to"].as<Id>();
+      if (!from || !to) {
+        throw std::invalid_argument{"Not enough data"};
+      }
+      pairs.emplace_back(*from, *to);
+    }
+    auto paths = graph.paths(request.context, pairs);
+    request.output.setStyle(JsonWriter::Style::kJson);
+    request.output.key("paths");
+    request.output.beginArray();
+    for (auto const& ids: paths) {
+      write(request.output, ids);
+    }
+    request.output.endArray();
+  }
+
+  void run(Graph& graph, BinaryRequest& request) const {
+    std::vector<std::pair<Id, Id>> pairs(request.input.count(16));
+    for (auto& [from, to]: pairs) {
+      from = request.input.u64();
+      to = request.input.u64();
+    }
+    finish(request.input);
+    auto paths = graph.paths(request.context, pairs);
+    request.output.u32(static_cast<std::uint32_t>(paths.size()));
+    for (auto const& ids: paths) {
+      write(request.output, ids);
+    }
+  }
+};
+
+class GetDistances: public Action {
+public:
+  bool isQuery() const { return true; }
+
+  void run(Graph& graph, TextRequest& request) const {
+    auto from = request.input["from"].as<Id>();
+    if (!from) {
+      throw std::invalid_argument{"Not enough data"};
+    }
+    request.output.key("distances");
+    request.output.beginObject();
+    for (auto const& [id, distance]: distances(graph, request.context, *from)) {
+      request.output.key(id);
+      request.output.value(distance);
+    }
+    request.output.endObject();
+  }
+
+  void run(Graph& graph, BinaryRequest& request) const {
+    auto from = request.input.u64();
+    finish(request.input);
+    auto sorted = distances(graph, request.context, from);
+    request.output.u32(static_cast<std::uint32_t>(sorted.size()));
+    for (auto const& [id, distance]: sorted) {
+      request.output.u64(id);
+      request.output.f64(distance);
+    }
+  }
+
+private:
+  static std::vector<std::pair<Id, Distance>> distances(Graph& graph, SearchContext& context,
+                                                        Id from) {
+    auto tree = graph.distances(context, from);
+    std::vector<std::pair<Id, Distance>> distances;
+    distances.reserve(tree.steps.size());
+    for (auto const& [id, step]: tree.steps) {
+      distances.emplace_back(id, step.distance);
+    }
+    std::sort(begin(distances), end(distances));
+    return distances;
+  }
+};
+
+class DistanceMatrix: public Action {
+public:
+  bool isQuery() const { return true; }
+
+  void run(Graph& graph, TextRequest& request) const {
+    auto sources = ids(request.input, "sources");
+    auto targets = ids(request.input, "targets");
+    auto chunk = request.input["chunk"].as<std::size_t>().value_or(sources.size());
+    request.output.setStyle(JsonWriter::Style::kJson);
+    matrix(graph, request, sources, targets, chunk);
+  }
+
+  void run(Graph& graph, BinaryRequest& request) const {
+    auto sources = ids(request.input);
+    auto targets = ids(request.input);
+    std::size_t chunk = request.input.u32();
+    finish(request.input);
+    matrix(graph, request, sources, targets, chunk == 0 ? sources.size() : chunk);
+  }
+
+private:
+  template <typename Input, typename Output>
+  static void matrix(Graph& graph, Request<Input, Output>& request,
+                     std::vector<Id> const& sources, std::vector<Id> const& targets,
+                     std::size_t chunk) {
+    bool written = false;
+    graph.distanceMatrix(request.context, sources, targets, chunk,
+        [&request, &written, &targets](std::size_t first, std::vector<Distance> const& values) {
+      if (written) reply(request);
+      rows(request.output, first, targets.size(), values);
+      written = true;
+    });
+    if (!written) rows(request.output, 0, targets.size(), {});
+  }
+
+  static void rows(JsonWriter& output, std::size_t first, std::size_t columns,
+                   std::vector<Distance> const& values) {
+    output.key("first");
+    output.value(first);
+    output.key("distances");
+    output.beginArray();
+    for (std::size_t i = 0; i < values.size(); i += columns) {
+      output.beginArray();
+      for (auto j = i; j < i + columns; ++j) {
+        output.value(values[j]);
+      }
+      output.endArray();
+    }
+    output.endArray();
+  }
+
+  static void rows(BinaryWriter& output, std::size_t first, std::size_t columns,
+                   std::vector<Distance> const& values) {
+    output.u32(static_cast<std::uint32_t>(first));
+    output.u32(static_cast<std::uint32_t>(columns == 0 ? 0 : values.size() / columns));
+    output.u32(static_cast<std::uint32_t>(columns));
+    for (auto value: values) {
+      output.f64(value);
+    }
+  }
+};
+
+class Batch: public Action {
+public:
+  void run(Graph& graph, TextRequest& request) const {
+    auto array = request.input["mutations"];
+    if (!array) {
+      throw std::invalid_argument{"Not enough data"};
+    }
+    std::vector<Mutation> batch;
+    for (auto item: array) {
+      auto type = item["type"].as<std::string_view>();
+      if (!type) {
+        throw std::invalid_argument{"Not enough data"};
+      }
+      auto& m = batch.emplace_back();
+      if (*type == "AddVertices") {
+        auto count = item["count"].as<std::size_t>();
+        if (!count) {
+          throw std::invalid_argument{"Not enough data"};
+        }
+        m.type = Mutation::Type::kAddVertices;
+        m.count = *count;
+      } else if (*type == "AddEdges" || *type == "RemoveEdges") {
+        auto edges = item["edges"];
+        if (!edges) {
+          throw std::invalid_argument{"Not enough data"};
+        }
+        bool add = *type == "AddEdges";
+        m.type = add ? Mutation::Type::kAddEdges : Mutation::Type::kRemoveEdges;
+        for (auto edge: edges) {
+          auto from = edge["from"].as<Id>();
+          auto to = edge["to"].as<Id>();
+          auto weight = add ? edge["weight"].as<Distance>() : Distance{0};
+          if (!from || !to || !weight) {
+            throw std::invalid_argument{"Not enough data"};
+          }
+          m.edges.push_back({*from, *to, *weight});
+        }
+      } else if (*type == "RemoveVertices") {
+        m.type = Mutation::Type::kRemoveVertices;
+        m.ids = ids(item, "ids");
+      } else {
+        throw std::invalid_argument{"Unknown mutation"};
+      }
+    }
+    auto firsts = graph.apply(batch);
+    request.output.setStyle(JsonWriter::Style::kJson);
+    request.output.key("vertices");
+    request.output.beginArray();
+    auto first = begin(firsts);
+    for (auto const& m: batch) {
+      if (m.type != Mutation::Type::kAddVertices) continue;
+      request.output.beginObject();
+      request.output.key("first");
+      request.output.value(*first++);
+      request.output.key("count");
+      request.output.value(m.count);
+      request.output.endObject();
+    }
+    request.output.endArray();
+  }
+
+  void run(Graph& graph, BinaryRequest& request) const {
+    auto& input = request.input;
+    std::vector<Mutation> batch(input.count(1));
+    for (auto& m: batch) {
+      auto type = input.u8();
+      if (type > static_cast<std::uint8_t>(Mutation::Type::kRemoveVertices)) {
+        throw std::invalid_argument{"Unknown mutation"};
+      }
+      m.type = static_cast<Mutation::Type>(type);
+      switch (m.type) {
+        case Mutation::Type::kAddVertices:
+          m.count = input.u32();
+          break;
+        case Mutation::Type::kAddEdges:
+          m.edges.resize(input.count(24));
+          for (auto& e: m.edges) e = {input.u64(), input.u64(), input.f64()};
+          break;
+        case Mutation::Type::kRemoveEdges:
+          m.edges.resize(input.count(16));
+          for (auto& e: m.edges) e = {input.u64(), input.u64(), 0};
+          break;
+        case Mutation::Type::kRemoveVertices:
+          m.ids = ids(input);
+          break;
+      }
+    }
+    finish(input);
+    auto firsts = graph.apply(batch);
+    request.output.u32(static_cast<std::uint32_t>(firsts.size()));
+    auto first = begin(firsts);
+    for (auto const& m: batch) {
+      if (m.type != Mutation::Type::kAddVertices) continue;
+      request.output.u64(*first++);
+      request.output.u32(static_cast<std::uint32_t>(m.count));
+    }
+  }
+};
+
+class BuildHierarchy: public Action {
+public:
+  bool isQuery() const { return true; }
+
+  void run(Graph& graph, TextRequest&) const {
+    graph.buildHierarchy();
+  }
+
+  void run(Graph& graph, BinaryRequest& request) const {
+    finish(request.input);
+    graph.buildHierarchy();
+  }
+};
+
+class BuildLandmarks: public Action {
+public:
+  bool isQuery() const { return true; }
+
+  void run(Graph& graph, TextRequest& request) const {
+    graph.buildLandmarks(request.input["count"].as<std::size_t>().value_or(Graph::kLandmarks));
+  }
+
+  void run(Graph& graph, BinaryRequest& request) const {
+    std::size_t count = request.input.u32();
+    finish(request.input);
+    graph.buildLandmarks(count == 0 ? Graph::kLandmarks : count);
+  }
+};
+
+class SaveSnapshot: public Action {
+public:
+  bool isQuery() const { return true; }
+
+  void run(Graph& graph, TextRequest& request) const {
+    save(graph, request.file);
+  }
+
+  void run(Graph& graph, BinaryRequest& request) const {
+    finish(request.input);
+    save(graph, request.file);
+  }
+
+private:
+  static void save(Graph const& graph, std::string const& file) {
+    if (file.empty()) {
+      throw std::invalid_argument{"Snapshots are disabled"};
+    }
+    Snapshot::write(graph, file);
+  }
+};
+
+class Stats: public Action {
+public:
+  bool isQuery() const { return true; }
+
+  void run(Graph& graph, TextRequest& request) const {
+    auto const totals = Metrics::collect();
+    auto const cache = graph.cacheStatistics();
+    auto& output = request.output;
+    if (request.input["format"].as<std::string_view>().value_or("json") == "prometheus") {
+      output.key("text");
+      output.value(prometheus(graph, totals, cache));
+      return;
     }
-    output.put_child("ids", array);
-    return output;
+    output.key("counters");
+    output.beginObject();
+    output.key("settled");
+    output.value(totals[Metrics::Counter::kSettled]);
+    output.key("scanned");
+    output.value(totals[Metrics::Counter::kScanned]);
+    output.key("relaxed");
+    output.value(totals[Metrics::Counter::kRelaxed]);
+    output.key("heapOperations");
+    output.value(totals[Metrics::Counter::kHeapOperations]);
+    output.key("cacheHits");
+    output.value(cache.hits);
+    output.key("cacheMisses");
+    output.value(cache.misses);
+    output.key("treesDropped");
+    output.value(cache.dropped);
+    output.key("treesEvicted");
+    output.value(cache.evicted);
+    output.key("cachedTrees");
+    output.value(cache.trees);
+    output.key("cacheMemory");
+    output.value(cache.memory);
+    output.key("answers");
+    output.beginObject();
+    for (std::size_t i = 0; i < SearchContext::kAnswers; ++i) {
+      output.key(kAnswers[i]);
+      output.value(totals.counters[static_cast<std::size_t>(Metrics::Counter::kSearched) + i]);
+    }
+    output.endObject();
+    output.endObject();
+    output.key("actions");
+    output.beginArray();
+    for (std::uint8_t i = 1; i < kCommands; ++i) {
+      auto const& h = totals.histograms[i];
+      if (h.count == 0) continue;
+      output.beginObject();
+      output.key("action");
+      output.value(name(i));
+      output.key("count");
+      output.value(h.count);
+      output.key("mean");
+      output.value(h.sum / h.count);
+      output.key("p50");
+      output.value(h.quantile(0.5));
+      output.key("p90");
+      output.value(h.quantile(0.9));
+      output.key("p99");
+      output.value(h.quantile(0.99));
+      output.key("max");
+      output.value(h.max);
+      output.endObject();
+    }
+    output.endArray();
+  }
+
+  void run(Graph& graph, BinaryRequest& request) const {
+    finish(request.input);
+    request.output.string(prometheus(graph, Metrics::collect(), graph.cacheStatistics()));
+  }
+
+private:
+  /**
+   * Formats metrics in text exposition format of Prometheus.
+   * Latencies are summaries whose quantiles are taken from the histograms.
+   * @param graph - the graph.
+   * @param totals - the metrics.
+   * @param cache - counters of the cache.
+   * @return the text.
+   */
+  static std::string prometheus(Graph const& graph, Metrics::Totals const& totals,
+                                TreeCache::Statistics const& cache) {
+    std::string text;
+    auto metric = [&text](char const* name, char const* type, char const* help, auto value) {
+      text += "# HELP ";
+      text += name;
+      text += ' ';
+      text += help;
+      text += "\n# TYPE ";
+      text += name;
+      text += ' ';
+      text += type;
+      text += '\n';
+      text += name;
+      text += ' ';
+      text += std::to_string(value);
+      text += '\n';
+    };
+    metric("spf_vertices_settled_total", "counter", "Vertices whose distance became final.",
+           totals[Metrics::Counter::kSettled]);
+    metric("spf_edges_scanned_total", "counter", "Edges which were looked at.",
+           totals[Metrics::Counter::kScanned]);
+    metric("spf_edges_relaxed_total", "counter", "Edges which improved a distance.",
+           totals[Metrics::Counter::kRelaxed]);
+    metric("spf_heap_operations_total", "counter", "Pushes, updates and pops of the queues.",
+           totals[Metrics::Counter::kHeapOperations]);
+    metric("spf_tree_cache_hits_total", "counter", "Paths answered by cached trees.", cache.hits);
+    metric("spf_tree_cache_misses_total", "counter", "Paths not answered by cached trees.",
+           cache.misses);
+    metric("spf_tree_cache_dropped_total", "counter",
+           "Cached trees dropped by changes of the graph.", cache.dropped);
+    metric("spf_tree_cache_evicted_total", "counter", "Cached trees evicted by the budget.",
+           cache.evicted);
+    metric("spf_tree_cache_trees", "gauge", "Cached trees.", cache.trees);
+    metric("spf_tree_cache_bytes", "gauge", "Memory of cached trees.", cache.memory);
+    text += "# HELP spf_path_answers_total Paths of Dijkstra search by how they were found.\n"
+            "# TYPE spf_path_answers_total counter\n";
+    for (std::size_t i = 0; i < SearchContext::kAnswers; ++i) {
+      text += "spf_path_answers_total{answer=\"";
+      text += kAnswers[i];
+      text += "\"} ";
+      text += std::to_string(totals.counters[static_cast<std::size_t>(Metrics::Counter::kSearched) + i]);
+      text += '\n';
+    }
+    metric("spf_graph_version", "gauge", "Version of the graph.", graph.version());
+    metric("spf_graph_vertices", "gauge", "Vertices of the graph.", graph.vertexes().size());
+    text += "# HELP spf_request_duration_seconds Latency of requests.\n"
+            "# TYPE spf_request_duration_seconds summary\n";
+    char line[128];
+    for (std::uint8_t i = 1; i < kCommands; ++i) {
+      auto const& h = totals.histograms[i];
+      if (h.count == 0) continue;
+      auto const action = name(i);
+      auto const size = static_cast<int>(action.size());
+      for (auto q: {0.5, 0.9, 0.99}) {
+        std::snprintf(line, sizeof(line), "spf_request_duration_seconds{action=\"%.*s\",quantile=\"%g\"} %.9f\n",
+                      size, action.data(), q, h.quantile(q) / 1e9);
+        text += line;
+      }
+      std::snprintf(line, sizeof(line), "spf_request_duration_seconds_sum{action=\"%.*s\"} %.9f\n",
+                    size, action.data(), h.sum / 1e9);
+      text += line;
+      std::snprintf(line, sizeof(line), "spf_request_duration_seconds_count{action=\"%.*s\"} %llu\n",
+                    size, action.data(), static_cast<unsigned long long>(h.count));
+      text += line;
+    }
+    return text;
   }
 };
 
 class Unknown: public Action {
 public:
-  using Action::Action;
-  ptree::ptree run(Graph&) {
+  void run(Graph&, TextRequest&) const {
+    throw std::invalid_argument{"Unknown action"};
+  }
+
+  void run(Graph&, BinaryRequest&) const {
     throw std::invalid_argument{"Unknown action"};
   }
 };
 
-std::unique_ptr<Action> Action::create(ptree::ptree input) {
-  auto action = input.get<std::string>("action", "unknown");
+AddVertex const addVertex;
+RemoveVertex const removeVertex;
+RemoveVertices const removeVertices;
+AddEdge const addEdge;
+RemoveEdge const removeEdge;
+GetPath const getPath;
+GetPaths const getPaths;
+GetDistances const getDistances;
+DistanceMatrix const distanceMatrix;
+Batch const batch;
+BuildHierarchy const buildHierarchy;
+BuildLandmarks const buildLandmarks;
+SaveSnapshot const saveSnapshot;
+Stats const stats;
+Unknown const unknown;
+
+/**
+ * Command with its name in JSON requests, commands are indexed by opcodes.
+ */
+struct Command {
+  std::string_view name;
+  Action const* action;
+};
+
+Command const commands[] = {
+  {"Unknown", &unknown},  // no command has opcode 0
+  {"AddVertex", &addVertex},
+  {"RemoveVertex", &removeVertex},
+  {"RemoveVertices", &removeVertices},
+  {"AddEdge", &addEdge},
+  {"RemoveEdge", &removeEdge},
+  {"GetPath", &getPath},
+  {"GetPaths", &getPaths},
+  {"GetDistances", &getDistances},
+  {"DistanceMatrix", &distanceMatrix},
+  {"BuildHierarchy", &buildHierarchy},
+  {"BuildLandmarks", &buildLandmarks},
+  {"Batch", &batch},
+  {"SaveSnapshot", &saveSnapshot},
+  {"Stats", &stats}
+};
+static_assert(std::size(commands) == kCommands, "every opcode has command");
+static_assert(kCommands <= Metrics::kHistograms, "every command has histogram");
 
-  if (action == "AddVertex") {
-    return std::make_unique<AddVertex>(move(input));
-  } else if (action == "RemoveVertex") {
-    return std::make_unique<RemoveVertex>(move(input));
-  } else if (action == "AddEdge") {
-    return std::make_unique<AddEdge>(move(input));
-  } else if (action == "RemoveEdge") {
-    return std::make_unique<RemoveEdge>(move(input));
-  } else if (action == "GetPath") {
-    return std::make_unique<GetPath>(move(input));
+std::uint8_t Action::find(std::string_view name) {
+  for (std::uint8_t i = 1; i < kCommands; ++i) {
+    if (commands[i].name == name) return i;
   }
-  return std::make_unique<Unknown>(move(input));
+  return 0;
+}
+
+std::uint8_t Action::find(std::uint8_t opcode) {
+  return opcode < kCommands ? opcode : 0;
+}
+
+Action const& Action::get(std::uint8_t opcode) {
+  return *commands[opcode].action;
+}
+
+std::string_view Action::name(std::uint8_t opcode) {
+  return commands[opcode].name;
 }
 
-ptree::ptree Action::execute(Graph& graph) try {
-  return run(graph);
+template <typename Input, typename Output>
+bool Action::execute(Graph& graph, Request<Input, Output>& request) const try {
+  run(graph, request);
+  return true;
 } catch (std::exception const& e) {
-  ptree::ptree error;
-  error.put("error", e.what());
-  return error;
+  fail(request.output, e.what());
+  return false;
+}
+
+std::vector<Id> Action::ids(JsonValue input, std::string_view key) {
+  auto array = input[key];
+  if (!array) {
+    throw std::invalid_argument{"Not enough data"};
+  }
+  std::vector<Id> ids;
+  for (auto item: array) {
+    auto id = item.as<Id>();
+    if (!id) {
+      throw std::invalid_argument{"Not enough data"};
+    }
+    ids.push_back(*id);
+  }
+  return ids;
+}
+
+std::vector<Id> Action::ids(BinaryReader& input) {
+  std::vector<Id> ids(input.count(8));
+  for (auto& id: ids) id = input.u64();
+  return ids;
+}
+
+void Action::finish(BinaryReader const& input) {
+  if (!input.isEnd()) {
+    throw std::invalid_argument{"Too much data"};
+  }
+}
+
+/**
+ * Serves request on the latest snapshot if it is a query
+ * or on the master graph otherwise.
+ * Preprocessing is built by queries, so it is built on a snapshot without
+ * holding modifications.
+ * @param graph - the graph.
+ * @param action - the command.
+ * @param request - the request.
+ */
+template <typename Input, typename Output>
+void serve(SharedGraph& graph, Action const& action, Request<Input, Output>& request) {
+  startPart(request.output);
+  bool done = false;
+  if (action.isQuery()) {
+    auto snapshot = graph.pin();
+    request.version = snapshot->version();
+    done = action.execute(*snapshot, request);
+    graph.publish(snapshot);
+  } else {
+    request.version = graph.modify([&action, &request, &done](Graph& graph) {
+      done = action.execute(graph, request);
+    }, type(request), request.message);
+  }
+  if (done) endPart(request);
+}
+
+/**
+ * Serves request and records its latency and work of the engine.
+ * @param graph - the graph.
+ * @param opcode - code of the command.
+ * @param request - the request.
+ * @param published - counters of the context which are already added to
+ * the metrics, they are updated.
+ */
+template <typename Input, typename Output>
+void measure(SharedGraph& graph, std::uint8_t opcode, Request<Input, Output>& request,
+             SearchContext::Counters& published) {
+  serve(graph, Action::get(opcode), request);
+  Metrics::record(opcode, std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now() - request.received).count());
+  auto const& counters = request.context.counters();
+  auto const work = counters - published;
+  if (work.heap == 0 && work.answers == decltype(work.answers){}) return;  // nothing was searched
+  std::array<std::uint64_t, Metrics::kCounters> values{work.settled, work.scanned, work.relaxed,
+                                                       work.heap};
+  std::copy(begin(work.answers), end(work.answers),
+            begin(values) + static_cast<std::size_t>(Metrics::Counter::kSearched));
+  Metrics::add(values);
+  published = counters;
 }
 }  // namespace
 
-std::string Processor::serve(std::string request) try {
-  std::istringstream iss{request};
-  ptree::ptree input;
-  json::read_json(iss, input);
-
-  std::ostringstream oss;
-  auto output = Action::create(move(input))->execute(graph_);
-  json::write_json_helper(oss, output, 0, false);
-  return oss.str();
-} catch (ptree::json_parser_error const& e) {
-  return R"({"error":"Invalid JSON"})";
+SharedGraph::SharedGraph() {
+  master_.recordChanges();
+}
+
+SharedGraph::~SharedGraph() {
+  if (refresher_.joinable()) refresher_.join();
+}
+
+std::size_t SharedGraph::modify(Modify const& modify) {
+  std::lock_guard lock{write_};
+  modify(master_);
+  version_ = master_.version();
+  return master_.version();
+}
+
+std::size_t SharedGraph::modify(Modify const& modify, Journal::Type type,
+                                std::string_view request) {
+  std::uint64_t ticket = 0;
+  std::size_t version;
+  {
+    std::lock_guard lock{write_};
+    auto const before = master_.version();
+    modify(master_);
+    version = master_.version();
+    if (journal_ && version != before) ticket = journal_->append(type, version, request);
+    version_ = version;
+  }
+  if (ticket > 0) journal_->wait(ticket);
+  return version;
+}
+
+std::shared_ptr<Graph> SharedGraph::pin() {
+  auto snapshot = std::atomic_load(&snapshot_);
+  if (snapshot && snapshot->version() == version_) return snapshot;
+  std::lock_guard publish{publish_};
+  snapshot = std::atomic_load(&snapshot_);
+  if (snapshot && snapshot->version() == version_) return snapshot;
+  if (!snapshot) {
+    std::lock_guard lock{write_};
+    auto first = std::make_shared<Graph>(master_);
+    master_.takeChanges();
+    std::atomic_store(&snapshot_, first);
+    return first;
+  }
+  // no query can pin the spare anymore, so nobody else holds it if the count is one
+  auto const reuse = spare_ && spare_.use_count() == 1;
+  std::shared_ptr<Graph> next;
+  if (reuse) {
+    std::atomic_thread_fence(std::memory_order_acquire);  // the last query is over
+    next = std::move(spare_);
+  } else {
+    next = std::make_shared<Graph>(*snapshot);  // modifications go on meanwhile
+  }
+  {
+    std::lock_guard lock{write_};
+    auto changed = master_.takeChanges();
+    if (reuse) {
+      published_.insert(begin(changed), end(changed));
+      next->update(master_, published_);
+    } else {
+      next->update(master_, changed);
+    }
+    published_ = std::move(changed);
+  }
+  next->share(*snapshot);
+  spare_ = snapshot;
+  std::atomic_store(&snapshot_, next);
+  return next;
+}
+
+void SharedGraph::publish(std::shared_ptr<Graph> const& snapshot) {
+  auto latest = std::atomic_load(&snapshot_);
+  if (latest && latest != snapshot) {
+    latest->share(*snapshot);
+  } else {
+    latest = snapshot;
+  }
+  if (!latest->hasStaleLandmarks()) return;
+  std::lock_guard lock{refresh_};
+  if (refreshing_) return;
+  refreshing_ = true;
+  if (refresher_.joinable()) refresher_.join();
+  refresher_ = std::thread{&SharedGraph::refresh, this, latest};
+}
+
+void SharedGraph::refresh(std::shared_ptr<Graph> const& snapshot) {
+  try {
+    snapshot->refreshLandmarks();
+    auto latest = std::atomic_load(&snapshot_);
+    if (latest != snapshot) latest->share(*snapshot);
+  } catch (std::exception const&) {
+    // the landmarks stay stale, so queries go on by Dijkstra
+  }
+  std::lock_guard lock{refresh_};
+  refreshing_ = false;
+}
+
+Processor::Processor(): graph_{std::make_shared<SharedGraph>()} {}
+
+Processor::Processor(std::size_t cache, std::size_t threads): Processor{} {
+  graph_->modify([cache, threads](Graph& graph) {
+    graph.setCacheBudget(cache);
+    graph.setThreads(threads);
+  });
+}
+
+Processor::Processor(std::shared_ptr<SharedGraph> graph): graph_{move(graph)} {}
+
+std::string Processor::serve(std::string_view request) {
+  std::string parts;
+  auto const& last = serve(request, [&parts](std::string const& part) {
+    parts += part;
+    parts += '\n';
+  });
+  return parts + last;
+}
+
+std::string const& Processor::serve(std::string_view request, Send const& send) try {
+  auto const received = std::chrono::steady_clock::now();
+  auto input = input_.parse(request);
+  auto const opcode = Action::find(input["action"].as<std::string_view>().value_or("unknown"));
+  JsonWriter output{output_};
+  TextRequest r{input, context_, output, send, 0, ids_, graph_->snapshotFile(), request, received};
+  measure(*graph_, opcode, r, published_);
+  return output_;
+} catch (JsonError const& e) {
+  output_ = R"({"error":"Invalid JSON"})";
+  return output_;
+} catch (...) {
+  output_ = R"({"error":"Internal error"})";
+  return output_;
+}
+
+std::string const& Processor::serveBinary(std::string_view request, Send const& send) try {
+  auto const received = std::chrono::steady_clock::now();
+  BinaryReader input{request};
+  auto const opcode = input.isEnd() ? 0 : Action::find(input.u8());
+  BinaryWriter output{output_};
+  BinaryRequest r{input, context_, output, send, 0, ids_, graph_->snapshotFile(), request, received};
+  measure(*graph_, opcode, r, published_);
+  return output_;
 } catch (...) {
-  return R"({"error":"Internal error"})";
+  BinaryWriter output{output_};
+  fail(output, "Internal error");
+  return output_;
+}
+
+void Processor::recover(std::string const& directory, Journal::Sync sync, std::size_t limit) {
+  // the graph owns the journal, which stops compaction before the graph is destroyed
+  auto journal = std::make_unique<Journal>(directory, sync, limit,
+      [graph = graph_.get()](std::string const& file) -> std::size_t {
+        auto snapshot = graph->pin();
+        if (snapshot->version() == 0) return 0;
+        Snapshot::write(*snapshot, file);
+        return snapshot->version();
+      });
+  if (std::ifstream{journal->snapshot()}) {
+    graph_->modify([&journal](Graph& graph) { Snapshot::read(journal->snapshot(), graph); });
+  }
+  Send const ignore = [](std::string const&) {};
+  journal->replay([this, &ignore](Journal::Type type, std::size_t version, std::string_view request) {
+    auto const current = graph_->version();
+    if (version <= current) return;
+    if (version != current + 1) {
+      throw std::runtime_error{"Broken journal"};
+    }
+    if (type == Journal::Type::kBinary) {
+      serveBinary(request, ignore);
+    } else {
+      serve(request, ignore);
+    }
+    if (graph_->version() != version) {
+      throw std::runtime_error{"Broken journal"};
+    }
+  });
+  graph_->setJournal(std::move(journal));
 }
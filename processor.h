@@ -1,24 +1,239 @@
 #ifndef PROCESSOR_H_
 #define PROCESSOR_H_
 
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_set>
+#include <utility>
+#include <vector>
 
 #include "graph.h"
+#include "journal.h"
+#include "json.h"
+
+/**
+ * Graph which is shared by several processors.
+ * Modifications are applied one by one to the master graph. Queries run on
+ * immutable snapshots of it: a query pins the latest snapshot, which is
+ * brought up to date when the master was changed since it was published.
+ * The master records the changed vertexes, so the previous snapshot is
+ * updated by copying only them once no query holds it, or the latest one is
+ * copied without holding modifications. A snapshot is released when the
+ * last query which pinned it finishes, so a long query holds neither
+ * modifications nor newer queries.
+ */
+class SharedGraph {
+public:
+  SharedGraph();
+
+  /**
+   * Waits for the background refresh of the landmarks.
+   */
+  ~SharedGraph();
+
+  SharedGraph(SharedGraph const&) = delete;
+  SharedGraph& operator=(SharedGraph const&) = delete;
+
+  /**
+   * Function which changes the graph.
+   */
+  using Modify = std::function<void(Graph&)>;
+
+  /**
+   * Applies modification to the master graph.
+   * @param modify - function which changes the graph.
+   * @return version of the graph after the modification.
+   */
+  std::size_t modify(Modify const& modify);
+
+  /**
+   * Applies modification to the master graph and appends the request which
+   * made it to the journal if the graph was changed.
+   * @param modify - function which changes the graph.
+   * @param type - encoding of the request.
+   * @param request - the request.
+   * @return version of the graph after the modification.
+   */
+  std::size_t modify(Modify const& modify, Journal::Type type, std::string_view request);
+
+  /**
+   * Gets the latest snapshot of the graph.
+   * Only queries may be run on it, the snapshot may be used by others.
+   * @return the snapshot.
+   */
+  std::shared_ptr<Graph> pin();
+
+  /**
+   * Passes the hierarchy and the landmarks which were built on a snapshot
+   * to the latest one, so they are not lost if a newer snapshot was
+   * published meanwhile. Stale landmarks of the latest snapshot are
+   * measured again by a background thread.
+   * @param snapshot - the pinned snapshot.
+   */
+  void publish(std::shared_ptr<Graph> const& snapshot);
+
+  /**
+   * Sets file which the graph is saved into by SaveSnapshot action.
+   * It is set before the graph is served.
+   * @param file - the file, empty one disables saving.
+   */
+  void setSnapshotFile(std::string file) { file_ = std::move(file); }
+
+  /**
+   * Gets file which the graph is saved into.
+   * @return the file, it is empty if saving is disabled.
+   */
+  std::string const& snapshotFile() const { return file_; }
+
+  /**
+   * Sets journal which modifications are appended to.
+   * It is set before the graph is served.
+   * @param journal - the journal.
+   */
+  void setJournal(std::unique_ptr<Journal> journal) { journal_ = std::move(journal); }
+
+  /**
+   * Gets version of the master graph.
+   * @return the version.
+   */
+  std::size_t version() const { return version_; }
+
+private:
+  void refresh(std::shared_ptr<Graph> const& snapshot);
+
+  Graph master_;
+  std::mutex write_;  // it guards the master graph
+  std::mutex publish_;  // it serializes making of snapshots
+  std::atomic<std::size_t> version_{0};  // version of the master graph
+  std::shared_ptr<Graph> snapshot_;  // it is loaded and stored atomically
+  std::shared_ptr<Graph> spare_;  // the previous snapshot, it is reused when it is released
+  std::unordered_set<Id> published_;  // vertexes changed between the spare and the snapshot
+  std::string file_;
+  std::unique_ptr<Journal> journal_;  // it is stopped before the graph is destroyed
+  std::mutex refresh_;  // it guards the fields below
+  bool refreshing_{false};
+  std::thread refresher_;  // it measures stale landmarks of a snapshot
+};
+
+/**
+ * Codes of commands of binary requests.
+ */
+enum class Opcode: std::uint8_t {
+  kAddVertex = 1,
+  kRemoveVertex,
+  kRemoveVertices,
+  kAddEdge,
+  kRemoveEdge,
+  kGetPath,
+  kGetPaths,
+  kGetDistances,
+  kDistanceMatrix,
+  kBuildHierarchy,
+  kBuildLandmarks,
+  kBatch,
+  kSaveSnapshot,
+  kStats
+};
+
+/**
+ * Codes of algorithms of binary GetPath request.
+ * The profile flag may be combined with any of them.
+ */
+enum class Algorithm: std::uint8_t {
+  kDijkstra,
+  kBidirectional,
+  kHierarchy,
+  kAlt,
+  kProfile = 0x80
+};
 
 /**
  * Processor serves incoming requests.
+ * Every processor keeps its own search context, so processors of the same
+ * graph may serve queries at the same time from different threads.
  */
 class Processor {
 public:
+  /**
+   * Creates processor with its own graph.
+   */
+  Processor();
+
+  /**
+   * Creates processor with its own graph.
+   * @param cache - memory budget of cache of shortest path trees in bytes.
+   * @param threads - number of threads for one-to-all calculations.
+   */
+  explicit Processor(std::size_t cache, std::size_t threads = 1);
+
+  /**
+   * Creates processor of the shared graph.
+   * @param graph - the graph.
+   */
+  explicit Processor(std::shared_ptr<SharedGraph> graph);
+
+  /**
+   * Function which sends a part of response, an exception thrown by it stops
+   * the computation and the response is the error.
+   */
+  using Send = std::function<void(std::string const&)>;
+
   /**
    * Serves incoming request.
    * @param request - incoming request.
-   * @return response.
+   * @return response, parts of a long one are separated by new line.
+   */
+  std::string serve(std::string_view request);
+
+  /**
+   * Serves incoming request whose response may be sent by parts.
+   * The request is parsed in place and the response is written into a buffer
+   * of the processor, so a warmed up processor serves a path without
+   * allocation if its search is continued or the cache budget is 0
+   * (see Graph::path()).
+   * @param request - incoming request.
+   * @param send - function which takes every part but the last one.
+   * @return response or its last part, it is valid until the next request.
+   */
+  std::string const& serve(std::string_view request, Send const& send);
+
+  /**
+   * Serves binary request whose response may be sent by parts.
+   * Request is an opcode followed by little-endian arguments, response is
+   * a status followed by the version and the result or by the error.
+   * @param request - incoming request.
+   * @param send - function which takes every part but the last one.
+   * @return response or its last part, it is valid until the next request.
+   */
+  std::string const& serveBinary(std::string_view request, Send const& send);
+
+  /**
+   * Restores the graph from the journal and makes its following
+   * modifications durable.
+   * The snapshot of the journal is loaded and the newer requests are served
+   * again, then every modification is appended to the journal.
+   * @param directory - directory of the journal.
+   * @param sync - when records are flushed.
+   * @param limit - size of a segment which causes compaction in bytes.
+   * @throw std::runtime_error if the journal can not be read.
    */
-  std::string serve(std::string request);
+  void recover(std::string const& directory, Journal::Sync sync,
+               std::size_t limit = Journal::kLimit);
 
 private:
-  Graph graph_;
+  std::shared_ptr<SharedGraph> graph_;
+  SearchContext context_;
+  SearchContext::Counters published_;  // counters of the context which are in the metrics
+  JsonDocument input_;
+  std::string output_;
+  std::vector<Id> ids_;
 };
 
 #endif /* PROCESSOR_H_ */
@@ -1,9 +1,69 @@
 #include <gtest/gtest.h>
 #include <gmock/gmock.h>
 
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <limits>
+#include <map>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "binary.h"
+#include "generator.h"
+#include "json.h"
 #include "processor.h"
 
 using ::testing::Eq;
+using ::testing::AnyOf;
+using ::testing::ElementsAre;
+using ::testing::Gt;
+using ::testing::HasSubstr;
+using ::testing::Lt;
+using ::testing::NotNull;
+using ::testing::Optional;
+using ::testing::StartsWith;
+
+namespace {
+/**
+ * Binary request which is built by a test.
+ */
+struct Message {
+  explicit Message(Opcode opcode) { writer.u8(static_cast<std::uint8_t>(opcode)); }
+
+  std::string buffer;
+  BinaryWriter writer{buffer};
+};
+
+std::string const& serve(Processor& p, Message const& m) {
+  return p.serveBinary(m.buffer, [](std::string const&) {});
+}
+
+std::string error(std::string const& response) {
+  BinaryReader r{response};
+  if (r.u8() != 1) return {};
+  auto size = r.u32();
+  return response.substr(5, size);
+}
+
+/**
+ * Edges of a graph by both ends, so incoming edges are checked as well.
+ */
+std::map<std::pair<Id, Id>, Distance> edges(Graph const& g) {
+  std::map<std::pair<Id, Id>, Distance> edges;
+  for (auto const& [id, v]: g.vertexes()) {
+    edges.emplace(std::pair{id, id}, -1);
+    for (auto const& [w, weight]: v.neighbors) edges.emplace(std::pair{id, w->id}, weight);
+    for (auto const& [w, weight]: v.incoming) edges.emplace(std::pair{w->id, id}, weight);
+  }
+  return edges;
+}
+}  // namespace
 
 TEST(Processor, UnknownAction) {
   EXPECT_THAT(Processor{}.serve(R"({"action":"RemoveGraph"})"),
@@ -14,15 +74,45 @@ TEST(Processor, NoAction) {
   EXPECT_THAT(Processor{}.serve(R"({})"), Eq(R"({"error":"Unknown action"})"));
 }
 
+TEST(Processor, InvalidJson) {
+  EXPECT_THAT(Processor{}.serve(R"({"action":"AddVertex")"), Eq(R"({"error":"Invalid JSON"})"));
+}
+
+TEST(Processor, NumbersAsStrings) {
+  Processor p;
+  p.serve(R"({"action":"AddVertex"})");
+  p.serve(R"({"action":"AddVertex"})");
+
+  EXPECT_THAT(p.serve(R"({"action":"AddEdge","from":"0","to":"1","weight":"2.5"})"),
+      Eq(R"({"version":"3"})"));
+  EXPECT_THAT(p.serve(R"({"action":"GetPath","from":"0","to":1})"),
+      Eq(R"({"ids":["0","1"],"version":"3"})"));
+}
+
+TEST(Processor, EscapedAction) {
+  EXPECT_THAT(Processor{}.serve(R"({"action":"Add\u0056ertex"})"),
+      Eq(R"({"id":"0","version":"1"})"));
+}
+
+TEST(Processor, ResponseIsReused) {
+  Processor p;
+  auto const& first = p.serve(R"({"action":"AddVertex"})", [](std::string const&) {});
+  auto const& second = p.serve(R"({"action":"AddVertex"})", [](std::string const&) {});
+
+  EXPECT_THAT(&first, Eq(&second));
+  EXPECT_THAT(second, Eq(R"({"id":"1","version":"2"})"));
+}
+
 TEST(Processor, AddVertex) {
-  EXPECT_THAT(Processor{}.serve(R"({"action":"AddVertex"})"), Eq(R"({"id":"0"})"));
+  EXPECT_THAT(Processor{}.serve(R"({"action":"AddVertex"})"),
+      Eq(R"({"id":"0","version":"1"})"));
 }
 
 TEST(Processor, RemoveVertex) {
   Processor p;
   p.serve(R"({"action":"AddVertex"})");
 
-  EXPECT_THAT(p.serve(R"({"action":"RemoveVertex","id":0})"), Eq(R"({})"));
+  EXPECT_THAT(p.serve(R"({"action":"RemoveVertex","id":0})"), Eq(R"({"version":"2"})"));
 }
 
 TEST(Processor, RemoveVertexWithWrongId) {
@@ -35,13 +125,37 @@ TEST(Processor, RemoveVertexWithoutId) {
       Eq(R"({"error":"Not enough data"})"));
 }
 
+TEST(Processor, RemoveVertices) {
+  Processor p;
+  p.serve(R"({"action":"AddVertex"})");
+  p.serve(R"({"action":"AddVertex"})");
+
+  EXPECT_THAT(p.serve(R"({"action":"RemoveVertices","ids":[0,1]})"),
+      Eq(R"({"version":"3"})"));
+  EXPECT_THAT(p.serve(R"({"action":"RemoveVertex","id":1})"),
+      Eq(R"({"error":"Wrong vertex ID"})"));
+}
+
+TEST(Processor, RemoveVerticesWithWrongId) {
+  Processor p;
+  p.serve(R"({"action":"AddVertex"})");
+
+  EXPECT_THAT(p.serve(R"({"action":"RemoveVertices","ids":[0,3]})"),
+      Eq(R"({"error":"Wrong vertex ID"})"));
+}
+
+TEST(Processor, RemoveVerticesWithoutIds) {
+  EXPECT_THAT(Processor{}.serve(R"({"action":"RemoveVertices"})"),
+      Eq(R"({"error":"Not enough data"})"));
+}
+
 TEST(Processor, AddEdge) {
   Processor p;
   p.serve(R"({"action":"AddVertex"})");
   p.serve(R"({"action":"AddVertex"})");
 
   EXPECT_THAT(p.serve(R"({"action":"AddEdge","from":0,"to":1,"weight":3.4})"),
-      Eq(R"({})"));
+      Eq(R"({"version":"3"})"));
 }
 
 TEST(Processor, AddEdgeWithWrongID) {
@@ -76,13 +190,28 @@ TEST(Processor, AddEdgeWithNegativeWeight) {
       Eq(R"({"error":"Negative weight"})"));
 }
 
+TEST(Processor, AddEdgeWithNotFiniteWeight) {
+  Processor p;
+  p.serve(R"({"action":"AddVertex"})");
+  p.serve(R"({"action":"AddVertex"})");
+  p.serve(R"({"action":"AddEdge","from":0,"to":1,"weight":2})");
+
+  EXPECT_THAT(p.serve(R"({"action":"AddEdge","from":0,"to":1,"weight":"nan"})"),
+      Eq(R"({"error":"Not enough data"})"));
+  EXPECT_THAT(p.serve(R"({"action":"AddEdge","from":0,"to":1,"weight":1e400})"),
+      Eq(R"({"error":"Not enough data"})"));
+  EXPECT_THAT(p.serve(R"({"action":"GetPath","from":0,"to":1})"),
+      Eq(R"({"ids":["0","1"],"version":"3"})"));
+}
+
 TEST(Processor, RemoveEdge) {
   Processor p;
   p.serve(R"({"action":"AddVertex"})");
   p.serve(R"({"action":"AddVertex"})");
   p.serve(R"({"action":"AddEdge","from":0,"to":1,"weight":3.4})");
 
-  EXPECT_THAT(p.serve(R"({"action":"RemoveEdge","from":0,"to":1})"), Eq(R"({})"));
+  EXPECT_THAT(p.serve(R"({"action":"RemoveEdge","from":0,"to":1})"),
+      Eq(R"({"version":"4"})"));
 }
 
 TEST(Processor, RemoveEdgeWithWrongID) {
@@ -110,7 +239,7 @@ TEST(Processor, GetPath) {
   p.serve(R"({"action":"AddEdge","from":0,"to":1,"weight":3.4})");
 
   EXPECT_THAT(p.serve(R"({"action":"GetPath","from":0,"to":1})"),
-      Eq(R"({"ids":["0","1"]})"));
+      Eq(R"({"ids":["0","1"],"version":"3"})"));
 }
 
 TEST(Processor, GetPathWithoutFrom) {
@@ -122,3 +251,922 @@ TEST(Processor, GetPathWithoutTo) {
   EXPECT_THAT(Processor{}.serve(R"({"action":"GetPath","from":0})"),
       Eq(R"({"error":"Not enough data"})"));
 }
+
+TEST(Processor, GetPathBidirectional) {
+  Processor p;
+  p.serve(R"({"action":"AddVertex"})");
+  p.serve(R"({"action":"AddVertex"})");
+  p.serve(R"({"action":"AddEdge","from":0,"to":1,"weight":3.4})");
+
+  EXPECT_THAT(p.serve(R"({"action":"GetPath","from":0,"to":1,"algorithm":"bidirectional"})"),
+      Eq(R"({"ids":["0","1"],"version":"3"})"));
+}
+
+TEST(Processor, GetPathWithUnknownAlgorithm) {
+  Processor p;
+  p.serve(R"({"action":"AddVertex"})");
+  p.serve(R"({"action":"AddVertex"})");
+
+  EXPECT_THAT(p.serve(R"({"action":"GetPath","from":0,"to":1,"algorithm":"magic"})"),
+      Eq(R"({"error":"Unknown algorithm"})"));
+}
+
+TEST(Processor, BuildHierarchy) {
+  Processor p;
+  p.serve(R"({"action":"AddVertex"})");
+
+  EXPECT_THAT(p.serve(R"({"action":"BuildHierarchy"})"), Eq(R"({"version":"1"})"));
+}
+
+TEST(Processor, GetPathByHierarchy) {
+  Processor p;
+  p.serve(R"({"action":"AddVertex"})");
+  p.serve(R"({"action":"AddVertex"})");
+  p.serve(R"({"action":"AddEdge","from":0,"to":1,"weight":3.4})");
+  p.serve(R"({"action":"BuildHierarchy"})");
+
+  EXPECT_THAT(p.serve(R"({"action":"GetPath","from":0,"to":1,"algorithm":"hierarchy"})"),
+      Eq(R"({"ids":["0","1"],"version":"3"})"));
+}
+
+TEST(Processor, BuildLandmarks) {
+  Processor p;
+  p.serve(R"({"action":"AddVertex"})");
+
+  EXPECT_THAT(p.serve(R"({"action":"BuildLandmarks","count":2})"),
+      Eq(R"({"version":"1"})"));
+}
+
+TEST(Processor, GetPathByLandmarks) {
+  Processor p;
+  p.serve(R"({"action":"AddVertex"})");
+  p.serve(R"({"action":"AddVertex"})");
+  p.serve(R"({"action":"AddEdge","from":0,"to":1,"weight":3.4})");
+  p.serve(R"({"action":"BuildLandmarks"})");
+
+  EXPECT_THAT(p.serve(R"({"action":"GetPath","from":0,"to":1,"algorithm":"alt"})"),
+      Eq(R"({"ids":["0","1"],"version":"3"})"));
+}
+
+TEST(Processor, GetDistances) {
+  Processor p{1024 * 1024, 2};
+  p.serve(R"({"action":"AddVertex"})");
+  p.serve(R"({"action":"AddVertex"})");
+  p.serve(R"({"action":"AddVertex"})");
+  p.serve(R"({"action":"AddEdge","from":0,"to":1,"weight":3})");
+
+  EXPECT_THAT(p.serve(R"({"action":"GetDistances","from":0})"),
+      Eq(R"({"distances":{"0":"0","1":"3"},"version":"4"})"));
+}
+
+TEST(Processor, GetDistancesWithoutSource) {
+  Processor p;
+
+  EXPECT_THAT(p.serve(R"({"action":"GetDistances"})"),
+      Eq(R"({"error":"Not enough data"})"));
+}
+
+TEST(Processor, GetPaths) {
+  Processor p;
+  p.serve(R"({"action":"AddVertex"})");
+  p.serve(R"({"action":"AddVertex"})");
+  p.serve(R"({"action":"AddVertex"})");
+  p.serve(R"({"action":"AddEdge","from":0,"to":1,"weight":3})");
+  p.serve(R"({"action":"AddEdge","from":1,"to":2,"weight":1})");
+
+  EXPECT_THAT(p.serve(R"({"action":"GetPaths","pairs":[{"from":0,"to":2},{"from":1,"to":2},{"from":0,"to":1}]})"),
+      Eq(R"({"paths":[["0","1","2"],["1","2"],["0","1"]],"version":"5"})"));
+}
+
+TEST(Processor, GetPathsOfNoPairs) {
+  Processor p;
+
+  EXPECT_THAT(p.serve(R"({"action":"GetPaths","pairs":[]})"),
+      Eq(R"({"paths":[],"version":"0"})"));
+}
+
+TEST(Processor, GetPathsWithoutPairs) {
+  Processor p;
+
+  EXPECT_THAT(p.serve(R"({"action":"GetPaths"})"),
+      Eq(R"({"error":"Not enough data"})"));
+}
+
+TEST(Processor, GetPathsWithoutTarget) {
+  Processor p;
+  p.serve(R"({"action":"AddVertex"})");
+
+  EXPECT_THAT(p.serve(R"({"action":"GetPaths","pairs":[{"from":0}]})"),
+      Eq(R"({"error":"Not enough data"})"));
+}
+
+TEST(Processor, DistanceMatrix) {
+  Processor p;
+  p.serve(R"({"action":"AddVertex"})");
+  p.serve(R"({"action":"AddVertex"})");
+  p.serve(R"({"action":"AddEdge","from":0,"to":1,"weight":3})");
+
+  EXPECT_THAT(p.serve(R"({"action":"DistanceMatrix","sources":[0,1],"targets":[1]})"),
+      Eq(R"({"first":"0","distances":[["3"],["0"]],"version":"3"})"));
+}
+
+TEST(Processor, DistanceMatrixOfFractions) {
+  Processor p;
+  p.serve(R"({"action":"AddVertex"})");
+  p.serve(R"({"action":"AddVertex"})");
+  p.serve(R"({"action":"AddEdge","from":0,"to":1,"weight":3.4})");
+
+  EXPECT_THAT(p.serve(R"({"action":"DistanceMatrix","sources":[0],"targets":[1]})"),
+      Eq(R"({"first":"0","distances":[["3.4"]],"version":"3"})"));
+  EXPECT_THAT(p.serve(R"({"action":"GetDistances","from":0})"),
+      Eq(R"({"distances":{"0":"0","1":"3.3999999999999999"},"version":"3"})"));
+}
+
+TEST(Processor, DistanceMatrixOfNoSources) {
+  Processor p;
+  p.serve(R"({"action":"AddVertex"})");
+
+  EXPECT_THAT(p.serve(R"({"action":"DistanceMatrix","sources":[],"targets":[0]})"),
+      Eq(R"({"first":"0","distances":[],"version":"1"})"));
+}
+
+TEST(Processor, DistanceMatrixByChunks) {
+  Processor p;
+  p.serve(R"({"action":"AddVertex"})");
+  p.serve(R"({"action":"AddVertex"})");
+  p.serve(R"({"action":"AddEdge","from":0,"to":1,"weight":3})");
+  std::vector<std::string> parts;
+
+  auto last = p.serve(R"({"action":"DistanceMatrix","sources":[0,1],"targets":[1,0],"chunk":1})",
+      [&parts](std::string const& part) { parts.push_back(part); });
+
+  EXPECT_THAT(parts, ElementsAre(R"({"first":"0","distances":[["3","0"]],"version":"3"})"));
+  EXPECT_THAT(last, Eq(R"({"first":"1","distances":[["0","inf"]],"version":"3"})"));
+}
+
+TEST(Processor, DistanceMatrixStopsWhenPartIsNotSent) {
+  Processor p;
+  p.serve(R"({"action":"AddVertex"})");
+  p.serve(R"({"action":"AddVertex"})");
+  auto parts = 0;
+
+  auto last = p.serve(R"({"action":"DistanceMatrix","sources":[0,1,0],"targets":[1],"chunk":1})",
+      [&parts](std::string const&) {
+        ++parts;
+        throw std::runtime_error{"Connection is closed"};
+      });
+
+  EXPECT_THAT(parts, Eq(1));
+  EXPECT_THAT(last, Eq(R"({"error":"Connection is closed"})"));
+}
+
+TEST(Processor, DistanceMatrixWithoutTargets) {
+  Processor p;
+  p.serve(R"({"action":"AddVertex"})");
+
+  EXPECT_THAT(p.serve(R"({"action":"DistanceMatrix","sources":[0]})"),
+      Eq(R"({"error":"Not enough data"})"));
+}
+
+TEST(Processor, Batch) {
+  Processor p;
+  p.serve(R"({"action":"AddVertex"})");
+
+  EXPECT_THAT(p.serve(R"({"action":"Batch","mutations":[)"
+                      R"({"type":"AddVertices","count":2},)"
+                      R"({"type":"AddEdges","edges":[{"from":0,"to":1,"weight":1},{"from":1,"to":2,"weight":1}]},)"
+                      R"({"type":"AddVertices","count":1},)"
+                      R"({"type":"RemoveEdges","edges":[{"from":1,"to":2}]},)"
+                      R"({"type":"RemoveVertices","ids":[3]}]})"),
+      Eq(R"({"vertices":[{"first":"1","count":"2"},{"first":"3","count":"1"}],"version":"2"})"));
+  EXPECT_THAT(p.serve(R"({"action":"GetPath","from":0,"to":1})"),
+      Eq(R"({"ids":["0","1"],"version":"2"})"));
+}
+
+TEST(Processor, BatchRollsBack) {
+  Processor p;
+
+  EXPECT_THAT(p.serve(R"({"action":"Batch","mutations":[)"
+                      R"({"type":"AddVertices","count":2},)"
+                      R"({"type":"AddEdges","edges":[{"from":0,"to":2,"weight":1}]}]})"),
+      Eq(R"({"error":"Wrong vertex ID"})"));
+  EXPECT_THAT(p.serve(R"({"action":"AddVertex"})"), Eq(R"({"id":"0","version":"1"})"));
+}
+
+TEST(Processor, BatchWithNotFiniteWeight) {
+  Processor p;
+  p.serve(R"({"action":"AddVertex"})");
+
+  EXPECT_THAT(p.serve(R"({"action":"Batch","mutations":[)"
+                      R"({"type":"AddVertices","count":1},)"
+                      R"({"type":"AddEdges","edges":[{"from":0,"to":1,"weight":"inf"}]}]})"),
+      Eq(R"({"error":"Not enough data"})"));
+  EXPECT_THAT(p.serve(R"({"action":"AddVertex"})"), Eq(R"({"id":"1","version":"2"})"));
+}
+
+TEST(Processor, EmptyBatch) {
+  Processor p;
+  p.serve(R"({"action":"AddVertex"})");
+
+  EXPECT_THAT(p.serve(R"({"action":"Batch","mutations":[]})"),
+      Eq(R"({"vertices":[],"version":"1"})"));
+  EXPECT_THAT(p.serve(R"({"action":"Batch","mutations":[{"type":"AddVertices","count":0}]})"),
+      Eq(R"({"vertices":[{"first":"1","count":"0"}],"version":"1"})"));
+}
+
+TEST(Processor, BatchWithTooManyVertexes) {
+  Processor p;
+  p.serve(R"({"action":"AddVertex"})");
+
+  EXPECT_THAT(p.serve(R"({"action":"Batch","mutations":[)"
+                      R"({"type":"AddVertices","count":18446744073709551615}]})"),
+      Eq(R"({"error":"Too many vertexes"})"));
+  EXPECT_THAT(p.serve(R"({"action":"AddVertex"})"), Eq(R"({"id":"1","version":"2"})"));
+}
+
+TEST(Processor, BatchWithUnknownMutation) {
+  EXPECT_THAT(Processor{}.serve(R"({"action":"Batch","mutations":[{"type":"Merge"}]})"),
+      Eq(R"({"error":"Unknown mutation"})"));
+}
+
+TEST(Processor, BatchWithoutWeight) {
+  EXPECT_THAT(Processor{}.serve(R"({"action":"Batch","mutations":[)"
+                                R"({"type":"AddVertices","count":2},)"
+                                R"({"type":"AddEdges","edges":[{"from":0,"to":1}]}]})"),
+      Eq(R"({"error":"Not enough data"})"));
+}
+
+TEST(Processor, BinaryBatch) {
+  Processor p;
+  Message batch{Opcode::kBatch};
+  batch.writer.u32(2);
+  batch.writer.u8(static_cast<std::uint8_t>(Mutation::Type::kAddVertices));
+  batch.writer.u32(2);
+  batch.writer.u8(static_cast<std::uint8_t>(Mutation::Type::kAddEdges));
+  batch.writer.u32(1);
+  batch.writer.u64(0);
+  batch.writer.u64(1);
+  batch.writer.f64(2);
+
+  BinaryReader r{serve(p, batch)};
+
+  EXPECT_THAT(r.u8(), Eq(0));
+  EXPECT_THAT(r.u64(), Eq(1));
+  EXPECT_THAT(r.u32(), Eq(1));
+  EXPECT_THAT(r.u64(), Eq(0));
+  EXPECT_THAT(r.u32(), Eq(2));
+  EXPECT_TRUE(r.isEnd());
+  EXPECT_THAT(p.serve(R"({"action":"GetPath","from":0,"to":1})"),
+      Eq(R"({"ids":["0","1"],"version":"1"})"));
+}
+
+TEST(Processor, BinaryAddVertex) {
+  Processor p;
+
+  BinaryReader r{serve(p, Message{Opcode::kAddVertex})};
+
+  EXPECT_THAT(r.u8(), Eq(0));
+  EXPECT_THAT(r.u64(), Eq(1));
+  EXPECT_THAT(r.u64(), Eq(0));
+  EXPECT_TRUE(r.isEnd());
+}
+
+TEST(Processor, BinaryGetPath) {
+  Processor p;
+  serve(p, Message{Opcode::kAddVertex});
+  serve(p, Message{Opcode::kAddVertex});
+  Message edge{Opcode::kAddEdge};
+  edge.writer.u64(0);
+  edge.writer.u64(1);
+  edge.writer.f64(3.4);
+  serve(p, edge);
+  Message path{Opcode::kGetPath};
+  path.writer.u64(0);
+  path.writer.u64(1);
+  path.writer.u8(static_cast<std::uint8_t>(Algorithm::kBidirectional));
+
+  BinaryReader r{serve(p, path)};
+
+  EXPECT_THAT(r.u8(), Eq(0));
+  EXPECT_THAT(r.u64(), Eq(3));
+  EXPECT_THAT(r.u32(), Eq(2));
+  EXPECT_THAT(r.u64(), Eq(0));
+  EXPECT_THAT(r.u64(), Eq(1));
+  EXPECT_TRUE(r.isEnd());
+}
+
+TEST(Processor, BinaryGetDistances) {
+  Processor p;
+  serve(p, Message{Opcode::kAddVertex});
+  serve(p, Message{Opcode::kAddVertex});
+  Message edge{Opcode::kAddEdge};
+  edge.writer.u64(0);
+  edge.writer.u64(1);
+  edge.writer.f64(3);
+  serve(p, edge);
+  Message distances{Opcode::kGetDistances};
+  distances.writer.u64(0);
+
+  BinaryReader r{serve(p, distances)};
+
+  EXPECT_THAT(r.u8(), Eq(0));
+  EXPECT_THAT(r.u64(), Eq(3));
+  EXPECT_THAT(r.u32(), Eq(2));
+  EXPECT_THAT(r.u64(), Eq(0));
+  EXPECT_THAT(r.f64(), Eq(0));
+  EXPECT_THAT(r.u64(), Eq(1));
+  EXPECT_THAT(r.f64(), Eq(3));
+  EXPECT_TRUE(r.isEnd());
+}
+
+TEST(Processor, BinaryDistanceMatrixByChunks) {
+  Processor p;
+  serve(p, Message{Opcode::kAddVertex});
+  serve(p, Message{Opcode::kAddVertex});
+  Message edge{Opcode::kAddEdge};
+  edge.writer.u64(0);
+  edge.writer.u64(1);
+  edge.writer.f64(3);
+  serve(p, edge);
+  Message matrix{Opcode::kDistanceMatrix};
+  matrix.writer.u32(2);
+  matrix.writer.u64(0);
+  matrix.writer.u64(1);
+  matrix.writer.u32(1);
+  matrix.writer.u64(1);
+  matrix.writer.u32(1);
+  std::vector<std::string> parts;
+
+  BinaryReader last{p.serveBinary(matrix.buffer,
+      [&parts](std::string const& part) { parts.push_back(part); })};
+
+  ASSERT_THAT(parts.size(), Eq(1));
+  BinaryReader first{parts[0]};
+  for (auto* r: {&first, &last}) {
+    EXPECT_THAT(r->u8(), Eq(0));
+    EXPECT_THAT(r->u64(), Eq(3));
+  }
+  EXPECT_THAT(first.u32(), Eq(0));
+  EXPECT_THAT(first.u32(), Eq(1));
+  EXPECT_THAT(first.u32(), Eq(1));
+  EXPECT_THAT(first.f64(), Eq(3));
+  EXPECT_TRUE(first.isEnd());
+  EXPECT_THAT(last.u32(), Eq(1));
+  EXPECT_THAT(last.u32(), Eq(1));
+  EXPECT_THAT(last.u32(), Eq(1));
+  EXPECT_THAT(last.f64(), Eq(0));
+  EXPECT_TRUE(last.isEnd());
+}
+
+TEST(Processor, BinaryUnknownAction) {
+  Processor p;
+
+  EXPECT_THAT(error(p.serveBinary(std::string{"\x63"}, [](std::string const&) {})),
+      Eq("Unknown action"));
+  EXPECT_THAT(error(p.serveBinary({}, [](std::string const&) {})), Eq("Unknown action"));
+}
+
+TEST(Processor, BinaryNotEnoughData) {
+  Processor p;
+  Message edge{Opcode::kAddEdge};
+  edge.writer.u64(0);
+
+  EXPECT_THAT(error(serve(p, edge)), Eq("Not enough data"));
+}
+
+TEST(Processor, BinaryAddEdgeWithNotFiniteWeight) {
+  Processor p;
+  serve(p, Message{Opcode::kAddVertex});
+  serve(p, Message{Opcode::kAddVertex});
+  p.serve(R"({"action":"AddEdge","from":0,"to":1,"weight":2})");
+
+  for (auto weight: {std::numeric_limits<Distance>::quiet_NaN(),
+                     std::numeric_limits<Distance>::infinity(),
+                     -std::numeric_limits<Distance>::infinity()}) {
+    Message edge{Opcode::kAddEdge};
+    edge.writer.u64(0);
+    edge.writer.u64(1);
+    edge.writer.f64(weight);
+
+    EXPECT_THAT(error(serve(p, edge)), Eq(weight < 0 ? "Negative weight" : "Wrong weight"));
+  }
+  EXPECT_THAT(p.serve(R"({"action":"GetPath","from":0,"to":1})"),
+      Eq(R"({"ids":["0","1"],"version":"3"})"));
+}
+
+TEST(Processor, BinaryBatchWithNaNWeight) {
+  Processor p;
+  Message batch{Opcode::kBatch};
+  batch.writer.u32(2);
+  batch.writer.u8(static_cast<std::uint8_t>(Mutation::Type::kAddVertices));
+  batch.writer.u32(2);
+  batch.writer.u8(static_cast<std::uint8_t>(Mutation::Type::kAddEdges));
+  batch.writer.u32(1);
+  batch.writer.u64(0);
+  batch.writer.u64(1);
+  batch.writer.f64(std::numeric_limits<Distance>::quiet_NaN());
+
+  EXPECT_THAT(error(serve(p, batch)), Eq("Wrong weight"));
+  EXPECT_THAT(p.serve(R"({"action":"AddVertex"})"), Eq(R"({"id":"0","version":"1"})"));
+}
+
+TEST(Processor, BinaryTooMuchData) {
+  Processor p;
+  Message vertex{Opcode::kAddVertex};
+  vertex.writer.u8(0);
+
+  EXPECT_THAT(error(serve(p, vertex)), Eq("Too much data"));
+  EXPECT_THAT(p.serve(R"({"action":"AddVertex"})"), Eq(R"({"id":"0","version":"1"})"));
+}
+
+TEST(Processor, BinaryUnknownAlgorithm) {
+  Processor p;
+  serve(p, Message{Opcode::kAddVertex});
+  Message path{Opcode::kGetPath};
+  path.writer.u64(0);
+  path.writer.u64(0);
+  path.writer.u8(9);
+
+  EXPECT_THAT(error(serve(p, path)), Eq("Unknown algorithm"));
+}
+
+TEST(Processor, BinarySaveSnapshotDisabled) {
+  Processor p;
+
+  EXPECT_THAT(error(serve(p, Message{Opcode::kSaveSnapshot})), Eq("Snapshots are disabled"));
+}
+
+TEST(Processor, SharedGraph) {
+  auto graph = std::make_shared<SharedGraph>();
+  Processor a{graph};
+  Processor b{graph};
+  a.serve(R"({"action":"AddVertex"})");
+  b.serve(R"({"action":"AddVertex"})");
+  a.serve(R"({"action":"AddEdge","from":0,"to":1,"weight":1})");
+
+  EXPECT_THAT(b.serve(R"({"action":"GetPath","from":0,"to":1})"),
+      Eq(R"({"ids":["0","1"],"version":"3"})"));
+  EXPECT_THAT(a.serve(R"({"action":"GetPath","from":1,"to":0})"),
+      Eq(R"({"ids":["0"],"version":"3"})"));
+}
+
+TEST(Processor, SeparateGraphs) {
+  Processor a;
+  Processor b;
+  a.serve(R"({"action":"AddVertex"})");
+
+  EXPECT_THAT(b.serve(R"({"action":"AddVertex"})"), Eq(R"({"id":"0","version":"1"})"));
+}
+
+TEST(Processor, QueryReportsVersion) {
+  Processor p;
+  p.serve(R"({"action":"AddVertex"})");
+  p.serve(R"({"action":"AddVertex"})");
+  p.serve(R"({"action":"AddEdge","from":0,"to":1,"weight":1})");
+  p.serve(R"({"action":"GetPath","from":0,"to":1})");
+
+  EXPECT_THAT(p.serve(R"({"action":"AddEdge","from":0,"to":1,"weight":2})"),
+      Eq(R"({"version":"4"})"));
+  EXPECT_THAT(p.serve(R"({"action":"GetPath","from":0,"to":1})"),
+      Eq(R"({"ids":["0","1"],"version":"4"})"));
+}
+
+TEST(Processor, QueryBuiltLandmarks) {
+  auto graph = std::make_shared<SharedGraph>();
+  Processor p{graph};
+  for (int i = 0; i < 4; ++i) p.serve(R"({"action":"AddVertex"})");
+  p.serve(R"({"action":"AddEdge","from":0,"to":1,"weight":1})");
+  p.serve(R"({"action":"AddEdge","from":1,"to":2,"weight":1})");
+  p.serve(R"({"action":"AddEdge","from":2,"to":3,"weight":1})");
+
+  EXPECT_THAT(p.serve(R"({"action":"BuildLandmarks","count":2})"), Eq(R"({"version":"7"})"));
+  ASSERT_THAT(graph->pin()->currentLandmarks(), NotNull());
+  EXPECT_THAT(graph->pin()->currentLandmarks()->landmarks().size(), Eq(2));
+  EXPECT_THAT(p.serve(R"({"action":"GetPath","from":0,"to":3,"algorithm":"alt"})"),
+      Eq(R"({"ids":["0","1","2","3"],"version":"7"})"));
+
+  p.serve(R"({"action":"AddEdge","from":0,"to":3,"weight":1})");
+
+  EXPECT_THAT(p.serve(R"({"action":"GetPath","from":0,"to":3,"algorithm":"alt"})"),
+      Eq(R"({"ids":["0","3"],"version":"8"})"));
+  EXPECT_THAT(graph->pin()->currentLandmarks()->landmarks().size(), Eq(2));
+}
+
+TEST(Processor, RefreshLandmarksInBackground) {
+  auto graph = std::make_shared<SharedGraph>();
+  Processor p{graph};
+  for (int i = 0; i < 4; ++i) p.serve(R"({"action":"AddVertex"})");
+  p.serve(R"({"action":"AddEdge","from":0,"to":1,"weight":1})");
+  p.serve(R"({"action":"AddEdge","from":1,"to":2,"weight":1})");
+  p.serve(R"({"action":"AddEdge","from":2,"to":3,"weight":1})");
+  p.serve(R"({"action":"AddEdge","from":0,"to":3,"weight":5})");
+  p.serve(R"({"action":"BuildLandmarks","count":2})");
+
+  p.serve(R"({"action":"AddEdge","from":0,"to":3,"weight":1})");
+
+  EXPECT_THAT(p.serve(R"({"action":"GetPath","from":0,"to":3,"algorithm":"alt"})"),
+      Eq(R"({"ids":["0","3"],"version":"9"})"));
+  auto const deadline = std::chrono::steady_clock::now() + std::chrono::seconds{10};
+  while (graph->pin()->hasStaleLandmarks() && std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds{1});
+  }
+  EXPECT_FALSE(graph->pin()->hasStaleLandmarks());
+  EXPECT_THAT(graph->pin()->currentLandmarks()->landmarks().size(), Eq(2));
+  EXPECT_THAT(p.serve(R"({"action":"GetPath","from":0,"to":3,"algorithm":"alt"})"),
+      Eq(R"({"ids":["0","3"],"version":"9"})"));
+}
+
+TEST(Processor, QueryBuiltHierarchy) {
+  auto graph = std::make_shared<SharedGraph>();
+  Processor p{graph};
+  for (int i = 0; i < 3; ++i) p.serve(R"({"action":"AddVertex"})");
+  p.serve(R"({"action":"AddEdge","from":0,"to":1,"weight":1})");
+  p.serve(R"({"action":"AddEdge","from":1,"to":2,"weight":1})");
+  p.serve(R"({"action":"AddEdge","from":0,"to":2,"weight":5})");
+
+  EXPECT_THAT(p.serve(R"({"action":"BuildHierarchy"})"), Eq(R"({"version":"6"})"));
+  auto built = graph->pin()->currentHierarchy();
+  ASSERT_THAT(built, NotNull());
+
+  p.serve(R"({"action":"AddEdge","from":0,"to":2,"weight":1})");
+
+  EXPECT_THAT(graph->pin()->currentHierarchy(), Eq(built));
+  EXPECT_THAT(p.serve(R"({"action":"GetPath","from":0,"to":2,"algorithm":"hierarchy"})"),
+      Eq(R"({"ids":["0","2"],"version":"7"})"));
+}
+
+TEST(SharedGraph, PinSameSnapshot) {
+  SharedGraph g;
+  g.modify([](Graph& graph) { graph.addVertex(); });
+
+  EXPECT_THAT(g.pin(), Eq(g.pin()));
+}
+
+TEST(SharedGraph, SnapshotIsNotChanged) {
+  SharedGraph g;
+  auto version = g.modify([](Graph& graph) {
+    graph.addVertex(); graph.addVertex(); graph.addVertex();
+    graph.setEdge(0, 1, 1); graph.setEdge(1, 2, 1);
+  });
+  auto snapshot = g.pin();
+
+  auto next = g.modify([](Graph& graph) { graph.removeEdge(1, 2); });
+
+  EXPECT_THAT(snapshot->version(), Eq(version));
+  EXPECT_THAT(snapshot->path(0, 2), ElementsAre(0, 1, 2));
+  EXPECT_THAT(g.pin()->version(), Eq(next));
+  EXPECT_THAT(g.pin()->path(0, 2), ElementsAre(2));
+}
+
+TEST(SharedGraph, SnapshotKeepsHierarchy) {
+  SharedGraph g;
+  g.modify([](Graph& graph) {
+    graph.addVertex(); graph.addVertex(); graph.addVertex();
+    graph.setEdge(0, 1, 1); graph.setEdge(1, 2, 1); graph.setEdge(0, 2, 5);
+  });
+  auto snapshot = g.pin();
+  snapshot->hierarchyPath(0, 2);
+
+  g.modify([](Graph& graph) { graph.setEdge(0, 2, 1); });
+
+  EXPECT_THAT(g.pin()->hierarchyPath(0, 2), ElementsAre(0, 2));
+  EXPECT_THAT(snapshot->hierarchyPath(0, 2), ElementsAre(0, 1, 2));
+}
+
+TEST(SharedGraph, PublishBuiltOnOlderSnapshot) {
+  SharedGraph g;
+  g.modify([](Graph& graph) {
+    graph.addVertex(); graph.addVertex(); graph.addVertex();
+    graph.setEdge(0, 1, 1); graph.setEdge(1, 2, 1);
+  });
+  auto older = g.pin();
+  g.modify([](Graph& graph) { graph.setEdge(1, 2, 2); });
+  auto latest = g.pin();
+
+  older->buildLandmarks(2);
+  older->buildHierarchy();
+  g.publish(older);
+
+  ASSERT_THAT(latest->currentLandmarks(), NotNull());
+  EXPECT_THAT(latest->currentLandmarks()->landmarks().size(), Eq(2));
+  EXPECT_THAT(latest->currentHierarchy(), Eq(older->currentHierarchy()));
+  EXPECT_THAT(latest->hierarchyPath(0, 2), ElementsAre(0, 1, 2));
+}
+
+TEST(SharedGraph, RebuildReplacesSharedLandmarks) {
+  SharedGraph g;
+  g.modify([](Graph& graph) {
+    graph.addVertex(); graph.addVertex(); graph.addVertex();
+    graph.setEdge(0, 1, 1); graph.setEdge(1, 2, 1);
+  });
+  g.pin()->buildLandmarks(3);
+  g.modify([](Graph& graph) { graph.setEdge(1, 2, 2); });
+  auto snapshot = g.pin();
+  snapshot->buildLandmarks(1);
+
+  g.modify([](Graph& graph) { graph.setEdge(1, 2, 3); });
+
+  EXPECT_THAT(g.pin()->currentLandmarks()->landmarks().size(), Eq(1));
+}
+
+TEST(SharedGraph, ReuseReleasedSnapshot) {
+  SharedGraph g;
+  g.modify([](Graph& graph) {
+    graph.addVertex(); graph.addVertex(); graph.addVertex();
+    graph.setEdge(0, 1, 1); graph.setEdge(1, 2, 1);
+  });
+  auto const first = g.pin().get();
+  g.modify([](Graph& graph) { graph.setEdge(0, 2, 5); });
+  g.pin();
+
+  g.modify([](Graph& graph) { graph.setEdge(0, 2, 1); });
+  auto third = g.pin();
+
+  EXPECT_THAT(third.get(), Eq(first));
+  EXPECT_THAT(third->version(), Eq(g.version()));
+  EXPECT_THAT(third->path(0, 2), ElementsAre(0, 2));
+}
+
+TEST(SharedGraph, SnapshotsMatchMaster) {
+  std::mt19937 random{11};
+  SharedGraph g;
+  Graph expected;
+  std::vector<Id> alive;
+  std::vector<std::shared_ptr<Graph>> held;
+  for (auto i = 0; i < 400; ++i) {
+    auto const action = alive.size() < 5 ? 0 : random() % 4;
+    auto const a = alive.empty() ? 0 : alive[random() % alive.size()];
+    auto const b = alive.empty() ? 0 : alive[random() % alive.size()];
+    auto const weight = 1.0 + random() % 10;
+    auto const change = [&](Graph& graph) {
+      if (action == 0) {
+        graph.addVertex();
+      } else if (action == 1) {
+        graph.removeEdge(a, b);
+      } else if (action == 2 && i % 7 == 0) {
+        graph.removeVertex(a);
+      } else {
+        graph.setEdge(a, b, weight);
+      }
+    };
+    g.modify(change);
+    change(expected);
+    if (action == 0) alive.push_back(expected.nextId() - 1);
+    if (action == 2 && i % 7 == 0) alive.erase(std::find(begin(alive), end(alive), a));
+    // some snapshots are held by long queries, so others are copied
+    auto snapshot = g.pin();
+    if (random() % 5 == 0) held.push_back(snapshot);
+    if (held.size() > 3) held.erase(begin(held));
+
+    ASSERT_THAT(snapshot->version(), Eq(expected.version()));
+    ASSERT_THAT(edges(*snapshot), Eq(edges(expected)));
+  }
+}
+
+TEST(SharedGraph, WriterIsNotBlockedBySnapshot) {
+  auto const vertexes = 100000;
+  SharedGraph g;
+  g.modify([vertexes](Graph& graph) {
+    graph.apply({
+      Mutation{Mutation::Type::kAddVertices, vertexes, {}, {}},
+      Mutation{Mutation::Type::kAddEdges, 0, Generator::edges(Generator::Kind::kGrid, vertexes), {}}
+    });
+  });
+  auto older = g.pin();
+  g.modify([](Graph& graph) { graph.setEdge(0, 1, 2); });
+  auto latest = g.pin();
+  g.modify([](Graph& graph) { graph.setEdge(0, 1, 3); });
+
+  // both snapshots are held, so the next one is a copy of the latest
+  std::atomic<bool> done{false};
+  auto const start = std::chrono::steady_clock::now();
+  std::thread reader{[&g, &done] {
+    g.pin();
+    done = true;
+  }};
+  std::chrono::steady_clock::duration slowest{};
+  for (Distance w = 1; !done; w = 3 - w) {
+    auto const before = std::chrono::steady_clock::now();
+    g.modify([w](Graph& graph) { graph.setEdge(0, 1, w); });
+    slowest = std::max(slowest, std::chrono::steady_clock::now() - before);
+  }
+  reader.join();
+  auto const pinning = std::chrono::steady_clock::now() - start;
+
+  EXPECT_THAT(slowest.count(), Lt(pinning.count() / 2));
+  EXPECT_THAT(g.pin()->version(), Eq(g.version()));
+}
+
+TEST(SharedGraph, LazyBuildDoesNotBlockPin) {
+  std::vector<std::pair<std::size_t, std::function<void(Graph&, Id)>>> const queries{
+    {50000, [](Graph& snapshot, Id last) { snapshot.landmarkPath(0, last); }},
+    {5000, [](Graph& snapshot, Id last) { snapshot.hierarchyPath(0, last); }}
+  };
+  for (auto const& [vertexes, function]: queries) {
+    auto const& query = function;
+    SharedGraph g;
+    g.modify([n = vertexes](Graph& graph) {
+      graph.apply({
+        Mutation{Mutation::Type::kAddVertices, n, {}, {}},
+        Mutation{Mutation::Type::kAddEdges, 0, Generator::edges(Generator::Kind::kGrid, n), {}}
+      });
+    });
+    auto snapshot = g.pin();
+
+    // the next snapshot takes what the building one has, while it builds
+    std::atomic<bool> done{false};
+    auto const start = std::chrono::steady_clock::now();
+    std::thread reader{[&snapshot, &done, &query, last = vertexes - 1] {
+      query(*snapshot, last);
+      done = true;
+    }};
+    std::chrono::steady_clock::duration slowest{};
+    for (Distance w = 1; !done; w = 3 - w) {
+      g.modify([w](Graph& graph) { graph.setEdge(0, 1, w); });
+      auto const before = std::chrono::steady_clock::now();
+      g.pin();
+      slowest = std::max(slowest, std::chrono::steady_clock::now() - before);
+    }
+    reader.join();
+    auto const building = std::chrono::steady_clock::now() - start;
+
+    EXPECT_THAT(slowest.count(), Lt(building.count() / 2));
+  }
+}
+
+TEST(SharedGraph, ReadersDoNotBlockWriter) {
+  auto graph = std::make_shared<SharedGraph>();
+  Processor writer{graph};
+  writer.serve(R"({"action":"AddVertex"})");
+  writer.serve(R"({"action":"AddVertex"})");
+  writer.serve(R"({"action":"AddVertex"})");
+  writer.serve(R"({"action":"AddEdge","from":0,"to":1,"weight":1})");
+  writer.serve(R"({"action":"AddEdge","from":1,"to":2,"weight":1})");
+
+  std::vector<std::thread> readers;
+  std::vector<std::vector<std::string>> responses(3);
+  for (auto& r: responses) {
+    readers.emplace_back([graph, &r] {
+      Processor p{graph};
+      for (auto i = 0; i < 100; ++i) {
+        r.push_back(p.serve(R"({"action":"GetPath","from":0,"to":2})"));
+      }
+    });
+  }
+  for (auto i = 0; i < 100; ++i) {
+    writer.serve(i % 2 ? R"({"action":"AddEdge","from":0,"to":2,"weight":1})"
+                       : R"({"action":"AddEdge","from":0,"to":2,"weight":5})");
+  }
+  for (auto& t: readers) t.join();
+
+  for (auto const& r: responses) {
+    for (auto const& response: r) {
+      ASSERT_THAT(response, AnyOf(StartsWith(R"({"ids":["0","1","2"],)"),
+                                  StartsWith(R"({"ids":["0","2"],)")));
+    }
+  }
+}
+
+TEST(Processor, Stats) {
+  Processor p;
+  p.serve(R"({"action":"AddVertex"})");
+  p.serve(R"({"action":"AddVertex"})");
+  p.serve(R"({"action":"AddEdge","from":0,"to":1,"weight":1})");
+  std::string const first = p.serve(R"({"action":"Stats"})");
+  JsonDocument before;
+  auto settled = before.parse(first)["counters"]["settled"];
+
+  p.serve(R"({"action":"GetPath","from":0,"to":1})");
+  auto stats = p.serve(R"({"action":"Stats"})");
+  JsonDocument after;
+  auto value = after.parse(stats);
+
+  EXPECT_THAT(value["counters"]["settled"].as<std::uint64_t>().value(),
+      Gt(settled.as<std::uint64_t>().value()));
+  EXPECT_THAT(value["counters"]["cacheMisses"].as<std::uint64_t>(), Optional(1));
+  EXPECT_THAT(stats, HasSubstr(R"({"action":"GetPath","count":)"));
+  EXPECT_THAT(stats, HasSubstr(R"("version":"3")"));
+}
+
+TEST(Processor, StatsCountsAnswers) {
+  Processor p{1024 * 1024, 2};
+  for (int i = 0; i < 3; ++i) p.serve(R"({"action":"AddVertex"})");
+  p.serve(R"({"action":"AddEdge","from":0,"to":1,"weight":1})");
+  p.serve(R"({"action":"AddEdge","from":1,"to":2,"weight":1})");
+  auto counters = [&p] {
+    std::string const stats = p.serve(R"({"action":"Stats"})");
+    JsonDocument document;
+    auto counters = document.parse(stats)["counters"];
+    auto answers = counters["answers"];
+    return std::vector<std::uint64_t>{
+      counters["settled"].as<std::uint64_t>().value(),
+      answers["search"].as<std::uint64_t>().value(),
+      answers["continue"].as<std::uint64_t>().value()
+    };
+  };
+  auto before = counters();
+
+  p.serve(R"({"action":"GetPath","from":0,"to":1})");
+  p.serve(R"({"action":"GetPath","from":0,"to":2})");
+  p.serve(R"({"action":"GetPaths","pairs":[{"from":0,"to":2},{"from":1,"to":2}]})");
+  auto after = counters();
+
+  EXPECT_THAT(after[0] - before[0], Eq(8));  // 0, 1 and 2 by GetPath, 5 by the workers
+  EXPECT_THAT(after[1] - before[1], Eq(3));
+  EXPECT_THAT(after[2] - before[2], Eq(1));
+}
+
+TEST(Processor, StatsInPrometheusFormat) {
+  Processor p;
+  p.serve(R"({"action":"AddVertex"})");
+  JsonDocument document;
+
+  auto text = document.parse(p.serve(R"({"action":"Stats","format":"prometheus"})"))["text"]
+      .as<std::string_view>().value();
+
+  EXPECT_THAT(text, HasSubstr("# TYPE spf_edges_relaxed_total counter\n"));
+  EXPECT_THAT(text, HasSubstr("\nspf_graph_vertices 1\n"));
+  EXPECT_THAT(text, HasSubstr("\nspf_path_answers_total{answer=\"continue\"} "));
+  EXPECT_THAT(text, HasSubstr("spf_request_duration_seconds{action=\"AddVertex\",quantile=\"0.5\"} "));
+}
+
+TEST(Processor, BinaryStats) {
+  Processor p;
+  serve(p, Message{Opcode::kAddVertex});
+
+  auto const& response = serve(p, Message{Opcode::kStats});
+  BinaryReader r{response};
+
+  EXPECT_THAT(r.u8(), Eq(0));
+  EXPECT_THAT(r.u64(), Eq(1));
+  EXPECT_THAT(r.u32(), Eq(response.size() - 13));
+  EXPECT_THAT(response.substr(13),
+      HasSubstr("spf_request_duration_seconds_count{action=\"AddVertex\"} "));
+}
+
+TEST(Processor, ProfileGetPath) {
+  Processor p;
+  for (int i = 0; i < 3; ++i) p.serve(R"({"action":"AddVertex"})");
+  p.serve(R"({"action":"AddEdge","from":0,"to":1,"weight":1})");
+  p.serve(R"({"action":"AddEdge","from":1,"to":2,"weight":1})");
+  auto answer = [&p](std::string_view request) {
+    std::string const response = p.serve(request);
+    JsonDocument document;
+    auto profile = document.parse(response)["profile"];
+    EXPECT_TRUE(profile["parse"].as<std::uint64_t>());
+    EXPECT_TRUE(profile["compute"].as<std::uint64_t>());
+    EXPECT_TRUE(profile["serialize"].as<std::uint64_t>());
+    return std::string{profile["answer"].as<std::string_view>().value_or("")} + " " +
+        std::string{profile["settled"].as<std::string_view>().value_or("")};
+  };
+
+  EXPECT_THAT(answer(R"({"action":"GetPath","from":0,"to":2,"profile":true})"), Eq("search 3"));
+  EXPECT_THAT(answer(R"({"action":"GetPath","from":0,"to":1,"profile":true})"), Eq("continue 0"));
+  p.serve(R"({"action":"AddEdge","from":0,"to":2,"weight":5})");
+  EXPECT_THAT(answer(R"({"action":"GetPath","from":0,"to":2,"profile":true})"),
+      Eq("recompute 3"));
+  EXPECT_THAT(answer(R"({"action":"GetPath","from":1,"to":2,"profile":true})"), Eq("search 2"));
+  EXPECT_THAT(answer(R"({"action":"GetPath","from":0,"to":2,"profile":true})"), Eq("cache 0"));
+  EXPECT_THAT(answer(R"({"action":"GetPath","from":0,"to":2,"algorithm":"alt","profile":true})"),
+      Eq("search 3"));
+}
+
+TEST(Processor, GetPathWithoutProfile) {
+  Processor p;
+  p.serve(R"({"action":"AddVertex"})");
+
+  EXPECT_THAT(p.serve(R"({"action":"GetPath","from":0,"to":0,"profile":false})"),
+      Eq(R"({"ids":["0"],"version":"1"})"));
+}
+
+TEST(Processor, BinaryProfileGetPath) {
+  Processor p;
+  serve(p, Message{Opcode::kAddVertex});
+  serve(p, Message{Opcode::kAddVertex});
+  Message edge{Opcode::kAddEdge};
+  edge.writer.u64(0);
+  edge.writer.u64(1);
+  edge.writer.f64(1);
+  serve(p, edge);
+  Message path{Opcode::kGetPath};
+  path.writer.u64(0);
+  path.writer.u64(1);
+  path.writer.u8(static_cast<std::uint8_t>(Algorithm::kProfile));
+
+  BinaryReader r{serve(p, path)};
+
+  EXPECT_THAT(r.u8(), Eq(0));
+  EXPECT_THAT(r.u64(), Eq(3));
+  EXPECT_THAT(r.u32(), Eq(2));
+  EXPECT_THAT(r.u64(), Eq(0));
+  EXPECT_THAT(r.u64(), Eq(1));
+  EXPECT_THAT(r.u8(), Eq(static_cast<std::uint8_t>(SearchContext::Answer::kSearched)));
+  EXPECT_THAT(r.u64(), Gt(0));  // parse
+  EXPECT_THAT(r.u64(), Gt(0));  // compute
+  EXPECT_THAT(r.u64(), Gt(0));  // serialize
+  EXPECT_THAT(r.u64(), Eq(2));  // settled
+  EXPECT_THAT(r.u64(), Eq(1));  // scanned
+  EXPECT_THAT(r.u64(), Eq(1));  // relaxed
+  EXPECT_THAT(r.u64(), Gt(0));  // heap operations
+  EXPECT_TRUE(r.isEnd());
+}
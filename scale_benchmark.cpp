@@ -0,0 +1,269 @@
+#include <benchmark/benchmark.h>
+#include <malloc.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "generator.h"
+#include "graph.h"
+#include "search_context.h"
+
+namespace {
+using Kind = Generator::Kind;
+
+constexpr Kind kKinds[] = {Kind::kGrid, Kind::kGeometric, Kind::kScaleFree, Kind::kRoad};
+constexpr std::size_t kSizes[] = {1000, 10000, 100000, 1000000, 10000000};
+constexpr std::size_t kMaxVertexes = 1000000;  // default limit, 10M vertexes take about 6 GB
+constexpr std::size_t kLarge = 1000000;  // only one graph of this size or more is kept
+constexpr std::size_t kMaxHierarchy = 100000;  // contraction hierarchy is built up to this size
+constexpr std::size_t kMaxHubHierarchy = 10000;  // contraction of hubs adds too many shortcuts
+constexpr std::size_t kPairs = 64;  // queries cycle through these random pairs
+constexpr std::size_t kEdges = 4096;  // updated edges cycle through these ones
+constexpr std::int64_t kRemovals = 1000;  // removed vertexes per run
+
+enum class Algorithm { kDijkstra, kBidirectional, kAlt, kHierarchy };
+
+/**
+ * Gets generated graph which is shared by the benchmarks.
+ * Benchmarks of one kind run one after another, so only graphs of the
+ * last kind are kept. Cache of trees is disabled, so every query is
+ * calculated.
+ * @param kind - kind of the graph.
+ * @param vertexes - number of vertexes.
+ * @return the graph.
+ */
+Graph& shared(Kind kind, std::size_t vertexes) {
+  static Kind last = kind;
+  static std::map<std::size_t, std::unique_ptr<Graph>> graphs;
+  if (kind != last) {
+    graphs.clear();
+    last = kind;
+  }
+  auto& g = graphs[vertexes];
+  if (!g) {
+    if (vertexes >= kLarge) {
+      for (auto& [size, graph]: graphs) {
+        if (size >= kLarge) graph.reset();
+      }
+    }
+    g = std::make_unique<Graph>(Generator::graph(kind, vertexes));
+    g->setCacheBudget(0);
+  }
+  return *g;
+}
+
+/**
+ * Gets random vertexes, the same ones for the same graph.
+ * @param vertexes - number of vertexes of the graph.
+ * @param count - number of the picked ones.
+ * @return the vertexes.
+ */
+std::vector<Id> pick(std::size_t vertexes, std::size_t count) {
+  std::mt19937_64 random{Generator::kSeed};
+  std::uniform_int_distribution<Id> id{0, vertexes - 1};
+  std::vector<Id> ids(count);
+  for (auto& v: ids) v = id(random);
+  return ids;
+}
+
+/**
+ * Gets bytes which are allocated on the heap.
+ */
+std::size_t heap() {
+  auto info = ::mallinfo2();
+  return info.uordblks + info.hblkhd;
+}
+
+/**
+ * Sets counters of work of searches per iteration.
+ * @param state - the state.
+ * @param counters - work of the searches.
+ */
+void report(benchmark::State& state, SearchContext::Counters const& counters) {
+  state.counters["settled"] = benchmark::Counter(counters.settled,
+                                                 benchmark::Counter::kAvgIterations);
+  state.counters["relaxed"] = benchmark::Counter(counters.relaxed,
+                                                 benchmark::Counter::kAvgIterations);
+}
+
+void Build(benchmark::State& state, Kind kind) {
+  std::size_t const vertexes = state.range(0);
+  std::size_t edges = 0;
+  std::size_t bytes = 0;
+
+  for (auto _ : state) {
+    auto const before = heap();
+    auto g = std::make_unique<Graph>(Generator::graph(kind, vertexes));
+    bytes = heap() - before;
+    state.PauseTiming();
+    edges = 0;
+    for (auto const& p: g->vertexes()) edges += p.second.neighbors.size();
+    g.reset();
+    state.ResumeTiming();
+  }
+  state.counters["edges"] = edges;
+  state.counters["bytes"] = benchmark::Counter(bytes, benchmark::Counter::kDefaults,
+                                               benchmark::Counter::kIs1024);
+  state.counters["bytesPerVertex"] = static_cast<double>(bytes) / vertexes;
+  state.counters["bytesPerEdge"] = edges ? static_cast<double>(bytes) / edges : 0;
+  state.SetItemsProcessed(state.iterations() * edges);
+  state.SetComplexityN(vertexes);
+}
+
+void Query(benchmark::State& state, Kind kind, Algorithm algorithm) {
+  std::size_t const vertexes = state.range(0);
+  auto& g = shared(kind, vertexes);
+  auto const ids = pick(vertexes, 2 * kPairs);
+  SearchContext c;
+  // preprocessing is done by the first query
+  if (algorithm == Algorithm::kAlt) g.landmarkPath(c, ids[0], ids[1]);
+  if (algorithm == Algorithm::kHierarchy) g.hierarchyPath(ids[0], ids[1]);
+  auto const before = c.counters();
+  std::size_t i = 0;
+
+  for (auto _ : state) {
+    auto const from = ids[i % kPairs * 2];
+    auto const to = ids[i % kPairs * 2 + 1];
+    ++i;
+    switch (algorithm) {
+      case Algorithm::kDijkstra:
+        benchmark::DoNotOptimize(g.path(c, from, to, true));
+        break;
+      case Algorithm::kBidirectional:
+        benchmark::DoNotOptimize(g.bidirectionalPath(c, from, to));
+        break;
+      case Algorithm::kAlt:
+        benchmark::DoNotOptimize(g.landmarkPath(c, from, to));
+        break;
+      case Algorithm::kHierarchy:
+        benchmark::DoNotOptimize(g.hierarchyPath(from, to));
+        break;
+    }
+  }
+  auto counters = c.counters();
+  counters.settled -= before.settled;
+  counters.relaxed -= before.relaxed;
+  report(state, counters);
+  state.SetComplexityN(vertexes);
+}
+
+void OneToAll(benchmark::State& state, Kind kind) {
+  std::size_t const vertexes = state.range(0);
+  auto const& g = shared(kind, vertexes);
+  auto const ids = pick(vertexes, kPairs);
+  SearchContext c;
+  std::size_t i = 0;
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(g.distances(c, ids[i++ % kPairs]));
+  }
+  report(state, c.counters());
+  state.SetItemsProcessed(c.counters().settled);
+  state.SetComplexityN(vertexes);
+}
+
+void SetEdge(benchmark::State& state, Kind kind) {
+  std::size_t const vertexes = state.range(0);
+  Graph g{shared(kind, vertexes)};
+  std::vector<Mutation::Edge> edges;
+  for (auto from: pick(vertexes, kEdges)) {
+    auto const& neighbors = g.vertexes().at(from).neighbors;
+    if (!neighbors.empty()) {
+      edges.push_back({from, neighbors.begin()->first->id, neighbors.begin()->second});
+    }
+  }
+  std::size_t i = 0;
+
+  for (auto _ : state) {
+    // the weight goes up and down, so both repair paths are taken
+    auto const& e = edges[i % edges.size()];
+    g.setEdge(e.from, e.to, e.weight * (i / edges.size() % 2 ? 1 : 2));
+    ++i;
+  }
+  state.SetItemsProcessed(state.iterations());
+  state.SetComplexityN(vertexes);
+}
+
+void RemoveVertex(benchmark::State& state, Kind kind) {
+  std::size_t const vertexes = state.range(0);
+  Graph g{shared(kind, vertexes)};
+  std::vector<Id> ids(vertexes);
+  for (Id v = 0; v < vertexes; ++v) ids[v] = v;
+  std::shuffle(begin(ids), end(ids), std::mt19937_64{Generator::kSeed});
+  std::size_t i = 0;
+
+  for (auto _ : state) {
+    g.removeVertex(ids[i++]);
+  }
+  state.SetItemsProcessed(state.iterations());
+  state.SetComplexityN(vertexes);
+}
+
+/**
+ * Registers benchmarks of every kind of graph for sizes up to the limit.
+ * Runs of one benchmark differ only by size, so its complexity is fitted.
+ * @param limit - the largest number of vertexes.
+ */
+void registerAll(std::size_t limit) {
+  auto sizes = [limit](benchmark::internal::Benchmark* b, std::size_t max) {
+    for (auto size: kSizes) {
+      if (size <= std::min(limit, max)) b->Arg(static_cast<std::int64_t>(size));
+    }
+    return b->Complexity();
+  };
+  auto const all = kSizes[std::size(kSizes) - 1];
+  for (auto kind: kKinds) {
+    std::string const name{Generator::name(kind)};
+    auto const hierarchy = kind == Kind::kScaleFree ? kMaxHubHierarchy : kMaxHierarchy;
+    sizes(benchmark::RegisterBenchmark(("Build/" + name).c_str(), Build, kind), all)
+        ->Unit(benchmark::kMillisecond);
+    sizes(benchmark::RegisterBenchmark(("Query/dijkstra/" + name).c_str(), Query, kind,
+                                       Algorithm::kDijkstra), all)
+        ->Unit(benchmark::kMicrosecond);
+    sizes(benchmark::RegisterBenchmark(("Query/bidirectional/" + name).c_str(), Query, kind,
+                                       Algorithm::kBidirectional), all)
+        ->Unit(benchmark::kMicrosecond);
+    sizes(benchmark::RegisterBenchmark(("Query/alt/" + name).c_str(), Query, kind,
+                                       Algorithm::kAlt), all)
+        ->Unit(benchmark::kMicrosecond);
+    sizes(benchmark::RegisterBenchmark(("Query/hierarchy/" + name).c_str(), Query, kind,
+                                       Algorithm::kHierarchy), hierarchy)
+        ->Unit(benchmark::kMicrosecond);
+    sizes(benchmark::RegisterBenchmark(("OneToAll/" + name).c_str(), OneToAll, kind), all)
+        ->Unit(benchmark::kMillisecond);
+    sizes(benchmark::RegisterBenchmark(("SetEdge/" + name).c_str(), SetEdge, kind), all);
+    sizes(benchmark::RegisterBenchmark(("RemoveVertex/" + name).c_str(), RemoveVertex, kind), all)
+        ->Iterations(kRemovals);
+  }
+}
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  constexpr std::string_view kLimit{"--max_vertexes="};
+  std::size_t limit = kMaxVertexes;
+  for (int i = 1; i < argc; ++i) {
+    std::string_view arg{argv[i]};
+    if (arg.substr(0, kLimit.size()) != kLimit) continue;
+    limit = std::stoull(std::string{arg.substr(kLimit.size())});
+    std::copy(argv + i + 1, argv + argc, argv + i);
+    --argc;
+    break;
+  }
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+    std::cerr << "Usage: " << argv[0] << " [--max_vertexes=N] [benchmark options]" << std::endl;
+    return 1;
+  }
+  registerAll(limit);
+  benchmark::RunSpecifiedBenchmarks();
+  return 0;
+}
@@ -0,0 +1,77 @@
+#include "search_context.h"
+
+#include <algorithm>
+
+#include "graph.h"
+
+bool SearchContext::LessDistance::operator()(std::size_t lhs, std::size_t rhs) const {
+  auto const& a = (*infos)[lhs];
+  auto const& b = (*infos)[rhs];
+  return (a.distance < b.distance) || (a.distance == b.distance && lhs < rhs);
+}
+
+bool SearchContext::LessEstimate::operator()(std::size_t lhs, std::size_t rhs) const {
+  auto const a = (*estimates)[lhs];
+  auto const b = (*estimates)[rhs];
+  return (a < b) || (a == b && lhs < rhs);
+}
+
+SearchContext::Counters& SearchContext::Counters::operator+=(Counters const& other) {
+  settled += other.settled;
+  scanned += other.scanned;
+  relaxed += other.relaxed;
+  heap += other.heap;
+  for (std::size_t i = 0; i < kAnswers; ++i) answers[i] += other.answers[i];
+  return *this;
+}
+
+SearchContext::Counters SearchContext::Counters::operator-(Counters const& other) const {
+  auto difference = *this;
+  difference.settled -= other.settled;
+  difference.scanned -= other.scanned;
+  difference.relaxed -= other.relaxed;
+  difference.heap -= other.heap;
+  for (std::size_t i = 0; i < kAnswers; ++i) difference.answers[i] -= other.answers[i];
+  return difference;
+}
+
+void SearchContext::fit(std::vector<SpfInfo>& states, std::size_t size) {
+  if (states.size() < size) {
+    states.resize(size);
+  } else if (states.size() / 2 > size) {
+    // stamps of the kept states are older than the next generation
+    states.resize(size);
+    states.shrink_to_fit();
+  }
+}
+
+void SearchContext::renew(Graph const& graph) {
+  reset(graph.slots());
+  graph_ = &graph;
+  version_ = graph.version();
+}
+
+void SearchContext::reset(std::size_t size) {
+  unvisited_.clear();
+  settled_.clear();
+  fit(info_, size);
+  if (++generation_ == 0) {
+    std::fill(begin(info_), end(info_), SpfInfo{});
+    generation_ = 1;
+  }
+  graph_ = nullptr;
+}
+
+void SearchContext::renewBack(std::size_t size) {
+  backward_.clear();
+  goal_.clear();
+  fit(back_, size);
+  if (estimates_.size() > back_.size()) {
+    estimates_.resize(back_.size());
+    estimates_.shrink_to_fit();
+  }
+  if (++backGeneration_ == 0) {
+    std::fill(begin(back_), end(back_), SpfInfo{});
+    backGeneration_ = 1;
+  }
+}
@@ -0,0 +1,185 @@
+#ifndef SEARCH_CONTEXT_H_
+#define SEARCH_CONTEXT_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "heap.h"
+#include "types.h"
+
+class Graph;
+struct Vertex;
+
+/**
+ * State of the vertex in a search.
+ * It belongs to the search whose generation is stamped in it,
+ * the state of an older search is treated like initial one.
+ */
+struct SpfInfo {
+  Distance distance{std::numeric_limits<Distance>::infinity()};
+  bool visited{false};
+  Vertex const* previous{nullptr};
+  std::size_t position{std::numeric_limits<std::size_t>::max()};
+  std::size_t generation{0};
+  Vertex const* vertex{nullptr};  // the vertex itself, it is set when reached
+};
+
+/**
+ * State of searches of one client.
+ * Graph keeps no state of queries, so every client which searches
+ * in the same graph at the same time needs its own context.
+ * The last search from a source stays in the context, so next request
+ * from the same source continues it while the graph is not changed.
+ * States are kept by slot of the vertex (see Graph::slots()), a context
+ * takes sizeof(SpfInfo) = 48 bytes per slot for the forward search and as
+ * much for the backward or goal-directed one once it is run, and it
+ * shrinks when the graph has less than half of the slots it has states for.
+ */
+class SearchContext {
+public:
+  /**
+   * How the last path of Dijkstra search was found.
+   */
+  enum class Answer: std::uint8_t {
+    kSearched,  // a new search was started from the source
+    kRecomputed,  // the search from the source was started again since the graph changed
+    kContinued,  // the search from the source was continued
+    kCached,  // the path was taken from a cached tree
+    kParallel  // the whole tree was calculated in parallel
+  };
+
+  static constexpr std::size_t kAnswers = static_cast<std::size_t>(Answer::kParallel) + 1;
+
+  /**
+   * Work done by searches in the context, the counters only grow.
+   * Work of the workers which a query of the context runs is added too.
+   */
+  struct Counters {
+    std::uint64_t settled{0};  // vertices whose distance became final
+    std::uint64_t scanned{0};  // edges which were looked at
+    std::uint64_t relaxed{0};  // edges which improved a distance
+    std::uint64_t heap{0};  // pushes, updates and pops of the queues
+    std::array<std::uint64_t, kAnswers> answers{};  // paths of Dijkstra search by Answer
+
+    Counters& operator+=(Counters const& other);
+    Counters operator-(Counters const& other) const;
+  };
+
+  SearchContext() = default;
+  SearchContext(SearchContext const&) = delete;
+  SearchContext& operator=(SearchContext const&) = delete;
+
+  /**
+   * Gets state of the vertex in the forward search.
+   * @param slot - slot of the vertex.
+   * @return the state.
+   */
+  SpfInfo& info(std::size_t slot) { return info_[slot]; }
+  SpfInfo const& info(std::size_t slot) const { return info_[slot]; }
+
+  /**
+   * Gets state of the vertex in the backward search.
+   * @param slot - slot of the vertex.
+   * @return the state.
+   */
+  SpfInfo& back(std::size_t slot) { return back_[slot]; }
+  SpfInfo const& back(std::size_t slot) const { return back_[slot]; }
+
+  /**
+   * Gets generation of the current search.
+   * @return the generation.
+   */
+  std::size_t generation() const { return generation_; }
+
+  /**
+   * Gets work done by searches in the context.
+   * @return the counters.
+   */
+  Counters const& counters() const { return counters_; }
+
+  /**
+   * Gets how the last path of Dijkstra search was found.
+   * @return the answer.
+   */
+  Answer answer() const { return answer_; }
+
+private:
+  friend class Graph;
+  friend class Landmarks;
+
+  struct LessDistance {
+    std::vector<SpfInfo> const* infos;
+    bool operator()(std::size_t lhs, std::size_t rhs) const;
+  };
+
+  struct Position {
+    std::vector<SpfInfo>* infos;
+    std::size_t& operator()(std::size_t slot) const { return (*infos)[slot].position; }
+  };
+
+  struct LessEstimate {
+    std::vector<Distance> const* estimates;
+    bool operator()(std::size_t lhs, std::size_t rhs) const;
+  };
+
+  // queues keep slots of the vertexes
+  using Queue = Heap<std::size_t, LessDistance, Position>;
+  using Goal = Heap<std::size_t, LessEstimate, Position>;
+
+  /**
+   * Starts new generation of search for the graph.
+   * @param graph - the graph.
+   */
+  void renew(Graph const& graph);
+
+  /**
+   * Starts new generation of search which can not be continued.
+   * @param size - number of states which are needed, the states are
+   * released if they are more than twice as many.
+   */
+  void reset(std::size_t size);
+
+  /**
+   * Starts new generation of the backward or goal-directed search, the
+   * forward one is kept. States of these searches are allocated only by
+   * the searches which need them.
+   * @param size - number of states which are needed, the states are
+   * released if they are more than twice as many.
+   */
+  void renewBack(std::size_t size);
+
+  /**
+   * Makes room for the states, or releases the extra ones.
+   * @param states - the states.
+   * @param size - number of states which are needed.
+   */
+  static void fit(std::vector<SpfInfo>& states, std::size_t size);
+
+  /**
+   * Sets how the last path was found and counts it.
+   * @param answer - the answer.
+   */
+  void answered(Answer answer) {
+    answer_ = answer;
+    ++counters_.answers[static_cast<std::size_t>(answer)];
+  }
+
+  std::vector<SpfInfo> info_;
+  std::vector<SpfInfo> back_;  // it is empty until a backward search is run
+  Queue unvisited_{LessDistance{&info_}, Position{&info_}};
+  Queue backward_{LessDistance{&back_}, Position{&back_}};
+  std::vector<Distance> estimates_;  // distance with the bound to the target by slot
+  Goal goal_{LessEstimate{&estimates_}, Position{&back_}};  // it keeps states in back_
+  std::vector<Vertex const*> settled_;
+  std::size_t generation_{0};
+  std::size_t backGeneration_{0};
+  Graph const* graph_{nullptr};  // graph of the current search
+  std::size_t version_{0};  // version of the graph when the search started
+  Counters counters_;
+  Answer answer_{Answer::kSearched};
+};
+
+#endif /* SEARCH_CONTEXT_H_ */
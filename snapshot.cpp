@@ -0,0 +1,286 @@
+#include "snapshot.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <numeric>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "graph.h"
+
+namespace {
+constexpr char kMagic[8] = {'S', 'P', 'F', 'G', 'R', 'A', 'P', 'H'};
+constexpr std::uint32_t kByteOrder = 0x01020304;
+
+struct Header {
+  char magic[8];
+  std::uint32_t format;
+  std::uint32_t order;  // it is read in other order on a host of other byte order
+  std::uint64_t version;
+  std::uint64_t nextId;
+  std::uint64_t vertexes;
+  std::uint64_t edges;
+};
+static_assert(sizeof(Header) % 8 == 0, "arrays follow the header aligned");
+
+void invalid() {
+  throw std::runtime_error{"Invalid snapshot"};
+}
+
+/**
+ * Flushes the written file to the disk.
+ * @param file - the file.
+ * @return true if the file is flushed.
+ */
+bool sync(std::string const& file) {
+  auto fd = ::open(file.c_str(), O_RDONLY);
+  if (fd < 0) return false;
+  auto done = ::fsync(fd) == 0;
+  ::close(fd);
+  return done;
+}
+
+template <typename T>
+void put(std::ofstream& out, T const* data, std::size_t size) {
+  out.write(reinterpret_cast<char const*>(data), static_cast<std::streamsize>(size * sizeof(T)));
+}
+
+/**
+ * Builds the in edges of the out ones, the in edges of every vertex are
+ * filled by ascending source.
+ * @param n - number of vertexes.
+ * @param out - the out edges, the other ends must be less than n.
+ * @param offsets - offsets of the in edges.
+ * @param sources - indexes of the other ends of the in edges.
+ * @param weights - weights of the in edges.
+ */
+void transpose(std::size_t n, SnapshotMapping::Rows const& out,
+               std::vector<std::uint64_t>& offsets, std::vector<std::uint64_t>& sources,
+               std::vector<Distance>& weights) {
+  auto const m = out.offsets[n];
+  offsets.assign(n + 1, 0);
+  for (std::uint64_t e = 0; e < m; ++e) ++offsets[out.ends[e] + 1];
+  std::partial_sum(begin(offsets), end(offsets), begin(offsets));
+  sources.resize(m);
+  weights.resize(m);
+  std::vector<std::uint64_t> next(begin(offsets), end(offsets) - 1);
+  for (std::uint64_t i = 0; i < n; ++i) {
+    for (auto e = out.offsets[i]; e < out.offsets[i + 1]; ++e) {
+      auto slot = next[out.ends[e]]++;
+      sources[slot] = i;
+      weights[slot] = out.weights[e];
+    }
+  }
+}
+}  // namespace
+
+void Snapshot::write(Graph const& graph, std::string const& file) {
+  static std::atomic<std::size_t> counter{0};
+  auto const& vertexes = graph.vertexes();
+  std::vector<Id> ids;
+  ids.reserve(vertexes.size());
+  for (auto const& p: vertexes) ids.push_back(p.first);
+  std::sort(begin(ids), end(ids));
+  std::unordered_map<Vertex const*, std::uint64_t> indexes;
+  indexes.reserve(ids.size());
+  for (std::size_t i = 0; i < ids.size(); ++i) indexes.emplace(&vertexes.at(ids[i]), i);
+
+  std::vector<std::uint64_t> offsets{0};
+  offsets.reserve(ids.size() + 1);
+  std::vector<std::pair<std::uint64_t, Distance>> edges;
+  for (auto id: ids) {
+    auto const& neighbors = vertexes.at(id).neighbors;
+    auto first = edges.size();
+    for (auto const& [w, weight]: neighbors) edges.emplace_back(indexes.at(w), weight);
+    std::sort(begin(edges) + first, end(edges));
+    offsets.push_back(edges.size());
+  }
+  std::vector<std::uint64_t> targets(edges.size());
+  std::vector<Distance> weights(edges.size());
+  for (std::size_t i = 0; i < edges.size(); ++i) {
+    targets[i] = edges[i].first;
+    weights[i] = edges[i].second;
+  }
+  std::vector<std::uint64_t> inOffsets;
+  std::vector<std::uint64_t> sources;
+  std::vector<Distance> inWeights;
+  transpose(ids.size(), {offsets.data(), targets.data(), weights.data()},
+            inOffsets, sources, inWeights);
+
+  Header header{};
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.format = kFormat;
+  header.order = kByteOrder;
+  header.version = graph.version();
+  header.nextId = graph.nextId();
+  header.vertexes = ids.size();
+  header.edges = edges.size();
+
+  auto temporary = file + ".tmp" + std::to_string(::getpid()) + "." + std::to_string(counter++);
+  {
+    std::ofstream out{temporary, std::ios::binary | std::ios::trunc};
+    put(out, &header, 1);
+    put(out, ids.data(), ids.size());
+    put(out, offsets.data(), offsets.size());
+    put(out, targets.data(), targets.size());
+    put(out, weights.data(), weights.size());
+    put(out, inOffsets.data(), inOffsets.size());
+    put(out, sources.data(), sources.size());
+    put(out, inWeights.data(), inWeights.size());
+    out.close();
+    if (!out || !sync(temporary)) {
+      std::remove(temporary.c_str());
+      throw std::runtime_error{"Can not write snapshot"};
+    }
+  }
+  if (std::rename(temporary.c_str(), file.c_str()) != 0) {
+    std::remove(temporary.c_str());
+    throw std::runtime_error{"Can not write snapshot"};
+  }
+}
+
+void Snapshot::read(std::string const& file, Graph& graph) {
+  auto mapping = std::make_shared<SnapshotMapping const>(file);
+  auto const n = mapping->vertexes();
+  auto const ids = mapping->ids();
+  auto const& out = mapping->out();
+  auto const& in = mapping->in();
+  std::unordered_map<Id, Vertex> vertexes;
+  vertexes.reserve(n);
+  std::vector<Vertex*> table(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    table[i] = &vertexes.emplace(ids[i], Vertex{ids[i], i}).first->second;
+  }
+  auto row = [&table](SnapshotMapping::Rows const& rows, std::size_t i) {
+    auto first = rows.offsets[i];
+    return Edges{{table.data(), rows.ends + first, rows.weights + first,
+                  rows.offsets[i + 1] - first}};
+  };
+  for (std::size_t i = 0; i < n; ++i) {
+    table[i]->neighbors = row(out, i);
+    table[i]->incoming = row(in, i);
+  }
+
+  graph.detach();
+  for (auto const& p: graph.vertexes_) graph.touch(p.first);
+  graph.vertexes_ = std::move(vertexes);
+  graph.slots_ = n;  // slots are the indexes in the file
+  graph.free_.clear();
+  graph.table_ = std::move(table);  // the edges keep referring to its array
+  graph.mapping_ = mapping;
+  for (auto const& p: graph.vertexes_) graph.touch(p.first);
+  graph.id_ = mapping->nextId();
+  graph.version_ = std::max<std::size_t>(graph.version_ + 1, mapping->version());
+  ++graph.topology_;
+  ++graph.decrease_;
+}
+
+SnapshotMapping::SnapshotMapping(std::string const& file) {
+  auto fd = ::open(file.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw std::runtime_error{"Can not open snapshot"};
+  }
+  struct stat st;
+  if (::fstat(fd, &st) != 0) {
+    ::close(fd);
+    throw std::runtime_error{"Can not open snapshot"};
+  }
+  size_ = static_cast<std::size_t>(st.st_size);
+  if (size_ < sizeof(Header)) {
+    ::close(fd);
+    invalid();
+  }
+  data_ = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (data_ == MAP_FAILED) {
+    data_ = nullptr;
+    throw std::runtime_error{"Can not map snapshot"};
+  }
+  try {
+    validate();
+  } catch (...) {
+    ::munmap(data_, size_);
+    throw;
+  }
+}
+
+SnapshotMapping::~SnapshotMapping() {
+  ::munmap(data_, size_);
+}
+
+void SnapshotMapping::validate() {
+  auto const data = static_cast<char const*>(data_);
+  Header header;
+  std::memcpy(&header, data, sizeof(header));
+  if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.order != kByteOrder) {
+    invalid();
+  }
+  if (header.format != Snapshot::kFormat && header.format != Snapshot::kOutFormat) {
+    throw std::runtime_error{"Unsupported snapshot format " + std::to_string(header.format)};
+  }
+  auto const rows = header.format == Snapshot::kFormat ? 2 : 1;
+  auto const n = header.vertexes;
+  auto const m = header.edges;
+  auto const words = (size_ - sizeof(header)) / 8;
+  if ((size_ - sizeof(header)) % 8 != 0 || n >= words || m > words
+      || words != n + rows * (n + 1 + 2 * m)) {
+    invalid();
+  }
+  ids_ = reinterpret_cast<std::uint64_t const*>(data + sizeof(header));
+  auto offsets = ids_ + n;
+  out_ = {offsets, offsets + n + 1, reinterpret_cast<Distance const*>(offsets + n + 1 + m)};
+  for (std::uint64_t i = 0; i < n; ++i) {
+    if (ids_[i] >= header.nextId || (i > 0 && ids_[i] <= ids_[i - 1])
+        || out_.offsets[i + 1] < out_.offsets[i]) {
+      invalid();
+    }
+  }
+  if (out_.offsets[0] != 0 || out_.offsets[n] != m) invalid();
+  if (rows == 1) {
+    // the in edges are built once, then the graph is queried like of a new file
+    if (std::any_of(out_.ends, out_.ends + m, [n](std::uint64_t b) { return b >= n; })) {
+      invalid();
+    }
+    transpose(n, out_, inOffsets_, inEnds_, inWeights_);
+    in_ = {inOffsets_.data(), inEnds_.data(), inWeights_.data()};
+  } else {
+    offsets += n + 1 + 2 * m;
+    in_ = {offsets, offsets + n + 1, reinterpret_cast<Distance const*>(offsets + n + 1 + m)};
+    for (std::uint64_t i = 0; i < n; ++i) {
+      if (in_.offsets[i + 1] < in_.offsets[i]) invalid();
+    }
+    if (in_.offsets[0] != 0 || in_.offsets[n] != m) invalid();
+  }
+  // the in edges must be exactly the out ones, modifications rely on both ends
+  std::vector<std::uint64_t> next(in_.offsets, in_.offsets + n);
+  for (std::uint64_t i = 0; i < n; ++i) {
+    for (auto e = out_.offsets[i]; e < out_.offsets[i + 1]; ++e) {
+      auto const b = out_.ends[e];
+      auto const weight = out_.weights[e];
+      if (b >= n || (e > out_.offsets[i] && b <= out_.ends[e - 1])
+          || !std::isfinite(weight) || weight < 0) {
+        invalid();
+      }
+      auto const slot = next[b]++;
+      if (slot >= in_.offsets[b + 1] || in_.ends[slot] != i || in_.weights[slot] != weight) {
+        invalid();
+      }
+    }
+  }
+  version_ = header.version;
+  nextId_ = header.nextId;
+  vertexes_ = n;
+  edges_ = m;
+}
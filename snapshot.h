@@ -0,0 +1,117 @@
+#ifndef SNAPSHOT_H_
+#define SNAPSHOT_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "types.h"
+
+class Graph;
+
+/**
+ * Binary file of a graph.
+ * The file is a header followed by arrays of 8-byte values in the byte
+ * order of the host: vertex IDs in ascending order, then the out edges and
+ * the in edges in compressed sparse rows. Every row is offsets of the edges
+ * of the vertexes (one more than vertexes), indexes of the other ends in
+ * the array of IDs and the weights. Edges of a vertex are sorted by index.
+ * The file is mapped into memory and the loaded graph is queried straight
+ * from the arrays, a vertex gets own edges only when they are changed.
+ */
+class Snapshot {
+public:
+  /**
+   * Version of the format which is written.
+   */
+  static constexpr std::uint32_t kFormat = 2;
+
+  /**
+   * Version of the format of the first files, they have no in edges.
+   * Such a file is read too, its in edges are built when it is mapped.
+   * A file of any other version is rejected.
+   */
+  static constexpr std::uint32_t kOutFormat = 1;
+
+  /**
+   * Writes the graph into the file.
+   * The file is replaced atomically, so a reader never sees a part of it
+   * and a graph which maps the replaced file keeps it.
+   * @param graph - the graph.
+   * @param file - the file.
+   * @throw std::runtime_error if the file can not be written.
+   */
+  static void write(Graph const& graph, std::string const& file);
+
+  /**
+   * Replaces vertexes and edges of the graph by the ones of the file.
+   * It takes time proportional to the number of vertexes, the edges are
+   * only validated. The graph keeps its settings and gets a version which
+   * is not less than the saved one and newer than its own one.
+   * @param file - the file, it must not be changed in place while it is mapped.
+   * @param graph - the graph.
+   * @throw std::runtime_error if the file can not be read or is not valid.
+   */
+  static void read(std::string const& file, Graph& graph);
+};
+
+/**
+ * Snapshot file which is mapped into memory read-only.
+ * It is validated once when it is mapped, graphs which refer to its arrays
+ * share it and it is unmapped when the last of them drops it.
+ */
+class SnapshotMapping {
+public:
+  /**
+   * Maps and validates the file.
+   * @param file - the file.
+   * @throw std::runtime_error if the file can not be mapped or is not valid.
+   */
+  explicit SnapshotMapping(std::string const& file);
+  ~SnapshotMapping();
+
+  SnapshotMapping(SnapshotMapping const&) = delete;
+  SnapshotMapping& operator=(SnapshotMapping const&) = delete;
+
+  std::size_t version() const { return version_; }
+  Id nextId() const { return nextId_; }
+  std::size_t vertexes() const { return vertexes_; }
+  std::size_t edges() const { return edges_; }
+
+  /**
+   * Gets IDs of the vertexes in ascending order.
+   * @return the array.
+   */
+  std::uint64_t const* ids() const { return ids_; }
+
+  /**
+   * Rows of edges of the vertexes by index.
+   */
+  struct Rows {
+    std::uint64_t const* offsets;  // first edge of every vertex and the end
+    std::uint64_t const* ends;  // indexes of the other ends
+    Distance const* weights;
+  };
+
+  Rows const& out() const { return out_; }
+  Rows const& in() const { return in_; }
+
+private:
+  void validate();
+
+  void* data_{nullptr};
+  std::size_t size_{0};
+  std::size_t version_{0};
+  Id nextId_{0};
+  std::size_t vertexes_{0};
+  std::size_t edges_{0};
+  std::uint64_t const* ids_{nullptr};
+  Rows out_{};
+  Rows in_{};
+  std::vector<std::uint64_t> inOffsets_;  // in edges which are built for a file of old format
+  std::vector<std::uint64_t> inEnds_;
+  std::vector<Distance> inWeights_;
+};
+
+#endif /* SNAPSHOT_H_ */
@@ -0,0 +1,337 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <list>
+#include <stdexcept>
+#include <string>
+
+#include "graph.h"
+#include "processor.h"
+#include "snapshot.h"
+
+using ::testing::ContainerEq;
+using ::testing::Eq;
+using ::testing::Ge;
+using ::testing::Gt;
+using ::testing::StrEq;
+
+namespace {
+/**
+ * File which is removed at the end of a test.
+ */
+struct TempFile {
+  explicit TempFile(std::string name): name{::testing::TempDir() + name} {}
+  ~TempFile() { std::remove(name.c_str()); }
+
+  std::string name;
+};
+}  // namespace
+
+TEST(Snapshot, ReadWritten) {
+  TempFile file{"snapshot_read_written"};
+  Graph g;
+  for (int i = 0; i < 4; ++i) g.addVertex();
+  g.setEdge(0, 1, 1.5);
+  g.setEdge(1, 3, 2);
+  g.setEdge(0, 3, 5);
+  g.setEdge(3, 0, 0.25);
+  g.removeVertex(2);
+  Snapshot::write(g, file.name);
+
+  Graph loaded;
+  Snapshot::read(file.name, loaded);
+
+  EXPECT_THAT(loaded.vertexes().size(), Eq(3));
+  EXPECT_THAT(loaded.nextId(), Eq(4));
+  EXPECT_THAT(loaded.version(), Eq(g.version()));
+  EXPECT_THAT(loaded.path(0, 3), Eq(std::list<Id>{0, 1, 3}));
+  EXPECT_THAT(loaded.distances(0).steps.at(3).distance, Eq(3.5));
+  EXPECT_THAT(loaded.distances(3).steps.at(1).distance, Eq(1.75));
+  EXPECT_THAT(loaded.addVertex(), Eq(4));
+}
+
+TEST(Snapshot, ReadEmpty) {
+  TempFile file{"snapshot_read_empty"};
+  Snapshot::write(Graph{}, file.name);
+
+  Graph loaded;
+  loaded.addVertex();
+  Snapshot::read(file.name, loaded);
+
+  EXPECT_TRUE(loaded.vertexes().empty());
+  EXPECT_THAT(loaded.nextId(), Eq(0));
+}
+
+TEST(Snapshot, VersionMovesForward) {
+  TempFile file{"snapshot_version"};
+  Graph g;
+  g.addVertex();
+  Snapshot::write(g, file.name);
+  Graph loaded;
+  for (int i = 0; i < 5; ++i) loaded.addVertex();
+  auto before = loaded.version();
+
+  Snapshot::read(file.name, loaded);
+
+  EXPECT_THAT(loaded.version(), Gt(before));
+  EXPECT_THAT(loaded.version(), Ge(g.version()));
+}
+
+TEST(Snapshot, LoadedGraphKeepsNoCachedPath) {
+  TempFile file{"snapshot_cached"};
+  Graph g;
+  g.addVertex(); g.addVertex();
+  g.setEdge(0, 1, 7);
+  Snapshot::write(g, file.name);
+  Graph loaded;
+  loaded.addVertex(); loaded.addVertex();
+  loaded.setEdge(0, 1, 1);
+  EXPECT_THAT(loaded.distances(0).steps.at(1).distance, Eq(1));
+
+  Snapshot::read(file.name, loaded);
+
+  EXPECT_THAT(loaded.distances(0).steps.at(1).distance, Eq(7));
+}
+
+TEST(Snapshot, MissingFile) {
+  Graph g;
+
+  EXPECT_THROW(Snapshot::read(::testing::TempDir() + "snapshot_missing", g), std::runtime_error);
+}
+
+TEST(Snapshot, InvalidFile) {
+  TempFile file{"snapshot_invalid"};
+  std::ofstream{file.name} << "not a snapshot of a graph, but long enough for a header";
+  Graph g;
+  g.addVertex();
+
+  EXPECT_THROW(Snapshot::read(file.name, g), std::runtime_error);
+  EXPECT_THAT(g.vertexes().size(), Eq(1));
+}
+
+namespace {
+/**
+ * Writes the graph in the given format, a file of format 1 has no in edges.
+ */
+void write(Graph const& graph, std::string const& file, std::uint32_t format) {
+  Snapshot::write(graph, file);
+  std::string data;
+  {
+    std::ifstream in{file, std::ios::binary};
+    data.assign(std::istreambuf_iterator<char>{in}, {});
+  }
+  std::memcpy(&data[8], &format, sizeof(format));
+  if (format == Snapshot::kOutFormat) {
+    auto const n = graph.vertexes().size();
+    auto m = std::size_t{0};
+    for (auto const& p: graph.vertexes()) m += p.second.neighbors.size();
+    data.resize(data.size() - 8 * (n + 1 + 2 * m));
+  }
+  std::ofstream{file, std::ios::binary | std::ios::trunc} << data;
+}
+}  // namespace
+
+TEST(Snapshot, ReadFirstFormat) {
+  TempFile file{"snapshot_first_format"};
+  Graph g;
+  g.addVertex(); g.addVertex(); g.addVertex(); g.addVertex();
+  g.removeVertex(0);
+  g.setEdge(1, 2, 1); g.setEdge(2, 3, 2); g.setEdge(3, 1, 3); g.setEdge(1, 3, 5);
+  write(g, file.name, Snapshot::kOutFormat);
+  Graph loaded;
+
+  Snapshot::read(file.name, loaded);
+
+  EXPECT_THAT(loaded.path(1, 3), ContainerEq(std::list<Id>{1, 2, 3}));
+  EXPECT_THAT(loaded.vertexes().at(1).incoming.at(&loaded.vertexes().at(3)), Eq(3));
+  loaded.removeVertex(2);
+  EXPECT_THAT(loaded.path(1, 3), ContainerEq(std::list<Id>{1, 3}));
+  EXPECT_TRUE(loaded.vertexes().at(3).incoming.size() == 1);
+}
+
+TEST(Snapshot, UnsupportedFormat) {
+  TempFile file{"snapshot_unsupported_format"};
+  Graph g;
+  g.addVertex();
+  write(g, file.name, Snapshot::kFormat + 1);
+  Graph loaded;
+
+  try {
+    Snapshot::read(file.name, loaded);
+    FAIL() << "the file is read";
+  } catch (std::runtime_error const& e) {
+    EXPECT_THAT(e.what(), StrEq("Unsupported snapshot format 3"));
+  }
+}
+
+TEST(Snapshot, TruncatedFile) {
+  TempFile file{"snapshot_truncated"};
+  Graph g;
+  g.addVertex(); g.addVertex();
+  g.setEdge(0, 1, 1);
+  Snapshot::write(g, file.name);
+  std::string data;
+  {
+    std::ifstream in{file.name, std::ios::binary};
+    data.assign(std::istreambuf_iterator<char>{in}, {});
+  }
+  std::ofstream{file.name, std::ios::binary} << data.substr(0, data.size() - 8);
+  Graph loaded;
+
+  EXPECT_THROW(Snapshot::read(file.name, loaded), std::runtime_error);
+}
+
+TEST(Snapshot, InfiniteWeight) {
+  TempFile file{"snapshot_infinite"};
+  Graph g;
+  g.addVertex(); g.addVertex();
+  g.setEdge(0, 1, 1);
+  Snapshot::write(g, file.name);
+  std::string data;
+  {
+    std::ifstream in{file.name, std::ios::binary};
+    data.assign(std::istreambuf_iterator<char>{in}, {});
+  }
+  auto const weight = std::numeric_limits<Distance>::infinity();
+  data.replace(data.size() - sizeof(weight), sizeof(weight),
+               reinterpret_cast<char const*>(&weight), sizeof(weight));
+  std::ofstream{file.name, std::ios::binary} << data;
+  Graph loaded;
+
+  EXPECT_THROW(Snapshot::read(file.name, loaded), std::runtime_error);
+}
+
+TEST(Snapshot, LoadedEdgesStayMapped) {
+  TempFile file{"snapshot_mapped"};
+  Graph g;
+  for (int i = 0; i < 4; ++i) g.addVertex();
+  g.setEdge(0, 1, 1);
+  g.setEdge(1, 2, 1);
+  g.setEdge(2, 3, 1);
+  g.setEdge(0, 3, 5);
+  Snapshot::write(g, file.name);
+  Graph loaded;
+  Snapshot::read(file.name, loaded);
+
+  EXPECT_TRUE(loaded.vertexes().at(0).neighbors.isMapped());
+  EXPECT_TRUE(loaded.vertexes().at(3).incoming.isMapped());
+  EXPECT_THAT(loaded.path(0, 3), Eq(std::list<Id>{0, 1, 2, 3}));
+  EXPECT_THAT(loaded.bidirectionalPath(0, 3), Eq(std::list<Id>{0, 1, 2, 3}));
+
+  loaded.setEdge(0, 2, 0.5);
+
+  EXPECT_FALSE(loaded.vertexes().at(0).neighbors.isMapped());
+  EXPECT_FALSE(loaded.vertexes().at(2).incoming.isMapped());
+  EXPECT_TRUE(loaded.vertexes().at(1).neighbors.isMapped());
+  EXPECT_THAT(loaded.vertexes().at(2).incoming.size(), Eq(2));
+  EXPECT_THAT(loaded.path(0, 3), Eq(std::list<Id>{0, 2, 3}));
+}
+
+TEST(Snapshot, RemoveLoadedVertex) {
+  TempFile file{"snapshot_remove"};
+  Graph g;
+  for (int i = 0; i < 4; ++i) g.addVertex();
+  g.setEdge(0, 1, 1);
+  g.setEdge(1, 3, 1);
+  g.setEdge(0, 2, 2);
+  g.setEdge(2, 3, 2);
+  Snapshot::write(g, file.name);
+  Graph loaded;
+  Snapshot::read(file.name, loaded);
+
+  loaded.removeVertex(1);
+
+  EXPECT_THAT(loaded.vertexes().at(0).neighbors.size(), Eq(1));
+  EXPECT_THAT(loaded.vertexes().at(3).incoming.size(), Eq(1));
+  EXPECT_THAT(loaded.path(0, 3), Eq(std::list<Id>{0, 2, 3}));
+  Snapshot::write(loaded, file.name);
+  Graph again;
+  Snapshot::read(file.name, again);
+  EXPECT_THAT(again.distances(0).steps.at(3).distance, Eq(4));
+}
+
+TEST(Snapshot, CopyOfLoadedGraph) {
+  TempFile file{"snapshot_copy"};
+  Graph g;
+  for (int i = 0; i < 3; ++i) g.addVertex();
+  g.setEdge(0, 1, 1);
+  g.setEdge(1, 2, 1);
+  Snapshot::write(g, file.name);
+  Graph loaded;
+  Snapshot::read(file.name, loaded);
+
+  Graph copy{loaded};
+  loaded.removeEdge(1, 2);
+
+  EXPECT_TRUE(copy.vertexes().at(1).neighbors.isMapped());
+  EXPECT_THAT(copy.path(0, 2), Eq(std::list<Id>{0, 1, 2}));
+  EXPECT_THAT(loaded.path(0, 2), Eq(std::list<Id>{2}));
+}
+
+TEST(Snapshot, SharedGraphOfLoadedFile) {
+  TempFile file{"snapshot_shared"};
+  Graph g;
+  for (int i = 0; i < 3; ++i) g.addVertex();
+  g.setEdge(0, 1, 1);
+  g.setEdge(1, 2, 1);
+  Snapshot::write(g, file.name);
+  auto shared = std::make_shared<SharedGraph>();
+  shared->modify([&file](Graph& graph) { Snapshot::read(file.name, graph); });
+  Processor p{shared};
+
+  EXPECT_THAT(p.serve(R"({"action":"GetPath","from":0,"to":2})"),
+      Eq(R"({"ids":["0","1","2"],"version":"5"})"));
+  p.serve(R"({"action":"AddEdge","from":0,"to":2,"weight":1})");
+  EXPECT_THAT(p.serve(R"({"action":"GetPath","from":0,"to":2})"),
+      Eq(R"({"ids":["0","2"],"version":"6"})"));
+  p.serve(R"({"action":"RemoveVertex","id":0})");
+  EXPECT_THAT(p.serve(R"({"action":"GetPath","from":1,"to":2})"),
+      Eq(R"({"ids":["1","2"],"version":"7"})"));
+}
+
+TEST(Snapshot, InconsistentIncomingEdges) {
+  TempFile file{"snapshot_incoming"};
+  Graph g;
+  g.addVertex(); g.addVertex(); g.addVertex();
+  g.setEdge(0, 1, 1);
+  Snapshot::write(g, file.name);
+  std::string data;
+  {
+    std::ifstream in{file.name, std::ios::binary};
+    data.assign(std::istreambuf_iterator<char>{in}, {});
+  }
+  // the source of the only in edge is the second to last word
+  std::uint64_t const source = 2;
+  data.replace(data.size() - 16, sizeof(source),
+               reinterpret_cast<char const*>(&source), sizeof(source));
+  std::ofstream{file.name, std::ios::binary} << data;
+  Graph loaded;
+
+  EXPECT_THROW(Snapshot::read(file.name, loaded), std::runtime_error);
+}
+
+TEST(Snapshot, SaveDisabled) {
+  EXPECT_THAT(Processor{}.serve(R"({"action":"SaveSnapshot"})"),
+      Eq(R"({"error":"Snapshots are disabled"})"));
+}
+
+TEST(Snapshot, Save) {
+  TempFile file{"snapshot_save"};
+  auto shared = std::make_shared<SharedGraph>();
+  shared->setSnapshotFile(file.name);
+  Processor p{shared};
+  p.serve(R"({"action":"AddVertex"})");
+  p.serve(R"({"action":"AddVertex"})");
+  p.serve(R"({"action":"AddEdge","from":0,"to":1,"weight":2})");
+
+  EXPECT_THAT(p.serve(R"({"action":"SaveSnapshot"})"), Eq(R"({"version":"3"})"));
+  Graph loaded;
+  Snapshot::read(file.name, loaded);
+  EXPECT_THAT(loaded.distances(0).steps.at(1).distance, Eq(2));
+}
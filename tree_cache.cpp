@@ -0,0 +1,112 @@
+#include "tree_cache.h"
+
+bool Tree::isComplete() const {
+  return bound == std::numeric_limits<Distance>::infinity();
+}
+
+bool Tree::covers(Id to) const {
+  return isComplete() || steps.find(to) != end(steps);
+}
+
+std::list<Id> Tree::path(Id to) const {
+  std::list<Id> p{to};
+  auto it = steps.find(to);
+  while (it != end(steps) && it->second.previous != it->first) {
+    p.push_front(it->second.previous);
+    it = steps.find(it->second.previous);
+  }
+  return p;
+}
+
+std::size_t Tree::memory() const {
+  using Node = std::pair<Id const, Step>;
+  return sizeof(Tree)
+      + steps.size() * (sizeof(Node) + sizeof(void*))
+      + steps.bucket_count() * sizeof(void*);
+}
+
+std::shared_ptr<Tree const> TreeCache::find(Id source, Id target, std::size_t version) {
+  auto it = trees_.find(source);
+  if (it != end(trees_) && it->second.tree->version != version) {
+    // a newer tree is kept for queries of newer snapshots
+    if (it->second.tree->version < version) {
+      erase(source);
+      ++dropped_;
+    }
+    it = end(trees_);
+  }
+  if (it == end(trees_) || !it->second.tree->covers(target)) {
+    ++misses_;
+    return nullptr;
+  }
+  ++hits_;
+  order_.splice(begin(order_), order_, it->second.order);
+  return it->second.tree;
+}
+
+void TreeCache::put(Tree tree) {
+  insert(std::make_shared<Tree>(std::move(tree)));
+}
+
+std::vector<std::shared_ptr<Tree>> TreeCache::take(std::size_t version) {
+  std::vector<std::shared_ptr<Tree>> taken;
+  for (auto it = order_.rbegin(); it != order_.rend(); ++it) {
+    auto& tree = trees_.at(*it).tree;
+    if (tree->version == version) {
+      taken.push_back(std::move(tree));
+    } else {
+      ++dropped_;
+    }
+  }
+  clear();
+  return taken;
+}
+
+void TreeCache::restore(std::vector<std::shared_ptr<Tree>> trees) {
+  for (auto& tree: trees) {
+    if (tree) {
+      insert(std::move(tree));
+    } else {
+      ++dropped_;
+    }
+  }
+}
+
+void TreeCache::insert(std::shared_ptr<Tree> tree) {
+  auto it = trees_.find(tree->source);
+  if (it != end(trees_) && it->second.tree->version > tree->version) return;
+  erase(tree->source);
+  auto memory = tree->memory();
+  if (memory > budget_) return;
+  auto source = tree->source;
+  order_.push_front(source);
+  trees_.emplace(source, Entry{std::move(tree), memory, begin(order_)});
+  memory_ += memory;
+  evict();
+}
+
+void TreeCache::erase(Id source) {
+  auto it = trees_.find(source);
+  if (it == end(trees_)) return;
+  memory_ -= it->second.memory;
+  order_.erase(it->second.order);
+  trees_.erase(it);
+}
+
+void TreeCache::clear() {
+  trees_.clear();
+  order_.clear();
+  memory_ = 0;
+}
+
+void TreeCache::setBudget(std::size_t bytes) {
+  budget_ = bytes;
+  evict();
+}
+
+void TreeCache::evict() {
+  while (memory_ > budget_ && !order_.empty()) {
+    erase(order_.back());
+    ++evicted_;
+  }
+}
@@ -0,0 +1,201 @@
+#ifndef TREE_CACHE_H_
+#define TREE_CACHE_H_
+
+#include <cstddef>
+#include <limits>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "types.h"
+
+/**
+ * Shortest path tree from a source vertex.
+ * Only settled vertices are stored, so a tree of a search which stopped early
+ * takes memory proportional to the explored region.
+ * No vertex out of the tree is closer to the source than the bound,
+ * the bound of a complete tree is infinite.
+ */
+struct Tree {
+  struct Step {
+    Distance distance;
+    Id previous;  // the source refers to itself
+  };
+
+  Id source;
+  std::size_t version;
+  Distance bound;
+  std::unordered_map<Id, Step> steps;
+
+  /**
+   * Checks whether every reachable vertex is in the tree.
+   * @return true if the tree is complete.
+   */
+  bool isComplete() const;
+
+  /**
+   * Checks whether the tree can answer about the vertex.
+   * @param to - the vertex.
+   * @return true if the vertex is settled or the tree is complete.
+   */
+  bool covers(Id to) const;
+
+  /**
+   * Gets path from the source to the vertex.
+   * @param to - the vertex.
+   * @return list of the vertex by order.
+   */
+  std::list<Id> path(Id to) const;
+
+  /**
+   * Estimates memory which is used by the tree.
+   * @return number of bytes.
+   */
+  std::size_t memory() const;
+};
+
+/**
+ * Least recently used cache of shortest path trees keyed by source.
+ * Trees are shared, so a found one may be read while the cache changes.
+ * Every tree is tagged with version of the graph it was calculated on,
+ * a tree of other version is never returned.
+ */
+class TreeCache {
+public:
+  /**
+   * Default memory budget.
+   */
+  static constexpr std::size_t kBudget = 64 * 1024 * 1024;
+
+  /**
+   * Counters of the cache.
+   */
+  struct Statistics {
+    std::size_t trees;
+    std::size_t memory;
+    std::size_t hits;
+    std::size_t misses;
+    std::size_t dropped;  // trees which could not be kept after a change of the graph
+    std::size_t evicted;  // trees which did not fit the budget
+  };
+
+  explicit TreeCache(std::size_t budget = kBudget): budget_{budget} {}
+
+  /**
+   * Gets tree of the source which is able to answer about the target.
+   * A tree of an older version is dropped, a newer one is kept.
+   * @param source - the source vertex.
+   * @param target - the target vertex.
+   * @param version - the current version of the graph.
+   * @return the tree or nullptr if there is no suitable one, it stays valid
+   * after it is evicted.
+   */
+  std::shared_ptr<Tree const> find(Id source, Id target, std::size_t version);
+
+  /**
+   * Puts the tree, the one of the same source is replaced unless it is of
+   * a newer version, so a query of an old snapshot does not evict it.
+   * Least recently used trees are evicted to fit the budget.
+   * @param tree - the tree.
+   */
+  void put(Tree tree);
+
+  /**
+   * Updates every tree, memory is recalculated after it.
+   * @param update - function which takes Tree& and returns false
+   * if the tree cannot be kept anymore.
+   */
+  template <typename Update>
+  void update(Update update);
+
+  /**
+   * Takes the trees of the version out, so they are changed without holding
+   * the cache and put back by restore(). Trees of other versions are dropped.
+   * @param version - the version.
+   * @return the trees from the least recently used one, a tree may be still
+   * read by somebody who found it before.
+   */
+  std::vector<std::shared_ptr<Tree>> take(std::size_t version);
+
+  /**
+   * Puts back the taken trees like put() in the same order of use.
+   * @param trees - the trees, null ones could not be kept and are dropped.
+   */
+  void restore(std::vector<std::shared_ptr<Tree>> trees);
+
+  /**
+   * Removes tree of the source.
+   * @param source - the source vertex.
+   */
+  void erase(Id source);
+
+  /**
+   * Removes all trees.
+   */
+  void clear();
+
+  /**
+   * Sets memory budget and evicts trees which do not fit it.
+   * @param bytes - the budget.
+   */
+  void setBudget(std::size_t bytes);
+
+  std::size_t budget() const { return budget_; }
+  std::size_t memory() const { return memory_; }
+  std::size_t size() const { return trees_.size(); }
+  std::size_t hits() const { return hits_; }
+  std::size_t misses() const { return misses_; }
+  std::size_t dropped() const { return dropped_; }
+  std::size_t evicted() const { return evicted_; }
+
+  /**
+   * Gets all counters at once.
+   * @return the counters.
+   */
+  Statistics statistics() const {
+    return {size(), memory_, hits_, misses_, dropped_, evicted_};
+  }
+
+private:
+  using Order = std::list<Id>;
+  struct Entry {
+    std::shared_ptr<Tree> tree;
+    std::size_t memory;
+    Order::iterator order;
+  };
+  void insert(std::shared_ptr<Tree> tree);
+  void evict();
+  std::size_t budget_;
+  std::size_t memory_{0};
+  std::size_t hits_{0};
+  std::size_t misses_{0};
+  std::size_t dropped_{0};
+  std::size_t evicted_{0};
+  Order order_;
+  std::unordered_map<Id, Entry> trees_;
+};
+
+template <typename Update>
+void TreeCache::update(Update update) {
+  for (auto it = begin(trees_); it != end(trees_);) {
+    auto& entry = it->second;
+    memory_ -= entry.memory;
+    if (entry.tree.use_count() > 1) {
+      entry.tree = std::make_shared<Tree>(*entry.tree);  // somebody still reads it
+    }
+    if (update(*entry.tree)) {
+      entry.memory = entry.tree->memory();
+      memory_ += entry.memory;
+      ++it;
+    } else {
+      order_.erase(entry.order);
+      it = trees_.erase(it);
+      ++dropped_;
+    }
+  }
+  evict();
+}
+
+#endif /* TREE_CACHE_H_ */
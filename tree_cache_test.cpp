@@ -0,0 +1,191 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <limits>
+
+#include "tree_cache.h"
+
+using ::testing::Eq;
+using ::testing::IsNull;
+using ::testing::NotNull;
+using ::testing::ContainerEq;
+
+namespace {
+Tree chain(Id source, std::size_t version = 0) {
+  return {source, version, 2, {
+    {source, {0, source}},
+    {source + 1, {1, source}},
+    {source + 2, {2, source + 1}}
+  }};
+}
+}  // namespace
+
+TEST(TreeCache, TreePath) {
+  auto t = chain(0);
+
+  EXPECT_THAT(t.path(2), ContainerEq(std::list<Id>{0, 1, 2}));
+}
+
+TEST(TreeCache, TreePathToSource) {
+  auto t = chain(0);
+
+  EXPECT_THAT(t.path(0), ContainerEq(std::list<Id>{0}));
+}
+
+TEST(TreeCache, PartialTreeCoversSettled) {
+  auto t = chain(0);
+
+  EXPECT_THAT(t.covers(2), Eq(true));
+  EXPECT_THAT(t.covers(3), Eq(false));
+}
+
+TEST(TreeCache, CompleteTreeCoversAll) {
+  auto t = chain(0);
+  t.bound = std::numeric_limits<Distance>::infinity();
+
+  EXPECT_THAT(t.covers(3), Eq(true));
+  EXPECT_THAT(t.path(3), ContainerEq(std::list<Id>{3}));
+}
+
+TEST(TreeCache, Hit) {
+  TreeCache c;
+  c.put(chain(0));
+
+  EXPECT_THAT(c.find(0, 2, 0), NotNull());
+  EXPECT_THAT(c.hits(), Eq(1));
+  EXPECT_THAT(c.misses(), Eq(0));
+}
+
+TEST(TreeCache, MissUnknownSource) {
+  TreeCache c;
+  c.put(chain(0));
+
+  EXPECT_THAT(c.find(5, 6, 0), IsNull());
+  EXPECT_THAT(c.misses(), Eq(1));
+}
+
+TEST(TreeCache, MissNotCoveredTarget) {
+  TreeCache c;
+  c.put(chain(0));
+
+  EXPECT_THAT(c.find(0, 7, 0), IsNull());
+  EXPECT_THAT(c.size(), Eq(1));
+}
+
+TEST(TreeCache, DropOtherVersion) {
+  TreeCache c;
+  c.put(chain(0, 1));
+
+  EXPECT_THAT(c.find(0, 2, 2), IsNull());
+  EXPECT_THAT(c.size(), Eq(0));
+  EXPECT_THAT(c.memory(), Eq(0));
+  EXPECT_THAT(c.dropped(), Eq(1));
+}
+
+TEST(TreeCache, KeepNewerVersion) {
+  TreeCache c;
+  c.put(chain(0, 2));
+
+  EXPECT_THAT(c.find(0, 2, 1), IsNull());
+  EXPECT_THAT(c.find(0, 2, 2), NotNull());
+  EXPECT_THAT(c.dropped(), Eq(0));
+}
+
+TEST(TreeCache, OlderTreeDoesNotReplaceNewer) {
+  TreeCache c;
+  c.put(chain(0, 2));
+  auto t = chain(0, 1);
+  t.bound = std::numeric_limits<Distance>::infinity();
+
+  c.put(t);
+
+  EXPECT_THAT(c.find(0, 2, 2), NotNull());
+  EXPECT_THAT(c.find(0, 9, 1), IsNull());
+}
+
+TEST(TreeCache, ReplaceTreeOfSameSource) {
+  TreeCache c;
+  c.put(chain(0));
+  auto t = chain(0);
+  t.bound = std::numeric_limits<Distance>::infinity();
+
+  c.put(t);
+
+  EXPECT_THAT(c.size(), Eq(1));
+  EXPECT_THAT(c.find(0, 9, 0), NotNull());
+}
+
+TEST(TreeCache, EvictLeastRecentlyUsed) {
+  TreeCache c{2 * chain(0).memory()};
+  c.put(chain(0));
+  c.put(chain(10));
+  c.find(0, 1, 0);
+
+  c.put(chain(20));
+
+  EXPECT_THAT(c.size(), Eq(2));
+  EXPECT_THAT(c.evicted(), Eq(1));
+  EXPECT_THAT(c.find(10, 11, 0), IsNull());
+  EXPECT_THAT(c.find(0, 1, 0), NotNull());
+  EXPECT_THAT(c.find(20, 21, 0), NotNull());
+}
+
+TEST(TreeCache, SkipTreeOverBudget) {
+  TreeCache c{1};
+
+  c.put(chain(0));
+
+  EXPECT_THAT(c.size(), Eq(0));
+}
+
+TEST(TreeCache, ShrinkBudget) {
+  TreeCache c;
+  c.put(chain(0));
+  c.put(chain(10));
+
+  c.setBudget(chain(0).memory());
+
+  EXPECT_THAT(c.size(), Eq(1));
+  EXPECT_THAT(c.find(10, 11, 0), NotNull());
+}
+
+TEST(TreeCache, UpdateTrees) {
+  TreeCache c;
+  c.put(chain(0));
+  c.put(chain(10));
+
+  c.update([](Tree& t) { ++t.version; return t.source == 0; });
+
+  EXPECT_THAT(c.size(), Eq(1));
+  EXPECT_THAT(c.memory(), Eq(chain(0).memory()));
+  EXPECT_THAT(c.find(0, 1, 1), NotNull());
+}
+
+TEST(TreeCache, TakeAndRestoreTrees) {
+  TreeCache c;
+  c.put(chain(0, 1));
+  c.put(chain(10, 0));
+  c.put(chain(20, 1));
+  c.put(chain(30, 1));
+  c.find(0, 1, 1);
+
+  auto trees = c.take(1);
+
+  EXPECT_THAT(c.size(), Eq(0));
+  EXPECT_THAT(c.memory(), Eq(0));
+  EXPECT_THAT(c.dropped(), Eq(1));
+  ASSERT_THAT(trees.size(), Eq(3));
+  EXPECT_THAT(trees[0]->source, Eq(20));
+  EXPECT_THAT(trees[2]->source, Eq(0));
+
+  for (auto& t: trees) ++t->version;
+  trees[1].reset();
+  c.put(chain(0, 1));
+  c.restore(std::move(trees));
+
+  EXPECT_THAT(c.size(), Eq(2));
+  EXPECT_THAT(c.dropped(), Eq(2));
+  EXPECT_THAT(c.find(0, 1, 2), NotNull());
+  EXPECT_THAT(c.find(20, 21, 2), NotNull());
+  EXPECT_THAT(c.find(30, 31, 2), IsNull());
+}
@@ -0,0 +1,7 @@
+#ifndef TYPES_H_
+#define TYPES_H_
+
+using Id = long long unsigned int;
+using Distance = double;
+
+#endif /* TYPES_H_ */
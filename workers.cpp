@@ -0,0 +1,48 @@
+#include "workers.h"
+
+#include <algorithm>
+
+Workers::Workers(std::size_t count) {
+  count = std::max<std::size_t>(count, 1);
+  threads_.reserve(count - 1);
+  for (std::size_t i = 1; i < count; ++i) {
+    threads_.emplace_back(&Workers::loop, this, i);
+  }
+}
+
+Workers::~Workers() {
+  {
+    std::lock_guard<std::mutex> lock{mutex_};
+    stop_ = true;
+  }
+  start_.notify_all();
+  for (auto& t: threads_) t.join();
+}
+
+void Workers::run(Task const& task) {
+  {
+    std::lock_guard<std::mutex> lock{mutex_};
+    task_ = &task;
+    running_ = threads_.size();
+    ++epoch_;
+  }
+  start_.notify_all();
+  task(0);
+  std::unique_lock<std::mutex> lock{mutex_};
+  finish_.wait(lock, [this] { return running_ == 0; });
+}
+
+void Workers::loop(std::size_t index) {
+  std::size_t seen = 0;
+  std::unique_lock<std::mutex> lock{mutex_};
+  for (;;) {
+    start_.wait(lock, [this, seen] { return stop_ || epoch_ != seen; });
+    if (stop_) return;
+    seen = epoch_;
+    auto task = task_;
+    lock.unlock();
+    (*task)(index);
+    lock.lock();
+    if (--running_ == 0) finish_.notify_one();
+  }
+}
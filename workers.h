@@ -0,0 +1,55 @@
+#ifndef WORKERS_H_
+#define WORKERS_H_
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Fixed team of threads which run the same task together.
+ * It is made for phases of a parallel algorithm: every call of run()
+ * is a fork and join, the calling thread takes part as the first worker.
+ */
+class Workers {
+public:
+  using Task = std::function<void(std::size_t)>;
+
+  /**
+   * Starts the threads.
+   * @param count - number of workers including the calling thread.
+   */
+  explicit Workers(std::size_t count);
+  ~Workers();
+
+  Workers(Workers const&) = delete;
+  Workers& operator=(Workers const&) = delete;
+
+  /**
+   * Gets number of workers.
+   * @return the number of workers including the calling thread.
+   */
+  std::size_t size() const { return threads_.size() + 1; }
+
+  /**
+   * Runs the task on every worker and waits until all of them finish it.
+   * @param task - function which takes index of the worker.
+   */
+  void run(Task const& task);
+
+private:
+  void loop(std::size_t index);
+
+  std::vector<std::thread> threads_;
+  std::mutex mutex_;
+  std::condition_variable start_;
+  std::condition_variable finish_;
+  Task const* task_{nullptr};
+  std::size_t epoch_{0};
+  std::size_t running_{0};
+  bool stop_{false};
+};
+
+#endif /* WORKERS_H_ */
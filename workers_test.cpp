@@ -0,0 +1,41 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <atomic>
+#include <vector>
+
+#include "workers.h"
+
+using ::testing::Eq;
+using ::testing::Each;
+
+TEST(Workers, Size) {
+  Workers w{3};
+
+  EXPECT_THAT(w.size(), Eq(3));
+}
+
+TEST(Workers, AtLeastOne) {
+  Workers w{0};
+
+  EXPECT_THAT(w.size(), Eq(1));
+}
+
+TEST(Workers, RunOnEvery) {
+  Workers w{4};
+  std::vector<int> calls(4, 0);
+
+  w.run([&calls](std::size_t i) { ++calls[i]; });
+
+  EXPECT_THAT(calls, Each(Eq(1)));
+}
+
+TEST(Workers, WaitForAll) {
+  Workers w{4};
+  std::atomic<int> sum{0};
+
+  for (auto i = 0; i < 100; ++i) {
+    w.run([&sum](std::size_t) { ++sum; });
+    ASSERT_THAT(sum.load(), Eq(4 * (i + 1)));
+  }
+}